@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Set of the addresses and the domains, built from a text file into a
+ * file mapped by mmap(2) read only, so the pages are shared among the
+ * processes.  The file is the header, a Bloom filter, the entries sorted
+ * by the hash and the strings.  A query is checked by the Bloom filter
+ * first, then by the binary search and the comparison of the string.
+ *
+ * A line of the text file is an address ("user@example.com") or a domain
+ * ("example.com"), a domain matches the addresses and the hosts in the
+ * domain and its subdomains.
+ */
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "addrset.h"
+
+#define	ADDRSET_MAGIC		"MFADDRS1"
+#define	ADDRSET_VERSION		1
+#define	ADDRSET_BLOOMBITS	16	/* per entry */
+#define	ADDRSET_BLOOMK		4	/* bits per key */
+#define	ADDRSET_MAXLEN		320	/* of an entry or a query */
+
+#define	FNV1A_INIT		14695981039346656037ULL
+#define	FNV1A(_h, _c)		(((_h) ^ (u_char)(_c)) * 1099511628211ULL)
+
+struct addrset_hdr {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 nents;
+	uint64_t	 nbits;		/* of the Bloom filter, power of 2 */
+	uint64_t	 strsiz;
+};
+
+struct addrset_ent {
+	uint64_t	 hash;
+	uint32_t	 off;		/* in the strings */
+	uint32_t	 len;
+};
+
+struct addrset {
+	void			*map;
+	size_t			 mapsiz;
+	struct addrset_hdr	*hdr;
+	const uint64_t		*bloom;
+	const struct addrset_ent
+				*ents;
+	const char		*strs;
+};
+
+static bool	 addrset_lookup(struct addrset *, const char *, size_t,
+		    const char **, size_t *);
+static uint64_t	 addrset_hash(const char *, size_t);
+static int	 addrset_ent_cmp(const void *, const void *);
+
+/* strings for addrset_ent_cmp(), qsort(3) doesn't pass the context */
+static const char	*addrset_build_strs;
+
+/*
+ * Build the set from the text file `src' into `dst'.  The file is written
+ * into a temporary file and renamed, the readers never see a partial file.
+ */
+int
+addrset_build(const char *src, const char *dst)
+{
+	FILE			*fp = NULL, *out = NULL;
+	struct addrset_hdr	 hdr;
+	struct addrset_ent	*ents = NULL, *nents;
+	uint64_t		*bloom = NULL, h2, bit;
+	char			*line = NULL, *strs = NULL, *nstrs, *sp, *ep;
+	char			 tmp[PATH_MAX];
+	size_t			 linesiz = 0, n = 0, entsiz = 0, strsiz = 0;
+	size_t			 strlen0 = 0, i, m, len;
+	int			 fd = -1, k, saved_errno;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", dst) >= (int)sizeof(tmp)) {
+		errno = ENAMETOOLONG;
+		return (-1);
+	}
+	if ((fp = fopen(src, "r")) == NULL)
+		return (-1);
+	while (getline(&line, &linesiz, fp) != -1) {
+		/* trim, ignore the comments and the leading "@" or "." */
+		if ((ep = strchr(line, '#')) == NULL)
+			ep = line + strlen(line);
+		for (sp = line; sp < ep && isspace((u_char)*sp); sp++)
+			;
+		while (ep > sp && isspace((u_char)ep[-1]))
+			ep--;
+		while (sp < ep && (*sp == '@' || *sp == '.'))
+			sp++;
+		if (sp == ep)
+			continue;
+		if ((len = ep - sp) > ADDRSET_MAXLEN) {
+			errno = ENAMETOOLONG;
+			goto fail;
+		}
+		if (n >= entsiz) {
+			if ((nents = reallocarray(ents, (entsiz == 0)? 1024 :
+			    entsiz * 2, sizeof(struct addrset_ent))) == NULL)
+				goto fail;
+			ents = nents;
+			entsiz = (entsiz == 0)? 1024 : entsiz * 2;
+		}
+		if (strlen0 + len > strsiz) {
+			if ((nstrs = realloc(strs, (strsiz == 0)? 65536 :
+			    strsiz * 2)) == NULL)
+				goto fail;
+			strs = nstrs;
+			strsiz = (strsiz == 0)? 65536 : strsiz * 2;
+		}
+		for (i = 0; i < len; i++)
+			strs[strlen0 + i] = tolower((u_char)sp[i]);
+		if (strlen0 > UINT32_MAX - len || n >= UINT32_MAX) {
+			errno = EFBIG;
+			goto fail;
+		}
+		ents[n].hash = addrset_hash(strs + strlen0, len);
+		ents[n].off = strlen0;
+		ents[n++].len = len;
+		strlen0 += len;
+	}
+	if (ferror(fp))
+		goto fail;
+	fclose(fp);
+	fp = NULL;
+
+	/* sort and remove the duplicates */
+	addrset_build_strs = strs;
+	if (n > 0)
+		qsort(ents, n, sizeof(struct addrset_ent), addrset_ent_cmp);
+	for (i = m = 0; i < n; i++) {
+		if (m == 0 || addrset_ent_cmp(&ents[m - 1], &ents[i]) != 0)
+			ents[m++] = ents[i];
+	}
+	n = m;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, ADDRSET_MAGIC, sizeof(hdr.magic));
+	hdr.version = ADDRSET_VERSION;
+	hdr.nents = n;
+	for (hdr.nbits = 64; hdr.nbits < (uint64_t)n * ADDRSET_BLOOMBITS;
+	    hdr.nbits *= 2)
+		;
+	hdr.strsiz = strlen0;
+	if ((bloom = calloc(hdr.nbits / 64, sizeof(uint64_t))) == NULL)
+		goto fail;
+	for (i = 0; i < n; i++) {
+		h2 = (ents[i].hash >> 32) | 1;
+		for (k = 0; k < ADDRSET_BLOOMK; k++) {
+			bit = (ents[i].hash + k * h2) & (hdr.nbits - 1);
+			bloom[bit / 64] |= 1ULL << (bit % 64);
+		}
+	}
+
+	if ((fd = mkstemp(tmp)) == -1)
+		goto fail;
+	if ((out = fdopen(fd, "w")) == NULL)
+		goto fail;
+	fd = -1;
+	if (fwrite(&hdr, sizeof(hdr), 1, out) != 1 ||
+	    fwrite(bloom, sizeof(uint64_t), hdr.nbits / 64, out) !=
+	    hdr.nbits / 64 ||
+	    (n > 0 && fwrite(ents, sizeof(struct addrset_ent), n, out) != n) ||
+	    (strlen0 > 0 && fwrite(strs, 1, strlen0, out) != strlen0) ||
+	    fflush(out) == EOF || fchmod(fileno(out), 0644) == -1)
+		goto fail;
+	fclose(out);
+	out = NULL;
+	if (rename(tmp, dst) == -1)
+		goto fail;
+	free(line);
+	free(ents);
+	free(strs);
+	free(bloom);
+
+	return (0);
+ fail:
+	saved_errno = errno;
+	if (fp != NULL)
+		fclose(fp);
+	if (out != NULL || fd >= 0) {
+		if (out != NULL)
+			fclose(out);
+		else
+			close(fd);
+		unlink(tmp);
+	}
+	free(line);
+	free(ents);
+	free(strs);
+	free(bloom);
+	errno = saved_errno;
+	return (-1);
+}
+
+struct addrset *
+addrset_open(const char *path)
+{
+	struct addrset	*self;
+	struct stat	 st;
+	int		 fd, saved_errno;
+	size_t		 siz;
+
+	if ((self = calloc(1, sizeof(struct addrset))) == NULL)
+		return (NULL);
+	self->map = MAP_FAILED;
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		goto fail;
+	if (fstat(fd, &st) == -1)
+		goto fail;
+	if ((size_t)st.st_size < sizeof(struct addrset_hdr)) {
+		errno = EINVAL;
+		goto fail;
+	}
+	self->mapsiz = st.st_size;
+	if ((self->map = mmap(NULL, self->mapsiz, PROT_READ, MAP_SHARED, fd,
+	    0)) == MAP_FAILED)
+		goto fail;
+	close(fd);
+	fd = -1;
+	self->hdr = self->map;
+	siz = sizeof(struct addrset_hdr) + self->hdr->nbits / 8 +
+	    (size_t)self->hdr->nents * sizeof(struct addrset_ent) +
+	    self->hdr->strsiz;
+	if (memcmp(self->hdr->magic, ADDRSET_MAGIC, sizeof(self->hdr->magic))
+	    != 0 || self->hdr->version != ADDRSET_VERSION ||
+	    self->hdr->nbits < 64 ||
+	    (self->hdr->nbits & (self->hdr->nbits - 1)) != 0 ||
+	    self->hdr->nbits / 8 > self->mapsiz ||
+	    self->hdr->strsiz > self->mapsiz || siz != self->mapsiz) {
+		errno = EINVAL;
+		goto fail;
+	}
+	self->bloom = (const uint64_t *)(self->hdr + 1);
+	self->ents = (const struct addrset_ent *)(self->bloom +
+	    self->hdr->nbits / 64);
+	self->strs = (const char *)(self->ents + self->hdr->nents);
+
+	return (self);
+ fail:
+	saved_errno = errno;
+	if (fd >= 0)
+		close(fd);
+	addrset_close(self);
+	errno = saved_errno;
+	return (NULL);
+}
+
+void
+addrset_close(struct addrset *self)
+{
+	if (self == NULL)
+		return;
+	if (self->map != MAP_FAILED)
+		munmap(self->map, self->mapsiz);
+	free(self);
+}
+
+size_t
+addrset_count(struct addrset *self)
+{
+	return (self->hdr->nents);
+}
+
+/*
+ * Match the address or the host name with the set.  An address matches
+ * the address itself or its domain, the domain matches itself or its
+ * parent domains.  Returns the entry matched, not terminated by NUL.
+ */
+const char *
+addrset_match(struct addrset *self, const char *query, size_t querylen,
+    size_t *lenp)
+{
+	char		 buf[ADDRSET_MAXLEN];
+	const char	*sp, *ep, *at, *entry;
+	size_t		 i, len;
+
+	/* "Name <user@example.com>" */
+	if ((sp = memchr(query, '<', querylen)) != NULL &&
+	    (ep = memchr(sp, '>', querylen - (sp - query))) != NULL) {
+		query = sp + 1;
+		querylen = ep - query;
+	}
+	for (sp = query, ep = query + querylen;
+	    sp < ep && isspace((u_char)*sp); sp++)
+		;
+	while (ep > sp && (isspace((u_char)ep[-1]) || ep[-1] == '.'))
+		ep--;
+	if ((len = ep - sp) == 0 || len > sizeof(buf))
+		return (NULL);
+	for (i = 0; i < len; i++)
+		buf[i] = tolower((u_char)sp[i]);
+
+	if ((at = memrchr(buf, '@', len)) != NULL) {
+		if (addrset_lookup(self, buf, len, &entry, lenp))
+			return (entry);
+		sp = at + 1;
+	} else
+		sp = buf;
+	/* the domain and the parents */
+	for (ep = buf + len; sp < ep; sp++) {
+		if (addrset_lookup(self, sp, ep - sp, &entry, lenp))
+			return (entry);
+		if ((sp = memchr(sp, '.', ep - sp)) == NULL)
+			break;
+	}
+
+	return (NULL);
+}
+
+bool
+addrset_lookup(struct addrset *self, const char *key, size_t keylen,
+    const char **entryp, size_t *lenp)
+{
+	const struct addrset_ent	*ent;
+	uint64_t			 hash, h2, bit;
+	size_t				 lo, hi, mid;
+	int				 k;
+
+	hash = addrset_hash(key, keylen);
+	h2 = (hash >> 32) | 1;
+	for (k = 0; k < ADDRSET_BLOOMK; k++) {
+		bit = (hash + k * h2) & (self->hdr->nbits - 1);
+		if ((self->bloom[bit / 64] & (1ULL << (bit % 64))) == 0)
+			return (false);
+	}
+	lo = 0;
+	hi = self->hdr->nents;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (self->ents[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (; lo < self->hdr->nents && self->ents[lo].hash == hash; lo++) {
+		ent = &self->ents[lo];
+		if (ent->len == keylen && (uint64_t)ent->off + ent->len <=
+		    self->hdr->strsiz &&
+		    memcmp(self->strs + ent->off, key, keylen) == 0) {
+			*entryp = self->strs + ent->off;
+			*lenp = ent->len;
+			return (true);
+		}
+	}
+
+	return (false);
+}
+
+uint64_t
+addrset_hash(const char *str, size_t len)
+{
+	uint64_t	 h = FNV1A_INIT;
+	size_t		 i;
+
+	for (i = 0; i < len; i++)
+		h = FNV1A(h, str[i]);
+	h ^= h >> 29;
+
+	return (h);
+}
+
+int
+addrset_ent_cmp(const void *a0, const void *b0)
+{
+	const struct addrset_ent	*a = a0, *b = b0;
+	int				 cmp;
+
+	if (a->hash != b->hash)
+		return ((a->hash < b->hash)? -1 : 1);
+	if (a->len != b->len)
+		return ((a->len < b->len)? -1 : 1);
+	if ((cmp = memcmp(addrset_build_strs + a->off,
+	    addrset_build_strs + b->off, a->len)) != 0)
+		return (cmp);
+
+	return (0);
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	ADDRSET_H
+#define	ADDRSET_H 1
+
+#include <stddef.h>
+
+struct addrset;
+
+int		 addrset_build(const char *, const char *);
+struct addrset	*addrset_open(const char *);
+void		 addrset_close(struct addrset *);
+size_t		 addrset_count(struct addrset *);
+const char	*addrset_match(struct addrset *, const char *, size_t,
+		    size_t *);
+
+#endif	/* !ADDRSET_H */
@@ -0,0 +1,545 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Bayesian spam classifier.  The tokens of a message are hashed into 64
+ * bits and counted in an open addressing hash table, the table is the
+ * token database file mapped by mapfile.c.  Scores are computed by Robinson's
+ * method combined by Fisher's chi-square.
+ */
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bayes.h"
+#include "mapfile.h"
+#include "utf8.h"
+
+#define	BAYES_MAGIC		"MFBAYES1"
+#define	BAYES_VERSION		1
+#define	BAYES_INITSLOTS		4096
+#define	BAYES_MAXTOKENS		65536	/* per message */
+#define	BAYES_WORDMIN		3	/* in characters */
+#define	BAYES_WORDMAX		40
+#define	BAYES_MAXCLUES		150
+#define	BAYES_MINDEV		0.1
+#define	BAYES_S			0.45	/* strength of the background */
+#define	BAYES_X			0.5	/* probability of unknown tokens */
+#define	BAYES_SIZE(_n)		(sizeof(struct bayes_hdr) +		\
+				    (size_t)(_n) * sizeof(struct bayes_slot))
+
+#define	MAXIMUM(_a,_b)	(((_a) > (_b))? (_a) : (_b))
+
+struct bayes_hdr {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 nslots;	/* power of 2 */
+	uint32_t	 nused;
+	uint32_t	 nspam;		/* number of messages trained */
+	uint32_t	 nham;
+	uint32_t	 obsolete;	/* replaced by a new file */
+};
+
+struct bayes_slot {
+	uint64_t	 token;		/* 0 if empty */
+	uint32_t	 spam;
+	uint32_t	 ham;
+};
+
+struct bayes {
+	struct mapfile		 mf;
+	struct bayes_hdr	*hdr;
+	struct bayes_slot	*slots;
+	uint64_t		*tokens;	/* of the current message */
+	int			 ntokens;
+	int			 tokensiz;
+	bool			 sorted;
+};
+
+static void	 bayes_init(void *, size_t, uint32_t);
+static int	 bayes_valid(const void *, size_t);
+static void	 bayes_attach(void *);
+static struct bayes_slot
+		*bayes_lookup(struct bayes *, uint64_t);
+static struct bayes_slot
+		*bayes_insert(struct bayes *, uint64_t);
+static int	 bayes_grow(struct bayes *);
+static void	 bayes_tokenize(struct bayes *, const char *, const u_char *,
+		    size_t);
+static void	 bayes_token(struct bayes *, const char *, const u_char *,
+		    size_t);
+static void	 bayes_uniq(struct bayes *);
+static bool	 is_cjk(uint32_t);
+static bool	 is_wordchar(uint32_t);
+static bool	 is_wordpunct(uint32_t);
+static double	 chi2q(double, int);
+static int	 uint64_compar(const void *, const void *);
+static int	 double_compar(const void *, const void *);
+
+/* headers not to be tokenized */
+static const char *bayes_skip_headers[] = {
+	"date", "message-id", "in-reply-to", "references", "content-length",
+	NULL
+};
+
+static const struct mapfile_ops bayes_ops = {
+	BAYES_MAGIC, BAYES_VERSION, offsetof(struct bayes_hdr, obsolete),
+	BAYES_INITSLOTS, BAYES_SIZE(BAYES_INITSLOTS),
+	bayes_init, bayes_valid, bayes_attach
+};
+
+/*
+ * Open the token database.  The file is created if it doesn't exist.
+ */
+struct bayes *
+bayes_open(const char *path)
+{
+	struct bayes	*self;
+
+	if ((self = calloc(1, sizeof(struct bayes))) == NULL)
+		return (NULL);
+	if (mapfile_open(&self->mf, path, &bayes_ops, self) == -1) {
+		free(self);
+		return (NULL);
+	}
+
+	return (self);
+}
+
+void
+bayes_close(struct bayes *self)
+{
+	if (self == NULL)
+		return;
+	mapfile_close(&self->mf);
+	free(self->tokens);
+	free(self);
+}
+
+/* start a message */
+void
+bayes_begin(struct bayes *self)
+{
+	self->ntokens = 0;
+	self->sorted = true;
+}
+
+void
+bayes_header(struct bayes *self, const char *hdr, const char *value)
+{
+	int	 i;
+
+	for (i = 0; bayes_skip_headers[i] != NULL; i++) {
+		if (strcmp(bayes_skip_headers[i], hdr) == 0)
+			return;
+	}
+	bayes_tokenize(self, hdr, (const u_char *)value, strlen(value));
+}
+
+void
+bayes_body(struct bayes *self, const char *line, size_t linelen)
+{
+	/* skip the lines of base64 or other encoded blobs */
+	if (linelen >= 60 && memchr(line, ' ', linelen) == NULL)
+		return;
+	bayes_tokenize(self, NULL, (const u_char *)line, linelen);
+}
+
+int
+bayes_ntokens(struct bayes *self)
+{
+	bayes_uniq(self);
+
+	return (self->ntokens);
+}
+
+/*
+ * Returns the spam probability of the current message, 0.0 for ham and 1.0
+ * for spam.  Returns 0.5 if the database doesn't have both of spam and ham.
+ */
+double
+bayes_score(struct bayes *self)
+{
+	struct bayes_slot	*slot;
+	double			*clues, p, f, s, h, pspam, pham;
+	int			 i, n = 0;
+
+	if (mapfile_refresh(&self->mf) == -1)
+		return (0.5);
+	if (self->hdr->nspam == 0 || self->hdr->nham == 0)
+		return (0.5);
+	bayes_uniq(self);
+	if ((clues = calloc(self->ntokens + 1, sizeof(double))) == NULL)
+		return (0.5);
+	for (i = 0; i < self->ntokens; i++) {
+		if ((slot = bayes_lookup(self, self->tokens[i])) == NULL)
+			continue;
+		pspam = (double)slot->spam / self->hdr->nspam;
+		pham = (double)slot->ham / self->hdr->nham;
+		p = pspam / (pspam + pham);
+		f = (BAYES_S * BAYES_X + (slot->spam + slot->ham) * p) /
+		    (BAYES_S + slot->spam + slot->ham);
+		if (fabs(f - 0.5) >= BAYES_MINDEV)
+			clues[n++] = f;
+	}
+	if (n == 0) {
+		free(clues);
+		return (0.5);
+	}
+	if (n > BAYES_MAXCLUES) {
+		/* use the most interesting ones */
+		qsort(clues, n, sizeof(double), double_compar);
+		n = BAYES_MAXCLUES;
+	}
+	s = h = 0.0;
+	for (i = 0; i < n; i++) {
+		s += log(1.0 - clues[i]);
+		h += log(clues[i]);
+	}
+	free(clues);
+	s = 1.0 - chi2q(-2.0 * s, 2 * n);
+	h = 1.0 - chi2q(-2.0 * h, 2 * n);
+
+	return ((s - h + 1.0) / 2.0);
+}
+
+/* train the current message as BAYES_SPAM or BAYES_HAM */
+int
+bayes_train(struct bayes *self, int class)
+{
+	struct bayes_slot	*slot;
+	int			 i;
+
+	bayes_uniq(self);
+	if (mapfile_lock(&self->mf) == -1)
+		return (-1);
+	for (i = 0; i < self->ntokens; i++) {
+		if ((slot = bayes_insert(self, self->tokens[i])) == NULL) {
+			mapfile_unlock(&self->mf);
+			return (-1);
+		}
+		if (class == BAYES_SPAM && slot->spam < UINT32_MAX)
+			slot->spam++;
+		else if (class == BAYES_HAM && slot->ham < UINT32_MAX)
+			slot->ham++;
+	}
+	if (class == BAYES_SPAM)
+		self->hdr->nspam++;
+	else
+		self->hdr->nham++;
+	msync(self->mf.map, self->mf.mapsiz, MS_ASYNC);
+	mapfile_unlock(&self->mf);
+
+	return (0);
+}
+
+/* number of the messages trained */
+void
+bayes_counts(struct bayes *self, uint32_t *nspam, uint32_t *nham)
+{
+	if (mapfile_refresh(&self->mf) == -1) {
+		*nspam = *nham = 0;
+		return;
+	}
+	*nspam = self->hdr->nspam;
+	*nham = self->hdr->nham;
+}
+
+/***********************************************************************
+ * Token database
+ ***********************************************************************/
+void
+bayes_init(void *map, size_t mapsiz, uint32_t nslots)
+{
+	struct bayes_hdr	*hdr = map;
+
+	hdr->nslots = nslots;
+}
+
+int
+bayes_valid(const void *map, size_t mapsiz)
+{
+	const struct bayes_hdr	*hdr = map;
+
+	if (mapsiz < sizeof(*hdr) || hdr->nslots == 0 ||
+	    (hdr->nslots & (hdr->nslots - 1)) != 0 ||
+	    mapsiz != BAYES_SIZE(hdr->nslots))
+		return (-1);
+
+	return (0);
+}
+
+void
+bayes_attach(void *ctx)
+{
+	struct bayes	*self = ctx;
+
+	self->hdr = self->mf.map;
+	self->slots = (struct bayes_slot *)(self->hdr + 1);
+}
+
+struct bayes_slot *
+bayes_lookup(struct bayes *self, uint64_t token)
+{
+	uint32_t	 i, mask = self->hdr->nslots - 1;
+
+	for (i = token & mask; self->slots[i].token != 0; i = (i + 1) & mask) {
+		if (self->slots[i].token == token)
+			return (&self->slots[i]);
+	}
+
+	return (NULL);
+}
+
+struct bayes_slot *
+bayes_insert(struct bayes *self, uint64_t token)
+{
+	uint32_t	 i, mask;
+
+	/* keep the load factor under 0.7 */
+	if ((uint64_t)(self->hdr->nused + 1) * 10 >
+	    (uint64_t)self->hdr->nslots * 7 && bayes_grow(self) == -1)
+		return (NULL);
+	mask = self->hdr->nslots - 1;
+	for (i = token & mask; self->slots[i].token != 0; i = (i + 1) & mask) {
+		if (self->slots[i].token == token)
+			return (&self->slots[i]);
+	}
+	self->slots[i].token = token;
+	self->hdr->nused++;
+
+	return (&self->slots[i]);
+}
+
+/*
+ * Rehash into a new file of the double size which replaces the database,
+ * so the database is never left half grown.  Must be called with the
+ * lock, the lock is taken over by the new file.
+ */
+int
+bayes_grow(struct bayes *self)
+{
+	struct bayes		 new;
+	struct bayes_slot	*slot;
+	uint32_t		 i, nslots;
+
+	if (self->hdr->nslots >= UINT32_MAX / 2) {
+		errno = ENOSPC;
+		return (-1);
+	}
+	nslots = self->hdr->nslots * 2;
+	if (mapfile_create(&self->mf, &new.mf, BAYES_SIZE(nslots), nslots,
+	    &new) == -1)
+		return (-1);
+	new.hdr->nspam = self->hdr->nspam;
+	new.hdr->nham = self->hdr->nham;
+	for (i = 0; i < self->hdr->nslots; i++) {
+		if (self->slots[i].token == 0)
+			continue;
+		slot = bayes_insert(&new, self->slots[i].token);
+		slot->spam = self->slots[i].spam;
+		slot->ham = self->slots[i].ham;
+	}
+	if (msync(new.mf.map, new.mf.mapsiz, MS_SYNC) == -1) {
+		mapfile_discard(&new.mf);
+		return (-1);
+	}
+
+	return (mapfile_replace(&self->mf, &new.mf));
+}
+
+/***********************************************************************
+ * Tokenizer
+ ***********************************************************************/
+/*
+ * Words are the runs of letters, digits and some punctuations, they are
+ * case folded.  CJK texts don't have spaces between words, they are split
+ * into bigrams.  Tokens of the headers are prefixed by the header name.
+ */
+void
+bayes_tokenize(struct bayes *self, const char *prefix, const u_char *text,
+    size_t len)
+{
+	u_char		 word[BAYES_WORDMAX * 4], cjk[8];
+	size_t		 i, wordlen = 0, cjklen = 0;
+	int		 n, nchars = 0, ncjk = 0, curlen;
+	uint32_t	 cp;
+
+	for (i = 0; i <= len; i += n) {
+		if (i == len) {
+			cp = ' ';
+			n = 1;
+		} else if ((n = utf8_decode(text + i, len - i, &cp)) <= 0) {
+			cp = ' ';
+			n = 1;
+		}
+		if (is_cjk(cp)) {
+			if (nchars > 0)
+				bayes_token(self, prefix, word, wordlen);
+			nchars = wordlen = 0;
+			/* `cjk' keeps the previous and the current char */
+			curlen = utf8_encode(cp, cjk + cjklen);
+			if (ncjk > 0) {
+				bayes_token(self, prefix, cjk,
+				    cjklen + curlen);
+				memmove(cjk, cjk + cjklen, curlen);
+			}
+			cjklen = curlen;
+			ncjk++;
+			continue;
+		}
+		if (ncjk == 1)
+			bayes_token(self, prefix, cjk, cjklen);
+		ncjk = cjklen = 0;
+		if (is_wordchar(cp) && !(nchars == 0 && is_wordpunct(cp))) {
+			if (++nchars <= BAYES_WORDMAX)
+				wordlen += utf8_encode(utf8_casefold(cp),
+				    word + wordlen);
+			continue;
+		}
+		while (nchars > 0 && nchars <= BAYES_WORDMAX &&
+		    is_wordpunct(word[wordlen - 1])) {
+			wordlen--;
+			nchars--;
+		}
+		if (BAYES_WORDMIN <= nchars && nchars <= BAYES_WORDMAX)
+			bayes_token(self, prefix, word, wordlen);
+		nchars = wordlen = 0;
+	}
+}
+
+void
+bayes_token(struct bayes *self, const char *prefix, const u_char *tok,
+    size_t toklen)
+{
+	uint64_t	 h = 14695981039346656037ULL;	/* FNV-1a */
+	uint64_t	*tokens;
+	size_t		 i;
+	int		 newsiz;
+
+	if (self->ntokens >= BAYES_MAXTOKENS)
+		return;
+	for (; prefix != NULL && *prefix != '\0'; prefix++)
+		h = (h ^ (u_char)*prefix) * 1099511628211ULL;
+	h = (h ^ ':') * 1099511628211ULL;
+	for (i = 0; i < toklen; i++)
+		h = (h ^ tok[i]) * 1099511628211ULL;
+	if (h == 0)
+		h = 1;
+
+	if (self->ntokens + 1 > self->tokensiz) {
+		newsiz = MAXIMUM(self->tokensiz * 2, 256);
+		if ((tokens = reallocarray(self->tokens, newsiz,
+		    sizeof(uint64_t))) == NULL)
+			return;
+		self->tokens = tokens;
+		self->tokensiz = newsiz;
+	}
+	self->tokens[self->ntokens++] = h;
+	self->sorted = false;
+}
+
+void
+bayes_uniq(struct bayes *self)
+{
+	int	 i, n;
+
+	if (self->sorted)
+		return;
+	qsort(self->tokens, self->ntokens, sizeof(uint64_t), uint64_compar);
+	for (i = n = 0; i < self->ntokens; i++) {
+		if (n == 0 || self->tokens[n - 1] != self->tokens[i])
+			self->tokens[n++] = self->tokens[i];
+	}
+	self->ntokens = n;
+	self->sorted = true;
+}
+
+/* Hiragana, Katakana, CJK ideographs and Hangul */
+bool
+is_cjk(uint32_t cp)
+{
+	return ((0x3040 <= cp && cp <= 0x30ff) ||
+	    (0x3400 <= cp && cp <= 0x4dbf) || (0x4e00 <= cp && cp <= 0x9fff) ||
+	    (0xac00 <= cp && cp <= 0xd7af) || (0xf900 <= cp && cp <= 0xfaff) ||
+	    (0xff66 <= cp && cp <= 0xff9f) || (0x20000 <= cp && cp <= 0x2fa1f));
+}
+
+bool
+is_wordchar(uint32_t cp)
+{
+	if (cp < 0x80)
+		return (('a' <= cp && cp <= 'z') || ('A' <= cp && cp <= 'Z') ||
+		    ('0' <= cp && cp <= '9') || cp == '$' || is_wordpunct(cp));
+	/* punctuations and symbols */
+	if (cp < 0xc0 || cp == 0xd7 || cp == 0xf7 ||
+	    (0x2000 <= cp && cp <= 0x2bff) || (0x3000 <= cp && cp <= 0x303f) ||
+	    (0xff00 <= cp && cp <= 0xff0f) || (0xff1a <= cp && cp <= 0xff20) ||
+	    (0xff3b <= cp && cp <= 0xff40) || (0xff5b <= cp && cp <= 0xff65) ||
+	    (0xfe30 <= cp && cp <= 0xfe4f) || cp == 0xfeff || cp == 0xfffd)
+		return (false);
+
+	return (true);
+}
+
+/* punctuations in words, not at the beginning or the end */
+bool
+is_wordpunct(uint32_t cp)
+{
+	return (cp == '\'' || cp == '-' || cp == '.' || cp == '_' ||
+	    cp == '@');
+}
+
+/* probability that chi-square with `v' (even) degrees exceeds `x2' */
+double
+chi2q(double x2, int v)
+{
+	double	 m, sum, term;
+	int	 i;
+
+	m = x2 / 2.0;
+	sum = term = exp(-m);
+	for (i = 1; i < v / 2; i++) {
+		term *= m / i;
+		sum += term;
+	}
+
+	return ((sum < 1.0)? sum : 1.0);
+}
+
+int
+uint64_compar(const void *a0, const void *b0)
+{
+	uint64_t	 a = *(const uint64_t *)a0, b = *(const uint64_t *)b0;
+
+	return ((a < b)? -1 : (a > b)? 1 : 0);
+}
+
+/* more distant from 0.5 first */
+int
+double_compar(const void *a0, const void *b0)
+{
+	double	 a = fabs(*(const double *)a0 - 0.5);
+	double	 b = fabs(*(const double *)b0 - 0.5);
+
+	return ((a > b)? -1 : (a < b)? 1 : 0);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	BAYES_H
+#define	BAYES_H 1
+
+#include <stdint.h>
+
+#define	BAYES_HAM		0
+#define	BAYES_SPAM		1
+
+struct bayes;
+
+struct bayes	*bayes_open(const char *);
+void		 bayes_close(struct bayes *);
+void		 bayes_begin(struct bayes *);
+void		 bayes_header(struct bayes *, const char *, const char *);
+void		 bayes_body(struct bayes *, const char *, size_t);
+int		 bayes_ntokens(struct bayes *);
+double		 bayes_score(struct bayes *);
+int		 bayes_train(struct bayes *, int);
+void		 bayes_counts(struct bayes *, uint32_t *, uint32_t *);
+
+#endif	/* !BAYES_H */
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * The text of the body.  The raw body lines are decoded by mime.c, the
+ * text is converted into UTF-8 by the charset of the part, the HTML parts
+ * are converted by html.c, and the text of the text parts is passed to the
+ * callback line by line, so the consumers of the raw lines can take it as
+ * is.  The other parts are skipped.
+ */
+#include <sys/types.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bodytext.h"
+#include "charset.h"
+#include "html.h"
+#include "mime.h"
+
+#define	BODYTEXT_LINESIZ	1024
+
+struct bodytext {
+	bodytext_on_line on_line;
+	void		*ctx;
+	struct mime	*mime;
+	struct html	*html;
+	int		 part;		/* index of the current part */
+	bool		 text;
+	bool		 ishtml;
+	bool		 conv;		/* charset conversion */
+	struct charset_conv
+			 charset;
+	char		 line[BODYTEXT_LINESIZ];
+	size_t		 linelen;
+};
+
+static void	 bodytext_on_data(void *, const struct mime_part *,
+		    const char *, size_t);
+static void	 bodytext_utf8(void *, const char *, size_t);
+static void	 bodytext_text(void *, const char *, size_t);
+static void	 bodytext_part_end(struct bodytext *);
+static void	 bodytext_line(struct bodytext *);
+
+struct bodytext *
+bodytext_new(bodytext_on_line on_line, void *ctx)
+{
+	struct bodytext	*self;
+
+	if ((self = calloc(1, sizeof(struct bodytext))) == NULL)
+		return (NULL);
+	self->on_line = on_line;
+	self->ctx = ctx;
+	if ((self->mime = mime_new(bodytext_on_data, self)) == NULL ||
+	    (self->html = html_new(bodytext_text, self)) == NULL) {
+		bodytext_free(self);
+		return (NULL);
+	}
+
+	return (self);
+}
+
+void
+bodytext_free(struct bodytext *self)
+{
+	if (self == NULL)
+		return;
+	if (self->conv)
+		charset_conv_end(&self->charset, NULL, NULL);
+	mime_free(self->mime);
+	html_free(self->html);
+	free(self);
+}
+
+void
+bodytext_begin(struct bodytext *self)
+{
+	/* the last message may have been aborted */
+	if (self->conv)
+		charset_conv_end(&self->charset, NULL, NULL);
+	mime_begin(self->mime);
+	html_reset(self->html);
+	self->part = 0;
+	self->text = self->ishtml = self->conv = false;
+	self->linelen = 0;
+}
+
+void
+bodytext_header(struct bodytext *self, const char *hdr, const char *value)
+{
+	mime_header(self->mime, hdr, value);
+}
+
+void
+bodytext_body(struct bodytext *self, const char *line, size_t linelen)
+{
+	mime_body(self->mime, line, linelen);
+}
+
+void
+bodytext_end(struct bodytext *self)
+{
+	mime_end(self->mime);
+	bodytext_part_end(self);
+}
+
+void
+bodytext_on_data(void *ctx, const struct mime_part *part, const char *data,
+    size_t len)
+{
+	struct bodytext	*self = ctx;
+
+	if (part->index != self->part) {
+		bodytext_part_end(self);
+		self->part = part->index;
+		self->text = (strncmp(part->type, "text/", 5) == 0);
+		self->ishtml = (strcmp(part->type, "text/html") == 0);
+		self->conv = (self->text &&
+		    charset_conv_init(&self->charset, part->charset) == 0);
+	}
+	if (!self->text)
+		return;
+	if (self->conv)
+		charset_conv(&self->charset, data, len, bodytext_utf8, self);
+	else
+		bodytext_utf8(self, data, len);
+}
+
+void
+bodytext_utf8(void *ctx, const char *text, size_t len)
+{
+	struct bodytext	*self = ctx;
+
+	if (self->ishtml)
+		html_text(self->html, text, len);
+	else
+		bodytext_text(self, text, len);
+}
+
+void
+bodytext_text(void *ctx, const char *text, size_t len)
+{
+	struct bodytext	*self = ctx;
+	const char	*lf;
+	size_t		 n;
+
+	while (len > 0) {
+		if ((lf = memchr(text, '\n', len)) != NULL)
+			n = lf - text;
+		else
+			n = len;
+		if (n > sizeof(self->line) - self->linelen)
+			n = sizeof(self->line) - self->linelen;
+		memcpy(self->line + self->linelen, text, n);
+		self->linelen += n;
+		text += n;
+		len -= n;
+		if (len > 0 && *text == '\n') {
+			text++;
+			len--;
+			bodytext_line(self);
+		} else if (self->linelen == sizeof(self->line))
+			bodytext_line(self);
+	}
+}
+
+void
+bodytext_part_end(struct bodytext *self)
+{
+	if (self->conv)
+		charset_conv_end(&self->charset, bodytext_utf8, self);
+	if (self->ishtml)
+		html_end(self->html);
+	if (self->linelen > 0)
+		bodytext_line(self);
+	self->text = self->ishtml = self->conv = false;
+}
+
+void
+bodytext_line(struct bodytext *self)
+{
+	char	*sp;
+	size_t	 n = self->linelen, len;
+
+	/* a long line is broken at a space if possible */
+	if (n == sizeof(self->line) &&
+	    (sp = memrchr(self->line, ' ', n)) != NULL && sp > self->line)
+		n = sp - self->line;
+	for (len = n; len > 0 && (self->line[len - 1] == '\r' ||
+	    self->line[len - 1] == ' '); len--)
+		;
+	self->on_line(self->ctx, self->line, len);
+	if (n < self->linelen && self->line[n] == ' ')
+		n++;
+	memmove(self->line, self->line + n, self->linelen - n);
+	self->linelen -= n;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	BODYTEXT_H
+#define	BODYTEXT_H 1
+
+#include <stddef.h>
+
+struct bodytext;
+
+typedef void	(*bodytext_on_line)(void *, const char *, size_t);
+
+struct bodytext	*bodytext_new(bodytext_on_line, void *);
+void		 bodytext_free(struct bodytext *);
+void		 bodytext_begin(struct bodytext *);
+void		 bodytext_header(struct bodytext *, const char *, const char *);
+void		 bodytext_body(struct bodytext *, const char *, size_t);
+void		 bodytext_end(struct bodytext *);
+
+#endif	/* !BODYTEXT_H */
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Charsets of MIME and the conversion into UTF-8.  The iconv handles are
+ * cached: charset_open() takes a handle from the cache and charset_close()
+ * puts it back, so a handle is never shared by the streams converted at
+ * the same time.
+ */
+#include <sys/types.h>
+
+#include <errno.h>
+#include <iconv.h>
+#include <string.h>
+#include <strings.h>
+
+#include "charset.h"
+
+#define	CHARSET_NCACHE		16
+
+static const struct {
+	const char	*mime;
+	const char	*iconv;
+} charset_names[] = {
+	{ "us-ascii",		"ASCII" },
+	{ "utf-8",		"UTF-8" },
+	{ "iso-8859-1",		"ISO-8859-1" },
+	{ "iso-8859-2",		"ISO-8859-2" },
+	{ "iso-8859-5",		"ISO-8859-5" },
+	{ "iso-8859-7",		"ISO-8859-7" },
+	{ "iso-8859-9",		"ISO-8859-9" },
+	{ "iso-8859-15",	"ISO-8859-15" },
+	{ "iso-2022-jp",	"ISO-2022-JP" },
+	{ "shift_jis",		"CP932" },
+	{ "shift-jis",		"CP932" },
+	{ "x-sjis",		"CP932" },
+	{ "windows-31j",	"CP932" },
+	{ "cp932",		"CP932" },
+	{ "euc-jp",		"EUC-JP" },
+	{ "x-euc-jp",		"EUC-JP" },
+	{ "gb2312",		"EUC-CN" },
+	{ "gbk",		"GBK" },
+	{ "gb18030",		"GB18030" },
+	{ "big5",		"BIG5" },
+	{ "euc-kr",		"EUC-KR" },
+	{ "ks_c_5601-1987",	"EUC-KR" },
+	{ "koi8-r",		"KOI8-R" },
+	{ "koi8-u",		"KOI8-U" },
+	{ "windows-1250",	"CP1250" },
+	{ "windows-1251",	"CP1251" },
+	{ "windows-1252",	"CP1252" },
+	{ "windows-1253",	"CP1253" },
+	{ "windows-1254",	"CP1254" },
+	{ "windows-1255",	"CP1255" },
+	{ "windows-1256",	"CP1256" },
+	{ "windows-1257",	"CP1257" },
+	{ "windows-1258",	"CP1258" }
+};
+
+static struct {
+	const char	*tocode;
+	const char	*fromcode;
+	iconv_t		 ic;
+} charset_cache[CHARSET_NCACHE];
+
+#define nitems(_x)	(sizeof((_x)) / sizeof((_x)[0]))
+
+/* returns the name for iconv of the MIME charset, or NULL if unknown */
+const char *
+charset_iconv(const char *name, size_t len)
+{
+	size_t	 i;
+
+	for (i = 0; i < nitems(charset_names); i++) {
+		if (strncasecmp(name, charset_names[i].mime, len) == 0 &&
+		    charset_names[i].mime[len] == '\0')
+			return (charset_names[i].iconv);
+	}
+
+	return (NULL);
+}
+
+/* the names are kept in the cache, they must be static */
+iconv_t
+charset_open(const char *tocode, const char *fromcode)
+{
+	iconv_t	 ic;
+	int	 i;
+
+	for (i = 0; i < CHARSET_NCACHE; i++) {
+		if (charset_cache[i].tocode != NULL &&
+		    strcmp(charset_cache[i].tocode, tocode) == 0 &&
+		    strcmp(charset_cache[i].fromcode, fromcode) == 0) {
+			ic = charset_cache[i].ic;
+			charset_cache[i].tocode = NULL;
+			charset_cache[i].fromcode = NULL;
+			/* into the initial state */
+			iconv(ic, NULL, NULL, NULL, NULL);
+			return (ic);
+		}
+	}
+
+	return (iconv_open(tocode, fromcode));
+}
+
+void
+charset_close(iconv_t ic, const char *tocode, const char *fromcode)
+{
+	int	 i;
+
+	for (i = 0; i < CHARSET_NCACHE; i++) {
+		if (charset_cache[i].tocode == NULL) {
+			charset_cache[i].tocode = tocode;
+			charset_cache[i].fromcode = fromcode;
+			charset_cache[i].ic = ic;
+			return;
+		}
+	}
+	iconv_close(ic);
+}
+
+/*
+ * Prepare the conversion of the MIME charset into UTF-8.  Returns -1 if
+ * the text doesn't need the conversion or can't be converted.
+ */
+int
+charset_conv_init(struct charset_conv *conv, const char *charset)
+{
+	const char	*fromcode;
+
+	conv->ic = (iconv_t)-1;
+	conv->npending = 0;
+	if ((fromcode = charset_iconv(charset, strlen(charset))) == NULL ||
+	    strcmp(fromcode, "ASCII") == 0 || strcmp(fromcode, "UTF-8") == 0)
+		return (-1);
+	if ((conv->ic = charset_open("UTF-8", fromcode)) == (iconv_t)-1)
+		return (-1);
+	conv->fromcode = fromcode;
+
+	return (0);
+}
+
+/*
+ * Convert the text and pass the result to `on_text'.  A multibyte sequence
+ * at the end of the text is kept and completed by the next call.  Broken
+ * sequences are replaced with U+FFFD.
+ */
+void
+charset_conv(struct charset_conv *conv, const char *text, size_t len,
+    charset_on_text on_text, void *ctx)
+{
+	char		 buf[1024], *in, *out;
+	size_t		 insz, outsz;
+
+	/* complete the pending sequence byte by byte */
+	while (conv->npending > 0 && len > 0) {
+		conv->pending[conv->npending++] = *text++;
+		len--;
+		in = conv->pending;
+		insz = conv->npending;
+		out = buf;
+		outsz = sizeof(buf);
+		if (iconv(conv->ic, &in, &insz, &out, &outsz) != (size_t)-1)
+			conv->npending = 0;
+		else if (errno == EILSEQ ||
+		    conv->npending == sizeof(conv->pending)) {
+			memcpy(out, "\xef\xbf\xbd", 3);
+			out += 3;
+			conv->npending = 0;
+		} else {
+			memmove(conv->pending, in, insz);
+			conv->npending = insz;
+		}
+		if (out > buf)
+			on_text(ctx, buf, out - buf);
+	}
+
+	in = (char *)text;
+	insz = len;
+	while (insz > 0) {
+		out = buf;
+		outsz = sizeof(buf);
+		if (iconv(conv->ic, &in, &insz, &out, &outsz) == (size_t)-1) {
+			if (errno == EINVAL && insz < sizeof(conv->pending)) {
+				memcpy(conv->pending, in, insz);
+				conv->npending = insz;
+				insz = 0;
+			} else if (errno != E2BIG) {
+				if (outsz >= 3) {
+					memcpy(out, "\xef\xbf\xbd", 3);
+					out += 3;
+				}
+				in++;
+				insz--;
+			}
+		}
+		if (out > buf)
+			on_text(ctx, buf, out - buf);
+	}
+}
+
+/*
+ * The end of the text, the handle is put back to the cache.  The rest is
+ * discarded if `on_text' is NULL.
+ */
+void
+charset_conv_end(struct charset_conv *conv, charset_on_text on_text,
+    void *ctx)
+{
+	char		 buf[64], *out = buf;
+	size_t		 outsz = sizeof(buf);
+
+	if (conv->ic == (iconv_t)-1)
+		return;
+	if (conv->npending > 0) {
+		memcpy(out, "\xef\xbf\xbd", 3);
+		out += 3;
+		outsz -= 3;
+	}
+	iconv(conv->ic, NULL, NULL, &out, &outsz);
+	if (out > buf && on_text != NULL)
+		on_text(ctx, buf, out - buf);
+	charset_close(conv->ic, "UTF-8", conv->fromcode);
+	conv->ic = (iconv_t)-1;
+	conv->npending = 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	CHARSET_H
+#define	CHARSET_H 1
+
+#include <stddef.h>
+#include <iconv.h>
+
+struct charset_conv {
+	iconv_t		 ic;
+	const char	*fromcode;
+	char		 pending[16];	/* incomplete multibyte sequence */
+	size_t		 npending;
+};
+
+typedef void	(*charset_on_text)(void *, const char *, size_t);
+
+const char	*charset_iconv(const char *, size_t);
+iconv_t		 charset_open(const char *, const char *);
+void		 charset_close(iconv_t, const char *, const char *);
+int		 charset_conv_init(struct charset_conv *, const char *);
+void		 charset_conv(struct charset_conv *, const char *, size_t,
+		    charset_on_text, void *);
+void		 charset_conv_end(struct charset_conv *, charset_on_text,
+		    void *);
+
+#endif	/* !CHARSET_H */
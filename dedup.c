@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Set of the messages seen, to suppress the duplicates.  A message is
+ * keyed by the hash of the Message-ID, or of the body if it doesn't have
+ * one.  The file is the header, a Bloom filter and an open addressing hash
+ * table of the keys, mapped by mmap(2).  The Bloom filter is checked first,
+ * it's small enough to stay in the cache and rejects most of the new
+ * messages.  The file is mapped by mapfile.c, it's rebuilt into a new file
+ * when the table becomes full.
+ */
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dedup.h"
+#include "mapfile.h"
+
+#define	DEDUP_MAGIC		"MFDEDUP1"
+#define	DEDUP_VERSION		1
+#define	DEDUP_INITSLOTS		4096
+#define	DEDUP_BLOOMBITS		16	/* per slot */
+#define	DEDUP_BLOOMK		4	/* bits per key */
+#define	DEDUP_SIZE(_n)		(sizeof(struct dedup_hdr) + (size_t)(_n) * \
+				    (DEDUP_BLOOMBITS / 8 + sizeof(uint64_t)))
+
+#define	FNV1A_INIT		14695981039346656037ULL
+#define	FNV1A(_h, _c)		(((_h) ^ (u_char)(_c)) * 1099511628211ULL)
+
+struct dedup_hdr {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 nslots;	/* power of 2 */
+	uint32_t	 nused;
+	uint32_t	 obsolete;	/* replaced by a new file */
+};
+
+struct dedup {
+	struct mapfile		 mf;
+	struct dedup_hdr	*hdr;
+	uint64_t		*bloom;		/* nslots * DEDUP_BLOOMBITS */
+	uint64_t		*slots;		/* 0 if empty */
+	/* the message being read */
+	uint64_t		 msgid;
+	uint64_t		 bodyhash;
+	bool			 body;		/* has a body line */
+};
+
+static void	 dedup_init(void *, size_t, uint32_t);
+static int	 dedup_valid(const void *, size_t);
+static void	 dedup_attach(void *);
+static int	 dedup_rebuild(struct dedup *, uint32_t);
+static uint64_t	 dedup_key(struct dedup *);
+static bool	 dedup_get(struct dedup *, uint64_t);
+static int	 dedup_put(struct dedup *, uint64_t);
+static void	 dedup_bloom_set(struct dedup *, uint64_t);
+static uint64_t	 dedup_msgid(const char *);
+
+static const struct mapfile_ops dedup_ops = {
+	DEDUP_MAGIC, DEDUP_VERSION, offsetof(struct dedup_hdr, obsolete),
+	DEDUP_INITSLOTS, DEDUP_SIZE(DEDUP_INITSLOTS),
+	dedup_init, dedup_valid, dedup_attach
+};
+
+struct dedup *
+dedup_open(const char *path)
+{
+	struct dedup	*self;
+
+	if ((self = calloc(1, sizeof(struct dedup))) == NULL)
+		return (NULL);
+	if (mapfile_open(&self->mf, path, &dedup_ops, self) == -1) {
+		free(self);
+		return (NULL);
+	}
+
+	return (self);
+}
+
+void
+dedup_close(struct dedup *self)
+{
+	if (self == NULL)
+		return;
+	mapfile_close(&self->mf);
+	free(self);
+}
+
+/* start reading a message */
+void
+dedup_begin(struct dedup *self)
+{
+	self->msgid = 0;
+	self->bodyhash = FNV1A_INIT;
+	self->body = false;
+}
+
+void
+dedup_header(struct dedup *self, const char *hdr, const char *value)
+{
+	if (self->msgid == 0 && strcmp(hdr, "message-id") == 0)
+		self->msgid = dedup_msgid(value);
+}
+
+/* the body is hashed only if the message doesn't have a Message-ID */
+void
+dedup_body(struct dedup *self, const char *line, size_t linelen)
+{
+	size_t	 i;
+
+	if (self->msgid != 0)
+		return;
+	/* same with CRLF */
+	if (linelen > 0 && line[linelen - 1] == '\r')
+		linelen--;
+	for (i = 0; i < linelen; i++)
+		self->bodyhash = FNV1A(self->bodyhash, line[i]);
+	self->bodyhash = FNV1A(self->bodyhash, '\n');
+	self->body = true;
+}
+
+/* record the message read */
+int
+dedup_end(struct dedup *self)
+{
+	uint64_t	 key;
+	int		 ret;
+
+	if ((key = dedup_key(self)) == 0)
+		return (0);
+	if (mapfile_lock(&self->mf) == -1)
+		return (-1);
+	ret = dedup_put(self, key);
+	mapfile_unlock(&self->mf);
+
+	return (ret);
+}
+
+/*
+ * Returns 1 if the message read is recorded, 0 if not, or -1 if it
+ * doesn't have the key yet, the body is needed.
+ */
+int
+dedup_check(struct dedup *self)
+{
+	uint64_t	 key;
+
+	if ((key = dedup_key(self)) == 0)
+		return (-1);
+	if (mapfile_refresh(&self->mf) == -1)
+		return (0);
+
+	return (dedup_get(self, key)? 1 : 0);
+}
+
+void
+dedup_init(void *map, size_t mapsiz, uint32_t nslots)
+{
+	struct dedup_hdr	*hdr = map;
+
+	hdr->nslots = nslots;
+}
+
+int
+dedup_valid(const void *map, size_t mapsiz)
+{
+	const struct dedup_hdr	*hdr = map;
+
+	if (mapsiz < sizeof(*hdr) || hdr->nslots < 64 ||
+	    (hdr->nslots & (hdr->nslots - 1)) != 0 ||
+	    mapsiz != DEDUP_SIZE(hdr->nslots))
+		return (-1);
+
+	return (0);
+}
+
+void
+dedup_attach(void *ctx)
+{
+	struct dedup	*self = ctx;
+
+	self->hdr = self->mf.map;
+	self->bloom = (uint64_t *)(self->hdr + 1);
+	self->slots = self->bloom +
+	    (size_t)self->hdr->nslots * DEDUP_BLOOMBITS / 64;
+}
+
+/*
+ * Copy the keys into a new file which replaces the file.  Must be called
+ * with the lock, the lock is taken over by the new file.
+ */
+int
+dedup_rebuild(struct dedup *self, uint32_t nslots)
+{
+	struct dedup	 new;
+	uint32_t	 i, j, mask;
+
+	if (nslots == 0 || nslots > UINT32_MAX / 2) {
+		errno = ENOSPC;
+		return (-1);
+	}
+	if (mapfile_create(&self->mf, &new.mf, DEDUP_SIZE(nslots), nslots,
+	    &new) == -1)
+		return (-1);
+	mask = nslots - 1;
+	for (i = 0; i < self->hdr->nslots; i++) {
+		if (self->slots[i] == 0)
+			continue;
+		for (j = self->slots[i] & mask; new.slots[j] != 0;
+		    j = (j + 1) & mask)
+			;
+		new.slots[j] = self->slots[i];
+		dedup_bloom_set(&new, self->slots[i]);
+		new.hdr->nused++;
+	}
+
+	return (mapfile_replace(&self->mf, &new.mf));
+}
+
+/* returns 0 if the message doesn't have the key */
+uint64_t
+dedup_key(struct dedup *self)
+{
+	uint64_t	 key;
+
+	if (self->msgid != 0)
+		return (self->msgid);
+	if (!self->body)
+		return (0);
+	/* not to be same with a Message-ID */
+	key = FNV1A(self->bodyhash, '\0');
+	key ^= key >> 29;
+
+	return ((key == 0)? 1 : key);
+}
+
+bool
+dedup_get(struct dedup *self, uint64_t key)
+{
+	uint64_t	 h2 = (key >> 32) | 1, bit, nbits;
+	uint32_t	 i, mask = self->hdr->nslots - 1;
+	int		 k;
+
+	nbits = (uint64_t)self->hdr->nslots * DEDUP_BLOOMBITS;
+	for (k = 0; k < DEDUP_BLOOMK; k++) {
+		bit = (key + k * h2) & (nbits - 1);
+		if ((self->bloom[bit / 64] & (1ULL << (bit % 64))) == 0)
+			return (false);
+	}
+	for (i = key & mask; self->slots[i] != 0; i = (i + 1) & mask) {
+		if (self->slots[i] == key)
+			return (true);
+	}
+
+	return (false);
+}
+
+int
+dedup_put(struct dedup *self, uint64_t key)
+{
+	uint32_t	 i, mask;
+
+	/* keep the load factor under 0.7 */
+	if ((uint64_t)(self->hdr->nused + 1) * 10 >
+	    (uint64_t)self->hdr->nslots * 7 &&
+	    dedup_rebuild(self, self->hdr->nslots * 2) == -1)
+		return (-1);
+
+	mask = self->hdr->nslots - 1;
+	for (i = key & mask; self->slots[i] != 0; i = (i + 1) & mask) {
+		if (self->slots[i] == key)
+			return (0);
+	}
+	/* the slot first, the lookups don't lock */
+	self->slots[i] = key;
+	dedup_bloom_set(self, key);
+	self->hdr->nused++;
+
+	return (0);
+}
+
+void
+dedup_bloom_set(struct dedup *self, uint64_t key)
+{
+	uint64_t	 h2 = (key >> 32) | 1, bit, nbits;
+	int		 k;
+
+	nbits = (uint64_t)self->hdr->nslots * DEDUP_BLOOMBITS;
+	for (k = 0; k < DEDUP_BLOOMK; k++) {
+		bit = (key + k * h2) & (nbits - 1);
+		self->bloom[bit / 64] |= 1ULL << (bit % 64);
+	}
+}
+
+/*
+ * Hash the Message-ID.  The angle brackets, the text around them and the
+ * spaces are removed, the domain part is case insensitive.
+ */
+uint64_t
+dedup_msgid(const char *value)
+{
+	const char	*sp, *ep;
+	uint64_t	 h = FNV1A_INIT;
+	bool		 domain = false;
+	u_char		 c;
+
+	if ((sp = strchr(value, '<')) != NULL) {
+		sp++;
+		if ((ep = strchr(sp, '>')) == NULL)
+			ep = sp + strlen(sp);
+	} else {
+		sp = value;
+		ep = sp + strlen(sp);
+	}
+	for (; sp < ep; sp++) {
+		c = *sp;
+		if (isspace(c))
+			continue;
+		if (c == '@')
+			domain = true;
+		else if (domain)
+			c = tolower(c);
+		h = FNV1A(h, c);
+	}
+	if (h == FNV1A_INIT)
+		return (0);	/* empty */
+	h ^= h >> 29;
+
+	return ((h == 0)? 1 : h);
+}
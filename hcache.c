@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Cache of the message headers of a folder.  The entries are keyed by the
+ * sequence number and validated by the inode, the modification time and
+ * the size of the file, so a changed file is simply missed.  The file is
+ * the header, an open addressing hash table of the entries and the data
+ * area where the values are appended.  It's mapped by mapfile.c and
+ * rebuilt into a new file when the table or the data area is full.
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hcache.h"
+#include "mapfile.h"
+
+#define	HCACHE_MAGIC		"MFHCACH1"
+#define	HCACHE_VERSION		1
+#define	HCACHE_INITSLOTS	1024
+#define	HCACHE_INITDATA		(256 * 1024)
+#define	HCACHE_SIZE(_n, _d)	\
+	(sizeof(struct hcache_hdr) + \
+	(size_t)(_n) * sizeof(struct hcache_slot) + (_d))
+
+struct hcache_hdr {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 nslots;	/* power of 2 */
+	uint32_t	 nused;
+	uint32_t	 obsolete;	/* replaced by a new file */
+	uint64_t	 datasiz;	/* size of the data area */
+	uint64_t	 datalen;	/* used */
+	uint64_t	 datalive;	/* used by the live entries */
+};
+
+struct hcache_slot {
+	uint32_t	 seq;		/* 0 if empty */
+	uint32_t	 len;
+	uint64_t	 off;		/* in the data area */
+	uint64_t	 ino;
+	int64_t		 mtime;		/* in nanoseconds */
+	uint64_t	 size;
+};
+
+struct hcache {
+	struct mapfile		 mf;
+	struct hcache_hdr	*hdr;
+	struct hcache_slot	*slots;
+	char			*data;
+};
+
+static void	 hcache_init(void *, size_t, uint32_t);
+static int	 hcache_valid(const void *, size_t);
+static void	 hcache_attach(void *);
+static struct hcache_slot
+		*hcache_lookup(struct hcache *, uint32_t);
+static int	 hcache_rebuild(struct hcache *, uint32_t, uint64_t);
+static bool	 hcache_inbounds(struct hcache *, struct hcache_slot *);
+static uint32_t	 hcache_hash(uint32_t);
+static int64_t	 hcache_mtime(const struct stat *);
+
+static const struct mapfile_ops hcache_ops = {
+	HCACHE_MAGIC, HCACHE_VERSION, offsetof(struct hcache_hdr, obsolete),
+	HCACHE_INITSLOTS, HCACHE_SIZE(HCACHE_INITSLOTS, HCACHE_INITDATA),
+	hcache_init, hcache_valid, hcache_attach
+};
+
+struct hcache *
+hcache_open(const char *path)
+{
+	struct hcache	*self;
+
+	if ((self = calloc(1, sizeof(struct hcache))) == NULL)
+		return (NULL);
+	if (mapfile_open(&self->mf, path, &hcache_ops, self) == -1) {
+		free(self);
+		return (NULL);
+	}
+
+	return (self);
+}
+
+void
+hcache_close(struct hcache *self)
+{
+	if (self == NULL)
+		return;
+	mapfile_close(&self->mf);
+	free(self);
+}
+
+/*
+ * Lock the cache among the processes.  The cache is opened again if it was
+ * rebuilt by others.
+ */
+int
+hcache_lock(struct hcache *self)
+{
+	return (mapfile_lock(&self->mf));
+}
+
+void
+hcache_unlock(struct hcache *self)
+{
+	mapfile_unlock(&self->mf);
+}
+
+/*
+ * Returns the data of the entry if the file isn't changed.  A broken entry
+ * is missed too.
+ */
+const void *
+hcache_get(struct hcache *self, uint32_t seq, const struct stat *st,
+    size_t *lenp)
+{
+	struct hcache_slot	*slot;
+
+	if ((slot = hcache_lookup(self, seq)) == NULL ||
+	    slot->ino != (uint64_t)st->st_ino ||
+	    slot->mtime != hcache_mtime(st) ||
+	    slot->size != (uint64_t)st->st_size || !hcache_inbounds(self, slot))
+		return (NULL);
+	*lenp = slot->len;
+
+	return (self->data + slot->off);
+}
+
+int
+hcache_put(struct hcache *self, uint32_t seq, const struct stat *st,
+    const void *data, size_t len)
+{
+	struct hcache_slot	*slot;
+	uint32_t		 i, mask, nslots;
+	uint64_t		 datasiz;
+
+	if (seq == 0 || len > UINT32_MAX) {
+		errno = EINVAL;
+		return (-1);
+	}
+	/* keep the load factor under 0.7 and room for the data */
+	if ((uint64_t)(self->hdr->nused + 1) * 10 >
+	    (uint64_t)self->hdr->nslots * 7 ||
+	    self->hdr->datalen + len > self->hdr->datasiz) {
+		nslots = self->hdr->nslots;
+		if ((uint64_t)(self->hdr->nused + 1) * 10 >
+		    (uint64_t)nslots * 7)
+			nslots *= 2;
+		datasiz = self->hdr->datasiz;
+		while (self->hdr->datalive + len > datasiz / 2)
+			datasiz *= 2;
+		if (hcache_rebuild(self, nslots, datasiz) == -1)
+			return (-1);
+	}
+
+	mask = self->hdr->nslots - 1;
+	for (i = hcache_hash(seq) & mask; self->slots[i].seq != 0;
+	    i = (i + 1) & mask) {
+		if (self->slots[i].seq == seq)
+			break;
+	}
+	slot = &self->slots[i];
+	if (slot->seq == 0)
+		self->hdr->nused++;
+	else
+		self->hdr->datalive -= slot->len;
+	if (len > 0)
+		memcpy(self->data + self->hdr->datalen, data, len);
+	slot->seq = seq;
+	slot->len = len;
+	slot->off = self->hdr->datalen;
+	slot->ino = st->st_ino;
+	slot->mtime = hcache_mtime(st);
+	slot->size = st->st_size;
+	self->hdr->datalen += len;
+	self->hdr->datalive += len;
+
+	return (0);
+}
+
+void
+hcache_delete(struct hcache *self, uint32_t seq)
+{
+	struct hcache_slot	*slot;
+	uint32_t		 i, j, k, mask = self->hdr->nslots - 1;
+
+	if ((slot = hcache_lookup(self, seq)) == NULL)
+		return;
+	self->hdr->datalive -= slot->len;
+	self->hdr->nused--;
+	/* shift the following entries back, no tombstone is needed */
+	i = slot - self->slots;
+	for (j = (i + 1) & mask; self->slots[j].seq != 0; j = (j + 1) & mask) {
+		k = hcache_hash(self->slots[j].seq) & mask;
+		if ((i <= j)? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		self->slots[i] = self->slots[j];
+		i = j;
+	}
+	memset(&self->slots[i], 0, sizeof(self->slots[i]));
+}
+
+/* the data area takes the rest of the file */
+void
+hcache_init(void *map, size_t mapsiz, uint32_t nslots)
+{
+	struct hcache_hdr	*hdr = map;
+
+	hdr->nslots = nslots;
+	hdr->datasiz = mapsiz - HCACHE_SIZE(nslots, 0);
+}
+
+int
+hcache_valid(const void *map, size_t mapsiz)
+{
+	const struct hcache_hdr	*hdr = map;
+
+	if (mapsiz < sizeof(*hdr) || hdr->nslots == 0 ||
+	    (hdr->nslots & (hdr->nslots - 1)) != 0 ||
+	    mapsiz < HCACHE_SIZE(hdr->nslots, 0) ||
+	    mapsiz != HCACHE_SIZE(hdr->nslots, 0) + hdr->datasiz ||
+	    hdr->datalen > hdr->datasiz)
+		return (-1);
+
+	return (0);
+}
+
+void
+hcache_attach(void *ctx)
+{
+	struct hcache	*self = ctx;
+
+	self->hdr = self->mf.map;
+	self->slots = (struct hcache_slot *)(self->hdr + 1);
+	self->data = (char *)(self->slots + self->hdr->nslots);
+}
+
+struct hcache_slot *
+hcache_lookup(struct hcache *self, uint32_t seq)
+{
+	uint32_t	 i, mask = self->hdr->nslots - 1;
+
+	for (i = hcache_hash(seq) & mask; self->slots[i].seq != 0;
+	    i = (i + 1) & mask) {
+		if (self->slots[i].seq == seq)
+			return (&self->slots[i]);
+	}
+
+	return (NULL);
+}
+
+/*
+ * Copy the live entries into a new file which replaces the cache.  Must be
+ * called with the lock, the lock is taken over by the new file.
+ */
+int
+hcache_rebuild(struct hcache *self, uint32_t nslots, uint64_t datasiz)
+{
+	struct hcache		 new;
+	struct hcache_slot	*slot;
+	uint32_t		 i, j, mask;
+
+	if (nslots == 0 || nslots > UINT32_MAX / 2 ||
+	    datasiz > SIZE_MAX / 2) {
+		errno = ENOSPC;
+		return (-1);
+	}
+	if (mapfile_create(&self->mf, &new.mf, HCACHE_SIZE(nslots, datasiz),
+	    nslots, &new) == -1)
+		return (-1);
+	mask = nslots - 1;
+	for (i = 0; i < self->hdr->nslots; i++) {
+		if (self->slots[i].seq == 0 ||
+		    !hcache_inbounds(self, &self->slots[i]))
+			continue;
+		for (j = hcache_hash(self->slots[i].seq) & mask;
+		    new.slots[j].seq != 0; j = (j + 1) & mask)
+			;
+		slot = &new.slots[j];
+		*slot = self->slots[i];
+		slot->off = new.hdr->datalen;
+		if (slot->len > 0)
+			memcpy(new.data + slot->off,
+			    self->data + self->slots[i].off, slot->len);
+		new.hdr->datalen += slot->len;
+		new.hdr->nused++;
+	}
+	new.hdr->datalive = new.hdr->datalen;
+
+	return (mapfile_replace(&self->mf, &new.mf));
+}
+
+/* the data of the entry is in the data area */
+bool
+hcache_inbounds(struct hcache *self, struct hcache_slot *slot)
+{
+	return (slot->off <= self->hdr->datasiz &&
+	    slot->len <= self->hdr->datasiz - slot->off);
+}
+
+uint32_t
+hcache_hash(uint32_t seq)
+{
+	return (seq * 2654435761U);	/* Knuth's multiplicative hash */
+}
+
+int64_t
+hcache_mtime(const struct stat *st)
+{
+	return ((int64_t)st->st_mtim.tv_sec * 1000000000 +
+	    st->st_mtim.tv_nsec);
+}
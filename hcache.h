@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	HCACHE_H
+#define	HCACHE_H 1
+
+#include <sys/stat.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct hcache;
+
+struct hcache	*hcache_open(const char *);
+void		 hcache_close(struct hcache *);
+int		 hcache_lock(struct hcache *);
+void		 hcache_unlock(struct hcache *);
+const void	*hcache_get(struct hcache *, uint32_t, const struct stat *,
+		    size_t *);
+int		 hcache_put(struct hcache *, uint32_t, const struct stat *,
+		    const void *, size_t);
+void		 hcache_delete(struct hcache *, uint32_t);
+
+#endif	/* !HCACHE_H */
@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Streaming HTML to text converter.  The markup is given in chunks of any
+ * size and the visible text is passed to the callback: the tags, the
+ * comments, the scripts and the styles are removed, the entities are
+ * decoded into UTF-8 and the spaces are collapsed.  The block elements
+ * break the lines, the inline elements are removed without a space, so
+ * "fr<b></b>ee" becomes "free".
+ */
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "html.h"
+#include "utf8.h"
+
+#define	HTML_TEXT		0
+#define	HTML_TAGNAME		1	/* after '<' */
+#define	HTML_TAG		2	/* attributes */
+#define	HTML_TAGQUOTE		3	/* quoted attribute value */
+#define	HTML_MARKUP		4	/* "<!" or "<?" */
+#define	HTML_COMMENT		5	/* "<!--" */
+#define	HTML_ENTITY		6	/* after '&' */
+#define	HTML_RAWTEXT		7	/* in <script> or <style> */
+
+#define	HTML_NAMESIZ		16
+#define	HTML_ENTITYSIZ		12
+#define	HTML_OUTSIZ		512
+
+struct html {
+	html_on_text	 on_text;
+	void		*ctx;
+	int		 state;
+	char		 name[HTML_NAMESIZ];	/* tag name in lower case */
+	size_t		 namelen;
+	bool		 closing;
+	char		 quote;
+	char		 raw[HTML_NAMESIZ];	/* "script" or "style" */
+	size_t		 rawmatch;		/* of "</" raw */
+	int		 dashes;		/* "--" seen in the comment */
+	char		 entity[HTML_ENTITYSIZ];
+	size_t		 entitylen;
+	u_char		 seq[4];		/* UTF-8 sequence in the text */
+	size_t		 seqlen;
+	size_t		 seqneed;
+	char		 last;			/* the last output */
+	char		 out[HTML_OUTSIZ];
+	size_t		 outlen;
+};
+
+static const char *html_blocks[] = {
+	"address", "article", "blockquote", "br", "center", "dd", "div",
+	"dl", "dt", "footer", "form", "h1", "h2", "h3", "h4", "h5", "h6",
+	"header", "hr", "li", "ol", "p", "pre", "section", "table", "title",
+	"tr", "ul", NULL
+};
+
+static const struct {
+	const char	*name;
+	uint32_t	 cp;
+} html_entities[] = {
+	{ "amp",	'&' },
+	{ "apos",	'\'' },
+	{ "bull",	0x2022 },
+	{ "cent",	0xa2 },
+	{ "copy",	0xa9 },
+	{ "euro",	0x20ac },
+	{ "gt",		'>' },
+	{ "hellip",	0x2026 },
+	{ "laquo",	0xab },
+	{ "ldquo",	0x201c },
+	{ "lsquo",	0x2018 },
+	{ "lt",		'<' },
+	{ "mdash",	0x2014 },
+	{ "middot",	0xb7 },
+	{ "nbsp",	' ' },
+	{ "ndash",	0x2013 },
+	{ "pound",	0xa3 },
+	{ "quot",	'"' },
+	{ "raquo",	0xbb },
+	{ "rdquo",	0x201d },
+	{ "reg",	0xae },
+	{ "rsquo",	0x2019 },
+	{ "shy",	0 },
+	{ "trade",	0x2122 },
+	{ "yen",	0xa5 },
+	{ "zwj",	0 },
+	{ "zwnj",	0 },
+};
+
+/* U+00C0 to U+00FF */
+static const char *html_latin1[] = {
+	"Agrave", "Aacute", "Acirc", "Atilde", "Auml", "Aring", "AElig",
+	"Ccedil", "Egrave", "Eacute", "Ecirc", "Euml", "Igrave", "Iacute",
+	"Icirc", "Iuml", "ETH", "Ntilde", "Ograve", "Oacute", "Ocirc",
+	"Otilde", "Ouml", "times", "Oslash", "Ugrave", "Uacute", "Ucirc",
+	"Uuml", "Yacute", "THORN", "szlig", "agrave", "aacute", "acirc",
+	"atilde", "auml", "aring", "aelig", "ccedil", "egrave", "eacute",
+	"ecirc", "euml", "igrave", "iacute", "icirc", "iuml", "eth", "ntilde",
+	"ograve", "oacute", "ocirc", "otilde", "ouml", "divide", "oslash",
+	"ugrave", "uacute", "ucirc", "uuml", "yacute", "thorn", "yuml"
+};
+
+static void	 html_char(struct html *, int);
+static void	 html_tag(struct html *);
+static bool	 html_entity(struct html *);
+static bool	 html_utf8(struct html *, int);
+static bool	 html_invisible(uint32_t);
+static void	 html_emit(struct html *, const char *, size_t);
+static void	 html_space(struct html *, char);
+static void	 html_flush(struct html *);
+
+struct html *
+html_new(html_on_text on_text, void *ctx)
+{
+	struct html	*self;
+
+	if ((self = calloc(1, sizeof(struct html))) == NULL)
+		return (NULL);
+	self->on_text = on_text;
+	self->ctx = ctx;
+	html_reset(self);
+
+	return (self);
+}
+
+void
+html_free(struct html *self)
+{
+	free(self);
+}
+
+void
+html_reset(struct html *self)
+{
+	self->state = HTML_TEXT;
+	self->seqlen = 0;
+	self->outlen = 0;
+	self->last = '\n';
+}
+
+void
+html_text(struct html *self, const char *text, size_t len)
+{
+	size_t	 i;
+
+	for (i = 0; i < len; i++)
+		html_char(self, (u_char)text[i]);
+	html_flush(self);
+}
+
+void
+html_end(struct html *self)
+{
+	if (self->state == HTML_ENTITY && !html_entity(self)) {
+		html_emit(self, "&", 1);
+		html_emit(self, self->entity, self->entitylen);
+	}
+	/* broken at the end */
+	html_emit(self, (char *)self->seq, self->seqlen);
+	html_flush(self);
+	html_reset(self);
+}
+
+void
+html_char(struct html *self, int c)
+{
+	switch (self->state) {
+	case HTML_TEXT:
+		if (html_utf8(self, c))
+			break;
+		if (c == '<') {
+			self->state = HTML_TAGNAME;
+			self->namelen = 0;
+			self->closing = false;
+		} else if (c == '&') {
+			self->state = HTML_ENTITY;
+			self->entitylen = 0;
+		} else if (isspace(c))
+			html_space(self, ' ');
+		else {
+			self->out[self->outlen++] = c;
+			self->last = c;
+			if (self->outlen >= sizeof(self->out) - 8)
+				html_flush(self);
+		}
+		break;
+	case HTML_TAGNAME:
+		if (self->namelen == 0 && !self->closing) {
+			if (c == '/') {
+				self->closing = true;
+				break;
+			} else if (c == '!' || c == '?') {
+				self->state = HTML_MARKUP;
+				self->dashes = 0;
+				break;
+			} else if (!isalpha(c)) {
+				/* not a tag */
+				self->state = HTML_TEXT;
+				html_emit(self, "<", 1);
+				html_char(self, c);
+				break;
+			}
+		}
+		if (isalnum(c)) {
+			if (self->namelen + 1 < sizeof(self->name))
+				self->name[self->namelen++] = tolower(c);
+			break;
+		}
+		self->name[self->namelen] = '\0';
+		self->state = HTML_TAG;
+		html_char(self, c);
+		break;
+	case HTML_TAG:
+		if (c == '"' || c == '\'') {
+			self->state = HTML_TAGQUOTE;
+			self->quote = c;
+		} else if (c == '>')
+			html_tag(self);
+		break;
+	case HTML_TAGQUOTE:
+		if (c == self->quote)
+			self->state = HTML_TAG;
+		break;
+	case HTML_MARKUP:
+		/* "<!--" starts a comment, others end at '>' */
+		if (c == '-' && self->dashes >= 0) {
+			if (++self->dashes == 2) {
+				self->state = HTML_COMMENT;
+				self->dashes = 0;
+			}
+			break;
+		}
+		self->dashes = -1;
+		if (c == '>')
+			self->state = HTML_TEXT;
+		break;
+	case HTML_COMMENT:
+		if (c == '>' && self->dashes >= 2)
+			self->state = HTML_TEXT;
+		else if (c == '-')
+			self->dashes++;
+		else
+			self->dashes = 0;
+		break;
+	case HTML_ENTITY:
+		if ((isalnum(c) || (c == '#' && self->entitylen == 0)) &&
+		    self->entitylen + 1 < sizeof(self->entity)) {
+			self->entity[self->entitylen++] = c;
+			break;
+		}
+		self->state = HTML_TEXT;
+		if (html_entity(self)) {
+			if (c != ';')
+				html_char(self, c);
+			break;
+		}
+		html_emit(self, "&", 1);
+		html_emit(self, self->entity, self->entitylen);
+		html_char(self, c);
+		break;
+	case HTML_RAWTEXT:
+		/* until "</script" or "</style" */
+		if (self->rawmatch == 0) {
+			if (c == '<')
+				self->rawmatch = 1;
+		} else if (self->rawmatch == 1) {
+			self->rawmatch = (c == '/')? 2 : (c == '<')? 1 : 0;
+		} else if (self->raw[self->rawmatch - 2] == '\0') {
+			if (isalnum(c)) {
+				self->rawmatch = 0;
+				break;
+			}
+			strlcpy(self->name, self->raw, sizeof(self->name));
+			self->closing = true;
+			self->state = HTML_TAG;
+			html_char(self, c);
+		} else if (tolower(c) == self->raw[self->rawmatch - 2])
+			self->rawmatch++;
+		else
+			self->rawmatch = (c == '<')? 1 : 0;
+		break;
+	}
+}
+
+/* the end of the tag */
+void
+html_tag(struct html *self)
+{
+	int	 i;
+
+	self->state = HTML_TEXT;
+	if (!self->closing && (strcmp(self->name, "script") == 0 ||
+	    strcmp(self->name, "style") == 0)) {
+		strlcpy(self->raw, self->name, sizeof(self->raw));
+		self->rawmatch = 0;
+		self->state = HTML_RAWTEXT;
+		return;
+	}
+	if (strcmp(self->name, "td") == 0 || strcmp(self->name, "th") == 0) {
+		html_space(self, ' ');
+		return;
+	}
+	for (i = 0; html_blocks[i] != NULL; i++) {
+		if (strcmp(self->name, html_blocks[i]) == 0) {
+			html_space(self, '\n');
+			break;
+		}
+	}
+}
+
+/* decode the entity, returns false if it's unknown */
+bool
+html_entity(struct html *self)
+{
+	uint32_t	 cp = 0;
+	unsigned long	 ul;
+	size_t		 i;
+	u_char		 buf[4];
+	char		*ep;
+
+	self->entity[self->entitylen] = '\0';
+	if (self->entity[0] == '#') {
+		if (self->entity[1] == 'x' || self->entity[1] == 'X')
+			ul = strtoul(self->entity + 2, &ep, 16);
+		else
+			ul = strtoul(self->entity + 1, &ep, 10);
+		/* no surrogate, they aren't valid in UTF-8 */
+		if (ep == self->entity + 1 || ep == self->entity + 2 ||
+		    *ep != '\0' || ul > 0x10ffff ||
+		    (0xd800 <= ul && ul <= 0xdfff))
+			return (false);
+		cp = ul;
+	} else {
+		for (i = 0; i < sizeof(html_entities) /
+		    sizeof(html_entities[0]); i++) {
+			if (strcmp(self->entity, html_entities[i].name) == 0)
+				break;
+		}
+		if (i < sizeof(html_entities) / sizeof(html_entities[0]))
+			cp = html_entities[i].cp;
+		else {
+			for (i = 0; i < sizeof(html_latin1) /
+			    sizeof(html_latin1[0]); i++) {
+				if (strcmp(self->entity, html_latin1[i]) == 0)
+					break;
+			}
+			if (i >= sizeof(html_latin1) / sizeof(html_latin1[0]))
+				return (false);
+			cp = 0xc0 + i;
+		}
+	}
+
+	if (html_invisible(cp))
+		return (true);
+	if (cp == 0xa0 || cp == ' ' || cp == '\t' || cp == '\n' ||
+	    cp == '\r')
+		html_space(self, ' ');
+	else
+		html_emit(self, (char *)buf, utf8_encode(cp, buf));
+
+	return (true);
+}
+
+/*
+ * Collect a non-ASCII character in the text to remove the invisible ones,
+ * the sequence may be split into the chunks.  Returns false if `c' isn't a
+ * part of a sequence, the broken one is emitted as is.
+ */
+bool
+html_utf8(struct html *self, int c)
+{
+	uint32_t	 cp;
+
+	if (self->seqlen > 0 && (c & 0xc0) != 0x80) {
+		html_emit(self, (char *)self->seq, self->seqlen);
+		self->seqlen = 0;
+	}
+	if (self->seqlen == 0) {
+		if ((c & 0xe0) == 0xc0)
+			self->seqneed = 2;
+		else if ((c & 0xf0) == 0xe0)
+			self->seqneed = 3;
+		else if ((c & 0xf8) == 0xf0)
+			self->seqneed = 4;
+		else
+			return (false);
+	}
+	self->seq[self->seqlen++] = c;
+	if (self->seqlen < self->seqneed)
+		return (true);
+	if (utf8_decode(self->seq, self->seqlen, &cp) == -1 ||
+	    !html_invisible(cp))
+		html_emit(self, (char *)self->seq, self->seqlen);
+	self->seqlen = 0;
+
+	return (true);
+}
+
+/* the invisible ones which split the words */
+bool
+html_invisible(uint32_t cp)
+{
+	return (cp == 0 || cp == 0xad || (0x200b <= cp && cp <= 0x200d) ||
+	    cp == 0x2060 || cp == 0xfeff);
+}
+
+void
+html_emit(struct html *self, const char *str, size_t len)
+{
+	if (len == 0)
+		return;
+	if (self->outlen + len > sizeof(self->out))
+		html_flush(self);
+	memcpy(self->out + self->outlen, str, len);
+	self->outlen += len;
+	self->last = str[len - 1];
+}
+
+/* collapse the spaces, a line break overrides a space */
+void
+html_space(struct html *self, char c)
+{
+	if (self->last == '\n' || (self->last == ' ' && c == ' '))
+		return;
+	if (self->last == ' ' && self->outlen > 0)
+		self->outlen--;
+	html_emit(self, &c, 1);
+}
+
+void
+html_flush(struct html *self)
+{
+	if (self->outlen > 0)
+		self->on_text(self->ctx, self->out, self->outlen);
+	self->outlen = 0;
+}
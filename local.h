@@ -3,3 +3,10 @@ int	 rfc2047_decode(const char *, const char *, char *, size_t);
 
 /* from mailfilter.c */
 int	 luaopen_mailfilter(lua_State *);
+char	*mailfilter_stats_report(void);
+void	 mailfilter_stats_reset(void);
+void	 mailfilter_stats_timing(bool);
+
+/* from profile.c */
+int	 profile_start(lua_State *, int);
+char	*profile_stop(void);
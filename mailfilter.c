@@ -14,8 +14,11 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include <sys/types.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/queue.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #include <ctype.h>
 #include <dirent.h>
@@ -25,36 +28,119 @@
 #include <limits.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <lua.h>
 #include <lauxlib.h>
 #include <curl/curl.h>
 
+#include "addrset.h"
+#include "bayes.h"
+#include "bodytext.h"
 #include "bytebuf.h"
+#include "dedup.h"
+#include "hcache.h"
+#include "matcher.h"
+#include "mboxscan.h"
+#include "mime.h"
 #include "rfc5322.h"
+#include "rules.h"
+#include "simhash.h"
+#include "sniff.h"
+#include "threads.h"
+#include "tindex.h"
+#include "urlscan.h"
+#include "utf8.h"
 
 /* from rfc2047.c */
 int		 rfc2047_decode(const char *, const char *, char *, size_t);
 
 int		 luaopen_mailfilter(lua_State *);
+char		*mailfilter_stats_report(void);
+void		 mailfilter_stats_reset(void);
+void		 mailfilter_stats_timing(bool);
 static int	 pop3_metatable(lua_State *);
 static int	 l_pop3(lua_State *);
 static int	 l_mbox(lua_State *);
+static int	 l_maildir(lua_State *);
+static int	 l_thread_of(lua_State *);
+static struct threads
+		*thread_index_open(lua_State *, bool);
+static void	 thread_index_attach(lua_State *, int);
+static void	 thread_index_file(lua_State *, const char *);
+static int	 l_message_is_duplicate(lua_State *);
+static struct dedup
+		*dedup_store_open(lua_State *, bool);
+static void	 dedup_store_attach(lua_State *, int);
+static void	 dedup_store_file(lua_State *, const char *);
+static int	 l_message_similar(lua_State *);
 static int	 mh_folder_metatable(lua_State *);
 static int	 l_mh_folder(lua_State *);
-
+static bool	 mh_folder_uncommitted(void);
+static bool	 mbox_uncommitted(void);
+static int	 l_matcher(lua_State *);
+static int	 l_rules(lua_State *);
+static int	 l_bayes(lua_State *);
+static int	 l_addrset(lua_State *);
+static int	 l_urlscan(lua_State *);
+static int	 l_partscan(lua_State *);
+
+struct pop3_read_ctx;
+struct read_state;
+struct rfc5322_tap;
+struct mf_stat;
+static void	 read_taps_init(struct pop3_read_ctx *);
+static void	 read_taps_attach(struct pop3_read_ctx *, struct rfc5322_tap *);
+static void	 read_taps_end(struct pop3_read_ctx *);
+static void	 read_text_on_begin(void *);
+static void	 read_text_on_header(void *, const char *, const char *);
+static void	 read_text_on_body(void *, const char *, size_t);
+static void	 read_text_on_end(void *);
+static void	 read_text_on_line(void *, const char *, size_t);
+static uint64_t	 stat_nsec(void);
+static void	 stat_add(struct mf_stat *, uint64_t);
+static void	 stat_register(struct mf_stat *, const char *, const char *);
+static void	 stat_unregister(struct mf_stat *);
+static void	 stat_print(FILE *, const char *, uint64_t, uint64_t, uint64_t);
 static ssize_t	 rfc5322_read(void *, size_t, size_t, void *);
+static void	 rfc5322_read_file(lua_State *, const char *, bool);
+static void	 rfc5322_read_mem(struct pop3_read_ctx *, const char *,
+		    size_t);
+static void	 rfc5322_read_last(struct pop3_read_ctx *, const char *,
+		    size_t);
+static struct read_state
+		*read_state_new(lua_State *);
+static void	 read_state_free(struct read_state *);
+static int	 l_read_state_gc(lua_State *);
+static void	 rfc5322_read_line(struct pop3_read_ctx *, char *, char *);
+static void	 rfc5322_read_body(struct pop3_read_ctx *, const char *,
+		    size_t);
+static void	 rfc5322_read_on_body(struct pop3_read_ctx *, const char *,
+		    size_t);
+static void	 rfc5322_read_on_write(struct pop3_read_ctx *, const char *,
+		    size_t);
+static void	 rfc5322_read_header(struct pop3_read_ctx *,
+		    struct rfc5322_result *);
 static bool	 need_decode(struct rfc5322_result *);
 static const char
 		*skip_ws(const char *);
 static char	*decode_text(const char *);
 static const char
 		*str_tolower(const char *, char *, size_t);
+static const char
+		*str_normalize(const char *, size_t, size_t *);
 
+/* files smaller than READ_MINMAP are read(2) instead of mmap(2) */
+#define	READ_BUFSIZ		4096
+#define	READ_MINMAP		READ_BUFSIZ
+
+#define	MINIMUM(_a,_b)	(((_a) < (_b))? (_a) : (_b))
 #define	MAXIMUM(_a,_b)	(((_a) > (_b))? (_a) : (_b))
 
 int
@@ -74,6 +160,38 @@ luaopen_mailfilter(lua_State *L)
 	lua_pushcfunction(L, l_mbox);
 	lua_settable(L, -3);
 
+	lua_pushstring(L, "maildir");
+	lua_pushcfunction(L, l_maildir);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "thread_of");
+	lua_pushcfunction(L, l_thread_of);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "matcher");
+	lua_pushcfunction(L, l_matcher);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "rules");
+	lua_pushcfunction(L, l_rules);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "bayes");
+	lua_pushcfunction(L, l_bayes);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "addrset");
+	lua_pushcfunction(L, l_addrset);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "urlscan");
+	lua_pushcfunction(L, l_urlscan);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "partscan");
+	lua_pushcfunction(L, l_partscan);
+	lua_settable(L, -3);
+
 	return (1);
 }
 
@@ -135,6 +253,14 @@ pop3_message_metatable(lua_State *L)
 		lua_pushstring(L, "delete");
 		lua_pushcfunction(L, l_pop3_message_delete);
 		lua_settable(L, -3);
+
+		lua_pushstring(L, "is_duplicate");
+		lua_pushcfunction(L, l_message_is_duplicate);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "similar");
+		lua_pushcfunction(L, l_message_similar);
+		lua_settable(L, -3);
 	}
 
 	return (ret);
@@ -386,11 +512,72 @@ l_pop3_gc(lua_State *L)
 	return (0);
 }
 
+/*
+ * Invocation counts, hit counts and the time spent for the callbacks, the
+ * native consumers and the rules.  Reported by mailfilter_stats_report().
+ */
+struct mf_stat {
+	char			 name[80];
+	uint64_t		 calls;
+	uint64_t		 hits;
+	uint64_t		 nsec;
+	struct mf_rules		*rules;		/* has stats for each rule */
+	bool			 registered;
+	TAILQ_ENTRY(mf_stat)	 next;
+};
+
+static TAILQ_HEAD(, mf_stat)	 mf_stats = TAILQ_HEAD_INITIALIZER(mf_stats);
+static struct mf_stat		 stat_on_header = { "lua on_header" };
+static struct mf_stat		 stat_on_end_of_headers =
+				    { "lua on_end_of_headers" };
+static struct mf_stat		 stat_on_write = { "lua on_write" };
+static struct mf_stat		 stat_on_text = { "lua on_text" };
+static bool			 stat_timing = false;	/* take the time */
+
+/*
+ * Native consumers of the message stream.  They are attached to the read
+ * context by read_taps_init() and called from rfc5322_read() without going
+ * through Lua.
+ */
+struct rfc5322_tap {
+	void		(*on_begin)(void *);
+	void		(*on_header)(void *, const char *, const char *);
+	void		(*on_end_of_headers)(void *);
+	void		(*on_body)(void *, const char *, size_t);
+	void		(*on_write)(void *, const char *, size_t);
+	void		(*on_end)(void *);
+	void		*ctx;
+	struct mf_stat	*stat;
+	bool		 stop;		/* set by on_body to stop reading */
+	TAILQ_ENTRY(rfc5322_tap)
+			 next;
+};
+
 struct pop3_read_ctx {
 	lua_State		*L;
 	bytebuffer		*buffer;
 	struct rfc5322_parser	*parser;
 	int			 state;
+	bool			 body;
+	bool			 top;		/* stop at the end of headers */
+	bool			 unquote;	/* mboxrd ">From " */
+	bool			 stop;		/* stopped by a consumer */
+	bool			 normalize;	/* NFKC and case folding */
+	int64_t			 size;		/* of the message or -1 */
+	char			*line;		/* for rfc5322_read_mem() */
+	size_t			 linesiz;
+	TAILQ_HEAD(, rfc5322_tap)
+				 taps;
+	struct bodytext		*text;		/* for on_text() */
+	struct rfc5322_tap	 text_tap;
+};
+
+/* the resources of a read, collected even if a callback raises an error */
+struct read_state {
+	struct pop3_read_ctx	 ctx;
+	int			 fd;
+	void			*map;		/* MAP_FAILED if not mapped */
+	size_t			 mapsiz;
 };
 
 int
@@ -412,7 +599,7 @@ l_pop3_message_topretr(lua_State *L, bool top)
 	char			 buf[128];
 	int			 idx;
 	CURLcode		 curlcode;
-	struct pop3_read_ctx	 ctx;
+	struct read_state	*rs;
 
 	lua_getfield(L, 1, "parent");
 	userdata = luaL_checkudata(L, -1, "mail.pop3");
@@ -430,32 +617,30 @@ l_pop3_message_topretr(lua_State *L, bool top)
 	else
 		snprintf(buf, sizeof(buf), "RETR %d", idx);
 
+	/* the parser and the on_text converter are collected on errors */
+	rs = read_state_new(L);
+
 	curl_easy_setopt(pop3->curl, CURLOPT_URL, pop3->url);
 	curl_easy_setopt(pop3->curl, CURLOPT_NOBODY, 0L);
 	curl_easy_setopt(pop3->curl, CURLOPT_CUSTOMREQUEST, buf);
 	curl_easy_setopt(pop3->curl, CURLOPT_WRITEFUNCTION, rfc5322_read);
-	curl_easy_setopt(pop3->curl, CURLOPT_WRITEDATA, &ctx);
+	curl_easy_setopt(pop3->curl, CURLOPT_WRITEDATA, &rs->ctx);
 
-	ctx.L = L;
-	ctx.state = RFC5322_NONE;
-	if ((ctx.parser = rfc5322_parser_new()) == NULL)
+	rs->ctx.top = top;
+	read_taps_init(&rs->ctx);
+	if ((rs->ctx.parser = rfc5322_parser_new()) == NULL)
 		POP3_FATAL(L, pop3, "rfc5322_parser_new(): %s",
 		    strerror(errno));
-	if ((ctx.buffer = bytebuffer_create(8192)) == NULL) {
-		rfc5322_free(ctx.parser);
+	if ((rs->ctx.buffer = bytebuffer_create(8192)) == NULL)
 		POP3_FATAL(L, pop3, "bytebuffer_create(): %s",
 		    strerror(errno));
-	}
 
 	curlcode = curl_easy_perform(pop3->curl);
-	if (curlcode != CURLE_OK) {
-		bytebuffer_destroy(ctx.buffer);
-		rfc5322_free(ctx.parser);
+	if (curlcode != CURLE_OK)
 		POP3_FATAL(L, pop3, "%s", curl_easy_strerror(curlcode));
-	}
+	read_taps_end(&rs->ctx);
 
-	bytebuffer_destroy(ctx.buffer);
-	rfc5322_free(ctx.parser);
+	read_state_free(rs);
 
 	return (0);
 }
@@ -479,6 +664,9 @@ l_pop3_message_delete(lua_State *L)
 	idx = luaL_checkinteger(L, -1);
 	lua_settop(L, -3);
 
+	if (mh_folder_uncommitted() || mbox_uncommitted())
+		luaL_error(L, "saved messages are not committed yet");
+
 	snprintf(buf, sizeof(buf), "%s/%d", pop3->url, idx);
 
 	curl_easy_setopt(pop3->curl, CURLOPT_URL, buf);
@@ -501,24 +689,155 @@ struct mh_folder {
 	char	*name;
 	char	 path[PATH_MAX];
 	int	 maxseq;
+	int	 seqfd;		/* MH_SEQFILE, -1 if not opened */
+	bool	 batch;		/* between begin() and commit() */
+	bool	 dirty;		/* saved but not committed */
+	int	*pending;	/* files not synced yet */
+	int	 npending;
+	int	 pendingsiz;
+	struct hcache
+		*hcache;	/* MH_HCACHE, NULL if not opened */
+	struct tindex
+		*tindex;	/* MH_TINDEX, NULL if not opened */
+	struct bodytext
+		*tindex_conv;	/* decodes the body for MH_TINDEX */
+};
+
+#define	MH_PENDING_MAX		64
+
+#define	MH_DIRBUFSIZ		65536
+
+/*
+ * The last sequence number allocated and the modification time of the
+ * directory at that time.  The directory is scanned only if the time is
+ * changed by others.
+ */
+#define	MH_SEQFILE		".mailfilter_seq"
+
+/*
+ * Cache of the decoded common headers for list{ headers = true }, keyed by
+ * the sequence number and validated by the inode, mtime and size.
+ */
+#define	MH_HCACHE		".mailfilter_hcache"
+
+static const char	*mh_hcache_headers[] = {
+	"from", "to", "cc", "subject", "date", "message-id", "in-reply-to",
+	"references", NULL
+};
+
+/*
+ * Full text index of the headers below and the body.  The saved messages
+ * are indexed only if the directory exists, it's created by search().
+ */
+#define	MH_TINDEX		".mailfilter_tindex"
+
+static const char	*mh_tindex_headers[] = {
+	"from", "to", "cc", "subject", NULL
+};
+
+struct mh_hcollect {
+	char			*buf;		/* "name\0value\0..." */
+	size_t			 len;
+	size_t			 siz;
+	u_int			 seen;
+	int			 error;
+	struct rfc5322_tap	 tap;
+};
+
+/* message missed in MH_HCACHE, its headers are at `off' of the collected */
+struct mh_hmiss {
+	size_t			 i;		/* index in the list */
+	struct stat		 st;
+	size_t			 off;
+	size_t			 len;
+	bool			 ok;
+};
+
+static int		 mh_ndirty = 0;	/* number of dirty folders */
+
+/*
+ * Output of folder:save().  Lines are accumulated in `buf' and written by
+ * writev(2) with the line which doesn't fit.
+ */
+#define	MH_WRITER_BUFSIZ	65536
+
+struct mh_writer {
+	int			 fd;
+	const char		*extra;		/* extra headers */
+	size_t			 extralen;
+	int			 error;		/* errno of the first error */
+	size_t			 buflen;
+	struct rfc5322_tap	 tap;
+	char			 buf[MH_WRITER_BUFSIZ];
 };
 
-struct direntseq {
-	struct dirent	dirent;
-	int		seq;
+/* sequence numbers for the lazy iteration of folder:messages() */
+struct mh_seqiter {
+	size_t		 n;
+	size_t		 pos;
+	uint32_t	 seqs[];
 };
 
 static int		 l_mh_folder_list(lua_State *);
+static int		 l_mh_folder_messages(lua_State *);
+static int		 l_mh_folder_messages_next(lua_State *);
+static int		 mh_message_metatable(lua_State *);
 static void		 mh_message(lua_State *, int, int);
 static int		 l_mh_folder_get(lua_State *);
 static int		 l_mh_folder_save(lua_State *);
-static int		 l_mh_folder_save_on_write(lua_State *);
-static int		 l_mh_folder_save_on_end_of_headers(lua_State *);
+static int		 l_mh_folder_move(lua_State *);
+static int		 mh_folder_store(lua_State *, bool);
+static struct mh_folder	*mh_message_path(lua_State *, int, char *, size_t);
+static int		 mh_copy_file(const char *, int);
+static void		 mh_writer_headers(lua_State *, int);
+static void		 mh_writer_on_end_of_headers(void *);
+static void		 mh_writer_on_write(void *, const char *, size_t);
+static void		 mh_writer_put(struct mh_writer *, const char *,
+			    size_t);
+static int		 mh_writer_flush(struct mh_writer *, const char *,
+			    size_t);
+static int		 l_mh_folder_begin(lua_State *);
+static int		 l_mh_folder_commit(lua_State *);
 static int		 l_mh_folder_gc(lua_State *);
+static int		 l_mh_folder_message_top(lua_State *);
 static int		 l_mh_folder_message_retr(lua_State *);
+static int		 mh_folder_message_read(lua_State *, bool);
+static void		 mh_folder_list_headers(lua_State *,
+			    struct mh_folder *, int, uint32_t *, size_t);
+static int		 mh_folder_hcache_lock(struct mh_folder *, int *);
+static void		 mh_folder_hcache_unlock(struct mh_folder *, int);
+static void		 mh_folder_set_headers(lua_State *, int, size_t,
+			    const char *, size_t);
+static void		 mh_hcollect_on_header(void *, const char *,
+			    const char *);
 static int		 l_mh_folder_message_delete(lua_State *);
-static int		 mh_folder_newfile(struct mh_folder *);
-static int		 direntseq_compar(const void *, const void *);
+static int		 l_mh_folder_search(lua_State *);
+static struct tindex	*mh_folder_tindex(struct mh_folder *);
+static int		 mh_folder_tindex_update(lua_State *, int,
+			    struct mh_folder *, int);
+static int		 mh_folder_tindex_message(lua_State *, int,
+			    struct mh_folder *, uint32_t,
+			    struct rfc5322_tap *);
+static void		 mh_tindex_on_begin(void *);
+static void		 mh_tindex_on_header(void *, const char *,
+			    const char *);
+static void		 mh_tindex_on_body(void *, const char *, size_t);
+static void		 mh_tindex_on_text(void *, const char *, size_t);
+static void		 mh_tindex_on_end(void *);
+static int		 mh_folder_newfile(struct mh_folder *, const char *);
+static int		 mh_folder_scan(struct mh_folder *);
+static int		 mh_folder_seq_load(struct mh_folder *);
+static void		 mh_folder_seq_store(struct mh_folder *);
+static int		 mh_folder_seq_open(struct mh_folder *, bool);
+static int		 mh_folder_seq_lock(struct mh_folder *);
+static void		 mh_folder_seq_unlock(struct mh_folder *, int);
+static int		 mh_folder_rename(struct mh_folder *, const char *,
+			    struct mh_folder *, const char *);
+static int		 mh_folder_flush(struct mh_folder *);
+static int		 mh_folder_commit(struct mh_folder *);
+static uint32_t		*mh_folder_seqs(lua_State *, struct mh_folder *, int,
+			    size_t *);
+static void		 radix_sort(uint32_t *, uint32_t *, size_t);
 
 int
 mh_folder_metatable(lua_State *L)
@@ -530,6 +849,10 @@ mh_folder_metatable(lua_State *L)
 		lua_pushcfunction(L, l_mh_folder_list);
 		lua_settable(L, -3);
 
+		lua_pushstring(L, "messages");
+		lua_pushcfunction(L, l_mh_folder_messages);
+		lua_settable(L, -3);
+
 		lua_pushstring(L, "get");
 		lua_pushcfunction(L, l_mh_folder_get);
 		lua_settable(L, -3);
@@ -538,6 +861,22 @@ mh_folder_metatable(lua_State *L)
 		lua_pushcfunction(L, l_mh_folder_save);
 		lua_settable(L, -3);
 
+		lua_pushstring(L, "move");
+		lua_pushcfunction(L, l_mh_folder_move);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "search");
+		lua_pushcfunction(L, l_mh_folder_search);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "begin");
+		lua_pushcfunction(L, l_mh_folder_begin);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "commit");
+		lua_pushcfunction(L, l_mh_folder_commit);
+		lua_settable(L, -3);
+
 		lua_pushstring(L, "__gc");
 		lua_pushcfunction(L, l_mh_folder_gc);
 		lua_settable(L, -3);
@@ -564,6 +903,7 @@ l_mh_folder(lua_State *L)
 	*userdata = folder;
 
 	folder->maxseq = -1;
+	folder->seqfd = -1;
 
 	mh_folder_metatable(L);
 
@@ -600,10 +940,47 @@ l_mh_folder(lua_State *L)
 	return (1);
 }
 
+int
+mh_message_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.mh_folder.message")) != 0) {
+		lua_pushstring(L, "top");
+		lua_pushcfunction(L, l_mh_folder_message_top);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "retr");
+		lua_pushcfunction(L, l_mh_folder_message_retr);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "delete");
+		lua_pushcfunction(L, l_mh_folder_message_delete);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "is_duplicate");
+		lua_pushcfunction(L, l_message_is_duplicate);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "similar");
+		lua_pushcfunction(L, l_message_similar);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__index");
+		lua_pushvalue(L, -2);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
 void
 mh_message(lua_State *L, int idx, int parent)
 {
-	lua_newtable(L);
+	lua_createtable(L, 0, 2);
+
+	mh_message_metatable(L);
+	lua_setmetatable(L, -2);
 
 	lua_pushstring(L, "parent");
 	lua_pushvalue(L, parent);
@@ -612,444 +989,5387 @@ mh_message(lua_State *L, int idx, int parent)
 	lua_pushstring(L, "index");
 	lua_pushinteger(L, idx);
 	lua_settable(L, -3);
-
-	lua_pushstring(L, "retr");
-	lua_pushcfunction(L, l_mh_folder_message_retr);
-	lua_settable(L, -3);
-
-	lua_pushstring(L, "delete");
-	lua_pushcfunction(L, l_mh_folder_message_delete);
-	lua_settable(L, -3);
 }
 
+/*
+ * folder:list([ options ])
+ *
+ * Returns the messages sorted by the sequence number.  `options' may have
+ * `from' and `to' (range of the sequence numbers), `reverse' (descending
+ * order), `limit' (max number of the messages) and `headers' (set
+ * `headers' of each message from the header cache).
+ */
 int
 l_mh_folder_list(lua_State *L)
 {
 	struct mh_folder	*folder;
-	DIR			*dir;
-	struct dirent		*ent, entr;
-	struct direntseq	*ent0 = NULL, *entn;
-	const char		*strerr;
-	int			 i, n, seq, maxseq, entsiz = 0, newsiz;
+	uint32_t		*seqs;
+	size_t			 i, n;
+	bool			 headers;
 
 	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
+	if (!lua_isnoneornil(L, 2))
+		luaL_checktype(L, 2, LUA_TTABLE);
+	lua_settop(L, 2);
 
-	lua_newtable(L);
-	maxseq = 0;
-	if ((dir = opendir(folder->path)) == NULL) {
-		if (errno == ENOENT)
-			return (1);
-		luaL_error(L, "could not open the directory");
-	}
-	for (n = 0; readdir_r(dir, &entr, &ent) == 0 && ent != NULL; ) {
-		if (ent->d_type != DT_REG)
-			continue;
-		seq = strtonum(ent->d_name, 1, UINT_MAX, &strerr);
-		if (strerr != NULL)
-			continue;
-		if (n >= entsiz) {
-			newsiz = (entsiz == 0)? 128 : entsiz * 2;
-			if ((entn = recallocarray(ent0, entsiz, newsiz,
-			    sizeof(struct direntseq))) == NULL) {
-				free(ent0);
-				luaL_error(L,
-				    "recallocarray(): %s", strerror(errno));
-			}
-			entsiz = newsiz;
-			ent0 = entn;
-		}
-		ent0[n].dirent = *ent;
-		ent0[n].seq = seq;
-		if (seq == 0)
-			abort();
-		maxseq = MAXIMUM(seq, maxseq);
-		n++;
-	}
-	qsort(ent0, n, sizeof(struct direntseq), direntseq_compar);
+	seqs = mh_folder_seqs(L, folder, 2, &n);
+	lua_createtable(L, n, 0);
 	for (i = 0; i < n; i++) {
-		mh_message(L, ent0[i].seq, 1);
+		mh_message(L, seqs[i], 1);
 		lua_rawseti(L, -2, i + 1);
 	}
-	closedir(dir);
-
-	free(ent0);
+	if (lua_istable(L, 2)) {
+		lua_getfield(L, 2, "headers");
+		headers = lua_toboolean(L, -1);
+		lua_settop(L, -2);
+		if (headers)
+			mh_folder_list_headers(L, folder, lua_gettop(L), seqs,
+			    n);
+	}
 
 	return (1);
 }
 
-int
-l_mh_folder_get(lua_State *L)
+/*
+ * Set `headers' of the messages in the list at `idx'.  The headers are
+ * taken from MH_HCACHE, only the messages missed are read.  The missed
+ * ones are read without the lock which is taken again to put them.
+ */
+void
+mh_folder_list_headers(lua_State *L, struct mh_folder *folder, int idx,
+    uint32_t *seqs, size_t n)
 {
-	int			 idx;
-
-	luaL_checkudata(L, 1, "mail.mh_folder");
-	idx = luaL_checkinteger(L, 2);
-	mh_message(L, idx, 1);
+	struct mh_hcollect	 coll;
+	struct mh_hmiss		*miss = NULL, *tmp;
+	struct stat		 st;
+	char			 path[PATH_MAX];
+	const char		*data;
+	size_t			 i, len, nmiss = 0;
+	int			 dirfd, valid;
+
+	if ((dirfd = open(folder->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+	    == -1)
+		luaL_error(L, "%s: %s", folder->path, strerror(errno));
+	if (mh_folder_hcache_lock(folder, &valid) == -1) {
+		close(dirfd);
+		luaL_error(L, "%s: %s", MH_HCACHE, strerror(errno));
+	}
+	for (i = 0; i < n; i++) {
+		snprintf(path, sizeof(path), "%u", seqs[i]);
+		if (fstatat(dirfd, path, &st, 0) == -1)
+			continue;	/* removed meanwhile */
+		if ((data = hcache_get(folder->hcache, seqs[i], &st, &len))
+		    != NULL) {
+			mh_folder_set_headers(L, idx, i, data, len);
+			continue;
+		}
+		if ((tmp = reallocarray(miss, nmiss + 1, sizeof(*miss)))
+		    == NULL) {
+			mh_folder_hcache_unlock(folder, valid);
+			close(dirfd);
+			free(miss);
+			luaL_error(L, "reallocarray: %s", strerror(errno));
+		}
+		miss = tmp;
+		miss[nmiss].i = i;
+		miss[nmiss].st = st;
+		miss[nmiss].ok = false;
+		nmiss++;
+	}
+	mh_folder_hcache_unlock(folder, valid);
+	close(dirfd);
+
+	memset(&coll, 0, sizeof(coll));
+	coll.tap.on_header = mh_hcollect_on_header;
+	coll.tap.ctx = &coll;
+	for (i = 0; i < nmiss; i++) {
+		miss[i].off = coll.len;
+		coll.seen = 0;
+		coll.error = 0;
+		lua_pushcfunction(L, l_mh_folder_message_top);
+		lua_rawgeti(L, idx, miss[i].i + 1);
+		lua_createtable(L, 0, 1);
+		lua_pushlightuserdata(L, &coll.tap);
+		lua_setfield(L, -2, "tap");
+		if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
+			lua_settop(L, -2);
+			coll.len = miss[i].off;
+			continue;
+		}
+		if (coll.error != 0) {
+			coll.len = miss[i].off;
+			continue;
+		}
+		miss[i].len = coll.len - miss[i].off;
+		miss[i].ok = true;
+		mh_folder_set_headers(L, idx, miss[i].i,
+		    coll.buf + miss[i].off, miss[i].len);
+	}
 
-	return (1);
+	/* the cache is only a hint, it's fine if it isn't updated */
+	if (nmiss > 0 && mh_folder_hcache_lock(folder, &valid) == 0) {
+		for (i = 0; i < nmiss; i++) {
+			if (miss[i].ok)
+				hcache_put(folder->hcache, seqs[miss[i].i],
+				    &miss[i].st, coll.buf + miss[i].off,
+				    miss[i].len);
+		}
+		mh_folder_hcache_unlock(folder, valid);
+	}
+	free(miss);
+	free(coll.buf);
 }
 
+/*
+ * Take the lock of MH_HCACHE, opened if not yet.  The sequences are locked
+ * first since creating or rebuilding MH_HCACHE modifies the directory.
+ */
 int
-l_mh_folder_save(lua_State *L)
+mh_folder_hcache_lock(struct mh_folder *folder, int *valid)
 {
-	struct mh_folder	*folder;
-	int			 fd, seq;
-
-	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
-	luaL_argcheck(L, lua_istable(L, 2), 2, "must be a message");
-
-	if ((fd = mh_folder_newfile(folder)) < 0)
-		luaL_error(L,
-		    "could not create a new file: %s", strerror(errno));
-	seq = folder->maxseq;
-
-	lua_getfield(L, 2, "retr");
-	lua_pushvalue(L, 2);
+	char	 path[PATH_MAX];
+	int	 saved_errno;
+
+	*valid = mh_folder_seq_lock(folder);
+	if (folder->hcache == NULL) {
+		snprintf(path, sizeof(path), "%s/%s", folder->path,
+		    MH_HCACHE);
+		if ((folder->hcache = hcache_open(path)) == NULL)
+			goto bad;
+	}
+	if (hcache_lock(folder->hcache) == -1)
+		goto bad;
 
-	lua_newtable(L);
+	return (0);
+bad:
+	saved_errno = errno;
+	mh_folder_seq_unlock(folder, *valid);
+	errno = saved_errno;
 
-	lua_pushstring(L, "on_write");
-	lua_pushvalue(L, 3);
-	lua_pushinteger(L, fd);
-	lua_pushcclosure(L, l_mh_folder_save_on_write, 2);
-	lua_settable(L, -3);
+	return (-1);
+}
 
-	lua_pushstring(L, "on_end_of_headers");
-	lua_pushvalue(L, 3);
-	lua_pushinteger(L, fd);
-	lua_pushcclosure(L, l_mh_folder_save_on_end_of_headers, 2);
-	lua_settable(L, -3);
+void
+mh_folder_hcache_unlock(struct mh_folder *folder, int valid)
+{
+	hcache_unlock(folder->hcache);
+	mh_folder_seq_unlock(folder, valid);
+}
 
-	lua_call(L, 2, 0);
+/* set `headers' of the `i'th message from "name\0value\0..." */
+void
+mh_folder_set_headers(lua_State *L, int idx, size_t i, const char *data,
+    size_t len)
+{
+	const char	*name, *value, *end;
 
-	if (fsync(fd) == -1)
-		luaL_error(L, "fsync(%s/%d) failed: %s", folder->path, seq,
-		    strerror(errno));
-	close(fd);
+	lua_rawgeti(L, idx, i + 1);
+	lua_newtable(L);
+	for (end = data + len; data < end; data = value + strlen(value) + 1) {
+		name = data;
+		value = name + strlen(name) + 1;
+		lua_pushstring(L, value);
+		lua_setfield(L, -2, name);
+	}
+	lua_setfield(L, -2, "headers");
+	lua_settop(L, -2);
+}
 
-	lua_pushinteger(L, seq);
+void
+mh_hcollect_on_header(void *ctx, const char *hdr, const char *value)
+{
+	struct mh_hcollect	*self = ctx;
+	size_t			 hdrlen, valuelen;
+	char			*buf;
+	int			 i;
 
-	return (1);
+	for (i = 0; mh_hcache_headers[i] != NULL; i++) {
+		if (strcmp(mh_hcache_headers[i], hdr) == 0)
+			break;
+	}
+	/* only the first one */
+	if (mh_hcache_headers[i] == NULL || (self->seen & (1U << i)) != 0 ||
+	    self->error != 0)
+		return;
+	self->seen |= 1U << i;
+	hdrlen = strlen(hdr) + 1;
+	valuelen = strlen(value) + 1;
+	if (self->len + hdrlen + valuelen > self->siz) {
+		if ((buf = realloc(self->buf, MAXIMUM(self->siz * 2,
+		    self->len + hdrlen + valuelen))) == NULL) {
+			self->error = errno;
+			return;
+		}
+		self->buf = buf;
+		self->siz = MAXIMUM(self->siz * 2, self->len + hdrlen +
+		    valuelen);
+	}
+	memcpy(self->buf + self->len, hdr, hdrlen);
+	memcpy(self->buf + self->len + hdrlen, value, valuelen);
+	self->len += hdrlen + valuelen;
 }
 
+/*
+ * folder:messages([ options ])
+ *
+ * Returns an iterator of the messages, `options' are same as list().  The
+ * message objects are created while iterating.
+ */
 int
-l_mh_folder_save_on_write(lua_State *L)
+l_mh_folder_messages(lua_State *L)
 {
-	const char	*buf;
-	size_t		 bufsz;
-	int		 fd;
+	struct mh_folder	*folder;
+	struct mh_seqiter	*iter;
+	uint32_t		*seqs;
+	size_t			 n;
 
-	buf = luaL_checklstring(L, 1, &bufsz);
-	fd = lua_tointeger(L, lua_upvalueindex(2));
-	if (fd >= 0) {
-		if (write(fd, buf, bufsz) == -1)
-			luaL_error(L, "write failed: %s", strerror(errno));
-	}
+	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
+	if (!lua_isnoneornil(L, 2))
+		luaL_checktype(L, 2, LUA_TTABLE);
+	lua_settop(L, 2);
+
+	seqs = mh_folder_seqs(L, folder, 2, &n);
+	iter = lua_newuserdata(L, offsetof(struct mh_seqiter, seqs) +
+	    n * sizeof(uint32_t));
+	iter->n = n;
+	iter->pos = 0;
+	memcpy(iter->seqs, seqs, n * sizeof(uint32_t));
+	lua_pushvalue(L, 1);
+	lua_pushcclosure(L, l_mh_folder_messages_next, 2);
 
-	return (0);
+	return (1);
 }
 
 int
-l_mh_folder_save_on_end_of_headers(lua_State *L)
+l_mh_folder_messages_next(lua_State *L)
 {
-	int		 fd;
-	const char	*key, *val;
+	struct mh_seqiter	*iter;
 
-	if (!lua_istable(L, lua_upvalueindex(1)))
+	iter = lua_touserdata(L, lua_upvalueindex(1));
+	if (iter->pos >= iter->n)
 		return (0);
-	fd = lua_tointeger(L, lua_upvalueindex(2));
-	if (fd >= 0) {
-		lua_pushnil(L);
-		while (lua_next(L, lua_upvalueindex(1)) != 0) {
-			key = luaL_checkstring(L, -2);
-			val = luaL_checkstring(L, -1);
-			dprintf(fd, "%s: %s\n", key, val);
-			lua_settop(L, -2);
-		}
-	}
+	mh_message(L, iter->seqs[iter->pos++], lua_upvalueindex(2));
 
-	return (0);
+	return (1);
 }
 
-int
-mh_folder_newfile(struct mh_folder *folder)
+/*
+ * Read the directory and returns the sorted sequence numbers in the range
+ * of the options at `opts'.  The result is kept on the Lua stack.
+ */
+uint32_t *
+mh_folder_seqs(lua_State *L, struct mh_folder *folder, int opts, size_t *np)
 {
-	char		 path[PATH_MAX];
-	int		 maxseq = 0, seq, fd = -1, maxtries;
-	DIR		*dir;
-	struct dirent	*ent, ent0;
-	const char	*strerr;
+	int		 fd, saved_errno;
+	char		*buf, *name;
+	ssize_t		 sz, off;
+	struct dirent	*ent;
+	uint32_t	*seqs, *nseqs, seq, tmp;
+	size_t		 n = 0, siz = 0, newsiz, limit = SIZE_MAX, i;
+	lua_Integer	 from = 1, to = INT_MAX;
+	bool		 reverse = false;
+
+	if (lua_istable(L, opts)) {
+		lua_getfield(L, opts, "from");
+		if (!lua_isnil(L, -1))
+			from = luaL_checkinteger(L, -1);
+		lua_getfield(L, opts, "to");
+		if (!lua_isnil(L, -1))
+			to = luaL_checkinteger(L, -1);
+		lua_getfield(L, opts, "limit");
+		if (!lua_isnil(L, -1))
+			limit = MAXIMUM(luaL_checkinteger(L, -1), 0);
+		lua_getfield(L, opts, "reverse");
+		reverse = lua_toboolean(L, -1);
+		lua_settop(L, -5);
+	}
 
-	do {
-		if (folder->maxseq < 0) {
-			if ((dir = opendir(folder->path)) == NULL)
-				return (-1);
-			while (readdir_r(dir, &ent0, &ent) == 0 &&
-			    ent != NULL) {
-				if (ent->d_type != DT_REG)
-					continue;
-				seq = strtonum(ent->d_name, 1, UINT_MAX,
-				    &strerr);
-				if (strerr != NULL)
-					continue;
-				maxseq = MAXIMUM(seq, maxseq);
+	/* buffer and the result are userdata, not to leak on errors */
+	buf = lua_newuserdata(L, MH_DIRBUFSIZ);
+	seqs = NULL;
+	if ((fd = open(folder->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+	    == -1) {
+		if (errno != ENOENT)
+			luaL_error(L, "%s: %s", folder->path, strerror(errno));
+		sz = 0;
+	}
+	while (fd >= 0 && (sz = getdents(fd, buf, MH_DIRBUFSIZ)) > 0) {
+		for (off = 0; off < sz; off += ent->d_reclen) {
+			ent = (struct dirent *)(buf + off);
+			if (ent->d_fileno == 0 || (ent->d_type != DT_REG &&
+			    ent->d_type != DT_UNKNOWN))
+				continue;
+			/* digits only, without leading zeros */
+			name = ent->d_name;
+			if (*name < '1' || *name > '9')
+				continue;
+			for (seq = 0; '0' <= *name && *name <= '9' &&
+			    seq <= INT_MAX / 10; name++)
+				seq = seq * 10 + (*name - '0');
+			if (*name != '\0' || seq > INT_MAX || seq < from ||
+			    seq > to)
+				continue;
+			if (n >= siz) {
+				newsiz = (siz == 0)? 1024 : siz * 2;
+				if ((nseqs = reallocarray(seqs, newsiz,
+				    sizeof(uint32_t))) == NULL) {
+					saved_errno = errno;
+					free(seqs);
+					close(fd);
+					luaL_error(L, "reallocarray(): %s",
+					    strerror(saved_errno));
+				}
+				seqs = nseqs;
+				siz = newsiz;
 			}
-			closedir(dir);
-			folder->maxseq = maxseq;
+			seqs[n++] = seq;
 		}
-		for (maxtries = 30; --maxtries > 0; ) {
-			snprintf(path, sizeof(path), "%s/%d",
-			    folder->path, ++folder->maxseq);
-			if ((fd = open(path,
-			    O_EXCL | O_WRONLY | O_CREAT, 0600)) >= 0)
-				break;
+	}
+	saved_errno = errno;
+	if (fd >= 0)
+		close(fd);
+	if (sz == -1) {
+		free(seqs);
+		luaL_error(L, "getdents(%s): %s", folder->path,
+		    strerror(saved_errno));
+	}
+
+	/* move to userdata, also use it as the work area of sorting */
+	nseqs = lua_newuserdata(L, MAXIMUM(n, 1) * sizeof(uint32_t) * 2);
+	if (n > 0)
+		memcpy(nseqs, seqs, n * sizeof(uint32_t));
+	free(seqs);
+	radix_sort(nseqs, nseqs + n, n);
+	if (reverse) {
+		for (i = 0; i < n / 2; i++) {
+			tmp = nseqs[i];
+			nseqs[i] = nseqs[n - i - 1];
+			nseqs[n - i - 1] = tmp;
 		}
-		if (fd >= 0)
-			break;
-	} while (maxseq == 0);	/* do again if max seq is not checked here */
+	}
+	*np = MINIMUM(n, limit);
 
-	return (fd);
+	return (nseqs);
 }
 
 int
-l_mh_folder_gc(lua_State *L)
+l_mh_folder_get(lua_State *L)
 {
-	struct mh_folder	*folder;
+	int			 idx;
 
-	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
-	freezero(folder, sizeof(*folder));
+	luaL_checkudata(L, 1, "mail.mh_folder");
+	idx = luaL_checkinteger(L, 2);
+	mh_message(L, idx, 1);
 
-	return (0);
+	return (1);
 }
 
+/*
+ * folder:save(msg [, headers ])
+ *
+ * The file and the directory are synced before returning, or by commit()
+ * if begin() is called.
+ */
 int
-l_mh_folder_message_retr(lua_State *L)
+l_mh_folder_save(lua_State *L)
 {
-	struct mh_folder	*folder;
-	struct pop3_read_ctx	 ctx;
-	int			 idx, f;
-	char			 path[PATH_MAX], buf[1024];
-	ssize_t			 sz;
+	return (mh_folder_store(L, false));
+}
+
+/* like save(), but the message is removed from the source folder */
+int
+l_mh_folder_move(lua_State *L)
+{
+	return (mh_folder_store(L, true));
+}
+
+/*
+ * Store the message to the folder.  A message of another MH folder is
+ * stored without parsing, it's renamed (move) or linked (save) if the
+ * folders are on the same file system, otherwise copied by the kernel.
+ * The message is streamed through the parser only if the extra headers
+ * are given.
+ */
+int
+mh_folder_store(lua_State *L, bool move)
+{
+	struct mh_folder	*folder, *srcfolder;
+	struct mh_writer	*writer;
+	int			 fd = -1, seq, *pending, newsiz, valid, error;
+	char			 src[PATH_MAX], path[PATH_MAX];
+	bool			 copied = false, streamed = false;
+
+	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
+	luaL_argcheck(L, lua_istable(L, 2), 2, "must be a message");
+	if (!lua_isnoneornil(L, 3))
+		luaL_checktype(L, 3, LUA_TTABLE);
+	lua_settop(L, 3);
+
+	/* userdata, to be collected even if an error is raised */
+	writer = lua_newuserdata(L, sizeof(struct mh_writer));
+	memset(writer, 0, offsetof(struct mh_writer, buf));
+	mh_writer_headers(L, 3);
+	writer->extra = lua_tolstring(L, -1, &writer->extralen);
+	writer->tap.on_end_of_headers = mh_writer_on_end_of_headers;
+	writer->tap.on_write = mh_writer_on_write;
+	writer->tap.ctx = writer;
+
+	srcfolder = mh_message_path(L, 2, src, sizeof(src));
+	if (move && srcfolder == NULL)
+		luaL_argerror(L, 2, "must be a message of a MH folder");
+	if (srcfolder != NULL && writer->extralen == 0 && !move &&
+	    mh_folder_newfile(folder, src) == 0) {
+		seq = folder->maxseq;
+		goto stored;
+	}
+
+	if ((fd = mh_folder_newfile(folder, NULL)) < 0)
+		luaL_error(L,
+		    "could not create a new file: %s", strerror(errno));
+	seq = folder->maxseq;
+	writer->fd = fd;
+
+	if (srcfolder != NULL && writer->extralen == 0) {
+		snprintf(path, sizeof(path), "%s/%d", folder->path, seq);
+		/* replace the new empty file */
+		if (move && mh_folder_rename(srcfolder, src, folder, path)
+		    == 0) {
+			close(fd);
+			fd = -1;
+			goto stored;
+		}
+		if (mh_copy_file(src, fd) == 0)
+			copied = true;
+		else if (ftruncate(fd, 0) == -1 || lseek(fd, 0, SEEK_SET) != 0) {
+			close(fd);
+			luaL_error(L, "write %s/%d failed: %s", folder->path,
+			    seq, strerror(errno));
+		}
+	}
+
+	if (!copied) {
+		lua_getfield(L, 2, "retr");
+		lua_pushvalue(L, 2);
+		lua_createtable(L, 0, 2);
+		lua_pushlightuserdata(L, &writer->tap);
+		lua_setfield(L, -2, "tap");
+		thread_index_attach(L, -1);
+		dedup_store_attach(L, -1);
+		lua_call(L, 2, 0);
+		streamed = true;
+
+		if (writer->error == 0)
+			mh_writer_flush(writer, NULL, 0);
+		if (writer->error != 0) {
+			close(fd);
+			luaL_error(L, "write %s/%d failed: %s", folder->path,
+			    seq, strerror(writer->error));
+		}
+	}
+
+	if (folder->npending + 1 > folder->pendingsiz) {
+		newsiz = MH_PENDING_MAX;
+		if ((pending = reallocarray(folder->pending, newsiz,
+		    sizeof(int))) == NULL) {
+			close(fd);
+			luaL_error(L, "reallocarray(): %s", strerror(errno));
+		}
+		folder->pending = pending;
+		folder->pendingsiz = newsiz;
+	}
+	folder->pending[folder->npending++] = fd;
+ stored:
+	if (!folder->dirty) {
+		folder->dirty = true;
+		mh_ndirty++;
+	}
+	/* the copy must be on the disk before the source is removed */
+	if (!folder->batch || (move && fd >= 0)) {
+		if (mh_folder_commit(folder) == -1)
+			luaL_error(L, "sync %s/%d failed: %s", folder->path,
+			    seq, strerror(errno));
+	} else if (folder->npending >= MH_PENDING_MAX) {
+		if (mh_folder_flush(folder) == -1)
+			luaL_error(L, "sync %s failed: %s", folder->path,
+			    strerror(errno));
+	}
+
+	if (move) {
+		if (fd >= 0) {
+			valid = mh_folder_seq_lock(srcfolder);
+			error = unlink(src);
+			mh_folder_seq_unlock(srcfolder, valid);
+			if (error == -1)
+				luaL_error(L, "%s: %s", src, strerror(errno));
+		}
+		if (!srcfolder->dirty) {
+			srcfolder->dirty = true;
+			mh_ndirty++;
+		}
+		if (!srcfolder->batch && mh_folder_commit(srcfolder) == -1)
+			luaL_error(L, "sync %s failed: %s", srcfolder->path,
+			    strerror(errno));
+		if (mh_folder_tindex(srcfolder) != NULL) {
+			lua_getfield(L, 2, "index");
+			tindex_remove(srcfolder->tindex, lua_tointeger(L, -1));
+			lua_settop(L, -2);
+		}
+		/* the message object follows the file */
+		lua_pushvalue(L, 1);
+		lua_setfield(L, 2, "parent");
+		lua_pushinteger(L, seq);
+		lua_setfield(L, 2, "index");
+	}
+
+	snprintf(path, sizeof(path), "%s/%d", folder->path, seq);
+	if (!streamed) {
+		thread_index_file(L, path);
+		dedup_store_file(L, path);
+	}
+
+	/* errors are ignored, the index is caught up by search() */
+	if (mh_folder_tindex(folder) != NULL)
+		mh_folder_tindex_update(L, 1, folder, seq);
+
+	lua_pushinteger(L, seq);
+
+	return (1);
+}
+
+/*
+ * Returns the folder of the message at `idx' and its path if the message
+ * is of a MH folder, otherwise returns NULL.
+ */
+struct mh_folder *
+mh_message_path(lua_State *L, int idx, char *path, size_t pathsiz)
+{
+	struct mh_folder	**folder;
+	bool			  ismh;
+
+	if (!lua_getmetatable(L, idx))
+		return (NULL);
+	luaL_getmetatable(L, "mail.mh_folder.message");
+	ismh = lua_rawequal(L, -1, -2);
+	lua_settop(L, -3);
+	if (!ismh)
+		return (NULL);
+
+	lua_getfield(L, idx, "parent");
+	folder = luaL_testudata(L, -1, "mail.mh_folder");
+	lua_getfield(L, idx, "index");
+	if (folder == NULL || *folder == NULL || !lua_isinteger(L, -1)) {
+		lua_settop(L, -3);
+		return (NULL);
+	}
+	snprintf(path, pathsiz, "%s/%d", (*folder)->path,
+	    (int)lua_tointeger(L, -1));
+	lua_settop(L, -3);
+
+	return (*folder);
+}
+
+/*
+ * Copy the file as it is.  copy_file_range(2) is used if it's available,
+ * the data isn't copied to userland.
+ */
+int
+mh_copy_file(const char *src, int dst)
+{
+	int		 fd, saved_errno;
+	ssize_t		 sz = -1, wsz, off;
+	char		 buf[READ_BUFSIZ * 16];
+
+	if ((fd = open(src, O_RDONLY | O_CLOEXEC)) == -1)
+		return (-1);
+#if defined(__linux__) || defined(__FreeBSD__)
+	while ((sz = copy_file_range(fd, NULL, dst, NULL, SSIZE_MAX, 0)) > 0)
+		;
+	if (sz == 0 || lseek(fd, 0, SEEK_CUR) != 0 || (errno != EXDEV &&
+	    errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP))
+		goto out;
+#endif
+	while ((sz = read(fd, buf, sizeof(buf))) > 0) {
+		for (off = 0; off < sz; off += wsz) {
+			if ((wsz = write(dst, buf + off, sz - off)) == -1)
+				goto out;
+		}
+	}
+ out:
+	saved_errno = errno;
+	close(fd);
+	errno = saved_errno;
+
+	return ((sz == 0)? 0 : -1);
+}
+
+void
+mh_writer_on_end_of_headers(void *ctx)
+{
+	struct mh_writer	*self = ctx;
+
+	mh_writer_put(self, self->extra, self->extralen);
+}
+
+/*
+ * Format the extra headers of folder:save(), { name, value, ... } or
+ * { name = value, ... }, and push them as a string.
+ */
+void
+mh_writer_headers(lua_State *L, int idx)
+{
+	int	 i, n, acc;
+
+	lua_pushliteral(L, "");
+	acc = lua_gettop(L);
+	if (!lua_istable(L, idx))
+		return;
+	n = lua_rawlen(L, idx);
+	for (i = 1; i + 1 <= n; i += 2) {
+		lua_pushvalue(L, acc);
+		lua_rawgeti(L, idx, i);
+		lua_rawgeti(L, idx, i + 1);
+		lua_pushfstring(L, "%s: %s\n", luaL_checkstring(L, -2),
+		    luaL_checkstring(L, -1));
+		lua_replace(L, -3);
+		lua_settop(L, -2);
+		lua_concat(L, 2);
+		lua_replace(L, acc);
+	}
+	lua_pushnil(L);
+	while (lua_next(L, idx) != 0) {
+		if (lua_type(L, -2) == LUA_TSTRING) {
+			lua_pushvalue(L, acc);
+			lua_pushfstring(L, "%s: %s\n", lua_tostring(L, -3),
+			    luaL_checkstring(L, -2));
+			lua_concat(L, 2);
+			lua_replace(L, acc);
+		}
+		lua_settop(L, -2);
+	}
+}
+
+void
+mh_writer_on_write(void *ctx, const char *line, size_t linelen)
+{
+	mh_writer_put(ctx, line, linelen);
+}
+
+void
+mh_writer_put(struct mh_writer *self, const char *data, size_t datalen)
+{
+	if (self->error != 0)
+		return;
+	if (self->buflen + datalen <= sizeof(self->buf)) {
+		memcpy(self->buf + self->buflen, data, datalen);
+		self->buflen += datalen;
+		return;
+	}
+	mh_writer_flush(self, data, datalen);
+}
+
+/* write the buffer and the given data */
+int
+mh_writer_flush(struct mh_writer *self, const char *data, size_t datalen)
+{
+	struct iovec	 iov[2];
+	int		 iovcnt = 0;
+	ssize_t		 sz;
+
+	if (self->buflen > 0) {
+		iov[iovcnt].iov_base = self->buf;
+		iov[iovcnt++].iov_len = self->buflen;
+	}
+	if (datalen > 0) {
+		iov[iovcnt].iov_base = (void *)data;
+		iov[iovcnt++].iov_len = datalen;
+	}
+	while (iovcnt > 0) {
+		if ((sz = writev(self->fd, iov, iovcnt)) == -1) {
+			if (errno == EINTR)
+				continue;
+			self->error = errno;
+			return (-1);
+		}
+		/* written partially */
+		while (iovcnt > 0 && (size_t)sz >= iov[0].iov_len) {
+			sz -= iov[0].iov_len;
+			iov[0] = iov[1];
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov[0].iov_base = (char *)iov[0].iov_base + sz;
+			iov[0].iov_len -= sz;
+		}
+	}
+	self->buflen = 0;
+
+	return (0);
+}
+
+/*
+ * Create a new message file and return its descriptor.  The sequence
+ * number is allocated under the lock of MH_SEQFILE, so the processes
+ * sharing the folder don't race.  If `link0' is specified, the file is
+ * created as a hard link of it and 0 is returned instead.
+ */
+int
+mh_folder_newfile(struct mh_folder *folder, const char *link0)
+{
+	char		 path[PATH_MAX];
+	int		 fd = -1, maxtries, saved_errno;
+	bool		 scanned;
+
+	if (mh_folder_seq_open(folder, true) == -1 ||
+	    flock(folder->seqfd, LOCK_EX) == -1)
+		return (-1);
+	if ((scanned = (mh_folder_seq_load(folder) == -1)) &&
+	    (folder->maxseq = mh_folder_scan(folder)) == -1)
+		goto out;
+	for (;;) {
+		for (maxtries = 30; --maxtries > 0; ) {
+			snprintf(path, sizeof(path), "%s/%d",
+			    folder->path, ++folder->maxseq);
+			if (link0 != NULL)
+				fd = link(link0, path);
+			else
+				fd = open(path, O_EXCL | O_WRONLY | O_CREAT,
+				    0600);
+			if (fd >= 0 || errno != EEXIST)
+				break;
+		}
+		if (fd >= 0 || scanned || errno != EEXIST)
+			break;
+		/* the number is stale, do again after scanning */
+		if ((folder->maxseq = mh_folder_scan(folder)) == -1)
+			break;
+		scanned = true;
+	}
+	if (fd >= 0)
+		mh_folder_seq_store(folder);
+ out:
+	saved_errno = errno;
+	flock(folder->seqfd, LOCK_UN);
+	errno = saved_errno;
+
+	return (fd);
+}
+
+/* returns the max sequence number in the directory */
+int
+mh_folder_scan(struct mh_folder *folder)
+{
+	DIR		*dir;
+	struct dirent	*ent, ent0;
+	const char	*strerr;
+	int		 seq, maxseq = 0;
+
+	if ((dir = opendir(folder->path)) == NULL)
+		return (-1);
+	while (readdir_r(dir, &ent0, &ent) == 0 && ent != NULL) {
+		if (ent->d_type != DT_REG)
+			continue;
+		seq = strtonum(ent->d_name, 1, INT_MAX, &strerr);
+		if (strerr != NULL)
+			continue;
+		maxseq = MAXIMUM(seq, maxseq);
+	}
+	closedir(dir);
+
+	return (maxseq);
+}
+
+/* load the number from MH_SEQFILE, fails if the directory is modified */
+int
+mh_folder_seq_load(struct mh_folder *folder)
+{
+	char		 buf[80];
+	ssize_t		 sz;
+	struct stat	 st;
+	long long	 sec;
+	long		 nsec;
+	int		 seq;
+
+	if ((sz = pread(folder->seqfd, buf, sizeof(buf) - 1, 0)) <= 0)
+		return (-1);
+	buf[sz] = '\0';
+	if (sscanf(buf, "%d %lld %ld", &seq, &sec, &nsec) != 3 || seq < 0)
+		return (-1);
+	if (stat(folder->path, &st) == -1 || st.st_mtim.tv_sec != sec ||
+	    st.st_mtim.tv_nsec != nsec)
+		return (-1);
+	folder->maxseq = seq;
+
+	return (0);
+}
+
+void
+mh_folder_seq_store(struct mh_folder *folder)
+{
+	char		 buf[80];
+	struct stat	 st;
+	int		 len;
+
+	if (stat(folder->path, &st) == -1)
+		return;
+	len = snprintf(buf, sizeof(buf), "%d %lld %ld\n", folder->maxseq,
+	    (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+	if (pwrite(folder->seqfd, buf, len, 0) == len)
+		ftruncate(folder->seqfd, len);
+}
+
+int
+mh_folder_seq_open(struct mh_folder *folder, bool create)
+{
+	char		 path[PATH_MAX];
+
+	if (folder->seqfd >= 0)
+		return (0);
+	snprintf(path, sizeof(path), "%s/%s", folder->path, MH_SEQFILE);
+	if ((folder->seqfd = open(path, O_RDWR | O_CLOEXEC |
+	    (create ? O_CREAT : 0), 0600)) == -1)
+		return (-1);
+
+	return (0);
+}
+
+/*
+ * Lock MH_SEQFILE around a change of the directory other than a new
+ * file.  Returns 1 if the number stored was valid before the change, so
+ * mh_folder_seq_unlock() stores it again with the new mtime.  Otherwise
+ * returns 0, or -1 if there is no MH_SEQFILE to keep.
+ */
+int
+mh_folder_seq_lock(struct mh_folder *folder)
+{
+	if (mh_folder_seq_open(folder, false) == -1 ||
+	    flock(folder->seqfd, LOCK_EX) == -1)
+		return (-1);
+
+	return (mh_folder_seq_load(folder) == 0);
+}
+
+void
+mh_folder_seq_unlock(struct mh_folder *folder, int valid)
+{
+	int		 saved_errno;
+
+	if (valid < 0)
+		return;
+	saved_errno = errno;
+	if (valid)
+		mh_folder_seq_store(folder);
+	flock(folder->seqfd, LOCK_UN);
+	errno = saved_errno;
+}
+
+/*
+ * Rename `src' of `srcfolder' to `path' of `folder' keeping the number
+ * cache of the both.  The locks are taken in the order of the paths not
+ * to deadlock with a move in the opposite direction.
+ */
+int
+mh_folder_rename(struct mh_folder *srcfolder, const char *src,
+    struct mh_folder *folder, const char *path)
+{
+	struct mh_folder	*first = srcfolder, *second = folder;
+	int			 valid1, valid2 = -1, ret;
+
+	if (strcmp(first->path, second->path) > 0) {
+		first = folder;
+		second = srcfolder;
+	}
+	valid1 = mh_folder_seq_lock(first);
+	if (strcmp(first->path, second->path) != 0)
+		valid2 = mh_folder_seq_lock(second);
+	ret = rename(src, path);
+	mh_folder_seq_unlock(second, valid2);
+	mh_folder_seq_unlock(first, valid1);
+
+	return (ret);
+}
+
+/*
+ * Start a batch.  Saved messages are synced together by commit(), deleting
+ * messages on the POP3 servers is refused until then.
+ */
+int
+l_mh_folder_begin(lua_State *L)
+{
+	struct mh_folder	*folder;
+
+	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
+	folder->batch = true;
+
+	return (0);
+}
+
+int
+l_mh_folder_commit(lua_State *L)
+{
+	struct mh_folder	*folder;
+
+	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
+	folder->batch = false;
+	if (mh_folder_commit(folder) == -1)
+		luaL_error(L, "sync %s failed: %s", folder->path,
+		    strerror(errno));
+
+	return (0);
+}
+
+/* sync and close the pending files */
+int
+mh_folder_flush(struct mh_folder *folder)
+{
+	int	 i, ret = 0, saved_errno = 0;
+
+	for (i = 0; i < folder->npending; i++) {
+		if (fdatasync(folder->pending[i]) == -1 && ret == 0) {
+			saved_errno = errno;
+			ret = -1;
+		}
+		close(folder->pending[i]);
+	}
+	folder->npending = 0;
+	errno = saved_errno;
+
+	return (ret);
+}
+
+/* sync the pending files, then the directory for their entries */
+int
+mh_folder_commit(struct mh_folder *folder)
+{
+	int	 dirfd, ret;
+
+	if (!folder->dirty)
+		return (0);
+	ret = mh_folder_flush(folder);
+	if ((dirfd = open(folder->path, O_RDONLY | O_DIRECTORY)) == -1)
+		ret = -1;
+	else {
+		if (fsync(dirfd) == -1)
+			ret = -1;
+		close(dirfd);
+	}
+	if (ret == 0) {
+		folder->dirty = false;
+		mh_ndirty--;
+	}
+
+	return (ret);
+}
+
+/* any saved message is not committed */
+bool
+mh_folder_uncommitted(void)
+{
+	return (mh_ndirty > 0);
+}
+
+int
+l_mh_folder_gc(lua_State *L)
+{
+	struct mh_folder	*folder;
+
+	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
+	mh_folder_commit(folder);
+	if (folder->dirty)
+		mh_ndirty--;
+	if (folder->seqfd >= 0)
+		close(folder->seqfd);
+	hcache_close(folder->hcache);
+	if (folder->tindex != NULL)
+		tindex_flush(folder->tindex);
+	tindex_close(folder->tindex);
+	bodytext_free(folder->tindex_conv);
+	free(folder->pending);
+	freezero(folder, sizeof(*folder));
+
+	return (0);
+}
+
+int
+l_mh_folder_message_top(lua_State *L)
+{
+	return (mh_folder_message_read(L, true));
+}
+
+int
+l_mh_folder_message_retr(lua_State *L)
+{
+	return (mh_folder_message_read(L, false));
+}
+
+int
+mh_folder_message_read(lua_State *L, bool top)
+{
+	struct mh_folder	*folder;
+	int			 idx;
+	char			 path[PATH_MAX];
+
+	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+
+	lua_getfield(L, 1, "parent");
+	folder = *(struct mh_folder **)luaL_checkudata(L, -1, "mail.mh_folder");
+
+	lua_getfield(L, 1, "index");
+	idx = luaL_checkinteger(L, -1);
+
+	snprintf(path, sizeof(path), "%s/%d", folder->path, idx);
+	rfc5322_read_file(L, path, top);
+
+	return (0);
+}
+
+int
+l_mh_folder_message_delete(lua_State *L)
+{
+	struct mh_folder	*folder;
+	int			 idx, valid;
+	char			 path[PATH_MAX];
+
+	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+
+	lua_getfield(L, 1, "parent");
+	folder = *(struct mh_folder **)luaL_checkudata(L, -1, "mail.mh_folder");
+
+	lua_getfield(L, 1, "index");
+	idx = luaL_checkinteger(L, -1);
+
+	snprintf(path, sizeof(path), "%s/%d", folder->path, idx);
+	valid = mh_folder_seq_lock(folder);
+	if (unlink(path) == 0) {
+		if (folder->hcache != NULL &&
+		    hcache_lock(folder->hcache) == 0) {
+			hcache_delete(folder->hcache, idx);
+			hcache_unlock(folder->hcache);
+		}
+		if (mh_folder_tindex(folder) != NULL)
+			tindex_remove(folder->tindex, idx);
+	}
+	mh_folder_seq_unlock(folder, valid);
+
+	return (0);
+}
+
+/*
+ * folder:search(text)
+ *
+ * Returns the messages which have all the trigrams of the text in the
+ * headers of mh_tindex_headers or the body, sorted by the sequence number.
+ * The messages not indexed yet are indexed first.
+ */
+int
+l_mh_folder_search(lua_State *L)
+{
+	struct mh_folder	*folder;
+	const char		*query;
+	uint32_t		*seqs, *result;
+	size_t			 i, n, nresult = 0;
+	char			 path[PATH_MAX];
+	struct stat		 st;
+	int			 dirfd, saved_errno;
+
+	folder = *(struct mh_folder **)luaL_checkudata(L, 1, "mail.mh_folder");
+	query = luaL_checkstring(L, 2);
+	lua_settop(L, 2);
+
+	if (folder->tindex == NULL) {
+		snprintf(path, sizeof(path), "%s/%s", folder->path,
+		    MH_TINDEX);
+		if ((folder->tindex = tindex_open(path)) == NULL) {
+			if (errno == ENOENT) {
+				/* no folder */
+				lua_newtable(L);
+				return (1);
+			}
+			luaL_error(L, "%s: %s", path, strerror(errno));
+		}
+	}
+	if (mh_folder_tindex_update(L, 1, folder, 0) == -1 ||
+	    tindex_flush(folder->tindex) == -1)
+		luaL_error(L, "%s/%s: %s", folder->path, MH_TINDEX,
+		    strerror(errno));
+	if (tindex_search(folder->tindex, query, &seqs, &n) == -1) {
+		if (errno == EINVAL)
+			luaL_argerror(L, 2, "shorter than 3 characters");
+		luaL_error(L, "%s/%s: %s", folder->path, MH_TINDEX,
+		    strerror(errno));
+	}
+	/* move to userdata, not to leak on errors */
+	result = lua_newuserdata(L, MAXIMUM(n, 1) * sizeof(uint32_t));
+	if (n > 0)
+		memcpy(result, seqs, n * sizeof(uint32_t));
+	free(seqs);
+
+	if ((dirfd = open(folder->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+	    == -1)
+		luaL_error(L, "%s: %s", folder->path, strerror(errno));
+	lua_createtable(L, n, 0);
+	for (i = 0; i < n; i++) {
+		/* the index has the messages removed */
+		snprintf(path, sizeof(path), "%u", result[i]);
+		if (fstatat(dirfd, path, &st, 0) == -1)
+			continue;
+		mh_message(L, result[i], 1);
+		lua_rawseti(L, -2, ++nresult);
+	}
+	saved_errno = errno;
+	close(dirfd);
+	errno = saved_errno;
+
+	return (1);
+}
+
+/* returns MH_TINDEX of the folder, NULL if the folder isn't indexed */
+struct tindex *
+mh_folder_tindex(struct mh_folder *folder)
+{
+	char		 path[PATH_MAX];
+
+	if (folder->tindex == NULL) {
+		snprintf(path, sizeof(path), "%s/%s", folder->path,
+		    MH_TINDEX);
+		if (access(path, F_OK) == 0)
+			folder->tindex = tindex_open(path);
+	}
+
+	return (folder->tindex);
+}
+
+/*
+ * Index the messages after the last one indexed, and the message `seq' if
+ * it's not 0.  The folder is at `idx'.
+ */
+int
+mh_folder_tindex_update(lua_State *L, int idx, struct mh_folder *folder,
+    int seq)
+{
+	struct rfc5322_tap	 tap;
+	uint32_t		*seqs, lastseq;
+	size_t			 i, n;
+	int			 top, ret = 0;
+
+	if (folder->tindex_conv == NULL && (folder->tindex_conv =
+	    bodytext_new(mh_tindex_on_text, folder->tindex)) == NULL)
+		return (-1);
+	memset(&tap, 0, sizeof(tap));
+	tap.on_begin = mh_tindex_on_begin;
+	tap.on_header = mh_tindex_on_header;
+	tap.on_body = mh_tindex_on_body;
+	tap.on_end = mh_tindex_on_end;
+	tap.ctx = folder;
+
+	top = lua_gettop(L);
+	lastseq = tindex_lastseq(folder->tindex);
+	/* the number is reused after the last message was removed */
+	if (seq > 0 && (uint32_t)seq <= lastseq &&
+	    (ret = tindex_remove(folder->tindex, seq)) == 0)
+		ret = mh_folder_tindex_message(L, idx, folder, seq, &tap);
+
+	lua_createtable(L, 0, 1);
+	lua_pushinteger(L, (lua_Integer)lastseq + 1);
+	lua_setfield(L, -2, "from");
+	seqs = mh_folder_seqs(L, folder, lua_gettop(L), &n);
+	for (i = 0; i < n && ret == 0; i++)
+		ret = mh_folder_tindex_message(L, idx, folder, seqs[i], &tap);
+	lua_settop(L, top);
+
+	return (ret);
+}
+
+int
+mh_folder_tindex_message(lua_State *L, int idx, struct mh_folder *folder,
+    uint32_t seq, struct rfc5322_tap *tap)
+{
+	tindex_begin(folder->tindex, seq);
+	lua_pushcfunction(L, l_mh_folder_message_retr);
+	mh_message(L, seq, idx);
+	lua_createtable(L, 0, 1);
+	lua_pushlightuserdata(L, tap);
+	lua_setfield(L, -2, "tap");
+	if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
+		/* removed meanwhile */
+		lua_settop(L, -2);
+		return (0);
+	}
+
+	return (tindex_end(folder->tindex));
+}
+
+void
+mh_tindex_on_begin(void *ctx)
+{
+	struct mh_folder	*folder = ctx;
+
+	bodytext_begin(folder->tindex_conv);
+}
+
+void
+mh_tindex_on_header(void *ctx, const char *hdr, const char *value)
+{
+	struct mh_folder	*folder = ctx;
+	int			 i;
+
+	bodytext_header(folder->tindex_conv, hdr, value);
+	for (i = 0; mh_tindex_headers[i] != NULL; i++) {
+		if (strcmp(mh_tindex_headers[i], hdr) == 0) {
+			tindex_text(folder->tindex, value, strlen(value));
+			break;
+		}
+	}
+}
+
+/* the body is indexed by the text decoded into UTF-8 */
+void
+mh_tindex_on_body(void *ctx, const char *line, size_t linelen)
+{
+	struct mh_folder	*folder = ctx;
+
+	bodytext_body(folder->tindex_conv, line, linelen);
+}
+
+void
+mh_tindex_on_text(void *ctx, const char *line, size_t linelen)
+{
+	tindex_text(ctx, line, linelen);
+}
+
+void
+mh_tindex_on_end(void *ctx)
+{
+	struct mh_folder	*folder = ctx;
+
+	bodytext_end(folder->tindex_conv);
+}
+
+/***********************************************************************
+ * mbox
+ ***********************************************************************/
+/*
+ * mboxrd.  The offsets of the messages are kept in the index file beside
+ * the mbox, `path.idx', so a message is accessed without scanning the
+ * mbox.  The index is brought up to date under the lock and the messages
+ * appended by others are scanned incrementally.
+ */
+#define	MBOX_IDX_MAGIC		"MFMBIDX2"
+#define	MBOX_IDX_NBUF		1024	/* entries written at once */
+#define	MBOX_LOCK_TRIES		30
+#define	MBOX_LOCK_STALE		300	/* seconds to break a dot lock */
+
+struct mbox_idx_header {
+	char		 magic[8];
+	uint64_t	 size;		/* bytes of the mbox indexed */
+	uint64_t	 count;
+	int64_t		 mtime;		/* of the mbox when written */
+	int64_t		 mtimensec;
+};
+
+struct mbox_idx_entry {
+	uint64_t	 offset;	/* of the From_ line */
+	uint64_t	 length;	/* including the separator */
+};
+
+struct mbox {
+	char			 path[PATH_MAX];
+	int			 fd;
+	int			 idxfd;
+	int			 locked;	/* nest count of mbox_lock() */
+	bool			 batch;		/* between begin() and commit() */
+	bool			 dirty;		/* appended but not synced */
+	struct mbox_idx_header	 idx;
+	struct mbox_idx_entry	 idxbuf[MBOX_IDX_NBUF];
+	int			 nidxbuf;
+};
+
+static int		 mbox_ndirty = 0;
+
+static int		 mbox_metatable(lua_State *);
+static int		 mbox_message_metatable(lua_State *);
+static int		 l_mbox_save(lua_State *);
+static int		 l_mbox_list(lua_State *);
+static int		 l_mbox_get(lua_State *);
+static int		 l_mbox_count(lua_State *);
+static int		 l_mbox_begin(lua_State *);
+static int		 l_mbox_commit(lua_State *);
+static int		 l_mbox_gc(lua_State *);
+static int		 l_mbox_message_top(lua_State *);
+static int		 l_mbox_message_retr(lua_State *);
+static int		 mbox_message_topretr(lua_State *, bool);
+static int		 mbox_message_read(lua_State *);
+static void		 mbox_message(lua_State *, int, uint64_t);
+static void		 mbox_writer_on_write(void *, const char *, size_t);
+static int		 mbox_lock(struct mbox *);
+static void		 mbox_unlock(struct mbox *);
+static int		 mbox_rdlock(struct mbox *);
+static void		 mbox_rdunlock(struct mbox *, int);
+static int		 mbox_commit(struct mbox *);
+static int		 mbox_index_sync(struct mbox *);
+static int		 mbox_index_add(struct mbox *, uint64_t, uint64_t);
+static int		 mbox_index_flush(struct mbox *);
+static int		 mbox_index_entry(struct mbox *, uint64_t,
+			    struct mbox_idx_entry *);
+
+int
+mbox_metatable(lua_State *L)
+{
+	int	ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.mbox")) != 0) {
+		lua_pushstring(L, "save");
+		lua_pushcfunction(L, l_mbox_save);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "list");
+		lua_pushcfunction(L, l_mbox_list);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "get");
+		lua_pushcfunction(L, l_mbox_get);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "count");
+		lua_pushcfunction(L, l_mbox_count);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "begin");
+		lua_pushcfunction(L, l_mbox_begin);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "commit");
+		lua_pushcfunction(L, l_mbox_commit);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_mbox_gc);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__index");
+		lua_pushvalue(L, -2);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+int
+mbox_message_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.mbox.message")) != 0) {
+		lua_pushstring(L, "top");
+		lua_pushcfunction(L, l_mbox_message_top);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "retr");
+		lua_pushcfunction(L, l_mbox_message_retr);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "is_duplicate");
+		lua_pushcfunction(L, l_message_is_duplicate);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "similar");
+		lua_pushcfunction(L, l_message_similar);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__index");
+		lua_pushvalue(L, -2);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.mbox(path)
+ *
+ * A relative path is taken from ~/Mail like MH folders.
+ */
+int
+l_mbox(lua_State *L)
+{
+	struct mbox		**userdata, *mbox;
+	const char		 *name, *home;
+	char			  path[PATH_MAX];
+
+	name = luaL_checkstring(L, 1);
+
+	userdata = lua_newuserdata(L, sizeof(mbox));
+	*userdata = NULL;
+	mbox_metatable(L);
+	lua_setmetatable(L, -2);
+
+	if ((mbox = calloc(1, sizeof(struct mbox))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	mbox->fd = mbox->idxfd = -1;
+	*userdata = mbox;
+
+	if (*name != '/') {
+		if ((home = getenv("HOME")) == NULL)
+			luaL_error(L, "missing HOME environment variable");
+		snprintf(mbox->path, sizeof(mbox->path), "%s/Mail/%s", home,
+		    name);
+	} else
+		strlcpy(mbox->path, name, sizeof(mbox->path));
+
+	if ((mbox->fd = open(mbox->path, O_RDWR | O_APPEND | O_CREAT |
+	    O_CLOEXEC, 0600)) == -1)
+		luaL_error(L, "%s: %s", mbox->path, strerror(errno));
+	snprintf(path, sizeof(path), "%s.idx", mbox->path);
+	if ((mbox->idxfd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600))
+	    == -1)
+		luaL_error(L, "%s: %s", path, strerror(errno));
+
+	return (1);
+}
+
+/*
+ * mbox:save(msg [, headers ])
+ *
+ * Append the message and return its number.
+ */
+int
+l_mbox_save(lua_State *L)
+{
+	struct mbox		*mbox;
+	struct mh_writer	*writer;
+	struct stat		 st;
+	uint64_t		 offset;
+	char			 buf[80], c;
+	time_t			 now;
+	int			 len;
+
+	mbox = *(struct mbox **)luaL_checkudata(L, 1, "mail.mbox");
+	luaL_argcheck(L, lua_istable(L, 2), 2, "must be a message");
+	if (!lua_isnoneornil(L, 3))
+		luaL_checktype(L, 3, LUA_TTABLE);
+	lua_settop(L, 3);
+
+	writer = lua_newuserdata(L, sizeof(struct mh_writer));
+	memset(writer, 0, offsetof(struct mh_writer, buf));
+	mh_writer_headers(L, 3);
+	writer->extra = lua_tolstring(L, -1, &writer->extralen);
+	writer->tap.on_end_of_headers = mh_writer_on_end_of_headers;
+	writer->tap.on_write = mbox_writer_on_write;
+	writer->tap.ctx = writer;
+	writer->fd = mbox->fd;
+
+	if (mbox_lock(mbox) == -1)
+		luaL_error(L, "%s: lock failed: %s", mbox->path,
+		    strerror(errno));
+	if (mbox_index_sync(mbox) == -1 || fstat(mbox->fd, &st) == -1) {
+		mbox_unlock(mbox);
+		luaL_error(L, "%s: %s", mbox->path, strerror(errno));
+	}
+	offset = st.st_size;
+
+	/* the previous message must be terminated by an empty line */
+	if (offset > 0 && pread(mbox->fd, &c, 1, offset - 1) == 1 &&
+	    c != '\n') {
+		mh_writer_put(writer, "\n\n", 2);
+		offset += 2;
+	}
+	now = time(NULL);
+	len = strftime(buf, sizeof(buf),
+	    "From MAILER-DAEMON %a %b %e %H:%M:%S %Y\n", localtime(&now));
+	mh_writer_put(writer, buf, len);
+
+	lua_getfield(L, 2, "retr");
+	lua_pushvalue(L, 2);
+	lua_createtable(L, 0, 2);
+	lua_pushlightuserdata(L, &writer->tap);
+	lua_setfield(L, -2, "tap");
+	thread_index_attach(L, -1);
+	dedup_store_attach(L, -1);
+	if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
+		ftruncate(mbox->fd, st.st_size);
+		mbox_unlock(mbox);
+		lua_error(L);
+	}
+	mh_writer_put(writer, "\n", 1);
+	if (writer->error == 0)
+		mh_writer_flush(writer, NULL, 0);
+	if (writer->error != 0 || fstat(mbox->fd, &st) == -1 ||
+	    mbox_index_add(mbox, offset, st.st_size - offset) == -1 ||
+	    mbox_index_flush(mbox) == -1) {
+		if (writer->error == 0)
+			writer->error = errno;
+		/* the index is rebuilt from the mbox next time */
+		ftruncate(mbox->fd, offset);
+		mbox_unlock(mbox);
+		luaL_error(L, "write %s failed: %s", mbox->path,
+		    strerror(writer->error));
+	}
+
+	if (!mbox->dirty) {
+		mbox->dirty = true;
+		mbox_ndirty++;
+	}
+	if (!mbox->batch && mbox_commit(mbox) == -1) {
+		mbox_unlock(mbox);
+		luaL_error(L, "sync %s failed: %s", mbox->path,
+		    strerror(errno));
+	}
+	mbox_unlock(mbox);
+
+	lua_pushinteger(L, mbox->idx.count);
+
+	return (1);
+}
+
+/*
+ * mbox:list([ options ])
+ *
+ * `options' may have `from' and `to' (range of the message numbers) and
+ * `limit' (max number of the messages).
+ */
+int
+l_mbox_list(lua_State *L)
+{
+	struct mbox	*mbox;
+	lua_Integer	 from = 1, to, limit, i;
+
+	mbox = *(struct mbox **)luaL_checkudata(L, 1, "mail.mbox");
+	if (mbox_lock(mbox) == -1 || mbox_index_sync(mbox) == -1) {
+		mbox_unlock(mbox);
+		luaL_error(L, "%s: %s", mbox->path, strerror(errno));
+	}
+	mbox_unlock(mbox);
+
+	to = limit = mbox->idx.count;
+	if (lua_istable(L, 2)) {
+		lua_getfield(L, 2, "from");
+		from = MAXIMUM(luaL_optinteger(L, -1, from), 1);
+		lua_getfield(L, 2, "to");
+		to = MINIMUM(luaL_optinteger(L, -1, to), to);
+		lua_getfield(L, 2, "limit");
+		limit = luaL_optinteger(L, -1, limit);
+		lua_settop(L, 2);
+	}
+
+	lua_newtable(L);
+	for (i = from; i <= to && i - from < limit; i++) {
+		mbox_message(L, 1, i);
+		lua_rawseti(L, -2, i - from + 1);
+	}
+
+	return (1);
+}
+
+int
+l_mbox_get(lua_State *L)
+{
+	struct mbox	*mbox;
+	lua_Integer	 i;
+
+	mbox = *(struct mbox **)luaL_checkudata(L, 1, "mail.mbox");
+	i = luaL_checkinteger(L, 2);
+	if (i < 1 || (uint64_t)i > mbox->idx.count) {
+		if (mbox_lock(mbox) == -1 || mbox_index_sync(mbox) == -1) {
+			mbox_unlock(mbox);
+			luaL_error(L, "%s: %s", mbox->path, strerror(errno));
+		}
+		mbox_unlock(mbox);
+	}
+	if (i < 1 || (uint64_t)i > mbox->idx.count)
+		return (0);
+	mbox_message(L, 1, i);
+
+	return (1);
+}
+
+int
+l_mbox_count(lua_State *L)
+{
+	struct mbox	*mbox;
+
+	mbox = *(struct mbox **)luaL_checkudata(L, 1, "mail.mbox");
+	if (mbox_lock(mbox) == -1 || mbox_index_sync(mbox) == -1) {
+		mbox_unlock(mbox);
+		luaL_error(L, "%s: %s", mbox->path, strerror(errno));
+	}
+	mbox_unlock(mbox);
+	lua_pushinteger(L, mbox->idx.count);
+
+	return (1);
+}
+
+/* the mbox is kept locked until commit() */
+int
+l_mbox_begin(lua_State *L)
+{
+	struct mbox	*mbox;
+
+	mbox = *(struct mbox **)luaL_checkudata(L, 1, "mail.mbox");
+	if (mbox->batch)
+		return (0);
+	if (mbox_lock(mbox) == -1)
+		luaL_error(L, "%s: lock failed: %s", mbox->path,
+		    strerror(errno));
+	mbox->batch = true;
+
+	return (0);
+}
+
+int
+l_mbox_commit(lua_State *L)
+{
+	struct mbox	*mbox;
+	int		 ret;
+
+	mbox = *(struct mbox **)luaL_checkudata(L, 1, "mail.mbox");
+	if (!mbox->batch)
+		return (0);
+	ret = mbox_commit(mbox);
+	mbox->batch = false;
+	mbox_unlock(mbox);
+	if (ret == -1)
+		luaL_error(L, "sync %s failed: %s", mbox->path,
+		    strerror(errno));
+
+	return (0);
+}
+
+int
+l_mbox_gc(lua_State *L)
+{
+	struct mbox	*mbox;
+
+	mbox = *(struct mbox **)luaL_checkudata(L, 1, "mail.mbox");
+	if (mbox == NULL)
+		return (0);
+	mbox_commit(mbox);
+	if (mbox->dirty)
+		mbox_ndirty--;
+	if (mbox->locked > 0) {
+		mbox->locked = 1;
+		mbox_unlock(mbox);
+	}
+	if (mbox->fd >= 0)
+		close(mbox->fd);
+	if (mbox->idxfd >= 0)
+		close(mbox->idxfd);
+	free(mbox);
+
+	return (0);
+}
+
+int
+l_mbox_message_top(lua_State *L)
+{
+	return (mbox_message_topretr(L, true));
+}
+
+int
+l_mbox_message_retr(lua_State *L)
+{
+	return (mbox_message_topretr(L, false));
+}
+
+/*
+ * The message is mapped and read under the shared lock, not to be
+ * truncated by others meanwhile.  The callbacks are called by
+ * mbox_message_read() in lua_pcall() to release the lock on errors.
+ */
+int
+mbox_message_topretr(lua_State *L, bool top)
+{
+	struct mbox		*mbox;
+	struct mbox_idx_entry	 ent;
+	struct read_state	*rs;
+	struct stat		 st;
+	lua_Integer		 i;
+	off_t			 off;
+	const char		*msg, *end, *lf;
+	int			 locked, ret;
+
+	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+	lua_settop(L, 2);
+
+	lua_getfield(L, 1, "parent");
+	mbox = *(struct mbox **)luaL_checkudata(L, -1, "mail.mbox");
+	lua_getfield(L, 1, "index");
+	i = luaL_checkinteger(L, -1);
+
+	rs = read_state_new(L);
+	rs->ctx.top = top;
+	rs->ctx.unquote = true;
+	if ((rs->ctx.parser = rfc5322_parser_new()) == NULL)
+		luaL_error(L, "rfc5322_parser_new(): %s", strerror(errno));
+
+	if ((locked = mbox_rdlock(mbox)) == -1)
+		luaL_error(L, "%s: lock failed: %s", mbox->path,
+		    strerror(errno));
+	if (i < 1 || mbox_index_entry(mbox, i - 1, &ent) == -1) {
+		mbox_rdunlock(mbox, locked);
+		luaL_error(L, "%s: no message %d", mbox->path, (int)i);
+	}
+	if (fstat(mbox->fd, &st) == -1 ||
+	    ent.offset + ent.length > (uint64_t)st.st_size) {
+		mbox_rdunlock(mbox, locked);
+		luaL_error(L, "%s: the index is stale", mbox->path);
+	}
+	if (ent.length == 0) {
+		mbox_rdunlock(mbox, locked);
+		read_state_free(rs);
+		return (0);
+	}
+
+	/* the offset of mmap(2) must be aligned to the page */
+	off = ent.offset - ent.offset % getpagesize();
+	rs->mapsiz = ent.offset + ent.length - off;
+	if ((rs->map = mmap(NULL, rs->mapsiz, PROT_READ, MAP_PRIVATE,
+	    mbox->fd, off)) == MAP_FAILED) {
+		mbox_rdunlock(mbox, locked);
+		luaL_error(L, "mmap(): %s", strerror(errno));
+	}
+	madvise(rs->map, rs->mapsiz, MADV_SEQUENTIAL);
+	msg = (char *)rs->map + (ent.offset - off);
+	end = msg + ent.length;
+
+	/* skip the From_ line and the separator */
+	if ((lf = memchr(msg, '\n', end - msg)) != NULL)
+		msg = lf + 1;
+	else
+		msg = end;
+	if (end - msg >= 2 && end[-1] == '\n' && end[-2] == '\n')
+		end--;
+
+	lua_pushcfunction(L, mbox_message_read);
+	lua_pushvalue(L, 1);
+	lua_pushvalue(L, 2);
+	lua_pushlightuserdata(L, rs);
+	lua_pushlightuserdata(L, (void *)msg);
+	lua_pushinteger(L, end - msg);
+	ret = lua_pcall(L, 5, 0, 0);
+	mbox_rdunlock(mbox, locked);
+	read_state_free(rs);
+	if (ret != LUA_OK)
+		lua_error(L);
+
+	return (0);
+}
+
+/* mbox_message_read(msg, callbacks, rs, msgptr, msglen) */
+int
+mbox_message_read(lua_State *L)
+{
+	struct read_state	*rs = lua_touserdata(L, 3);
+
+	rs->ctx.L = L;
+	rs->ctx.size = lua_tointeger(L, 5);
+	read_taps_init(&rs->ctx);
+	rfc5322_read_mem(&rs->ctx, lua_touserdata(L, 4), lua_tointeger(L, 5));
+	read_taps_end(&rs->ctx);
+
+	return (0);
+}
+
+void
+mbox_message(lua_State *L, int parent, uint64_t idx)
+{
+	lua_createtable(L, 0, 2);
+
+	mbox_message_metatable(L);
+	lua_setmetatable(L, -2);
+
+	lua_pushstring(L, "parent");
+	lua_pushvalue(L, parent);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "index");
+	lua_pushinteger(L, idx);
+	lua_settable(L, -3);
+}
+
+/* quote the lines looking like the From_ line, ">From " to ">>From " */
+void
+mbox_writer_on_write(void *ctx, const char *line, size_t linelen)
+{
+	size_t	 i;
+
+	for (i = 0; i < linelen && line[i] == '>'; i++)
+		;
+	if (linelen - i >= 5 && strncmp(line + i, "From ", 5) == 0)
+		mh_writer_put(ctx, ">", 1);
+	mh_writer_put(ctx, line, linelen);
+}
+
+/* lock the mbox by both a dot lock file and fcntl(2) */
+int
+mbox_lock(struct mbox *mbox)
+{
+	char		 path[PATH_MAX];
+	struct flock	 lock;
+	struct stat	 st;
+	int		 fd, tries, saved_errno;
+
+	if (mbox->locked++ > 0)
+		return (0);
+
+	snprintf(path, sizeof(path), "%s.lock", mbox->path);
+	for (tries = 0; tries < MBOX_LOCK_TRIES; tries++) {
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+		    0600)) >= 0)
+			break;
+		if (errno != EEXIST)
+			goto fail;
+		if (stat(path, &st) == 0 &&
+		    st.st_mtime + MBOX_LOCK_STALE < time(NULL)) {
+			unlink(path);
+			continue;
+		}
+		sleep(1);
+	}
+	if (fd < 0) {
+		errno = EWOULDBLOCK;
+		goto fail;
+	}
+	close(fd);
+
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	while (fcntl(mbox->fd, F_SETLKW, &lock) == -1) {
+		if (errno == EINTR)
+			continue;
+		saved_errno = errno;
+		unlink(path);
+		errno = saved_errno;
+		goto fail;
+	}
+
+	return (0);
+ fail:
+	mbox->locked = 0;
+	return (-1);
+}
+
+void
+mbox_unlock(struct mbox *mbox)
+{
+	char		 path[PATH_MAX];
+	struct flock	 lock;
+
+	if (mbox->locked == 0 || --mbox->locked > 0)
+		return;
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_UNLCK;
+	lock.l_whence = SEEK_SET;
+	fcntl(mbox->fd, F_SETLK, &lock);
+	snprintf(path, sizeof(path), "%s.lock", mbox->path);
+	unlink(path);
+}
+
+/*
+ * Take the shared lock of fcntl(2).  Returns 1 if it's taken, or 0 if the
+ * mbox is locked by this process already.
+ */
+int
+mbox_rdlock(struct mbox *mbox)
+{
+	struct flock	 lock;
+
+	if (mbox->locked > 0)
+		return (0);
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_RDLCK;
+	lock.l_whence = SEEK_SET;
+	while (fcntl(mbox->fd, F_SETLKW, &lock) == -1) {
+		if (errno != EINTR)
+			return (-1);
+	}
+
+	return (1);
+}
+
+void
+mbox_rdunlock(struct mbox *mbox, int locked)
+{
+	struct flock	 lock;
+
+	if (locked <= 0)
+		return;
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_UNLCK;
+	lock.l_whence = SEEK_SET;
+	fcntl(mbox->fd, F_SETLK, &lock);
+}
+
+int
+mbox_commit(struct mbox *mbox)
+{
+	if (!mbox->dirty)
+		return (0);
+	if (fdatasync(mbox->fd) == -1)
+		return (-1);
+	mbox->dirty = false;
+	mbox_ndirty--;
+
+	return (0);
+}
+
+/* any appended message is not synced */
+bool
+mbox_uncommitted(void)
+{
+	return (mbox_ndirty > 0);
+}
+
+/*
+ * Bring the index up to date with the mbox.  The messages appended after
+ * the index was written are scanned, the index is rebuilt if the mbox
+ * was rewritten.  Must be called with the lock.
+ */
+int
+mbox_index_sync(struct mbox *mbox)
+{
+	struct stat		 st;
+	struct mbox_idx_entry	 last;
+	char			 buf[5];
+	const char		*map;
+	off_t			 off;
+	size_t			 maplen, i, noffs;
+	uint64_t		 begin, *offs;
+	int			 ret;
+
+	mbox->nidxbuf = 0;
+	if (fstat(mbox->fd, &st) == -1)
+		return (-1);
+	/*
+	 * Rewritten if the same size is modified, or the From_ lines are
+	 * not at the last message and at the end indexed.
+	 */
+	if (pread(mbox->idxfd, &mbox->idx, sizeof(mbox->idx), 0) !=
+	    sizeof(mbox->idx) ||
+	    memcmp(mbox->idx.magic, MBOX_IDX_MAGIC, 8) != 0 ||
+	    mbox->idx.size > (uint64_t)st.st_size ||
+	    (mbox->idx.size == (uint64_t)st.st_size &&
+	    (mbox->idx.mtime != st.st_mtim.tv_sec ||
+	    mbox->idx.mtimensec != st.st_mtim.tv_nsec)) ||
+	    (mbox->idx.size > 0 && mbox->idx.size < (uint64_t)st.st_size &&
+	    (pread(mbox->fd, buf, 5, mbox->idx.size) != 5 ||
+	    memcmp(buf, "From ", 5) != 0 ||
+	    mbox_index_entry(mbox, mbox->idx.count - 1, &last) == -1 ||
+	    pread(mbox->fd, buf, 5, last.offset) != 5 ||
+	    memcmp(buf, "From ", 5) != 0))) {
+		/* rebuild */
+		memset(&mbox->idx, 0, sizeof(mbox->idx));
+		memcpy(mbox->idx.magic, MBOX_IDX_MAGIC, 8);
+		if (ftruncate(mbox->idxfd, sizeof(mbox->idx)) == -1)
+			return (-1);
+	}
+	if (mbox->idx.size == (uint64_t)st.st_size)
+		return (mbox_index_flush(mbox));
+
+	off = mbox->idx.size - mbox->idx.size % getpagesize();
+	maplen = st.st_size - off;
+	if ((map = mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, mbox->fd, off))
+	    == MAP_FAILED)
+		return (-1);
+	madvise((void *)map, maplen, MADV_SEQUENTIAL);
+	begin = mbox->idx.size;
+	ret = mbox_scan(map + (begin - off), st.st_size - begin, &offs,
+	    &noffs);
+	munmap((void *)map, maplen);
+	if (ret == -1)
+		return (-1);
+	for (i = 0; i < noffs; i++) {
+		if (mbox_index_add(mbox, begin + offs[i], ((i + 1 < noffs)?
+		    offs[i + 1] : st.st_size - begin) - offs[i]) == -1) {
+			free(offs);
+			return (-1);
+		}
+	}
+	free(offs);
+	mbox->idx.size = st.st_size;
+
+	return (mbox_index_flush(mbox));
+}
+
+int
+mbox_index_add(struct mbox *mbox, uint64_t offset, uint64_t length)
+{
+	if (mbox->nidxbuf >= MBOX_IDX_NBUF && mbox_index_flush(mbox) == -1)
+		return (-1);
+	mbox->idxbuf[mbox->nidxbuf].offset = offset;
+	mbox->idxbuf[mbox->nidxbuf].length = length;
+	mbox->nidxbuf++;
+	mbox->idx.size = offset + length;
+
+	return (0);
+}
+
+/* write the buffered entries and the header with the time of the mbox */
+int
+mbox_index_flush(struct mbox *mbox)
+{
+	struct stat	 st;
+	ssize_t		 len;
+
+	if (mbox->nidxbuf > 0) {
+		len = mbox->nidxbuf * sizeof(struct mbox_idx_entry);
+		if (pwrite(mbox->idxfd, mbox->idxbuf, len,
+		    sizeof(mbox->idx) + mbox->idx.count *
+		    sizeof(struct mbox_idx_entry)) != len)
+			return (-1);
+		mbox->idx.count += mbox->nidxbuf;
+		mbox->nidxbuf = 0;
+	}
+	if (fstat(mbox->fd, &st) == -1)
+		return (-1);
+	mbox->idx.mtime = st.st_mtim.tv_sec;
+	mbox->idx.mtimensec = st.st_mtim.tv_nsec;
+	if (pwrite(mbox->idxfd, &mbox->idx, sizeof(mbox->idx), 0) !=
+	    sizeof(mbox->idx))
+		return (-1);
+
+	return (0);
+}
+
+int
+mbox_index_entry(struct mbox *mbox, uint64_t i, struct mbox_idx_entry *ent)
+{
+	if (i >= mbox->idx.count) {
+		errno = ENOENT;
+		return (-1);
+	}
+	if (pread(mbox->idxfd, ent, sizeof(*ent), sizeof(mbox->idx) +
+	    i * sizeof(*ent)) != sizeof(*ent))
+		return (-1);
+
+	return (0);
+}
+
+/***********************************************************************
+ * Maildir
+ ***********************************************************************/
+/*
+ * A message is written to tmp/ with a unique name, then renamed to new/.
+ * No lock or counter is shared by the writers.  The flags are kept in the
+ * suffix of the name in cur/, ":2,FS", so updating them is a rename.
+ */
+struct maildir {
+	char		 path[PATH_MAX];
+	char		 host[HOST_NAME_MAX + 1];
+	unsigned	 ndeliveries;
+};
+
+struct maildir_ent {
+	char		*name;		/* "new/..." or "cur/..." */
+	const char	*uniq;
+	long long	 sec;		/* time of the delivery */
+	long		 usec;
+};
+
+static int		 maildir_metatable(lua_State *);
+static int		 maildir_message_metatable(lua_State *);
+static int		 l_maildir_save(lua_State *);
+static int		 l_maildir_list(lua_State *);
+static int		 l_maildir_get(lua_State *);
+static int		 l_maildir_gc(lua_State *);
+static int		 l_maildir_message_top(lua_State *);
+static int		 l_maildir_message_retr(lua_State *);
+static int		 l_maildir_message_delete(lua_State *);
+static int		 l_maildir_message_flags(lua_State *);
+static int		 l_maildir_message_setflags(lua_State *);
+static void		 maildir_message(lua_State *, int, const char *);
+static const char	*maildir_message_path(lua_State *, int, char *,
+			    size_t);
+static int		 maildir_mkdirs(struct maildir *);
+static void		 maildir_ent_time(struct maildir_ent *);
+static int		 maildir_ent_cmp(const void *, const void *);
+
+int
+maildir_metatable(lua_State *L)
+{
+	int	ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.maildir")) != 0) {
+		lua_pushstring(L, "save");
+		lua_pushcfunction(L, l_maildir_save);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "list");
+		lua_pushcfunction(L, l_maildir_list);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "get");
+		lua_pushcfunction(L, l_maildir_get);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_maildir_gc);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__index");
+		lua_pushvalue(L, -2);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+int
+maildir_message_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.maildir.message")) != 0) {
+		lua_pushstring(L, "top");
+		lua_pushcfunction(L, l_maildir_message_top);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "retr");
+		lua_pushcfunction(L, l_maildir_message_retr);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "delete");
+		lua_pushcfunction(L, l_maildir_message_delete);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "flags");
+		lua_pushcfunction(L, l_maildir_message_flags);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "setflags");
+		lua_pushcfunction(L, l_maildir_message_setflags);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "is_duplicate");
+		lua_pushcfunction(L, l_message_is_duplicate);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "similar");
+		lua_pushcfunction(L, l_message_similar);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__index");
+		lua_pushvalue(L, -2);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.maildir(path)
+ *
+ * A relative path is taken from ~/Mail like MH folders.
+ */
+int
+l_maildir(lua_State *L)
+{
+	struct maildir		**userdata, *maildir;
+	const char		 *name, *home;
+	char			 *p;
+
+	name = luaL_checkstring(L, 1);
+
+	userdata = lua_newuserdata(L, sizeof(maildir));
+	*userdata = NULL;
+	maildir_metatable(L);
+	lua_setmetatable(L, -2);
+
+	if ((maildir = calloc(1, sizeof(struct maildir))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	*userdata = maildir;
+
+	if (*name != '/') {
+		if ((home = getenv("HOME")) == NULL)
+			luaL_error(L, "missing HOME environment variable");
+		snprintf(maildir->path, sizeof(maildir->path), "%s/Mail/%s",
+		    home, name);
+	} else
+		strlcpy(maildir->path, name, sizeof(maildir->path));
+
+	if (gethostname(maildir->host, sizeof(maildir->host)) == -1)
+		strlcpy(maildir->host, "localhost", sizeof(maildir->host));
+	/* `/' and `:' can't be in the name */
+	for (p = maildir->host; *p != '\0'; p++) {
+		if (*p == '/' || *p == ':')
+			*p = '_';
+	}
+
+	return (1);
+}
+
+/*
+ * maildir:save(msg [, headers ])
+ *
+ * Deliver the message to new/ and return its name.
+ */
+int
+l_maildir_save(lua_State *L)
+{
+	struct maildir		*maildir;
+	struct mh_writer	*writer;
+	struct timespec		 ts;
+	char			 uniq[NAME_MAX + 1], tmp[PATH_MAX];
+	char			 path[PATH_MAX], src[PATH_MAX];
+	int			 fd, dirfd;
+	bool			 copied = false;
+
+	maildir = *(struct maildir **)luaL_checkudata(L, 1, "mail.maildir");
+	luaL_argcheck(L, lua_istable(L, 2), 2, "must be a message");
+	if (!lua_isnoneornil(L, 3))
+		luaL_checktype(L, 3, LUA_TTABLE);
+	lua_settop(L, 3);
+
+	writer = lua_newuserdata(L, sizeof(struct mh_writer));
+	memset(writer, 0, offsetof(struct mh_writer, buf));
+	mh_writer_headers(L, 3);
+	writer->extra = lua_tolstring(L, -1, &writer->extralen);
+	writer->tap.on_end_of_headers = mh_writer_on_end_of_headers;
+	writer->tap.on_write = mh_writer_on_write;
+	writer->tap.ctx = writer;
+
+	if (maildir_mkdirs(maildir) == -1)
+		luaL_error(L, "%s: %s", maildir->path, strerror(errno));
+
+	/* time, pid and the count make it unique on the host */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	snprintf(uniq, sizeof(uniq), "%lld.M%06ldP%dQ%u.%s",
+	    (long long)ts.tv_sec, ts.tv_nsec / 1000, (int)getpid(),
+	    ++maildir->ndeliveries, maildir->host);
+	snprintf(tmp, sizeof(tmp), "%s/tmp/%s", maildir->path, uniq);
+	snprintf(path, sizeof(path), "%s/new/%s", maildir->path, uniq);
+
+	if ((fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600))
+	    == -1)
+		luaL_error(L, "%s: %s", tmp, strerror(errno));
+	writer->fd = fd;
+
+	/* a local file is copied as it is */
+	if (writer->extralen == 0 &&
+	    (mh_message_path(L, 2, src, sizeof(src)) != NULL ||
+	    maildir_message_path(L, 2, src, sizeof(src)) != NULL)) {
+		if (mh_copy_file(src, fd) == 0)
+			copied = true;
+		else if (ftruncate(fd, 0) == -1 || lseek(fd, 0, SEEK_SET) != 0)
+			writer->error = errno;
+	}
+	if (!copied && writer->error == 0) {
+		lua_getfield(L, 2, "retr");
+		lua_pushvalue(L, 2);
+		lua_createtable(L, 0, 2);
+		lua_pushlightuserdata(L, &writer->tap);
+		lua_setfield(L, -2, "tap");
+		thread_index_attach(L, -1);
+		dedup_store_attach(L, -1);
+		if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
+			close(fd);
+			unlink(tmp);
+			lua_error(L);
+		}
+		if (writer->error == 0)
+			mh_writer_flush(writer, NULL, 0);
+	}
+	if (writer->error == 0 && fdatasync(fd) == -1)
+		writer->error = errno;
+	close(fd);
+	if (writer->error == 0 && rename(tmp, path) == -1)
+		writer->error = errno;
+	if (writer->error != 0) {
+		unlink(tmp);
+		luaL_error(L, "write %s failed: %s", path,
+		    strerror(writer->error));
+	}
+	if (copied) {
+		thread_index_file(L, path);
+		dedup_store_file(L, path);
+	}
+
+	snprintf(path, sizeof(path), "%s/new", maildir->path);
+	if ((dirfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1 ||
+	    fsync(dirfd) == -1) {
+		if (dirfd >= 0)
+			close(dirfd);
+		luaL_error(L, "sync %s failed: %s", path, strerror(errno));
+	}
+	close(dirfd);
+
+	lua_pushfstring(L, "new/%s", uniq);
+
+	return (1);
+}
+
+/*
+ * maildir:list([ options ])
+ *
+ * Returns the messages in new/ and cur/ in the order of the delivery.
+ * `options' may have `from' and `to' (range of the positions in the
+ * order) and `limit' (max number of the messages) like mbox:list().
+ */
+int
+l_maildir_list(lua_State *L)
+{
+	struct maildir		*maildir;
+	struct maildir_ent	*ents = NULL, *nents;
+	size_t			 i, n = 0, entsiz = 0;
+	const char		*subdirs[] = { "new", "cur" };
+	char			 path[PATH_MAX];
+	DIR			*dir;
+	struct dirent		*de;
+	int			 j;
+	lua_Integer		 from = 1, to = LUA_MAXINTEGER;
+	lua_Integer		 limit = LUA_MAXINTEGER, k;
+
+	maildir = *(struct maildir **)luaL_checkudata(L, 1, "mail.maildir");
+	if (lua_istable(L, 2)) {
+		lua_getfield(L, 2, "from");
+		from = MAXIMUM(luaL_optinteger(L, -1, from), 1);
+		lua_getfield(L, 2, "to");
+		to = luaL_optinteger(L, -1, to);
+		lua_getfield(L, 2, "limit");
+		limit = luaL_optinteger(L, -1, limit);
+		lua_settop(L, 2);
+	}
+
+	for (j = 0; j < (int)(sizeof(subdirs) / sizeof(subdirs[0])); j++) {
+		snprintf(path, sizeof(path), "%s/%s", maildir->path,
+		    subdirs[j]);
+		if ((dir = opendir(path)) == NULL) {
+			if (errno == ENOENT)
+				continue;
+			goto fail;
+		}
+		while ((de = readdir(dir)) != NULL) {
+			if (de->d_name[0] == '.')
+				continue;
+			if (n >= entsiz) {
+				entsiz = (entsiz == 0)? 256 : entsiz * 2;
+				if ((nents = reallocarray(ents, entsiz,
+				    sizeof(struct maildir_ent))) == NULL) {
+					closedir(dir);
+					goto fail;
+				}
+				ents = nents;
+			}
+			if (asprintf(&ents[n].name, "%s/%s", subdirs[j],
+			    de->d_name) == -1) {
+				closedir(dir);
+				goto fail;
+			}
+			ents[n].uniq = ents[n].name + 4;
+			maildir_ent_time(&ents[n]);
+			n++;
+		}
+		closedir(dir);
+	}
+	if (n > 0)
+		qsort(ents, n, sizeof(struct maildir_ent), maildir_ent_cmp);
+
+	lua_newtable(L);
+	for (k = from; k <= to && (size_t)k <= n && k - from < limit; k++) {
+		maildir_message(L, 1, ents[k - 1].name);
+		lua_rawseti(L, -2, k - from + 1);
+	}
+	for (i = 0; i < n; i++)
+		free(ents[i].name);
+	free(ents);
+
+	return (1);
+ fail:
+	for (i = 0; i < n; i++)
+		free(ents[i].name);
+	free(ents);
+	luaL_error(L, "%s: %s", path, strerror(errno));
+
+	return (0);
+}
+
+/* maildir:get(name), `name' is what save() returns or msg.name */
+int
+l_maildir_get(lua_State *L)
+{
+	struct maildir	*maildir;
+	const char	*name;
+	char		 path[PATH_MAX];
+	struct stat	 st;
+
+	maildir = *(struct maildir **)luaL_checkudata(L, 1, "mail.maildir");
+	name = luaL_checkstring(L, 2);
+	luaL_argcheck(L, (strncmp(name, "new/", 4) == 0 ||
+	    strncmp(name, "cur/", 4) == 0) && strchr(name + 4, '/') == NULL,
+	    2, "invalid name");
+
+	snprintf(path, sizeof(path), "%s/%s", maildir->path, name);
+	if (stat(path, &st) == -1 || !S_ISREG(st.st_mode))
+		return (0);
+	maildir_message(L, 1, name);
+
+	return (1);
+}
+
+int
+l_maildir_gc(lua_State *L)
+{
+	struct maildir	*maildir;
+
+	maildir = *(struct maildir **)luaL_checkudata(L, 1, "mail.maildir");
+	free(maildir);
+
+	return (0);
+}
+
+int
+l_maildir_message_top(lua_State *L)
+{
+	char	 path[PATH_MAX];
+
+	luaL_argcheck(L, maildir_message_path(L, 1, path, sizeof(path)) !=
+	    NULL, 1, "must be a message");
+	rfc5322_read_file(L, path, true);
+
+	return (0);
+}
+
+int
+l_maildir_message_retr(lua_State *L)
+{
+	char	 path[PATH_MAX];
+
+	luaL_argcheck(L, maildir_message_path(L, 1, path, sizeof(path)) !=
+	    NULL, 1, "must be a message");
+	rfc5322_read_file(L, path, false);
+
+	return (0);
+}
+
+int
+l_maildir_message_delete(lua_State *L)
+{
+	char	 path[PATH_MAX];
+
+	luaL_argcheck(L, maildir_message_path(L, 1, path, sizeof(path)) !=
+	    NULL, 1, "must be a message");
+	unlink(path);
+
+	return (0);
+}
+
+/* returns the flags, like "FS" */
+int
+l_maildir_message_flags(lua_State *L)
+{
+	const char	*name, *info;
+
+	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+	lua_getfield(L, 1, "name");
+	name = luaL_checkstring(L, -1);
+	if ((info = strstr(name, ":2,")) != NULL)
+		lua_pushstring(L, info + 3);
+	else
+		lua_pushliteral(L, "");
+
+	return (1);
+}
+
+/*
+ * msg:setflags(flags)
+ *
+ * Rename the message to cur/ with the flags, the uppercase letters.  The
+ * file isn't rewritten.
+ */
+int
+l_maildir_message_setflags(lua_State *L)
+{
+	struct maildir	*maildir;
+	const char	*name, *flags, *info;
+	char		 path[PATH_MAX], npath[PATH_MAX], nflags[27];
+	int		 c, n = 0;
+
+	if (maildir_message_path(L, 1, path, sizeof(path)) == NULL)
+		luaL_argerror(L, 1, "must be a message");
+	flags = luaL_checkstring(L, 2);
+	for (c = 0; flags[c] != '\0'; c++) {
+		if (flags[c] < 'A' || 'Z' < flags[c])
+			luaL_argerror(L, 2, "flags must be uppercase letters");
+	}
+
+	/* ASCII order without duplicates */
+	for (c = 'A'; c <= 'Z'; c++) {
+		if (strchr(flags, c) != NULL)
+			nflags[n++] = c;
+	}
+	nflags[n] = '\0';
+
+	lua_getfield(L, 1, "parent");
+	maildir = *(struct maildir **)luaL_checkudata(L, -1, "mail.maildir");
+	lua_getfield(L, 1, "name");
+	name = lua_tostring(L, -1) + 4;
+	if ((info = strchr(name, ':')) == NULL)
+		info = name + strlen(name);
+	lua_pushlstring(L, name, info - name);
+	lua_pushfstring(L, "cur/%s:2,%s", lua_tostring(L, -1), nflags);
+	snprintf(npath, sizeof(npath), "%s/%s", maildir->path,
+	    lua_tostring(L, -1));
+	if (strcmp(path, npath) != 0 && rename(path, npath) == -1)
+		luaL_error(L, "%s: %s", path, strerror(errno));
+	lua_setfield(L, 1, "name");
+
+	return (0);
+}
+
+void
+maildir_message(lua_State *L, int parent, const char *name)
+{
+	lua_createtable(L, 0, 2);
+
+	maildir_message_metatable(L);
+	lua_setmetatable(L, -2);
+
+	lua_pushstring(L, "parent");
+	lua_pushvalue(L, parent);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "name");
+	lua_pushstring(L, name);
+	lua_settable(L, -3);
+}
+
+/*
+ * Returns the path of the message at `idx' if the message is of a
+ * Maildir, otherwise returns NULL.
+ */
+const char *
+maildir_message_path(lua_State *L, int idx, char *path, size_t pathsiz)
+{
+	struct maildir	**maildir;
+	bool		  ismaildir;
+
+	if (!lua_getmetatable(L, idx))
+		return (NULL);
+	luaL_getmetatable(L, "mail.maildir.message");
+	ismaildir = lua_rawequal(L, -1, -2);
+	lua_settop(L, -3);
+	if (!ismaildir)
+		return (NULL);
+
+	lua_getfield(L, idx, "parent");
+	maildir = luaL_testudata(L, -1, "mail.maildir");
+	lua_getfield(L, idx, "name");
+	if (maildir == NULL || *maildir == NULL || !lua_isstring(L, -1)) {
+		lua_settop(L, -3);
+		return (NULL);
+	}
+	snprintf(path, pathsiz, "%s/%s", (*maildir)->path,
+	    lua_tostring(L, -1));
+	lua_settop(L, -3);
+
+	return (path);
+}
+
+int
+maildir_mkdirs(struct maildir *maildir)
+{
+	const char	*subdirs[] = { "", "/tmp", "/new", "/cur" };
+	char		 path[PATH_MAX];
+	int		 i;
+
+	for (i = 0; i < (int)(sizeof(subdirs) / sizeof(subdirs[0])); i++) {
+		snprintf(path, sizeof(path), "%s%s", maildir->path,
+		    subdirs[i]);
+		if (mkdir(path, 0700) == -1 && errno != EEXIST)
+			return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * The unique part begins with the seconds, the microseconds follow as
+ * "M<usec>" in the next field if any.  They are not always zero padded.
+ */
+void
+maildir_ent_time(struct maildir_ent *ent)
+{
+	const char	*sp, *ep;
+	char		*end;
+
+	ent->sec = strtoll(ent->uniq, &end, 10);
+	ent->usec = 0;
+	if (*end != '.')
+		return;
+	sp = end + 1;
+	if ((ep = strchr(sp, '.')) == NULL)
+		ep = sp + strlen(sp);
+	for (; sp < ep; sp++) {
+		if (*sp == 'M' && isdigit((u_char)sp[1])) {
+			ent->usec = strtol(sp + 1, NULL, 10);
+			break;
+		}
+	}
+}
+
+/* by the time of the delivery, then by the unique part */
+int
+maildir_ent_cmp(const void *a0, const void *b0)
+{
+	const struct maildir_ent	*a = a0, *b = b0;
+
+	if (a->sec != b->sec)
+		return ((a->sec < b->sec)? -1 : 1);
+	if (a->usec != b->usec)
+		return ((a->usec < b->usec)? -1 : 1);
+
+	return (strcmp(a->uniq, b->uniq));
+}
+
+/***********************************************************************
+ * Thread index
+ ***********************************************************************/
+/*
+ * Message-ID to the thread, shared by the folders.  The messages saved are
+ * indexed only if the file exists, it's created by thread_of().
+ */
+#define	THREADS_FILE		".mailfilter_threads"
+
+static struct threads		*thread_index = NULL;
+static struct rfc5322_tap	 thread_tap;
+
+static void	 thread_on_begin(void *);
+static void	 thread_on_header(void *, const char *, const char *);
+static void	 thread_on_end(void *);
+static int	 l_thread_read_file(lua_State *);
+
+/*
+ * mailfilter.thread_of(ids)
+ *
+ * Returns the thread of the first known Message-ID in `ids', the value of
+ * In-Reply-To or References typically, or nil.
+ */
+int
+l_thread_of(lua_State *L)
+{
+	const char	*ids;
+	uint64_t	 thread;
+
+	if (lua_isnoneornil(L, 1)) {
+		lua_pushnil(L);
+		return (1);
+	}
+	ids = luaL_checkstring(L, 1);
+	thread_index_open(L, true);
+	if ((thread = threads_lookup(thread_index, ids)) == 0)
+		lua_pushnil(L);
+	else
+		lua_pushinteger(L, thread);
+
+	return (1);
+}
+
+/* returns the index if it exists or `create' is true, otherwise NULL */
+struct threads *
+thread_index_open(lua_State *L, bool create)
+{
+	const char	*home;
+	char		 path[PATH_MAX];
+
+	if (thread_index != NULL)
+		return (thread_index);
+	if ((home = getenv("HOME")) == NULL) {
+		if (create)
+			luaL_error(L, "missing HOME environment variable");
+		return (NULL);
+	}
+	snprintf(path, sizeof(path), "%s/Mail/%s", home, THREADS_FILE);
+	if (!create && access(path, F_OK) == -1)
+		return (NULL);
+	if ((thread_index = threads_open(path)) == NULL) {
+		if (create)
+			luaL_error(L, "%s: %s", path, strerror(errno));
+		return (NULL);
+	}
+	thread_tap.on_begin = thread_on_begin;
+	thread_tap.on_header = thread_on_header;
+	thread_tap.on_end = thread_on_end;
+	thread_tap.ctx = thread_index;
+
+	return (thread_index);
+}
+
+/* let the saved message be indexed, `idx' is the callback table */
+void
+thread_index_attach(lua_State *L, int idx)
+{
+	if (thread_index_open(L, false) == NULL)
+		return;
+	lua_pushboolean(L, 1);
+	lua_setfield(L, (idx < 0)? idx - 1 : idx, "threads");
+}
+
+/* index the message file saved without parsing, errors are ignored */
+void
+thread_index_file(lua_State *L, const char *path)
+{
+	if (thread_index_open(L, false) == NULL)
+		return;
+	lua_pushcfunction(L, l_thread_read_file);
+	lua_pushstring(L, path);
+	lua_createtable(L, 0, 1);
+	thread_index_attach(L, -1);
+	if (lua_pcall(L, 2, 0, 0) != LUA_OK)
+		lua_settop(L, -2);
+}
+
+int
+l_thread_read_file(lua_State *L)
+{
+	rfc5322_read_file(L, luaL_checkstring(L, 1), true);
+
+	return (0);
+}
+
+void
+thread_on_begin(void *ctx)
+{
+	threads_begin(ctx);
+}
+
+void
+thread_on_header(void *ctx, const char *hdr, const char *value)
+{
+	threads_header(ctx, hdr, value);
+}
+
+void
+thread_on_end(void *ctx)
+{
+	threads_end(ctx);
+}
+
+/***********************************************************************
+ * Duplicates
+ ***********************************************************************/
+/*
+ * Messages saved, shared by the folders.  The messages saved are recorded
+ * only if the file exists, it's created by is_duplicate().
+ */
+#define	DEDUP_FILE		".mailfilter_dedup"
+
+static struct dedup		*dedup_store = NULL;
+static struct rfc5322_tap	 dedup_tap;		/* records */
+static struct rfc5322_tap	 dedup_check_tap;
+
+static void	 dedup_on_begin(void *);
+static void	 dedup_on_header(void *, const char *, const char *);
+static void	 dedup_on_body(void *, const char *, size_t);
+static void	 dedup_on_end(void *);
+static int	 l_dedup_read_file(lua_State *);
+
+/*
+ * msg:is_duplicate()
+ *
+ * Returns true if a message of the same Message-ID is saved already.  Only
+ * the headers are read, but the whole message is read if it doesn't have
+ * a Message-ID, the body is compared instead.
+ */
+int
+l_message_is_duplicate(lua_State *L)
+{
+	struct dedup	*store;
+	int		 i, ret = -1;
+
+	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+	lua_settop(L, 1);
+	store = dedup_store_open(L, true);
+
+	for (i = 0; i < 2 && ret == -1; i++) {
+		/* some don't have top() */
+		lua_getfield(L, 1, (i == 0)? "top" : "retr");
+		if (lua_isnil(L, -1)) {
+			lua_settop(L, 1);
+			continue;
+		}
+		lua_pushvalue(L, 1);
+		lua_createtable(L, 0, 1);
+		lua_pushlightuserdata(L, &dedup_check_tap);
+		lua_setfield(L, -2, "tap");
+		lua_call(L, 2, 0);
+		ret = dedup_check(store);
+	}
+	lua_pushboolean(L, ret == 1);
+
+	return (1);
+}
+
+/* returns the store if it exists or `create' is true, otherwise NULL */
+struct dedup *
+dedup_store_open(lua_State *L, bool create)
+{
+	const char	*home;
+	char		 path[PATH_MAX];
+
+	if (dedup_store != NULL)
+		return (dedup_store);
+	if ((home = getenv("HOME")) == NULL) {
+		if (create)
+			luaL_error(L, "missing HOME environment variable");
+		return (NULL);
+	}
+	snprintf(path, sizeof(path), "%s/Mail/%s", home, DEDUP_FILE);
+	if (!create && access(path, F_OK) == -1)
+		return (NULL);
+	if ((dedup_store = dedup_open(path)) == NULL) {
+		if (create)
+			luaL_error(L, "%s: %s", path, strerror(errno));
+		return (NULL);
+	}
+	dedup_tap.on_begin = dedup_on_begin;
+	dedup_tap.on_header = dedup_on_header;
+	dedup_tap.on_body = dedup_on_body;
+	dedup_tap.on_end = dedup_on_end;
+	dedup_tap.ctx = dedup_store;
+	dedup_check_tap = dedup_tap;
+	dedup_check_tap.on_end = NULL;
+
+	return (dedup_store);
+}
+
+/* let the saved message be recorded, `idx' is the callback table */
+void
+dedup_store_attach(lua_State *L, int idx)
+{
+	if (dedup_store_open(L, false) == NULL)
+		return;
+	lua_pushboolean(L, 1);
+	lua_setfield(L, (idx < 0)? idx - 1 : idx, "dedup");
+}
+
+/*
+ * Record the message file saved without parsing, errors are ignored.  The
+ * body is read only if the headers don't have a Message-ID.
+ */
+void
+dedup_store_file(lua_State *L, const char *path)
+{
+	int	 top;
+
+	if (dedup_store_open(L, false) == NULL)
+		return;
+	for (top = 1; top >= 0; top--) {
+		lua_pushcfunction(L, l_dedup_read_file);
+		lua_pushstring(L, path);
+		lua_createtable(L, 0, 1);
+		lua_pushlightuserdata(L, &dedup_check_tap);
+		lua_setfield(L, -2, "tap");
+		lua_pushboolean(L, top);
+		if (lua_pcall(L, 3, 0, 0) != LUA_OK) {
+			lua_settop(L, -2);
+			return;
+		}
+		if (dedup_check(dedup_store) != -1)
+			break;
+	}
+	dedup_end(dedup_store);
+}
+
+int
+l_dedup_read_file(lua_State *L)
+{
+	rfc5322_read_file(L, luaL_checkstring(L, 1), lua_toboolean(L, 3));
+
+	return (0);
+}
+
+void
+dedup_on_begin(void *ctx)
+{
+	dedup_begin(ctx);
+}
+
+void
+dedup_on_header(void *ctx, const char *hdr, const char *value)
+{
+	dedup_header(ctx, hdr, value);
+}
+
+void
+dedup_on_body(void *ctx, const char *line, size_t linelen)
+{
+	dedup_body(ctx, line, linelen);
+}
+
+void
+dedup_on_end(void *ctx)
+{
+	dedup_end(ctx);
+}
+
+/***********************************************************************
+ * Similar messages
+ ***********************************************************************/
+/*
+ * Fuzzy hashes of the messages read by similar(), shared by the folders,
+ * to find the bulk mail.
+ */
+#define	SIMHASH_FILE		".mailfilter_simhash"
+
+static struct simhash		*simhash_store = NULL;
+static struct bodytext		*simhash_text_conv = NULL;
+static struct rfc5322_tap	 simhash_tap;
+
+static void	 simhash_store_open(lua_State *);
+static void	 simhash_on_line(void *, const char *, size_t);
+static void	 simhash_on_begin(void *);
+static void	 simhash_on_header(void *, const char *, const char *);
+static void	 simhash_on_body(void *, const char *, size_t);
+static void	 simhash_on_end(void *);
+
+/*
+ * msg:similar([threshold [, callbacks ]])
+ *
+ * Reads the message and returns the number of the messages read before
+ * whose body text is similar to the message, and the similarity of the
+ * nearest one or nil.  The similarity is from 0 to 1, the messages of the
+ * similarity `threshold' (0.9 by default) or more are counted.  It must be
+ * 0.9 or more, the lookup can't find the messages less similar surely.
+ * The message is recorded then.  `callbacks' is passed to `retr' too, to use
+ * the same read for the others.  A message of a few words is not compared,
+ * 0 is returned.
+ */
+int
+l_message_similar(lua_State *L)
+{
+	lua_Number	 threshold;
+	int		 n, mindist;
+
+	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+	threshold = luaL_optnumber(L, 2, 0.9);
+	luaL_argcheck(L, 0.9 <= threshold && threshold <= 1.0, 2,
+	    "must be from 0.9 to 1");
+	if (!lua_isnoneornil(L, 3))
+		luaL_checktype(L, 3, LUA_TTABLE);
+	lua_settop(L, 3);
+	simhash_store_open(L);
+
+	lua_getfield(L, 1, "retr");
+	lua_pushvalue(L, 1);
+	lua_newtable(L);
+	if (lua_istable(L, 3)) {
+		lua_pushnil(L);
+		while (lua_next(L, 3) != 0) {
+			lua_pushvalue(L, -2);
+			lua_insert(L, -2);
+			lua_settable(L, -4);
+		}
+	}
+	lua_pushlightuserdata(L, &simhash_tap);
+	lua_setfield(L, -2, "tap");
+	lua_call(L, 2, 0);
+
+	if (simhash_end(simhash_store) == -1) {
+		lua_pushinteger(L, 0);
+		lua_pushnil(L);
+		return (2);
+	}
+	n = simhash_lookup(simhash_store, (int)((1.0 - threshold) * 64.0 +
+	    0.0001), &mindist);
+	simhash_put(simhash_store);
+	lua_pushinteger(L, n);
+	if (mindist < 0)
+		lua_pushnil(L);
+	else
+		lua_pushnumber(L, 1.0 - mindist / 64.0);
+
+	return (2);
+}
+
+void
+simhash_store_open(lua_State *L)
+{
+	const char	*home;
+	char		 path[PATH_MAX];
+
+	if (simhash_store != NULL)
+		return;
+	if ((home = getenv("HOME")) == NULL)
+		luaL_error(L, "missing HOME environment variable");
+	if ((simhash_text_conv = bodytext_new(simhash_on_line, NULL)) == NULL)
+		luaL_error(L, "bodytext_new(): %s", strerror(errno));
+	snprintf(path, sizeof(path), "%s/Mail/%s", home, SIMHASH_FILE);
+	if ((simhash_store = simhash_open(path)) == NULL) {
+		bodytext_free(simhash_text_conv);
+		simhash_text_conv = NULL;
+		luaL_error(L, "%s: %s", path, strerror(errno));
+	}
+	simhash_tap.on_begin = simhash_on_begin;
+	simhash_tap.on_header = simhash_on_header;
+	simhash_tap.on_body = simhash_on_body;
+	simhash_tap.on_end = simhash_on_end;
+	simhash_tap.ctx = simhash_store;
+}
+
+void
+simhash_on_line(void *ctx, const char *line, size_t linelen)
+{
+	line = str_normalize(line, linelen, &linelen);
+	simhash_text(simhash_store, line, linelen);
+}
+
+void
+simhash_on_begin(void *ctx)
+{
+	simhash_begin(ctx);
+	bodytext_begin(simhash_text_conv);
+}
+
+void
+simhash_on_header(void *ctx, const char *hdr, const char *value)
+{
+	simhash_header(ctx, hdr, value);
+	bodytext_header(simhash_text_conv, hdr, value);
+}
+
+void
+simhash_on_body(void *ctx, const char *line, size_t linelen)
+{
+	bodytext_body(simhash_text_conv, line, linelen);
+}
+
+void
+simhash_on_end(void *ctx)
+{
+	bodytext_end(simhash_text_conv);
+}
+
+/***********************************************************************
+ * Matcher
+ ***********************************************************************/
+struct mf_matcher {
+	struct matcher		*matcher;
+	struct matcher_state	 state;
+	int			 npats;
+	u_char			*hits;		/* found in the last message */
+	u_char			*scratch;	/* for `match' */
+	char			**headers;	/* headers to be scanned */
+	int			 nheaders;
+	bool			 body;
+	bool			 normalize;	/* NFKC and case folding */
+	struct bodytext		*text;		/* scan the text of the body */
+	struct rfc5322_tap	 tap;
+	struct mf_stat		 stat;
+};
+
+static int		 matcher_metatable(lua_State *);
+static int		 l_matcher_match(lua_State *);
+static int		 l_matcher_matches(lua_State *);
+static int		 l_matcher_gc(lua_State *);
+static void		 matcher_pushhits(lua_State *, int, int, u_char *);
+static void		 matcher_hit(void *, int);
+static void		 matcher_on_begin(void *);
+static void		 matcher_on_header(void *, const char *, const char *);
+static void		 matcher_on_end_of_headers(void *);
+static void		 matcher_on_body(void *, const char *, size_t);
+static void		 matcher_on_text(void *, const char *, size_t);
+static void		 matcher_on_end(void *);
+
+int
+matcher_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.matcher")) != 0) {
+		lua_pushstring(L, "match");
+		lua_pushcfunction(L, l_matcher_match);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "matches");
+		lua_pushcfunction(L, l_matcher_matches);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_matcher_gc);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.matcher(patterns [, options])
+ *
+ * `patterns' is a table of { id = pattern, ... }.  The pattern is a string
+ * or a table { pattern, icase = boolean }.  `options' may have `icase'
+ * (default for all patterns), `headers' (list of the header names to be
+ * scanned, all headers by default), `body' (scan the body or not), `text'
+ * (scan the text of the body decoded instead of the raw body), `normalize'
+ * (match after NFKC and case folding) and `name' (shown in the statistics).
+ */
+int
+l_matcher(lua_State *L)
+{
+	struct mf_matcher	*self, **userdata;
+	const char		*pat;
+	size_t			 patlen;
+	int			 i, flags, icase = 0;
+	char			 hdr[128];
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+	if (!lua_isnoneornil(L, 2))
+		luaL_checktype(L, 2, LUA_TTABLE);
+	lua_settop(L, 2);
+
+	userdata = lua_newuserdata(L, sizeof(self));
+	*userdata = NULL;
+
+	matcher_metatable(L);
+	lua_pushstring(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);
+	lua_setmetatable(L, -2);
+
+	if ((self = calloc(1, sizeof(*self))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	*userdata = self;
+	self->body = true;
+	self->tap.on_begin = matcher_on_begin;
+	self->tap.on_header = matcher_on_header;
+	self->tap.on_end_of_headers = matcher_on_end_of_headers;
+	self->tap.on_body = matcher_on_body;
+	self->tap.on_end = matcher_on_end;
+	self->tap.ctx = self;
+	self->tap.stat = &self->stat;
+	if ((self->matcher = matcher_new()) == NULL)
+		luaL_error(L, "matcher_new(): %s", strerror(errno));
+
+	if (lua_istable(L, 2))
+		lua_getfield(L, 2, "name");
+	else
+		lua_pushnil(L);
+	stat_register(&self->stat, "matcher", lua_tostring(L, -1));
+	lua_settop(L, -2);
+
+	if (lua_istable(L, 2)) {
+		lua_getfield(L, 2, "icase");
+		icase = lua_toboolean(L, -1);
+		lua_settop(L, -2);
+
+		lua_getfield(L, 2, "body");
+		if (!lua_isnil(L, -1))
+			self->body = lua_toboolean(L, -1);
+		lua_settop(L, -2);
+
+		lua_getfield(L, 2, "text");
+		if (lua_toboolean(L, -1) && (self->text =
+		    bodytext_new(matcher_on_text, self)) == NULL)
+			luaL_error(L, "bodytext_new(): %s", strerror(errno));
+		lua_settop(L, -2);
+
+		lua_getfield(L, 2, "normalize");
+		self->normalize = lua_toboolean(L, -1);
+		lua_settop(L, -2);
+
+		lua_getfield(L, 2, "headers");
+		if (lua_istable(L, -1)) {
+			self->nheaders = lua_rawlen(L, -1);
+			if ((self->headers = calloc(self->nheaders + 1,
+			    sizeof(char *))) == NULL)
+				luaL_error(L, "calloc(): %s", strerror(errno));
+			for (i = 0; i < self->nheaders; i++) {
+				lua_rawgeti(L, -1, i + 1);
+				str_tolower(luaL_checkstring(L, -1), hdr,
+				    sizeof(hdr));
+				if ((self->headers[i] = strdup(hdr)) == NULL)
+					luaL_error(L, "strdup(): %s",
+					    strerror(errno));
+				lua_settop(L, -2);
+			}
+		}
+		lua_settop(L, -2);
+	}
+
+	/* uservalue keeps the ids of the patterns */
+	lua_newtable(L);
+	lua_pushnil(L);
+	while (lua_next(L, 1) != 0) {
+		flags = (icase)? MATCHER_ICASE : 0;
+		if (lua_istable(L, -1)) {
+			lua_getfield(L, -1, "icase");
+			if (!lua_isnil(L, -1))
+				flags = (lua_toboolean(L, -1))
+				    ? MATCHER_ICASE : 0;
+			lua_settop(L, -2);
+			lua_rawgeti(L, -1, 1);
+			lua_replace(L, -2);
+		}
+		if (lua_type(L, -1) != LUA_TSTRING)
+			luaL_error(L, "pattern must be a string");
+		pat = lua_tolstring(L, -1, &patlen);
+		if (self->normalize)
+			pat = str_normalize(pat, patlen, &patlen);
+		if (matcher_add(self->matcher, pat, patlen, flags,
+		    self->npats) == -1)
+			luaL_error(L, "matcher_add(): %s", strerror(errno));
+		lua_settop(L, -2);
+		lua_pushvalue(L, -1);
+		lua_rawseti(L, 4, ++self->npats);
+	}
+	if (matcher_compile(self->matcher) == -1)
+		luaL_error(L, "matcher_compile(): %s", strerror(errno));
+	if ((self->hits = calloc(self->npats + 1, 1)) == NULL ||
+	    (self->scratch = calloc(self->npats + 1, 1)) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	lua_setuservalue(L, 3);
+
+	return (1);
+}
+
+/* returns the ids of the patterns found in the string, or nil */
+int
+l_matcher_match(lua_State *L)
+{
+	struct mf_matcher	*self;
+	struct matcher_state	 state;
+	const char		*str;
+	size_t			 len;
+
+	self = *(struct mf_matcher **)luaL_checkudata(L, 1, "mail.matcher");
+	str = luaL_checklstring(L, 2, &len);
+	if (self->normalize)
+		str = str_normalize(str, len, &len);
+
+	memset(self->scratch, 0, self->npats);
+	matcher_reset(self->matcher, &state);
+	matcher_scan(self->matcher, &state, str, len, matcher_hit,
+	    self->scratch);
+	matcher_pushhits(L, 1, self->npats, self->scratch);
+	if (lua_rawlen(L, -1) == 0)
+		lua_pushnil(L);
+
+	return (1);
+}
+
+/* returns the ids of the patterns found in the last message */
+int
+l_matcher_matches(lua_State *L)
+{
+	struct mf_matcher	*self;
+
+	self = *(struct mf_matcher **)luaL_checkudata(L, 1, "mail.matcher");
+	matcher_pushhits(L, 1, self->npats, self->hits);
+
+	return (1);
+}
+
+int
+l_matcher_gc(lua_State *L)
+{
+	struct mf_matcher	*self;
+	int			 i;
+
+	self = *(struct mf_matcher **)luaL_checkudata(L, 1, "mail.matcher");
+	if (self == NULL)
+		return (0);
+	stat_unregister(&self->stat);
+	matcher_free(self->matcher);
+	for (i = 0; self->headers != NULL && self->headers[i] != NULL; i++)
+		free(self->headers[i]);
+	free(self->headers);
+	free(self->hits);
+	free(self->scratch);
+	bodytext_free(self->text);
+	freezero(self, sizeof(*self));
+
+	return (0);
+}
+
+void
+matcher_pushhits(lua_State *L, int idx, int npats, u_char *hits)
+{
+	int	 i, n = 0;
+
+	lua_newtable(L);
+	lua_getuservalue(L, idx);
+	for (i = 0; i < npats; i++) {
+		if (!hits[i])
+			continue;
+		lua_rawgeti(L, -1, i + 1);
+		lua_rawseti(L, -3, ++n);
+	}
+	lua_settop(L, -2);
+}
+
+void
+matcher_hit(void *ctx, int id)
+{
+	u_char	*hits = ctx;
+
+	hits[id] = 1;
+}
+
+void
+matcher_on_begin(void *ctx)
+{
+	struct mf_matcher	*self = ctx;
+
+	memset(self->hits, 0, self->npats);
+	if (self->text != NULL)
+		bodytext_begin(self->text);
+}
+
+void
+matcher_on_header(void *ctx, const char *hdr, const char *value)
+{
+	struct mf_matcher	*self = ctx;
+	size_t			 len;
+	int			 i;
+
+	if (self->text != NULL)
+		bodytext_header(self->text, hdr, value);
+	if (self->headers != NULL) {
+		for (i = 0; self->headers[i] != NULL; i++) {
+			if (strcmp(self->headers[i], hdr) == 0)
+				break;
+		}
+		if (self->headers[i] == NULL)
+			return;
+	}
+	len = strlen(value);
+	if (self->normalize)
+		value = str_normalize(value, len, &len);
+	matcher_reset(self->matcher, &self->state);
+	matcher_scan(self->matcher, &self->state, value, len, matcher_hit,
+	    self->hits);
+}
+
+void
+matcher_on_end_of_headers(void *ctx)
+{
+	struct mf_matcher	*self = ctx;
+
+	matcher_reset(self->matcher, &self->state);
+}
+
+void
+matcher_on_body(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_matcher	*self = ctx;
+
+	if (!self->body)
+		return;
+	if (self->text != NULL)
+		bodytext_body(self->text, line, linelen);
+	else
+		matcher_on_text(self, line, linelen);
+}
+
+void
+matcher_on_text(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_matcher	*self = ctx;
+
+	if (self->normalize)
+		line = str_normalize(line, linelen, &linelen);
+	matcher_scan(self->matcher, &self->state, line, linelen, matcher_hit,
+	    self->hits);
+	matcher_scan(self->matcher, &self->state, "\n", 1, matcher_hit,
+	    self->hits);
+}
+
+void
+matcher_on_end(void *ctx)
+{
+	struct mf_matcher	*self = ctx;
+
+	if (self->text != NULL)
+		bodytext_end(self->text);
+	if (memchr(self->hits, 1, self->npats) != NULL)
+		self->stat.hits++;
+}
+
+/***********************************************************************
+ * Rules
+ ***********************************************************************/
+struct mf_rules {
+	struct rules		*rules;
+	lua_State		*L;
+	int			 testsref;	/* functions for `test' */
+	int64_t			 size;
+	bool			 headers_only;	/* top() */
+	char			**names;	/* names of the rules */
+	bool			 normalize;	/* NFKC and case folding */
+	struct bodytext		*text;		/* match the text of the body */
+	struct rfc5322_tap	 tap;
+	struct mf_stat		 stat;
+};
+
+static int		 rules_metatable(lua_State *);
+static void		 rules_compile_cond(lua_State *, struct mf_rules *,
+			    int, int);
+static int		 l_rules_result(lua_State *);
+static int		 l_rules_gc(lua_State *);
+static int		 rules_test(void *, int, const char *);
+static void		 rules_on_begin(void *);
+static void		 rules_on_header(void *, const char *, const char *);
+static void		 rules_on_end_of_headers(void *);
+static void		 rules_on_body(void *, const char *, size_t);
+static void		 rules_on_text(void *, const char *, size_t);
+static void		 rules_on_end(void *);
+
+int
+rules_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.rules")) != 0) {
+		lua_pushstring(L, "result");
+		lua_pushcfunction(L, l_rules_result);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_rules_gc);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.rules{ rule, ... }
+ *
+ * A rule is a table of conditions and an `action'.  Conditions are
+ *   header = name, contains = string [, icase = boolean ]
+ *   contains = string (body)
+ *   header = name, exists = true
+ *   header = name, test = function(value) ... end
+ *   larger = bytes, smaller = bytes
+ *   ["and"] = { cond, ... }, ["or"] = { cond, ... }, ["not"] = cond
+ * and multiple conditions in a table are ANDed.  The rules are evaluated
+ * natively while the message is read, Lua is called only for `test'.
+ * A rule may have `name' and the 2nd argument may have `name' of the rules,
+ * they are shown in the statistics.  The body is matched with its text
+ * decoded if the 2nd argument has `text' = true.  The strings and the
+ * values are matched after NFKC and case folding if it has `normalize' =
+ * true.  The body isn't read by `top', then the conditions on the body,
+ * and on the size if it isn't known, are undecided and don't match.
+ */
+int
+l_rules(lua_State *L)
+{
+	struct mf_rules		*self, **userdata;
+	int			 i, n;
+	bool			 text = false, normalize = false;
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+	if (!lua_isnoneornil(L, 2))
+		luaL_checktype(L, 2, LUA_TTABLE);
+	lua_settop(L, 2);
+	if (lua_istable(L, 2)) {
+		lua_getfield(L, 2, "text");
+		text = lua_toboolean(L, -1);
+		lua_settop(L, -2);
+		lua_getfield(L, 2, "normalize");
+		normalize = lua_toboolean(L, -1);
+		lua_settop(L, -2);
+		lua_getfield(L, 2, "name");
+	} else
+		lua_pushnil(L);
+	lua_replace(L, 2);
+
+	userdata = lua_newuserdata(L, sizeof(self));
+	*userdata = NULL;
+
+	rules_metatable(L);
+	lua_pushstring(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);
+	lua_setmetatable(L, -2);
+
+	if ((self = calloc(1, sizeof(*self))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	*userdata = self;
+	self->testsref = LUA_NOREF;
+	self->normalize = normalize;
+	self->tap.on_begin = rules_on_begin;
+	self->tap.on_header = rules_on_header;
+	self->tap.on_end_of_headers = rules_on_end_of_headers;
+	self->tap.on_body = rules_on_body;
+	self->tap.on_end = rules_on_end;
+	self->tap.ctx = self;
+	self->tap.stat = &self->stat;
+	self->stat.rules = self;
+	if ((self->rules = rules_new()) == NULL)
+		luaL_error(L, "rules_new(): %s", strerror(errno));
+	if (text && (self->text = bodytext_new(rules_on_text, self)) == NULL)
+		luaL_error(L, "bodytext_new(): %s", strerror(errno));
+
+	lua_newtable(L);	/* 4: actions */
+	lua_newtable(L);	/* 5: tests */
+	n = lua_rawlen(L, 1);
+	if ((self->names = calloc(n + 1, sizeof(char *))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	for (i = 1; i <= n; i++) {
+		lua_rawgeti(L, 1, i);
+		luaL_argcheck(L, lua_istable(L, -1), 1, "rule must be a table");
+		rules_compile_cond(L, self, lua_gettop(L), 5);
+		if (rules_add(self->rules) == -1)
+			luaL_error(L, "rules_add(): %s", strerror(errno));
+		lua_getfield(L, -1, "action");
+		if (lua_isnil(L, -1))
+			luaL_error(L, "rule #%d: missing action", i);
+		lua_rawseti(L, 4, i);
+		lua_getfield(L, -1, "name");
+		if (lua_isstring(L, -1) && (self->names[i - 1] =
+		    strdup(lua_tostring(L, -1))) == NULL)
+			luaL_error(L, "strdup(): %s", strerror(errno));
+		lua_settop(L, -3);
+	}
+	if (rules_compile(self->rules) == -1)
+		luaL_error(L, "rules_compile(): %s", strerror(errno));
+	self->testsref = luaL_ref(L, LUA_REGISTRYINDEX);
+	lua_setuservalue(L, 3);
+	/* the report walks the rules, register once they are complete */
+	stat_register(&self->stat, "rules", lua_tostring(L, 2));
+
+	return (1);
+}
+
+void
+rules_compile_cond(lua_State *L, struct mf_rules *self, int idx, int tests)
+{
+	const char	*header = NULL, *pat;
+	char		 hdr[128];
+	size_t		 patlen;
+	int		 i, j, n, ncond = 0, leaf, flags;
+	static const char
+			*conds[] = { "contains", "exists", "test", "larger",
+			    "smaller", "and", "or", "not" };
+
+	for (i = 0; i < (int)(sizeof(conds) / sizeof(conds[0])); i++) {
+		lua_getfield(L, idx, conds[i]);
+		if (!lua_isnil(L, -1))
+			ncond++;
+		lua_settop(L, -2);
+	}
+	if (ncond == 0)
+		luaL_error(L, "rule has no condition");
+	if (ncond > 1 && rules_open(self->rules, RULES_AND) == -1)
+		luaL_error(L, "rules_open(): %s", strerror(errno));
+
+	lua_getfield(L, idx, "header");
+	if (!lua_isnil(L, -1))
+		header = str_tolower(luaL_checkstring(L, -1), hdr, sizeof(hdr));
+	lua_settop(L, -2);
+
+	lua_getfield(L, idx, "contains");
+	if (!lua_isnil(L, -1)) {
+		pat = luaL_checklstring(L, -1, &patlen);
+		if (self->normalize)
+			pat = str_normalize(pat, patlen, &patlen);
+		lua_getfield(L, idx, "icase");
+		flags = (lua_toboolean(L, -1))? MATCHER_ICASE : 0;
+		lua_settop(L, -2);
+		if (rules_leaf(self->rules, RULES_CONTAINS, header, pat,
+		    patlen, flags, 0) == -1)
+			luaL_error(L, "rules_leaf(): %s", strerror(errno));
+	}
+	lua_settop(L, -2);
+
+	lua_getfield(L, idx, "exists");
+	if (!lua_isnil(L, -1)) {
+		if (header == NULL)
+			luaL_error(L, "`exists' needs `header'");
+		if (rules_leaf(self->rules, RULES_EXISTS, header, NULL, 0, 0,
+		    0) == -1)
+			luaL_error(L, "rules_leaf(): %s", strerror(errno));
+	}
+	lua_settop(L, -2);
+
+	lua_getfield(L, idx, "test");
+	if (!lua_isnil(L, -1)) {
+		luaL_checktype(L, -1, LUA_TFUNCTION);
+		if (header == NULL)
+			luaL_error(L, "`test' needs `header'");
+		if ((leaf = rules_leaf(self->rules, RULES_EXTERN, header, NULL,
+		    0, 0, 0)) == -1)
+			luaL_error(L, "rules_leaf(): %s", strerror(errno));
+		lua_pushvalue(L, -1);
+		lua_rawseti(L, tests, leaf + 1);
+	}
+	lua_settop(L, -2);
+
+	lua_getfield(L, idx, "larger");
+	if (!lua_isnil(L, -1) && rules_leaf(self->rules, RULES_LARGER, NULL,
+	    NULL, 0, 0, luaL_checkinteger(L, -1)) == -1)
+		luaL_error(L, "rules_leaf(): %s", strerror(errno));
+	lua_settop(L, -2);
+
+	lua_getfield(L, idx, "smaller");
+	if (!lua_isnil(L, -1) && rules_leaf(self->rules, RULES_SMALLER, NULL,
+	    NULL, 0, 0, luaL_checkinteger(L, -1)) == -1)
+		luaL_error(L, "rules_leaf(): %s", strerror(errno));
+	lua_settop(L, -2);
+
+	for (i = 0; i < 2; i++) {
+		lua_getfield(L, idx, (i == 0)? "and" : "or");
+		if (!lua_isnil(L, -1)) {
+			luaL_checktype(L, -1, LUA_TTABLE);
+			if (rules_open(self->rules,
+			    (i == 0)? RULES_AND : RULES_OR) == -1)
+				luaL_error(L, "rules_open(): %s",
+				    strerror(errno));
+			n = lua_rawlen(L, -1);
+			for (j = 1; j <= n; j++) {
+				lua_rawgeti(L, -1, j);
+				luaL_checktype(L, -1, LUA_TTABLE);
+				rules_compile_cond(L, self, lua_gettop(L),
+				    tests);
+				lua_settop(L, -2);
+			}
+			if (rules_close(self->rules) == -1)
+				luaL_error(L, "empty `%s'",
+				    (i == 0)? "and" : "or");
+		}
+		lua_settop(L, -2);
+	}
+
+	lua_getfield(L, idx, "not");
+	if (!lua_isnil(L, -1)) {
+		luaL_checktype(L, -1, LUA_TTABLE);
+		if (rules_open(self->rules, RULES_NOT) == -1)
+			luaL_error(L, "rules_open(): %s", strerror(errno));
+		rules_compile_cond(L, self, lua_gettop(L), tests);
+		if (rules_close(self->rules) == -1)
+			luaL_error(L, "rules_close(): %s", strerror(errno));
+	}
+	lua_settop(L, -2);
+
+	if (ncond > 1 && rules_close(self->rules) == -1)
+		luaL_error(L, "rules_close(): %s", strerror(errno));
+}
+
+/* returns the action and the index of the rule matched the last message */
+int
+l_rules_result(lua_State *L)
+{
+	struct mf_rules		*self;
+	int			 r;
+
+	self = *(struct mf_rules **)luaL_checkudata(L, 1, "mail.rules");
+	if ((r = rules_result(self->rules)) < 0) {
+		lua_pushnil(L);
+		return (1);
+	}
+	lua_getuservalue(L, 1);
+	lua_rawgeti(L, -1, r + 1);
+	lua_pushinteger(L, r + 1);
+
+	return (2);
+}
+
+int
+l_rules_gc(lua_State *L)
+{
+	struct mf_rules		*self;
+	int			 i;
+
+	self = *(struct mf_rules **)luaL_checkudata(L, 1, "mail.rules");
+	if (self == NULL)
+		return (0);
+	stat_unregister(&self->stat);
+	luaL_unref(L, LUA_REGISTRYINDEX, self->testsref);
+	for (i = 0; self->names != NULL && self->names[i] != NULL; i++)
+		free(self->names[i]);
+	free(self->names);
+	rules_free(self->rules);
+	bodytext_free(self->text);
+	freezero(self, sizeof(*self));
+
+	return (0);
+}
+
+int
+rules_test(void *ctx, int leaf, const char *value)
+{
+	struct mf_rules		*self = ctx;
+	lua_State		*L = self->L;
+	int			 ret;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, self->testsref);
+	lua_rawgeti(L, -1, leaf + 1);
+	lua_pushstring(L, value);
+	lua_call(L, 1, 1);
+	ret = lua_toboolean(L, -1);
+	lua_settop(L, -3);
+
+	return (ret);
+}
+
+void
+rules_on_begin(void *ctx)
+{
+	struct mf_rules		*self = ctx;
+
+	rules_begin(self->rules, self->size, self->headers_only);
+	if (self->text != NULL)
+		bodytext_begin(self->text);
+}
+
+void
+rules_on_header(void *ctx, const char *hdr, const char *value)
+{
+	struct mf_rules		*self = ctx;
+	char			*copy = NULL;
+	size_t			 len;
+
+	if (self->text != NULL)
+		bodytext_header(self->text, hdr, value);
+	if (self->normalize) {
+		/* copied since `test' may normalize another */
+		value = str_normalize(value, strlen(value), &len);
+		if ((copy = strndup(value, len)) != NULL)
+			value = copy;
+	}
+	rules_header(self->rules, hdr, value, rules_test, self);
+	free(copy);
+}
+
+void
+rules_on_end_of_headers(void *ctx)
+{
+	struct mf_rules		*self = ctx;
+
+	rules_end_of_headers(self->rules);
+}
+
+void
+rules_on_body(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_rules		*self = ctx;
+
+	if (self->text != NULL)
+		bodytext_body(self->text, line, linelen);
+	else
+		rules_on_text(self, line, linelen);
+}
+
+void
+rules_on_text(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_rules		*self = ctx;
+
+	if (self->normalize)
+		line = str_normalize(line, linelen, &linelen);
+	rules_body(self->rules, line, linelen);
+}
+
+void
+rules_on_end(void *ctx)
+{
+	struct mf_rules		*self = ctx;
+
+	if (self->text != NULL)
+		bodytext_end(self->text);
+	rules_end(self->rules, -1);
+	if (rules_result(self->rules) >= 0)
+		self->stat.hits++;
+}
+
+/***********************************************************************
+ * Bayes
+ ***********************************************************************/
+struct mf_bayes {
+	struct bayes		*bayes;
+	bool			 read;		/* a message has been read */
+	bool			 normalize;	/* NFKC and case folding */
+	struct bodytext		*text;		/* tokenize the body text */
+	struct rfc5322_tap	 tap;
+	struct mf_stat		 stat;
+};
+
+static int		 bayes_metatable(lua_State *);
+static int		 l_bayes_score(lua_State *);
+static int		 l_bayes_train(lua_State *);
+static int		 l_bayes_counts(lua_State *);
+static int		 l_bayes_gc(lua_State *);
+static void		 bayes_on_begin(void *);
+static void		 bayes_on_header(void *, const char *, const char *);
+static void		 bayes_on_body(void *, const char *, size_t);
+static void		 bayes_on_text(void *, const char *, size_t);
+static void		 bayes_on_end(void *);
+
+int
+bayes_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.bayes")) != 0) {
+		lua_pushstring(L, "score");
+		lua_pushcfunction(L, l_bayes_score);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "train");
+		lua_pushcfunction(L, l_bayes_train);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "counts");
+		lua_pushcfunction(L, l_bayes_counts);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_bayes_gc);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.bayes(path [, options ])
+ *
+ * Opens the token database at `path', it is created if it doesn't exist.
+ * `options' may have `name' (shown in the statistics), `text' (tokenize
+ * the text of the body decoded instead of the raw body) and `normalize'
+ * (tokenize after NFKC and case folding).  Pass the object
+ * as `bayes' in the callback table of `top' or `retr', then the message is
+ * tokenized while it is read.
+ */
+int
+l_bayes(lua_State *L)
+{
+	struct mf_bayes		*self, **userdata;
+	const char		*path;
+
+	path = luaL_checkstring(L, 1);
+	if (!lua_isnoneornil(L, 2))
+		luaL_checktype(L, 2, LUA_TTABLE);
+	lua_settop(L, 2);
+
+	userdata = lua_newuserdata(L, sizeof(self));
+	*userdata = NULL;
+
+	bayes_metatable(L);
+	lua_pushstring(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);
+	lua_setmetatable(L, -2);
+
+	if ((self = calloc(1, sizeof(*self))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	*userdata = self;
+	self->tap.on_begin = bayes_on_begin;
+	self->tap.on_header = bayes_on_header;
+	self->tap.on_body = bayes_on_body;
+	self->tap.on_end = bayes_on_end;
+	self->tap.ctx = self;
+	self->tap.stat = &self->stat;
+
+	if (lua_istable(L, 2))
+		lua_getfield(L, 2, "name");
+	else
+		lua_pushnil(L);
+	stat_register(&self->stat, "bayes", lua_tostring(L, -1));
+	lua_settop(L, -2);
+
+	if (lua_istable(L, 2)) {
+		lua_getfield(L, 2, "text");
+		if (lua_toboolean(L, -1) && (self->text =
+		    bodytext_new(bayes_on_text, self)) == NULL)
+			luaL_error(L, "bodytext_new(): %s", strerror(errno));
+		lua_settop(L, -2);
+
+		lua_getfield(L, 2, "normalize");
+		self->normalize = lua_toboolean(L, -1);
+		lua_settop(L, -2);
+	}
+
+	if ((self->bayes = bayes_open(path)) == NULL)
+		luaL_error(L, "bayes_open(%s): %s", path, strerror(errno));
+
+	return (1);
+}
+
+/* returns the spam probability of the last message, or nil */
+int
+l_bayes_score(lua_State *L)
+{
+	struct mf_bayes		*self;
+
+	self = *(struct mf_bayes **)luaL_checkudata(L, 1, "mail.bayes");
+	if (!self->read) {
+		lua_pushnil(L);
+		return (1);
+	}
+	lua_pushnumber(L, bayes_score(self->bayes));
+
+	return (1);
+}
+
+/*
+ * b:train(msg, "spam" | "ham")
+ *
+ * Reads the message and trains it.  If `msg' is nil, the last message read
+ * is trained.
+ */
+int
+l_bayes_train(lua_State *L)
+{
+	struct mf_bayes		*self;
+	int			 class;
+	static const char	*classes[] = { "ham", "spam", NULL };
+
+	self = *(struct mf_bayes **)luaL_checkudata(L, 1, "mail.bayes");
+	class = luaL_checkoption(L, 3, NULL, classes);
+	lua_settop(L, 3);
+
+	if (!lua_isnil(L, 2)) {
+		luaL_checktype(L, 2, LUA_TTABLE);
+		lua_getfield(L, 2, "retr");
+		lua_pushvalue(L, 2);
+		lua_createtable(L, 0, 1);
+		lua_pushvalue(L, 1);
+		lua_setfield(L, -2, "bayes");
+		lua_call(L, 2, 0);
+	}
+	if (!self->read)
+		luaL_error(L, "no message to be trained");
+	if (bayes_train(self->bayes, (class == 1)? BAYES_SPAM : BAYES_HAM)
+	    == -1)
+		luaL_error(L, "bayes_train(): %s", strerror(errno));
+
+	return (0);
+}
+
+/* returns the numbers of the spam and the ham trained */
+int
+l_bayes_counts(lua_State *L)
+{
+	struct mf_bayes		*self;
+	uint32_t		 nspam, nham;
+
+	self = *(struct mf_bayes **)luaL_checkudata(L, 1, "mail.bayes");
+	bayes_counts(self->bayes, &nspam, &nham);
+	lua_pushinteger(L, nspam);
+	lua_pushinteger(L, nham);
+
+	return (2);
+}
+
+int
+l_bayes_gc(lua_State *L)
+{
+	struct mf_bayes		*self;
+
+	self = *(struct mf_bayes **)luaL_checkudata(L, 1, "mail.bayes");
+	if (self == NULL)
+		return (0);
+	stat_unregister(&self->stat);
+	bayes_close(self->bayes);
+	bodytext_free(self->text);
+	freezero(self, sizeof(*self));
+
+	return (0);
+}
+
+void
+bayes_on_begin(void *ctx)
+{
+	struct mf_bayes		*self = ctx;
+
+	self->read = false;
+	bayes_begin(self->bayes);
+	if (self->text != NULL)
+		bodytext_begin(self->text);
+}
+
+void
+bayes_on_header(void *ctx, const char *hdr, const char *value)
+{
+	struct mf_bayes		*self = ctx;
+	size_t			 len;
+
+	if (self->text != NULL)
+		bodytext_header(self->text, hdr, value);
+	if (self->normalize)
+		value = str_normalize(value, strlen(value), &len);
+	bayes_header(self->bayes, hdr, value);
+}
+
+void
+bayes_on_body(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_bayes		*self = ctx;
+
+	if (self->text != NULL)
+		bodytext_body(self->text, line, linelen);
+	else
+		bayes_on_text(self, line, linelen);
+}
+
+void
+bayes_on_text(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_bayes		*self = ctx;
+
+	if (self->normalize)
+		line = str_normalize(line, linelen, &linelen);
+	bayes_body(self->bayes, line, linelen);
+}
+
+void
+bayes_on_end(void *ctx)
+{
+	struct mf_bayes		*self = ctx;
+
+	if (self->text != NULL)
+		bodytext_end(self->text);
+	self->read = true;
+}
+
+/***********************************************************************
+ * Address set
+ ***********************************************************************/
+static int	 addrset_metatable(lua_State *);
+static int	 l_addrset_match(lua_State *);
+static int	 l_addrset_count(lua_State *);
+static int	 l_addrset_gc(lua_State *);
+
+int
+addrset_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.addrset")) != 0) {
+		lua_pushstring(L, "match");
+		lua_pushcfunction(L, l_addrset_match);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "count");
+		lua_pushcfunction(L, l_addrset_count);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_addrset_gc);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.addrset(path)
+ *
+ * `path' is a text file of the addresses and the domains, one per line.
+ * It's built into `path.db' if the file is missing or older, the processes
+ * share the built file.
+ */
+int
+l_addrset(lua_State *L)
+{
+	struct addrset	**userdata;
+	const char	 *path;
+	char		  dbpath[PATH_MAX];
+	struct stat	  st, dbst;
+
+	path = luaL_checkstring(L, 1);
+	lua_settop(L, 1);
+
+	userdata = lua_newuserdata(L, sizeof(struct addrset *));
+	*userdata = NULL;
+
+	addrset_metatable(L);
+	lua_pushstring(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);
+	lua_setmetatable(L, -2);
+
+	if (snprintf(dbpath, sizeof(dbpath), "%s.db", path) >=
+	    (int)sizeof(dbpath))
+		luaL_error(L, "%s: %s", path, strerror(ENAMETOOLONG));
+	if (stat(path, &st) == -1)
+		luaL_error(L, "%s: %s", path, strerror(errno));
+	if ((stat(dbpath, &dbst) == -1 ||
+	    st.st_mtim.tv_sec > dbst.st_mtim.tv_sec ||
+	    (st.st_mtim.tv_sec == dbst.st_mtim.tv_sec &&
+	    st.st_mtim.tv_nsec > dbst.st_mtim.tv_nsec)) &&
+	    addrset_build(path, dbpath) == -1)
+		luaL_error(L, "%s: build failed: %s", dbpath, strerror(errno));
+	if ((*userdata = addrset_open(dbpath)) == NULL)
+		luaL_error(L, "%s: %s", dbpath, strerror(errno));
+
+	return (1);
+}
+
+/*
+ * set:match(str)
+ *
+ * Returns the entry matched with the address or the host name, or nil.
+ * A domain matches the addresses and the hosts of its subdomains.
+ */
+int
+l_addrset_match(lua_State *L)
+{
+	struct addrset	*set;
+	const char	*str, *entry;
+	size_t		 len, entrylen;
+
+	set = *(struct addrset **)luaL_checkudata(L, 1, "mail.addrset");
+	str = luaL_checklstring(L, 2, &len);
+	if ((entry = addrset_match(set, str, len, &entrylen)) == NULL)
+		lua_pushnil(L);
+	else
+		lua_pushlstring(L, entry, entrylen);
+
+	return (1);
+}
+
+int
+l_addrset_count(lua_State *L)
+{
+	struct addrset	*set;
+
+	set = *(struct addrset **)luaL_checkudata(L, 1, "mail.addrset");
+	lua_pushinteger(L, addrset_count(set));
+
+	return (1);
+}
+
+int
+l_addrset_gc(lua_State *L)
+{
+	struct addrset	**set;
+
+	set = luaL_checkudata(L, 1, "mail.addrset");
+	addrset_close(*set);
+	*set = NULL;
+
+	return (0);
+}
+
+/***********************************************************************
+ * URL scanner
+ ***********************************************************************/
+struct mf_urlscan_hit {
+	size_t			 host;		/* index of the host */
+	const char		*entry;		/* in the address set */
+	size_t			 entrylen;
+};
+
+struct mf_urlscan {
+	struct urlscan		*scan;
+	struct mime		*mime;
+	struct addrset		**set;		/* referred by the uservalue */
+	struct mf_urlscan_hit	*hits;
+	size_t			 nhits;
+	struct rfc5322_tap	 tap;
+	struct mf_stat		 stat;
+};
+
+static int		 urlscan_metatable(lua_State *);
+static int		 l_urlscan_count(lua_State *);
+static int		 l_urlscan_hits(lua_State *);
+static int		 l_urlscan_gc(lua_State *);
+static void		 urlscan_on_data(void *, const struct mime_part *,
+			    const char *, size_t);
+static void		 urlscan_on_begin(void *);
+static void		 urlscan_on_header(void *, const char *, const char *);
+static void		 urlscan_on_body(void *, const char *, size_t);
+static void		 urlscan_on_end(void *);
+
+int
+urlscan_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.urlscan")) != 0) {
+		lua_pushstring(L, "count");
+		lua_pushcfunction(L, l_urlscan_count);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "hits");
+		lua_pushcfunction(L, l_urlscan_hits);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_urlscan_gc);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.urlscan([set [, options]])
+ *
+ * Scans the URLs in the text parts of the body, the host names are matched
+ * with `set', an address set of the domains.  `options' may have `name'
+ * (shown in the statistics).
+ */
+int
+l_urlscan(lua_State *L)
+{
+	struct mf_urlscan	*self, **userdata;
+
+	if (!lua_isnoneornil(L, 1))
+		luaL_checkudata(L, 1, "mail.addrset");
+	if (!lua_isnoneornil(L, 2))
+		luaL_checktype(L, 2, LUA_TTABLE);
+	lua_settop(L, 2);
+
+	userdata = lua_newuserdata(L, sizeof(self));
+	*userdata = NULL;
+
+	urlscan_metatable(L);
+	lua_pushstring(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);
+	lua_setmetatable(L, -2);
+
+	/* keep the set while in use */
+	lua_pushvalue(L, 1);
+	lua_setuservalue(L, -2);
+
+	if ((self = calloc(1, sizeof(*self))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	*userdata = self;
+	self->tap.on_begin = urlscan_on_begin;
+	self->tap.on_header = urlscan_on_header;
+	self->tap.on_body = urlscan_on_body;
+	self->tap.on_end = urlscan_on_end;
+	self->tap.ctx = self;
+	self->tap.stat = &self->stat;
+	if ((self->scan = urlscan_new()) == NULL)
+		luaL_error(L, "urlscan_new(): %s", strerror(errno));
+	if ((self->mime = mime_new(urlscan_on_data, self)) == NULL)
+		luaL_error(L, "mime_new(): %s", strerror(errno));
+	if (!lua_isnil(L, 1)) {
+		self->set = lua_touserdata(L, 1);
+		if ((self->hits = calloc(URLSCAN_MAXHOSTS,
+		    sizeof(struct mf_urlscan_hit))) == NULL)
+			luaL_error(L, "calloc(): %s", strerror(errno));
+	}
+
+	if (lua_istable(L, 2))
+		lua_getfield(L, 2, "name");
+	else
+		lua_pushnil(L);
+	stat_register(&self->stat, "urlscan", lua_tostring(L, -1));
+	lua_settop(L, -2);
+
+	return (1);
+}
+
+/*
+ * scan:count()
+ *
+ * Returns the number of the URLs and the number of the distinct hosts in
+ * the last message.
+ */
+int
+l_urlscan_count(lua_State *L)
+{
+	struct mf_urlscan	*self;
+
+	self = *(struct mf_urlscan **)luaL_checkudata(L, 1, "mail.urlscan");
+	lua_pushinteger(L, urlscan_nurls(self->scan));
+	lua_pushinteger(L, urlscan_nhosts(self->scan));
+
+	return (2);
+}
+
+/*
+ * scan:hits()
+ *
+ * Returns the list of the hosts matched with the set in the last message,
+ * { { host = host, entry = entry in the set, count = number of the URLs },
+ * ... }.
+ */
+int
+l_urlscan_hits(lua_State *L)
+{
+	struct mf_urlscan	*self;
+	const char		*host;
+	u_int			 count;
+	size_t			 i;
+
+	self = *(struct mf_urlscan **)luaL_checkudata(L, 1, "mail.urlscan");
+	lua_createtable(L, self->nhits, 0);
+	for (i = 0; i < self->nhits; i++) {
+		host = urlscan_host(self->scan, self->hits[i].host, &count);
+		lua_createtable(L, 0, 3);
+		lua_pushstring(L, host);
+		lua_setfield(L, -2, "host");
+		lua_pushlstring(L, self->hits[i].entry,
+		    self->hits[i].entrylen);
+		lua_setfield(L, -2, "entry");
+		lua_pushinteger(L, count);
+		lua_setfield(L, -2, "count");
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return (1);
+}
+
+int
+l_urlscan_gc(lua_State *L)
+{
+	struct mf_urlscan	*self;
+
+	self = *(struct mf_urlscan **)luaL_checkudata(L, 1, "mail.urlscan");
+	if (self == NULL)
+		return (0);
+	stat_unregister(&self->stat);
+	urlscan_free(self->scan);
+	mime_free(self->mime);
+	free(self->hits);
+	freezero(self, sizeof(*self));
+
+	return (0);
+}
+
+void
+urlscan_on_data(void *ctx, const struct mime_part *part, const char *data,
+    size_t len)
+{
+	struct mf_urlscan	*self = ctx;
+
+	/* text/plain, text/html and so on */
+	if (strncmp(part->type, "text/", 5) == 0)
+		urlscan_text(self->scan, data, len);
+}
+
+void
+urlscan_on_begin(void *ctx)
+{
+	struct mf_urlscan	*self = ctx;
+
+	urlscan_begin(self->scan);
+	mime_begin(self->mime);
+	self->nhits = 0;
+}
+
+void
+urlscan_on_header(void *ctx, const char *hdr, const char *value)
+{
+	struct mf_urlscan	*self = ctx;
+
+	mime_header(self->mime, hdr, value);
+}
+
+void
+urlscan_on_body(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_urlscan	*self = ctx;
+
+	mime_body(self->mime, line, linelen);
+}
+
+void
+urlscan_on_end(void *ctx)
+{
+	struct mf_urlscan	*self = ctx;
+	struct mf_urlscan_hit	*hit;
+	const char		*host;
+	size_t			 i;
+
+	mime_end(self->mime);
+	urlscan_end(self->scan);
+	if (self->set == NULL || *self->set == NULL)
+		return;
+	for (i = 0; (host = urlscan_host(self->scan, i, NULL)) != NULL;
+	    i++) {
+		hit = &self->hits[self->nhits];
+		if ((hit->entry = addrset_match(*self->set, host, strlen(host),
+		    &hit->entrylen)) == NULL)
+			continue;
+		hit->host = i;
+		self->nhits++;
+	}
+	if (self->nhits > 0)
+		self->stat.hits++;
+}
+
+/***********************************************************************
+ * Part scanner
+ ***********************************************************************/
+#define	PARTSCAN_MAXPARTS	64	/* parts reported in a message */
+
+struct mf_partscan_part {
+	struct mime_part	 part;
+	enum sniff_type		 type;
+};
+
+struct mf_partscan {
+	struct mime		*mime;
+	struct sniff		 sniff;		/* of the last part */
+	bool			 sniffing;
+	struct mf_partscan_part	*parts;
+	int			 nparts;
+	bool			 abort[SNIFF_NTYPES];
+	int			 found;		/* first part to abort, or -1 */
+	struct rfc5322_tap	 tap;
+	struct mf_stat		 stat;
+};
+
+static int		 partscan_metatable(lua_State *);
+static int		 l_partscan_parts(lua_State *);
+static int		 l_partscan_found(lua_State *);
+static int		 l_partscan_gc(lua_State *);
+static void		 partscan_pushpart(lua_State *,
+			    struct mf_partscan_part *);
+static void		 partscan_sniffed(struct mf_partscan *,
+			    enum sniff_type);
+static void		 partscan_on_data(void *, const struct mime_part *,
+			    const char *, size_t);
+static void		 partscan_on_begin(void *);
+static void		 partscan_on_header(void *, const char *, const char *);
+static void		 partscan_on_body(void *, const char *, size_t);
+static void		 partscan_on_end(void *);
+
+int
+partscan_metatable(lua_State *L)
+{
+	int	 ret;
+
+	if ((ret = luaL_newmetatable(L, "mail.partscan")) != 0) {
+		lua_pushstring(L, "parts");
+		lua_pushcfunction(L, l_partscan_parts);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "found");
+		lua_pushcfunction(L, l_partscan_found);
+		lua_settable(L, -3);
+
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_partscan_gc);
+		lua_settable(L, -3);
+	}
+
+	return (ret);
+}
+
+/*
+ * mailfilter.partscan([options])
+ *
+ * Inspects the parts of the body.  The type of the content is taken from
+ * the first bytes decoded, the rest of the part is skipped without being
+ * decoded, except the zip archives and PDF which are followed to find the
+ * macros, the executables and JavaScript.  `options' may have `abort', the
+ * list of the types to stop reading the message when found ("exe", "vba",
+ * "pdf-js" and so on), and `name' (shown in the statistics).
+ */
+int
+l_partscan(lua_State *L)
+{
+	struct mf_partscan	*self, **userdata;
+	int			 i, n, type;
+
+	if (!lua_isnoneornil(L, 1))
+		luaL_checktype(L, 1, LUA_TTABLE);
+	lua_settop(L, 1);
+
+	userdata = lua_newuserdata(L, sizeof(self));
+	*userdata = NULL;
+
+	partscan_metatable(L);
+	lua_pushstring(L, "__index");
+	lua_pushvalue(L, -2);
+	lua_settable(L, -3);
+	lua_setmetatable(L, -2);
+
+	if ((self = calloc(1, sizeof(*self))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+	*userdata = self;
+	self->found = -1;
+	self->tap.on_begin = partscan_on_begin;
+	self->tap.on_header = partscan_on_header;
+	self->tap.on_body = partscan_on_body;
+	self->tap.on_end = partscan_on_end;
+	self->tap.ctx = self;
+	self->tap.stat = &self->stat;
+	if ((self->mime = mime_new(partscan_on_data, self)) == NULL)
+		luaL_error(L, "mime_new(): %s", strerror(errno));
+	if ((self->parts = calloc(PARTSCAN_MAXPARTS,
+	    sizeof(struct mf_partscan_part))) == NULL)
+		luaL_error(L, "calloc(): %s", strerror(errno));
+
+	if (lua_istable(L, 1)) {
+		lua_getfield(L, 1, "abort");
+		if (!lua_isnil(L, -1)) {
+			luaL_checktype(L, -1, LUA_TTABLE);
+			n = lua_rawlen(L, -1);
+			for (i = 1; i <= n; i++) {
+				lua_rawgeti(L, -1, i);
+				if ((type = sniff_lookup(luaL_checkstring(L,
+				    -1))) == -1)
+					luaL_error(L, "unknown type: %s",
+					    lua_tostring(L, -1));
+				self->abort[type] = true;
+				lua_settop(L, -2);
+			}
+		}
+		lua_settop(L, -2);
+		lua_getfield(L, 1, "name");
+	} else
+		lua_pushnil(L);
+	stat_register(&self->stat, "partscan", lua_tostring(L, -1));
+	lua_settop(L, -2);
+
+	return (1);
+}
+
+/*
+ * scan:parts()
+ *
+ * Returns the list of the parts in the last message, { { index = n,
+ * depth = n, type = declared type, charset = charset, encoding = "base64"
+ * or "quoted-printable", disposition = disposition, filename = filename,
+ * sniffed = type of the content }, ... }.  The fields not specified or
+ * not known are nil.
+ */
+int
+l_partscan_parts(lua_State *L)
+{
+	struct mf_partscan	*self;
+	int			 i;
+
+	self = *(struct mf_partscan **)luaL_checkudata(L, 1,
+	    "mail.partscan");
+	lua_createtable(L, self->nparts, 0);
+	for (i = 0; i < self->nparts; i++) {
+		partscan_pushpart(L, &self->parts[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+
+	return (1);
+}
+
+/*
+ * scan:found()
+ *
+ * Returns the first part of the types to abort in the last message, or nil.
+ */
+int
+l_partscan_found(lua_State *L)
+{
+	struct mf_partscan	*self;
+
+	self = *(struct mf_partscan **)luaL_checkudata(L, 1,
+	    "mail.partscan");
+	if (self->found < 0)
+		lua_pushnil(L);
+	else
+		partscan_pushpart(L, &self->parts[self->found]);
+
+	return (1);
+}
+
+int
+l_partscan_gc(lua_State *L)
+{
+	struct mf_partscan	*self;
+
+	self = *(struct mf_partscan **)luaL_checkudata(L, 1,
+	    "mail.partscan");
+	if (self == NULL)
+		return (0);
+	stat_unregister(&self->stat);
+	mime_free(self->mime);
+	free(self->parts);
+	freezero(self, sizeof(*self));
+
+	return (0);
+}
+
+void
+partscan_pushpart(lua_State *L, struct mf_partscan_part *part)
+{
+	lua_createtable(L, 0, 8);
+	lua_pushinteger(L, part->part.index);
+	lua_setfield(L, -2, "index");
+	lua_pushinteger(L, part->part.depth);
+	lua_setfield(L, -2, "depth");
+	lua_pushstring(L, part->part.type);
+	lua_setfield(L, -2, "type");
+	if (part->part.charset[0] != '\0') {
+		lua_pushstring(L, part->part.charset);
+		lua_setfield(L, -2, "charset");
+	}
+	if (part->part.encoding != MIME_ENC_NONE) {
+		lua_pushstring(L, (part->part.encoding == MIME_ENC_BASE64)?
+		    "base64" : "quoted-printable");
+		lua_setfield(L, -2, "encoding");
+	}
+	if (part->part.disposition[0] != '\0') {
+		lua_pushstring(L, part->part.disposition);
+		lua_setfield(L, -2, "disposition");
+	}
+	if (part->part.filename[0] != '\0') {
+		lua_pushstring(L, part->part.filename);
+		lua_setfield(L, -2, "filename");
+	}
+	if (sniff_name(part->type) != NULL) {
+		lua_pushstring(L, sniff_name(part->type));
+		lua_setfield(L, -2, "sniffed");
+	}
+}
+
+/* the type of the last part is known */
+void
+partscan_sniffed(struct mf_partscan *self, enum sniff_type type)
+{
+	self->sniffing = false;
+	self->parts[self->nparts - 1].type = type;
+	if (self->abort[type] && self->found < 0) {
+		self->found = self->nparts - 1;
+		self->tap.stop = true;
+		self->stat.hits++;
+	}
+}
+
+void
+partscan_on_data(void *ctx, const struct mime_part *part, const char *data,
+    size_t len)
+{
+	struct mf_partscan	*self = ctx;
+
+	if (self->nparts == 0 ||
+	    self->parts[self->nparts - 1].part.index != part->index) {
+		/* a new part */
+		if (self->sniffing)
+			partscan_sniffed(self, sniff_end(&self->sniff));
+		if (self->nparts >= PARTSCAN_MAXPARTS) {
+			mime_skip(self->mime);
+			return;
+		}
+		self->parts[self->nparts].part = *part;
+		self->parts[self->nparts].type = SNIFF_UNKNOWN;
+		self->nparts++;
+		self->sniffing = true;
+		sniff_begin(&self->sniff);
+	}
+	if (!self->sniffing)
+		return;
+	if (!sniff_data(&self->sniff, (const u_char *)data, len)) {
+		partscan_sniffed(self, self->sniff.type);
+		mime_skip(self->mime);
+	}
+}
+
+void
+partscan_on_begin(void *ctx)
+{
+	struct mf_partscan	*self = ctx;
+
+	mime_begin(self->mime);
+	self->nparts = 0;
+	self->sniffing = false;
+	self->found = -1;
+}
+
+void
+partscan_on_header(void *ctx, const char *hdr, const char *value)
+{
+	struct mf_partscan	*self = ctx;
+
+	mime_header(self->mime, hdr, value);
+}
+
+void
+partscan_on_body(void *ctx, const char *line, size_t linelen)
+{
+	struct mf_partscan	*self = ctx;
+
+	mime_body(self->mime, line, linelen);
+}
+
+void
+partscan_on_end(void *ctx)
+{
+	struct mf_partscan	*self = ctx;
+
+	mime_end(self->mime);
+	if (self->sniffing)
+		partscan_sniffed(self, sniff_end(&self->sniff));
+}
+
+/***********************************************************************
+ * Statistics
+ ***********************************************************************/
+/* 0 unless the time is taken */
+uint64_t
+stat_nsec(void)
+{
+	struct timespec	 ts;
+
+	if (!stat_timing)
+		return (0);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+void
+stat_add(struct mf_stat *stat, uint64_t t0)
+{
+	if (stat == NULL)
+		return;
+	stat->calls++;
+	if (t0 != 0)
+		stat->nsec += stat_nsec() - t0;
+}
+
+void
+stat_register(struct mf_stat *stat, const char *type, const char *name)
+{
+	if (name != NULL)
+		snprintf(stat->name, sizeof(stat->name), "%s %s", type, name);
+	else
+		snprintf(stat->name, sizeof(stat->name), "%s %p", type, stat);
+	TAILQ_INSERT_TAIL(&mf_stats, stat, next);
+	stat->registered = true;
+}
+
+void
+stat_unregister(struct mf_stat *stat)
+{
+	if (stat->registered)
+		TAILQ_REMOVE(&mf_stats, stat, next);
+	stat->registered = false;
+}
+
+void
+stat_print(FILE *fp, const char *name, uint64_t calls, uint64_t hits,
+    uint64_t nsec)
+{
+	fprintf(fp, "%-36s %10llu %10llu %14llu %10llu\n", name,
+	    (unsigned long long)calls, (unsigned long long)hits,
+	    (unsigned long long)nsec,
+	    (unsigned long long)((calls > 0)? nsec / calls : 0));
+}
 
-	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+/*
+ * Returns the statistics report.  The caller must free the result.
+ */
+char *
+mailfilter_stats_report(void)
+{
+	FILE			*fp;
+	char			*buf = NULL, name[80];
+	size_t			 bufsiz = 0;
+	struct mf_stat		*stat, *lstats[4];
+	const struct rules_stat	*rstat;
+	int			 i;
 
-	lua_getfield(L, 1, "parent");
-	folder = *(struct mh_folder **)luaL_checkudata(L, -1, "mail.mh_folder");
+	if ((fp = open_memstream(&buf, &bufsiz)) == NULL)
+		return (NULL);
+	fprintf(fp, "%-36s %10s %10s %14s %10s\n", "name", "calls", "hits",
+	    "nsec", "nsec/call");
+	lstats[0] = &stat_on_header;
+	lstats[1] = &stat_on_end_of_headers;
+	lstats[2] = &stat_on_write;
+	lstats[3] = &stat_on_text;
+	for (i = 0; i < 4; i++)
+		stat_print(fp, lstats[i]->name, lstats[i]->calls,
+		    lstats[i]->hits, lstats[i]->nsec);
+	TAILQ_FOREACH(stat, &mf_stats, next) {
+		stat_print(fp, stat->name, stat->calls, stat->hits,
+		    stat->nsec);
+		if (stat->rules == NULL)
+			continue;
+		/* evaluations are counted as the calls */
+		for (i = 0; (rstat = rules_stat(stat->rules->rules, i))
+		    != NULL; i++) {
+			if (stat->rules->names[i] != NULL)
+				snprintf(name, sizeof(name), "  rule %s",
+				    stat->rules->names[i]);
+			else
+				snprintf(name, sizeof(name), "  rule #%d",
+				    i + 1);
+			stat_print(fp, name, rstat->evals, rstat->hits,
+			    rstat->nsec);
+		}
+	}
+	fclose(fp);
 
-	lua_getfield(L, 1, "index");
-	idx = luaL_checkinteger(L, -1);
+	return (buf);
+}
 
-	snprintf(path, sizeof(path), "%s/%d", folder->path, idx);
+void
+mailfilter_stats_reset(void)
+{
+	struct mf_stat		*stat;
+
+	stat_on_header.calls = stat_on_header.hits = stat_on_header.nsec = 0;
+	stat_on_end_of_headers.calls = stat_on_end_of_headers.hits =
+	    stat_on_end_of_headers.nsec = 0;
+	stat_on_write.calls = stat_on_write.hits = stat_on_write.nsec = 0;
+	stat_on_text.calls = stat_on_text.hits = stat_on_text.nsec = 0;
+	TAILQ_FOREACH(stat, &mf_stats, next) {
+		stat->calls = stat->hits = stat->nsec = 0;
+		if (stat->rules != NULL)
+			rules_stat_reset(stat->rules->rules);
+	}
+}
+
+/*
+ * Take the time of the calls or not.  The calls and the hits are counted
+ * always, the time costs clock_gettime(2) for each call.
+ */
+void
+mailfilter_stats_timing(bool on)
+{
+	stat_timing = on;
+	rules_stat_timing(on);
+}
+
+/************************************************************************
+ * common, miscellaneous functions
+ ************************************************************************/
+/* LSD radix sort by bytes, `tmp' must have the same size as `v' */
+void
+radix_sort(uint32_t *v, uint32_t *tmp, size_t n)
+{
+	size_t		 count[256], i, pos, sum;
+	uint32_t	*src = v, *dst = tmp, *swap;
+	int		 shift;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < n; i++)
+			count[(src[i] >> shift) & 0xff]++;
+		if (n == 0 || count[(src[0] >> shift) & 0xff] == n)
+			continue;	/* all the same */
+		for (i = 0, sum = 0; i < 256; i++) {
+			pos = count[i];
+			count[i] = sum;
+			sum += pos;
+		}
+		for (i = 0; i < n; i++)
+			dst[count[(src[i] >> shift) & 0xff]++] = src[i];
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != v)
+		memcpy(v, src, n * sizeof(uint32_t));
+}
+
+ssize_t
+rfc5322_read(void *buf, size_t nmemb, size_t size, void *ctx0)
+{
+	char			*lf, *line;
+	struct pop3_read_ctx	*ctx = ctx0;
+
+	/*
+	 * POP3 has no way to cancel RETR but closing the session, which
+	 * loses the deletions.  The rest is received and discarded.
+	 */
+	if (ctx->stop)
+		return (nmemb * size);
+	bytebuffer_put(ctx->buffer, buf, nmemb * size);
+	bytebuffer_flip(ctx->buffer);
+	while (ctx->state == RFC5322_NONE && !(ctx->top && ctx->body) &&
+	    !ctx->stop) {
+		/* XXX handle if the buffer is full but no LF */
+		line = bytebuffer_pointer(ctx->buffer);
+		if ((lf = memchr(line, '\n',
+		    bytebuffer_remaining(ctx->buffer))) == NULL)
+			break;
+		bytebuffer_get(ctx->buffer, BYTEBUFFER_GET_DIRECT,
+		    lf - line + 1);
+		rfc5322_read_line(ctx, line, lf);
+	}
+	bytebuffer_compact(ctx->buffer);
+
+	return (nmemb * size);
+}
+
+/*
+ * Read the message file.  The file is mapped and parsed in place, read(2)
+ * is used for the small files or the files which can't be mapped.
+ */
+void
+rfc5322_read_file(lua_State *L, const char *path, bool top)
+{
+	struct read_state	*rs;
+	struct pop3_read_ctx	*ctx;
+	struct stat		 st;
+	char			 buf[READ_BUFSIZ];
+	ssize_t			 sz;
 
-	if ((f = open(path, O_RDONLY)) < 0)
+	rs = read_state_new(L);
+	ctx = &rs->ctx;
+	if ((rs->fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
 		luaL_error(L, "%s: %s", path, strerror(errno));
 
-	ctx.L = L;
-	ctx.state = RFC5322_NONE;
-	if ((ctx.parser = rfc5322_parser_new()) == NULL) {
-		close(f);
-		luaL_error(L, "rfc5322_parser_new(): %s", strerror(errno));
+	if (fstat(rs->fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		ctx->size = st.st_size;
+		if (st.st_size >= READ_MINMAP &&
+		    (uintmax_t)st.st_size <= SIZE_MAX &&
+		    (rs->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+		    rs->fd, 0)) != MAP_FAILED) {
+			rs->mapsiz = st.st_size;
+			madvise(rs->map, rs->mapsiz, MADV_SEQUENTIAL);
+		}
 	}
-	if ((ctx.buffer = bytebuffer_create(8192)) == NULL) {
-		rfc5322_free(ctx.parser);
-		close(f);
-		luaL_error(L, "bytebuffer_create(): %s", strerror(errno));
+
+	ctx->top = top;
+	read_taps_init(ctx);
+	if ((ctx->parser = rfc5322_parser_new()) == NULL)
+		luaL_error(L, "rfc5322_parser_new(): %s", strerror(errno));
+
+	if (rs->map != MAP_FAILED)
+		rfc5322_read_mem(ctx, rs->map, rs->mapsiz);
+	else {
+		if ((ctx->buffer = bytebuffer_create(8192)) == NULL)
+			luaL_error(L, "bytebuffer_create(): %s",
+			    strerror(errno));
+		while (!(top && ctx->body) && !ctx->stop &&
+		    (sz = read(rs->fd, buf, sizeof(buf))) > 0)
+			rfc5322_read(buf, sz, 1, ctx);
+		bytebuffer_flip(ctx->buffer);
+		rfc5322_read_last(ctx, bytebuffer_pointer(ctx->buffer),
+		    bytebuffer_remaining(ctx->buffer));
 	}
+	read_taps_end(ctx);
 
-	while ((sz = read(f, buf, sizeof(buf))) > 0)
-		rfc5322_read(buf, sz, 1, &ctx);
+	read_state_free(rs);
+	lua_settop(L, -2);
+}
 
-	bytebuffer_destroy(ctx.buffer);
-	rfc5322_free(ctx.parser);
-	close(f);
+/*
+ * Read the message from the memory, typically mapped from a file.  The
+ * memory is not modified.  The body lines are passed to the consumers in
+ * place, the header lines and the lines ending with CRLF, which need to be
+ * terminated or rewritten, are copied to the small line buffer.
+ */
+void
+rfc5322_read_mem(struct pop3_read_ctx *ctx, const char *buf, size_t bufsiz)
+{
+	const char	*line, *lf, *p, *end = buf + bufsiz;
+	char		*nline;
+	size_t		 len;
 
-	return (0);
+	for (line = buf; line < end && ctx->state == RFC5322_NONE &&
+	    !(ctx->top && ctx->body) && !ctx->stop; line = lf + 1) {
+		if ((lf = memchr(line, '\n', end - line)) == NULL)
+			break;
+		len = lf - line + 1;
+		if (ctx->unquote && *line == '>') {
+			for (p = line; p < lf && *p == '>'; p++)
+				;
+			if (lf - p >= 5 && strncmp(p, "From ", 5) == 0) {
+				line++;
+				len--;
+			}
+		}
+		if (ctx->body && (line == lf || *(lf - 1) != '\r')) {
+			rfc5322_read_body(ctx, line, len);
+			continue;
+		}
+		if (len > ctx->linesiz) {
+			if ((nline = realloc(ctx->line, len)) == NULL)
+				luaL_error(ctx->L, "realloc(): %s",
+				    strerror(errno));
+			ctx->line = nline;
+			ctx->linesiz = len;
+		}
+		memcpy(ctx->line, line, len);
+		rfc5322_read_line(ctx, ctx->line, ctx->line + len - 1);
+	}
+	/* the last line without LF */
+	if (line < end)
+		rfc5322_read_last(ctx, line, end - line);
 }
 
-int
-l_mh_folder_message_delete(lua_State *L)
+/*
+ * Pass the bytes left at the end of the message, the last line of the
+ * body without LF.  It's written as is.
+ */
+void
+rfc5322_read_last(struct pop3_read_ctx *ctx, const char *line, size_t len)
 {
-	struct mh_folder	*folder;
-	int			 idx;
-	char			 path[PATH_MAX];
+	size_t		 bodylen = len;
 
-	luaL_argcheck(L, lua_istable(L, 1), 1, "must be a message");
+	if (len == 0 || !ctx->body || ctx->top || ctx->stop ||
+	    ctx->state != RFC5322_NONE)
+		return;
+	if (line[bodylen - 1] == '\r')
+		bodylen--;
+	rfc5322_read_on_body(ctx, line, bodylen);
+	rfc5322_read_on_write(ctx, line, len);
+}
 
-	lua_getfield(L, 1, "parent");
-	folder = *(struct mh_folder **)luaL_checkudata(L, -1, "mail.mh_folder");
+/*
+ * Push the userdata which keeps the resources of a read.  They are
+ * released by read_state_free(), or when it's collected after an error.
+ */
+struct read_state *
+read_state_new(lua_State *L)
+{
+	struct read_state	*rs;
+
+	rs = lua_newuserdata(L, sizeof(struct read_state));
+	memset(rs, 0, sizeof(*rs));
+	rs->ctx.L = L;
+	rs->ctx.state = RFC5322_NONE;
+	rs->ctx.size = -1;
+	TAILQ_INIT(&rs->ctx.taps);
+	rs->fd = -1;
+	rs->map = MAP_FAILED;
+	if (luaL_newmetatable(L, "mail.read_state") != 0) {
+		lua_pushstring(L, "__gc");
+		lua_pushcfunction(L, l_read_state_gc);
+		lua_settable(L, -3);
+	}
+	lua_setmetatable(L, -2);
 
-	lua_getfield(L, 1, "index");
-	idx = luaL_checkinteger(L, -1);
+	return (rs);
+}
 
-	snprintf(path, sizeof(path), "%s/%d", folder->path, idx);
-	unlink(path);
+void
+read_state_free(struct read_state *rs)
+{
+	struct pop3_read_ctx	*ctx = &rs->ctx;
+
+	if (rs->map != MAP_FAILED)
+		munmap(rs->map, rs->mapsiz);
+	rs->map = MAP_FAILED;
+	if (rs->fd >= 0)
+		close(rs->fd);
+	rs->fd = -1;
+	if (ctx->parser != NULL)
+		rfc5322_free(ctx->parser);
+	ctx->parser = NULL;
+	if (ctx->buffer != NULL)
+		bytebuffer_destroy(ctx->buffer);
+	ctx->buffer = NULL;
+	free(ctx->line);
+	ctx->line = NULL;
+	bodytext_free(ctx->text);
+	ctx->text = NULL;
+}
+
+int
+l_read_state_gc(lua_State *L)
+{
+	read_state_free(luaL_checkudata(L, 1, "mail.read_state"));
 
 	return (0);
 }
 
-int
-direntseq_compar(const void *a0, const void *b0)
+/* process the line which ends at `lf'.  the line is restored after that */
+void
+rfc5322_read_line(struct pop3_read_ctx *ctx, char *line, char *lf)
 {
-	const struct direntseq *a, *b;
+	char			*cr;
+	struct rfc5322_result	 res;
+	struct rfc5322_tap	*tap;
+	uint64_t		 t0;
+
+	*lf = '\0';
+	if (line < lf && *(lf - 1) == '\r') {
+		cr = lf - 1;
+		*cr = '\0';
+	} else
+		cr = NULL;
+	rfc5322_push(ctx->parser, line);
+	ctx->state = rfc5322_next(ctx->parser, &res);
+	do {
+		switch (ctx->state) {
+		case RFC5322_HEADER_START:
+			rfc5322_unfold_header(ctx->parser);
+			break;
+		case RFC5322_HEADER_END:
+			rfc5322_read_header(ctx, &res);
+			break;
+		case RFC5322_END_OF_HEADERS:
+			TAILQ_FOREACH(tap, &ctx->taps, next) {
+				if (tap->on_end_of_headers == NULL)
+					continue;
+				t0 = stat_nsec();
+				tap->on_end_of_headers(tap->ctx);
+				stat_add(tap->stat, t0);
+			}
+			lua_getfield(ctx->L, 2, "on_end_of_headers");
+			if (lua_isfunction(ctx->L, -1)) {
+				t0 = stat_nsec();
+				lua_call(ctx->L, 0, 0);
+				stat_add(&stat_on_end_of_headers, t0);
+			} else
+				lua_settop(ctx->L, -2);
+			break;
+		case RFC5322_BODY_START:
+			ctx->body = true;
+			break;
+		case RFC5322_BODY:
+			rfc5322_read_on_body(ctx, res.value,
+			    strlen(res.value));
+			break;
+		}
+		ctx->state = rfc5322_next(ctx->parser, &res);
+	} while (ctx->state != RFC5322_NONE &&
+	    ctx->state != RFC5322_ERR);
+	/* the line is written with LF */
+	if (cr)
+		*cr = '\n';
+	else
+		*lf = '\n';
+	rfc5322_read_on_write(ctx, line, ((cr)? cr : lf) - line + 1);
 
-	a = (const struct direntseq *)a0;
-	b = (const struct direntseq *)b0;
+	*lf = '\n';
+	if (cr)
+		*cr = '\r';
+}
 
-	return (a->seq - b->seq);
+/* body line ending with LF, which doesn't need the parser */
+void
+rfc5322_read_body(struct pop3_read_ctx *ctx, const char *line, size_t len)
+{
+	rfc5322_read_on_body(ctx, line, len - 1);
+	rfc5322_read_on_write(ctx, line, len);
 }
 
-/***********************************************************************
- * mbox
- ***********************************************************************/
-struct mbox {
-	int	 fd;
-};
+void
+rfc5322_read_on_body(struct pop3_read_ctx *ctx, const char *line, size_t len)
+{
+	struct rfc5322_tap	*tap;
+	uint64_t		 t0;
 
-static int		 mbox_metatable(lua_State *L);
-static int		 l_mbox_save(lua_State *L);
-static int		 l_mbox_gc(lua_State *L);
+	TAILQ_FOREACH(tap, &ctx->taps, next) {
+		if (tap->on_body == NULL)
+			continue;
+		t0 = stat_nsec();
+		tap->on_body(tap->ctx, line, len);
+		stat_add(tap->stat, t0);
+		if (tap->stop)
+			ctx->stop = true;
+	}
+}
 
-int
-mbox_metatable(lua_State *L)
+void
+rfc5322_read_on_write(struct pop3_read_ctx *ctx, const char *line,
+    size_t len)
 {
-	int	ret;
+	struct rfc5322_tap	*tap;
+	uint64_t		 t0;
 
-	if ((ret = luaL_newmetatable(L, "mail.mbox")) != 0) {
-		lua_pushstring(L, "save");
-		lua_pushcfunction(L, l_mbox_save);
-		lua_settable(L, -3);
+	TAILQ_FOREACH(tap, &ctx->taps, next) {
+		if (tap->on_write == NULL)
+			continue;
+		t0 = stat_nsec();
+		tap->on_write(tap->ctx, line, len);
+		stat_add(tap->stat, t0);
+	}
+	lua_getfield(ctx->L, 2, "on_write");
+	if (lua_isfunction(ctx->L, -1)) {
+		lua_pushlstring(ctx->L, line, len);
+		t0 = stat_nsec();
+		lua_call(ctx->L, 1, 0);
+		stat_add(&stat_on_write, t0);
+	} else
+		lua_settop(ctx->L, -2);
+}
 
-		lua_pushstring(L, "__gc");
-		lua_pushcfunction(L, l_mbox_gc);
-		lua_settable(L, -3);
+void
+rfc5322_read_header(struct pop3_read_ctx *ctx, struct rfc5322_result *res)
+{
+	char			*decoded = NULL, hdr[128];
+	const char		*value;
+	size_t			 len;
+	struct rfc5322_tap	*tap;
+	uint64_t		 t0;
+
+	lua_getfield(ctx->L, 2, "on_header");
+	if (!lua_isfunction(ctx->L, -1) && TAILQ_EMPTY(&ctx->taps)) {
+		lua_settop(ctx->L, -2);
+		return;
 	}
-	fprintf(stderr, "%s() ret %d\n", __func__, ret);
+	str_tolower(res->hdr, hdr, sizeof(hdr));
+	value = skip_ws(res->value);
+	if (need_decode(res) && (decoded = decode_text(value)) != NULL)
+		value = decoded;
 
-	return (ret);
+	TAILQ_FOREACH(tap, &ctx->taps, next) {
+		if (tap->on_header == NULL)
+			continue;
+		t0 = stat_nsec();
+		tap->on_header(tap->ctx, hdr, value);
+		stat_add(tap->stat, t0);
+	}
+	if (lua_isfunction(ctx->L, -1)) {
+		lua_pushstring(ctx->L, hdr);
+		if (ctx->normalize) {
+			value = str_normalize(value, strlen(value), &len);
+			lua_pushlstring(ctx->L, value, len);
+		} else
+			lua_pushstring(ctx->L, value);
+		free(decoded);
+		t0 = stat_nsec();
+		lua_call(ctx->L, 2, 0);
+		stat_add(&stat_on_header, t0);
+	} else {
+		lua_settop(ctx->L, -2);
+		free(decoded);
+	}
 }
 
-int
-l_mbox(lua_State *L)
+/*
+ * Attach the native consumers specified in the callback table, the 2nd
+ * argument of `top' or `retr'.
+ */
+void
+read_taps_init(struct pop3_read_ctx *ctx)
 {
-	luaL_checkstring(L, 1);
+	lua_State		*L = ctx->L;
+	struct mf_matcher	**matcher;
+	struct mf_rules		**rules;
+	struct mf_bayes		**bayes;
+	struct mf_urlscan	**urlscan;
+	struct mf_partscan	**partscan;
+
+	TAILQ_INIT(&ctx->taps);
+	if (!lua_istable(L, 2))
+		return;
 
-	lua_newtable(L);	/* returning table */
+	lua_getfield(L, 2, "normalize");
+	ctx->normalize = lua_toboolean(L, -1);
+	lua_settop(L, -2);
+
+	lua_getfield(L, 2, "matcher");
+	if ((matcher = luaL_testudata(L, -1, "mail.matcher")) != NULL &&
+	    *matcher != NULL)
+		read_taps_attach(ctx, &(*matcher)->tap);
+	lua_settop(L, -2);
+
+	lua_getfield(L, 2, "rules");
+	if ((rules = luaL_testudata(L, -1, "mail.rules")) != NULL &&
+	    *rules != NULL) {
+		(*rules)->L = L;
+		(*rules)->size = ctx->size;
+		(*rules)->headers_only = ctx->top;
+		if (lua_istable(L, 1)) {
+			lua_getfield(L, 1, "size");
+			if (lua_isinteger(L, -1))
+				(*rules)->size = lua_tointeger(L, -1);
+			lua_settop(L, -2);
+		}
+		read_taps_attach(ctx, &(*rules)->tap);
+	}
+	lua_settop(L, -2);
+
+	lua_getfield(L, 2, "bayes");
+	if ((bayes = luaL_testudata(L, -1, "mail.bayes")) != NULL &&
+	    *bayes != NULL)
+		read_taps_attach(ctx, &(*bayes)->tap);
+	lua_settop(L, -2);
+
+	lua_getfield(L, 2, "urlscan");
+	if ((urlscan = luaL_testudata(L, -1, "mail.urlscan")) != NULL &&
+	    *urlscan != NULL)
+		read_taps_attach(ctx, &(*urlscan)->tap);
+	lua_settop(L, -2);
+
+	lua_getfield(L, 2, "partscan");
+	if ((partscan = luaL_testudata(L, -1, "mail.partscan")) != NULL &&
+	    *partscan != NULL)
+		read_taps_attach(ctx, &(*partscan)->tap);
+	lua_settop(L, -2);
+
+	/* the text of the body decoded into UTF-8 */
+	lua_getfield(L, 2, "on_text");
+	if (lua_isfunction(L, -1)) {
+		if ((ctx->text = bodytext_new(read_text_on_line, ctx)) == NULL)
+			luaL_error(L, "bodytext_new(): %s", strerror(errno));
+		ctx->text_tap.on_begin = read_text_on_begin;
+		ctx->text_tap.on_header = read_text_on_header;
+		ctx->text_tap.on_body = read_text_on_body;
+		ctx->text_tap.on_end = read_text_on_end;
+		ctx->text_tap.ctx = ctx->text;
+		ctx->text_tap.stat = &stat_on_text;
+		read_taps_attach(ctx, &ctx->text_tap);
+	}
+	lua_settop(L, -2);
+
+	lua_getfield(L, 2, "threads");
+	if (lua_toboolean(L, -1) && thread_index != NULL)
+		read_taps_attach(ctx, &thread_tap);
+	lua_settop(L, -2);
+
+	lua_getfield(L, 2, "dedup");
+	if (lua_toboolean(L, -1) && dedup_store != NULL)
+		read_taps_attach(ctx, &dedup_tap);
+	lua_settop(L, -2);
+
+	/* internal consumers, like the writer of folder:save() */
+	lua_getfield(L, 2, "tap");
+	if (lua_islightuserdata(L, -1))
+		read_taps_attach(ctx, lua_touserdata(L, -1));
+	lua_settop(L, -2);
+}
 
-	/* metatable */
-	mbox_metatable(L);
-	lua_pushstring(L, "__index");
-	lua_pushvalue(L, -2);
-	lua_settable(L, -3);
+void
+read_taps_attach(struct pop3_read_ctx *ctx, struct rfc5322_tap *tap)
+{
+	uint64_t	 t0;
 
-	lua_pushstring(L, "path");
-	lua_pushvalue(L, 1);
-	lua_settable(L, -3);
+	tap->stop = false;
+	if (tap->on_begin != NULL) {
+		t0 = stat_nsec();
+		tap->on_begin(tap->ctx);
+		stat_add(tap->stat, t0);
+	}
+	TAILQ_INSERT_TAIL(&ctx->taps, tap, next);
+}
 
-	lua_setmetatable(L, -2);
+void
+read_taps_end(struct pop3_read_ctx *ctx)
+{
+	struct rfc5322_tap	*tap;
+	uint64_t		 t0;
 
-	return (1);
+	TAILQ_FOREACH(tap, &ctx->taps, next) {
+		if (tap->on_end == NULL)
+			continue;
+		t0 = stat_nsec();
+		tap->on_end(tap->ctx);
+		stat_add(tap->stat, t0);
+	}
+	bodytext_free(ctx->text);
+	ctx->text = NULL;
 }
 
-int
-l_mbox_save(lua_State *L)
+void
+read_text_on_begin(void *ctx)
 {
-	fprintf(stderr, "%s()\n", __func__);
-	return (0);
+	bodytext_begin(ctx);
 }
 
-int
-l_mbox_gc(lua_State *L)
+void
+read_text_on_header(void *ctx, const char *hdr, const char *value)
 {
-	fprintf(stderr, "%s()\n", __func__);
-	return (0);
+	bodytext_header(ctx, hdr, value);
 }
-/************************************************************************
- * common, miscellaneous functions
- ************************************************************************/
-ssize_t
-rfc5322_read(void *buf, size_t nmemb, size_t size, void *ctx0)
+
+void
+read_text_on_body(void *ctx, const char *line, size_t linelen)
 {
-	char			*lf, *cr, *line, *decoded, hdr[128];
-	struct rfc5322_result	 res;
-	struct pop3_read_ctx	*ctx = ctx0;
+	bodytext_body(ctx, line, linelen);
+}
 
-	bytebuffer_put(ctx->buffer, buf, nmemb * size);
-	bytebuffer_flip(ctx->buffer);
-	while (ctx->state == RFC5322_NONE) {
-		/* XXX handle if the buffer is full but no LF */
-		line = bytebuffer_pointer(ctx->buffer);
-		if ((lf = memchr(line, '\n',
-		    bytebuffer_remaining(ctx->buffer))) == NULL)
-			break;
-		bytebuffer_get(ctx->buffer, BYTEBUFFER_GET_DIRECT,
-		    lf - line + 1);
-		*lf = '\0';
-		if (line < lf && *(lf - 1) == '\r') {
-			cr = lf - 1;
-			*cr = '\0';
-		} else
-			cr = NULL;
-		rfc5322_push(ctx->parser, line);
-		ctx->state = rfc5322_next(ctx->parser, &res);
-		do {
-			switch (ctx->state) {
-			case RFC5322_HEADER_START:
-				rfc5322_unfold_header(ctx->parser);
-				break;
-			case RFC5322_HEADER_END:
-				lua_getfield(ctx->L, 2, "on_header");
-				if (!lua_isfunction(ctx->L, -1)) {
-					lua_settop(ctx->L, -2);
-					break;
-				}
-				lua_pushstring(ctx->L,
-				    str_tolower(res.hdr, hdr, sizeof(hdr)));
-				decoded = NULL;
-				if (need_decode(&res)) {
-					decoded = decode_text(
-					    skip_ws(res.value));
-					if (decoded) {
-						lua_pushstring(ctx->L, decoded);
-						free(decoded);
-					}
-				}
-				if (decoded == NULL)
-					lua_pushstring(
-					    ctx->L, skip_ws(res.value));
-				lua_call(ctx->L, 2, 0);
-				//lua_settop(ctx->L, -2);
-				break;
-			case RFC5322_END_OF_HEADERS:
-				lua_getfield(ctx->L, 2, "on_end_of_headers");
-				if (lua_isfunction(ctx->L, -1))
-					lua_call(ctx->L, 0, 0);
-				else
-					lua_settop(ctx->L, -2);
-				break;
-			}
-			ctx->state = rfc5322_next(ctx->parser, &res);
-		} while (ctx->state != RFC5322_NONE &&
-		    ctx->state != RFC5322_ERR);
-		lua_getfield(ctx->L, 2, "on_write");
-		if (lua_isfunction(ctx->L, -1)) {
-			if (cr) {
-				*cr = '\n';
-				lua_pushlstring(ctx->L, line, cr - line + 1);
-			} else {
-				*lf = '\n';
-				lua_pushlstring(ctx->L, line, lf - line + 1);
-			}
-			lua_call(ctx->L, 1, 0);
-		} else
-			lua_settop(ctx->L, -2);
+void
+read_text_on_end(void *ctx)
+{
+	bodytext_end(ctx);
+}
 
-		*lf = '\n';
-		if (cr)
-			*cr = '\r';
-	}
-	bytebuffer_compact(ctx->buffer);
+void
+read_text_on_line(void *ctx0, const char *line, size_t linelen)
+{
+	struct pop3_read_ctx	*ctx = ctx0;
 
-	return (nmemb * size);
+	lua_getfield(ctx->L, 2, "on_text");
+	if (ctx->normalize)
+		line = str_normalize(line, linelen, &linelen);
+	lua_pushlstring(ctx->L, line, linelen);
+	lua_call(ctx->L, 1, 0);
 }
 
 bool
@@ -1120,3 +6440,32 @@ str_tolower(const char *str, char *buf, size_t bufsiz)
 
 	return (buf);
 }
+
+/*
+ * NFKC and case folding by utf8_normalize().  The result is valid until the
+ * next call.  The string is returned as is if the memory is exhausted.
+ */
+const char *
+str_normalize(const char *str, size_t len, size_t *outlen)
+{
+	static u_char	*buf = NULL;
+	static size_t	 bufsiz = 0;
+	u_char		*nbuf;
+
+	if (len > SIZE_MAX / 6 - 1) {
+		*outlen = len;
+		return (str);
+	}
+	if (bufsiz < len * 6 + 1) {
+		if ((nbuf = realloc(buf, len * 6 + 1)) == NULL) {
+			*outlen = len;
+			return (str);
+		}
+		buf = nbuf;
+		bufsiz = len * 6 + 1;
+	}
+	*outlen = utf8_normalize((const u_char *)str, len, buf);
+	buf[*outlen] = '\0';
+
+	return ((const char *)buf);
+}
@@ -20,6 +20,7 @@
 #include <err.h>
 #include <errno.h>
 #include <event.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -40,16 +41,21 @@
 
 #define DEFAULT_INTERVAL	1800
 #define	NAME			"mailfilter"
+#define	PROFILE_HZ		1000
+#define	CLIENT_WRITE_TIMEOUT	10000	/* msec to wait for the client */
+#define	MINIMUM(_a,_b)	(((_a) < (_b))? (_a) : (_b))
 
 struct daemon;
 struct client;
 
 static void	 daemon_stop(void);
 static void	 lua_call_inc(struct client *);
+static void	 stats_send(struct client *, bool);
 static int	 lua_call_inc_write(lua_State *L);
 static void	 on_signal(int, short, void *);
 static void	 on_event(int, short, void *);
 static void	 on_event2(int, short, void *);
+static void	 client_write(struct client *, const char *);
 static void	 client_close(struct client *);
 static void	 on_timer(int, short, void *);
 static void	 reset_timer(struct daemon *);
@@ -82,7 +88,11 @@ static const char	*logfn = NULL;
 
 enum MAILFILTERD_CMD {
 	MAILFILTERD_INC,
-	MAILFILTERD_STOP
+	MAILFILTERD_STOP,
+	MAILFILTERD_STATS,
+	MAILFILTERD_STATS_RESET,
+	MAILFILTERD_PROFILE_START,
+	MAILFILTERD_PROFILE_STOP
 };
 
 
@@ -177,6 +187,10 @@ main(int argc, char *argv[])
 		break;
 	case INC:
 	case STOP:
+	case STATS:
+	case STATS_RESET:
+	case PROFILE_START:
+	case PROFILE_STOP:
 		if (sock == -1)
 			errx(EXIT_FAILURE, "daemon is not running");
 		ipc_control(result, sock);
@@ -265,6 +279,7 @@ main(int argc, char *argv[])
 	signal_del(&ev_sock);
 
 	event_loop(0);
+	free(profile_stop());
 	log_info("Daemon terminated");
 
 	lua_close(L);
@@ -312,6 +327,23 @@ lua_call_inc_write(lua_State *L)
 	return (0);
 }
 
+void
+stats_send(struct client *self, bool reset)
+{
+	char	*report;
+
+	if ((report = mailfilter_stats_report()) == NULL) {
+		log_warn("%s; mailfilter_stats_report()", __func__);
+		return;
+	}
+	if (reset)
+		mailfilter_stats_reset();
+	/* take the time from the first request until the reset */
+	mailfilter_stats_timing(!reset);
+	client_write(self, report);
+	free(report);
+}
+
 void
 on_signal(int fd, short ev, void *ctx)
 {
@@ -360,6 +392,7 @@ on_event2(int fd, short ev, void *ctx)
 	u_char			 buf[128];
 	enum MAILFILTERD_CMD	 cmd;
 	ssize_t			 sz;
+	char			*report = NULL, msg[128];
 	struct client	*self = ctx;
 
 	if ((sz = recv(self->sock, buf, sizeof(buf), 0)) == -1) {
@@ -382,6 +415,31 @@ on_event2(int fd, short ev, void *ctx)
 		lua_call_inc(self);
 		client_close(self);
 		break;
+	case MAILFILTERD_STATS:
+	case MAILFILTERD_STATS_RESET:
+		stats_send(self, cmd == MAILFILTERD_STATS_RESET);
+		client_close(self);
+		break;
+	case MAILFILTERD_PROFILE_START:
+		log_info("Starting the profiler requested");
+		if (profile_start(self->parent->L, PROFILE_HZ) == -1) {
+			snprintf(msg, sizeof(msg), "profile_start(): %s\n",
+			    strerror(errno));
+			client_write(self, msg);
+		}
+		client_close(self);
+		break;
+	case MAILFILTERD_PROFILE_STOP:
+		log_info("Stopping the profiler requested");
+		if ((report = profile_stop()) == NULL) {
+			snprintf(msg, sizeof(msg), "profile_stop(): %s\n",
+			    strerror(errno));
+			client_write(self, msg);
+		} else
+			client_write(self, report);
+		free(report);
+		client_close(self);
+		break;
 	default:
 		log_warnx("%s; received a wrong message: cmd=%d", __func__,
 		    (int)cmd);
@@ -389,6 +447,44 @@ on_event2(int fd, short ev, void *ctx)
 	}
 }
 
+/*
+ * Write `buf' to the client.  The socket is non-blocking, wait until the
+ * client reads the previous ones.
+ */
+void
+client_write(struct client *self, const char *buf)
+{
+	struct pollfd	 pfd;
+	size_t		 len, off;
+	ssize_t		 sz;
+
+	len = strlen(buf);
+	for (off = 0; off < len; off += sz) {
+		if ((sz = write(self->sock, buf + off,
+		    MINIMUM(len - off, BUFSIZ))) != -1)
+			continue;
+		sz = 0;
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN) {
+			log_warn("%s; write()", __func__);
+			return;
+		}
+		pfd.fd = self->sock;
+		pfd.events = POLLOUT;
+		switch (poll(&pfd, 1, CLIENT_WRITE_TIMEOUT)) {
+		case -1:
+			if (errno == EINTR)
+				continue;
+			log_warn("%s; poll()", __func__);
+			return;
+		case 0:
+			log_warnx("%s; timed out", __func__);
+			return;
+		}
+	}
+}
+
 void
 client_close(struct client *self)
 {
@@ -463,6 +559,22 @@ ipc_control(struct parse_result *result, int sock)
 	case RESTART:
 		cmd = MAILFILTERD_STOP;
 		break;
+	case STATS:
+		cmd = MAILFILTERD_STATS;
+		read = true;
+		break;
+	case STATS_RESET:
+		cmd = MAILFILTERD_STATS_RESET;
+		read = true;
+		break;
+	case PROFILE_START:
+		cmd = MAILFILTERD_PROFILE_START;
+		read = true;
+		break;
+	case PROFILE_STOP:
+		cmd = MAILFILTERD_PROFILE_STOP;
+		read = true;
+		break;
 	default:
 		abort();
 	}
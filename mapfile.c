@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * The files mapped by mmap(2) and shared among the processes, the thread
+ * index, the duplicates, the header cache, the similarity index and the
+ * token database.  A file is the header and the records of the module,
+ * it's locked by flock(2) for the updates.  A file full is rebuilt into a
+ * new file which replaces it by rename(2), and the old one is marked
+ * obsolete, so the readers need neither lock nor system call until then.
+ * A broken file is just initialized.
+ */
+#include <sys/types.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mapfile.h"
+
+static int	 mapfile_map(struct mapfile *, int, size_t, uint32_t);
+static int	 mapfile_reopen(struct mapfile *);
+static bool	 mapfile_obsolete(struct mapfile *);
+
+/* open the file, it's created if it doesn't exist */
+int
+mapfile_open(struct mapfile *self, const char *path,
+    const struct mapfile_ops *ops, void *ctx)
+{
+	memset(self, 0, sizeof(*self));
+	self->ops = ops;
+	self->ctx = ctx;
+	self->fd = -1;
+	if ((self->path = strdup(path)) == NULL || mapfile_reopen(self) == -1) {
+		mapfile_close(self);
+		return (-1);
+	}
+
+	return (0);
+}
+
+void
+mapfile_close(struct mapfile *self)
+{
+	if (self->map != NULL)
+		munmap(self->map, self->mapsiz);
+	if (self->fd >= 0)
+		close(self->fd);
+	free(self->path);
+	self->map = NULL;
+	self->fd = -1;
+	self->path = NULL;
+}
+
+/* for the readers without the lock, open the file again if replaced */
+int
+mapfile_refresh(struct mapfile *self)
+{
+	if (mapfile_obsolete(self))
+		return (mapfile_reopen(self));
+
+	return (0);
+}
+
+/*
+ * Lock the file among the processes.  The file is opened again if it was
+ * replaced by others.
+ */
+int
+mapfile_lock(struct mapfile *self)
+{
+	for (;;) {
+		if (flock(self->fd, LOCK_EX) == -1)
+			return (-1);
+		if (!mapfile_obsolete(self))
+			return (0);
+		flock(self->fd, LOCK_UN);
+		if (mapfile_reopen(self) == -1)
+			return (-1);
+	}
+}
+
+void
+mapfile_unlock(struct mapfile *self)
+{
+	flock(self->fd, LOCK_UN);
+}
+
+/*
+ * Create a new file of `size' to replace `self', it's locked.  The
+ * records are copied by the caller, then mapfile_replace() or
+ * mapfile_discard() is called.  Must be called with the lock.
+ */
+int
+mapfile_create(struct mapfile *self, struct mapfile *new, size_t size,
+    uint32_t nslots, void *ctx)
+{
+	char	 path[PATH_MAX];
+	int	 fd;
+
+	if (snprintf(path, sizeof(path), "%s.tmp", self->path) >=
+	    (int)sizeof(path)) {
+		errno = ENAMETOOLONG;
+		return (-1);
+	}
+	memset(new, 0, sizeof(*new));
+	new->ops = self->ops;
+	new->ctx = ctx;
+	new->fd = -1;
+	if ((new->path = strdup(path)) == NULL)
+		return (-1);
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600))
+	    == -1) {
+		mapfile_close(new);
+		return (-1);
+	}
+	if (flock(fd, LOCK_EX) == -1 ||
+	    mapfile_map(new, fd, size, nslots) == -1) {
+		close(fd);
+		mapfile_discard(new);
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Replace the file by the new one, the lock is taken over by the new
+ * file.  `new' is discarded if it fails.
+ */
+int
+mapfile_replace(struct mapfile *self, struct mapfile *new)
+{
+	if (rename(new->path, self->path) == -1) {
+		mapfile_discard(new);
+		return (-1);
+	}
+	/* others open the new file */
+	if (self->ops->obsolete != 0)
+		*(uint32_t *)((char *)self->map + self->ops->obsolete) = 1;
+	munmap(self->map, self->mapsiz);
+	flock(self->fd, LOCK_UN);
+	close(self->fd);
+	self->fd = new->fd;
+	self->map = new->map;
+	self->mapsiz = new->mapsiz;
+	free(new->path);
+	self->ops->attach(self->ctx);
+
+	return (0);
+}
+
+void
+mapfile_discard(struct mapfile *self)
+{
+	if (self->path != NULL)
+		unlink(self->path);
+	mapfile_close(self);
+}
+
+/* map the file, or initialize it if `size' isn't 0 */
+int
+mapfile_map(struct mapfile *self, int fd, size_t size, uint32_t nslots)
+{
+	struct mapfile_hdr	*hdr;
+	struct stat		 st;
+	size_t			 mapsiz = size;
+
+	if (size > 0) {
+		if (ftruncate(fd, size) == -1)
+			return (-1);
+	} else {
+		if (fstat(fd, &st) == -1)
+			return (-1);
+		mapsiz = st.st_size;
+		if (mapsiz < sizeof(struct mapfile_hdr)) {
+			errno = EINVAL;
+			return (-1);
+		}
+	}
+	if ((hdr = mmap(NULL, mapsiz, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+	    0)) == MAP_FAILED)
+		return (-1);
+	if (size > 0) {
+		memcpy(hdr->magic, self->ops->magic, sizeof(hdr->magic));
+		hdr->version = self->ops->version;
+		self->ops->init(hdr, mapsiz, nslots);
+	} else if (memcmp(hdr->magic, self->ops->magic, sizeof(hdr->magic))
+	    != 0 || hdr->version != self->ops->version ||
+	    self->ops->valid(hdr, mapsiz) == -1) {
+		munmap(hdr, mapsiz);
+		errno = EINVAL;
+		return (-1);
+	}
+	if (self->map != NULL)
+		munmap(self->map, self->mapsiz);
+	if (self->fd >= 0 && self->fd != fd)
+		close(self->fd);
+	self->fd = fd;
+	self->map = hdr;
+	self->mapsiz = mapsiz;
+	self->ops->attach(self->ctx);
+
+	return (0);
+}
+
+/* open the file, a broken file is just initialized */
+int
+mapfile_reopen(struct mapfile *self)
+{
+	struct stat	 st;
+	int		 fd;
+
+	if ((fd = open(self->path, O_RDWR | O_CREAT | O_CLOEXEC, 0600)) == -1)
+		return (-1);
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return (-1);
+	}
+	if (st.st_size > 0 && mapfile_map(self, fd, 0, 0) == 0)
+		return (0);
+	if (flock(fd, LOCK_EX) == -1 || fstat(fd, &st) == -1)
+		goto fail;
+	/* may be initialized by others meanwhile */
+	if (st.st_size > 0 && mapfile_map(self, fd, 0, 0) == 0) {
+		flock(fd, LOCK_UN);
+		return (0);
+	}
+	if (ftruncate(fd, 0) == -1 || mapfile_map(self, fd,
+	    self->ops->initsiz, self->ops->initslots) == -1)
+		goto fail;
+	flock(fd, LOCK_UN);
+
+	return (0);
+ fail:
+	close(fd);
+	return (-1);
+}
+
+bool
+mapfile_obsolete(struct mapfile *self)
+{
+	return (self->ops->obsolete != 0 &&
+	    *(volatile uint32_t *)((char *)self->map + self->ops->obsolete)
+	    != 0);
+}
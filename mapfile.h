@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	MAPFILE_H
+#define	MAPFILE_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* the files start with this */
+struct mapfile_hdr {
+	char		 magic[8];
+	uint32_t	 version;
+};
+
+struct mapfile_ops {
+	const char	*magic;
+	uint32_t	 version;
+	size_t		 obsolete;	/* offset of the flag, 0 if none */
+	uint32_t	 initslots;	/* of a new file */
+	size_t		 initsiz;
+	/* initialize the header of a new file */
+	void		(*init)(void *, size_t, uint32_t);
+	/* returns 0 if the file mapped is valid */
+	int		(*valid)(const void *, size_t);
+	/* the file is mapped, `ctx' updates the pointers into it */
+	void		(*attach)(void *);
+};
+
+struct mapfile {
+	const struct mapfile_ops
+			*ops;
+	void		*ctx;
+	char		*path;
+	int		 fd;
+	void		*map;		/* NULL if not mapped */
+	size_t		 mapsiz;
+};
+
+int		 mapfile_open(struct mapfile *, const char *,
+		    const struct mapfile_ops *, void *);
+void		 mapfile_close(struct mapfile *);
+int		 mapfile_refresh(struct mapfile *);
+int		 mapfile_lock(struct mapfile *);
+void		 mapfile_unlock(struct mapfile *);
+int		 mapfile_create(struct mapfile *, struct mapfile *, size_t,
+		    uint32_t, void *);
+int		 mapfile_replace(struct mapfile *, struct mapfile *);
+void		 mapfile_discard(struct mapfile *);
+
+#endif	/* !MAPFILE_H */
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Multi-pattern matcher.  All the patterns are compiled into an
+ * Aho-Corasick automaton, so the text is scanned only once regardless of
+ * the number of the patterns.  Patterns which are added with MATCHER_ICASE
+ * go to the second automaton, the text is case-folded (UTF-8) on the fly
+ * when it is fed to that automaton.
+ */
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matcher.h"
+#include "utf8.h"
+
+struct ac_node {
+	uint32_t	 fail;
+	uint32_t	 dict;		/* nearest node having output on fail */
+	uint32_t	 child;		/* first child, or first edge */
+	uint32_t	 sibling;	/* next sibling, only when building */
+	uint32_t	 nedges;
+	int32_t		 out;		/* first pattern ends here, or -1 */
+	u_char		 c;
+};
+
+struct ac_edge {
+	uint32_t	 to;
+	u_char		 c;
+};
+
+struct ac {
+	struct ac_node	*nodes;
+	size_t		 nnodes;
+	size_t		 nodesiz;
+	struct ac_edge	*edges;
+	uint32_t	 root[256];
+	int		 npats;
+};
+
+struct ac_pattern {
+	int		 id;
+	int32_t		 next;
+};
+
+struct matcher {
+	struct ac		 exact;
+	struct ac		 folded;
+	struct ac_pattern	*pats;
+	size_t			 npats;
+	size_t			 patsiz;
+	int			 compiled;
+};
+
+static int	 ac_init(struct ac *);
+static void	 ac_fini(struct ac *);
+static int	 ac_newnode(struct ac *, uint32_t *);
+static int	 ac_insert(struct ac *, struct ac_pattern *, const u_char *,
+		    size_t, int32_t);
+static uint32_t	 ac_child(struct ac *, uint32_t, u_char);
+static int	 ac_compile(struct ac *);
+static uint32_t	 ac_goto(struct ac *, uint32_t, u_char);
+static void	 ac_feed(struct matcher *, struct ac *, uint32_t *, u_char,
+		    void (*)(void *, int), void *);
+
+struct matcher *
+matcher_new(void)
+{
+	struct matcher	*self;
+
+	if ((self = calloc(1, sizeof(struct matcher))) == NULL)
+		return (NULL);
+	if (ac_init(&self->exact) == -1 || ac_init(&self->folded) == -1) {
+		matcher_free(self);
+		return (NULL);
+	}
+
+	return (self);
+}
+
+void
+matcher_free(struct matcher *self)
+{
+	if (self == NULL)
+		return;
+	ac_fini(&self->exact);
+	ac_fini(&self->folded);
+	free(self->pats);
+	free(self);
+}
+
+/*
+ * Add a pattern.  `id' is passed to the callback function of
+ * matcher_scan() when the pattern is found.
+ */
+int
+matcher_add(struct matcher *self, const char *pat, size_t patlen, int flags,
+    int id)
+{
+	struct ac_pattern	*pats;
+	u_char			*folded;
+	size_t			 newsiz, foldedlen;
+	int			 ret;
+
+	if (self->compiled) {
+		errno = EBUSY;
+		return (-1);
+	}
+	if (patlen == 0) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if (self->npats >= self->patsiz) {
+		newsiz = (self->patsiz == 0)? 64 : self->patsiz * 2;
+		if ((pats = reallocarray(self->pats, newsiz,
+		    sizeof(struct ac_pattern))) == NULL)
+			return (-1);
+		self->pats = pats;
+		self->patsiz = newsiz;
+	}
+	self->pats[self->npats].id = id;
+	self->pats[self->npats].next = -1;
+
+	if (flags & MATCHER_ICASE) {
+		if ((folded = reallocarray(NULL, patlen, 4)) == NULL)
+			return (-1);
+		foldedlen = utf8_casefold_str((const u_char *)pat, patlen,
+		    folded);
+		ret = ac_insert(&self->folded, self->pats, folded, foldedlen,
+		    self->npats);
+		free(folded);
+	} else
+		ret = ac_insert(&self->exact, self->pats,
+		    (const u_char *)pat, patlen, self->npats);
+	if (ret == -1)
+		return (-1);
+	self->npats++;
+
+	return (0);
+}
+
+int
+matcher_compile(struct matcher *self)
+{
+	if (self->compiled)
+		return (0);
+	if (ac_compile(&self->exact) == -1 || ac_compile(&self->folded) == -1)
+		return (-1);
+	self->compiled = 1;
+
+	return (0);
+}
+
+void
+matcher_reset(struct matcher *self, struct matcher_state *state)
+{
+	state->exact = 0;
+	state->folded = 0;
+}
+
+/*
+ * Feed the text to the automatons.  The state is kept in `state', so a
+ * long text can be fed by chunks.
+ */
+void
+matcher_scan(struct matcher *self, struct matcher_state *state,
+    const char *text0, size_t textlen, void (*cb)(void *, int), void *ctx)
+{
+	const u_char	*text = (const u_char *)text0;
+	u_char		 buf[4];
+	uint32_t	 cp;
+	size_t		 i;
+	int		 j, n, buflen;
+
+	if (!self->compiled)
+		return;
+	if (self->exact.npats > 0) {
+		for (i = 0; i < textlen; i++)
+			ac_feed(self, &self->exact, &state->exact, text[i], cb,
+			    ctx);
+	}
+	if (self->folded.npats > 0) {
+		for (i = 0; i < textlen; i += n) {
+			if (text[i] < 0x80) {
+				ac_feed(self, &self->folded, &state->folded,
+				    utf8_casefold(text[i]), cb, ctx);
+				n = 1;
+				continue;
+			}
+			n = utf8_decode(text + i, textlen - i, &cp);
+			if (n <= 0) {
+				/* pass the broken sequence as is */
+				ac_feed(self, &self->folded, &state->folded,
+				    text[i], cb, ctx);
+				n = 1;
+				continue;
+			}
+			buflen = utf8_encode(utf8_casefold(cp), buf);
+			for (j = 0; j < buflen; j++)
+				ac_feed(self, &self->folded, &state->folded,
+				    buf[j], cb, ctx);
+		}
+	}
+}
+
+/***********************************************************************
+ * Aho-Corasick automaton
+ ***********************************************************************/
+int
+ac_init(struct ac *ac)
+{
+	uint32_t	 root;
+
+	memset(ac, 0, sizeof(*ac));
+
+	return (ac_newnode(ac, &root));
+}
+
+void
+ac_fini(struct ac *ac)
+{
+	free(ac->nodes);
+	free(ac->edges);
+}
+
+int
+ac_newnode(struct ac *ac, uint32_t *idx)
+{
+	struct ac_node	*nodes;
+	size_t		 newsiz;
+
+	if (ac->nnodes >= ac->nodesiz) {
+		if (ac->nodesiz >= UINT32_MAX / 2) {
+			errno = ERANGE;
+			return (-1);
+		}
+		newsiz = (ac->nodesiz == 0)? 256 : ac->nodesiz * 2;
+		if ((nodes = reallocarray(ac->nodes, newsiz,
+		    sizeof(struct ac_node))) == NULL)
+			return (-1);
+		ac->nodes = nodes;
+		ac->nodesiz = newsiz;
+	}
+	memset(&ac->nodes[ac->nnodes], 0, sizeof(struct ac_node));
+	ac->nodes[ac->nnodes].out = -1;
+	*idx = ac->nnodes++;
+
+	return (0);
+}
+
+int
+ac_insert(struct ac *ac, struct ac_pattern *pats, const u_char *pat,
+    size_t patlen, int32_t patidx)
+{
+	uint32_t	 n = 0, ch;
+	size_t		 i;
+
+	for (i = 0; i < patlen; i++) {
+		if ((ch = ac_child(ac, n, pat[i])) == 0) {
+			if (ac_newnode(ac, &ch) == -1)
+				return (-1);
+			ac->nodes[ch].c = pat[i];
+			ac->nodes[ch].sibling = ac->nodes[n].child;
+			ac->nodes[n].child = ch;
+		}
+		n = ch;
+	}
+	pats[patidx].next = ac->nodes[n].out;
+	ac->nodes[n].out = patidx;
+	ac->npats++;
+
+	return (0);
+}
+
+/* lookup the child while building the trie */
+uint32_t
+ac_child(struct ac *ac, uint32_t n, u_char c)
+{
+	uint32_t	 ch;
+
+	for (ch = ac->nodes[n].child; ch != 0; ch = ac->nodes[ch].sibling) {
+		if (ac->nodes[ch].c == c)
+			break;
+	}
+
+	return (ch);
+}
+
+int
+ac_compile(struct ac *ac)
+{
+	uint32_t	*queue, n, ch, f, g, nedges = 0;
+	size_t		 head = 0, tail = 0, i, j;
+	struct ac_edge	 tmp;
+
+	if ((queue = reallocarray(NULL, ac->nnodes, sizeof(uint32_t)))
+	    == NULL)
+		return (-1);
+	if (ac->nnodes > 1 && (ac->edges = reallocarray(NULL,
+	    ac->nnodes - 1, sizeof(struct ac_edge))) == NULL) {
+		free(queue);
+		return (-1);
+	}
+
+	/* breadth first, to calculate the failure links */
+	memset(ac->root, 0, sizeof(ac->root));
+	for (ch = ac->nodes[0].child; ch != 0; ch = ac->nodes[ch].sibling) {
+		ac->root[ac->nodes[ch].c] = ch;
+		queue[tail++] = ch;
+	}
+	while (head < tail) {
+		n = queue[head++];
+		for (ch = ac->nodes[n].child; ch != 0;
+		    ch = ac->nodes[ch].sibling) {
+			queue[tail++] = ch;
+			for (f = ac->nodes[n].fail, g = 0; f != 0;
+			    f = ac->nodes[f].fail) {
+				if ((g = ac_child(ac, f, ac->nodes[ch].c)) != 0)
+					break;
+			}
+			if (f == 0)
+				g = ac->root[ac->nodes[ch].c];
+			ac->nodes[ch].fail = g;
+			ac->nodes[ch].dict = (ac->nodes[g].out >= 0)
+			    ? g : ac->nodes[g].dict;
+		}
+	}
+	free(queue);
+
+	/* flatten the children into the sorted edge array */
+	for (n = 0; n < ac->nnodes; n++) {
+		ch = ac->nodes[n].child;
+		ac->nodes[n].child = nedges;
+		ac->nodes[n].nedges = 0;
+		for (; ch != 0; ch = ac->nodes[ch].sibling) {
+			i = nedges + ac->nodes[n].nedges++;
+			ac->edges[i].to = ch;
+			ac->edges[i].c = ac->nodes[ch].c;
+			for (j = i; j > nedges &&
+			    ac->edges[j - 1].c > ac->edges[j].c; j--) {
+				tmp = ac->edges[j];
+				ac->edges[j] = ac->edges[j - 1];
+				ac->edges[j - 1] = tmp;
+			}
+		}
+		nedges += ac->nodes[n].nedges;
+	}
+
+	return (0);
+}
+
+/* lookup the child of the compiled automaton */
+uint32_t
+ac_goto(struct ac *ac, uint32_t n, u_char c)
+{
+	struct ac_edge	*edges;
+	uint32_t	 lo, hi, mid;
+
+	edges = ac->edges + ac->nodes[n].child;
+	for (lo = 0, hi = ac->nodes[n].nedges; lo < hi; ) {
+		mid = (lo + hi) / 2;
+		if (edges[mid].c == c)
+			return (edges[mid].to);
+		if (edges[mid].c < c)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (0);
+}
+
+void
+ac_feed(struct matcher *self, struct ac *ac, uint32_t *state, u_char c,
+    void (*cb)(void *, int), void *ctx)
+{
+	uint32_t	 n = *state, t;
+	int32_t		 p;
+
+	for (;;) {
+		if (n == 0) {
+			n = ac->root[c];
+			break;
+		}
+		if ((t = ac_goto(ac, n, c)) != 0) {
+			n = t;
+			break;
+		}
+		n = ac->nodes[n].fail;
+	}
+	*state = n;
+
+	for (t = (ac->nodes[n].out >= 0)? n : ac->nodes[n].dict; t != 0;
+	    t = ac->nodes[t].dict) {
+		for (p = ac->nodes[t].out; p >= 0; p = self->pats[p].next)
+			cb(ctx, self->pats[p].id);
+	}
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	MATCHER_H
+#define	MATCHER_H 1
+
+#include <stdint.h>
+
+#define	MATCHER_ICASE		0x0001
+
+struct matcher;
+
+struct matcher_state {
+	uint32_t	 exact;		/* node of the exact automaton */
+	uint32_t	 folded;	/* node of the folded automaton */
+};
+
+struct matcher	*matcher_new(void);
+void		 matcher_free(struct matcher *);
+int		 matcher_add(struct matcher *, const char *, size_t, int, int);
+int		 matcher_compile(struct matcher *);
+void		 matcher_reset(struct matcher *, struct matcher_state *);
+void		 matcher_scan(struct matcher *, struct matcher_state *,
+		    const char *, size_t, void (*)(void *, int), void *);
+
+#endif	/* !MATCHER_H */
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <sys/types.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "mboxscan.h"
+
+/*
+ * Find the From_ lines of a mbox.  The candidates, LF followed by `F', are
+ * found 16 bytes at once by SSE2, then verified.  A large mbox is split
+ * into chunks by the LF position and they are scanned by the threads.
+ */
+
+#define	SCAN_CHUNKSIZ		(64 * 1024 * 1024)
+#define	SCAN_MAXTHREADS		8
+
+struct scan {
+	const char	*buf;
+	size_t		 len;		/* of the whole buffer */
+	size_t		 begin;		/* LFs in [begin, end) are scanned */
+	size_t		 end;
+	uint64_t	*offs;
+	size_t		 noffs;
+	size_t		 offssiz;
+	int		 error;
+	bool		 threaded;
+	pthread_t	 thread;
+};
+
+static void	*scan_thread(void *);
+static void	 scan_chunk(struct scan *);
+static void	 scan_add(struct scan *, size_t);
+
+/*
+ * Returns the offsets of the From_ lines in `buf'.  The caller must free
+ * `*offsp'.
+ */
+int
+mbox_scan(const char *buf, size_t len, uint64_t **offsp, size_t *noffsp)
+{
+	struct scan	*scans, first;
+	long		 ncpu;
+	int		 i, nscans;
+	size_t		 noffs = 0, chunk;
+	uint64_t	*offs = NULL, *p;
+
+	memset(&first, 0, sizeof(first));
+	first.buf = buf;
+	first.len = len;
+	if (len >= 5 && memcmp(buf, "From ", 5) == 0)
+		scan_add(&first, 0);
+
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	nscans = len / SCAN_CHUNKSIZ;
+	if (nscans > ncpu)
+		nscans = ncpu;
+	if (nscans > SCAN_MAXTHREADS)
+		nscans = SCAN_MAXTHREADS;
+	if (nscans < 1)
+		nscans = 1;
+	if ((scans = calloc(nscans, sizeof(struct scan))) == NULL) {
+		free(first.offs);
+		return (-1);
+	}
+	chunk = len / nscans;
+	for (i = 0; i < nscans; i++) {
+		scans[i].buf = buf;
+		scans[i].len = len;
+		scans[i].begin = chunk * i;
+		scans[i].end = (i + 1 < nscans)? chunk * (i + 1) : len;
+		/* the first one is done by this thread */
+		if (i > 0 && pthread_create(&scans[i].thread, NULL,
+		    scan_thread, &scans[i]) == 0)
+			scans[i].threaded = true;
+		else
+			scan_chunk(&scans[i]);
+	}
+	for (i = 0; i < nscans; i++) {
+		if (scans[i].threaded)
+			pthread_join(scans[i].thread, NULL);
+		if (scans[i].error != 0)
+			first.error = scans[i].error;
+		noffs += scans[i].noffs;
+	}
+	noffs += first.noffs;
+
+	/* concatenate in the order of the chunks */
+	if (first.error == 0 && noffs > 0 &&
+	    (offs = reallocarray(NULL, noffs, sizeof(uint64_t))) == NULL)
+		first.error = errno;
+	if (first.error == 0 && offs != NULL) {
+		p = offs;
+		if (first.noffs > 0) {
+			memcpy(p, first.offs, first.noffs * sizeof(uint64_t));
+			p += first.noffs;
+		}
+		for (i = 0; i < nscans; i++) {
+			if (scans[i].noffs == 0)
+				continue;
+			memcpy(p, scans[i].offs,
+			    scans[i].noffs * sizeof(uint64_t));
+			p += scans[i].noffs;
+		}
+	}
+	for (i = 0; i < nscans; i++)
+		free(scans[i].offs);
+	free(scans);
+	free(first.offs);
+	if (first.error != 0) {
+		free(offs);
+		errno = first.error;
+		return (-1);
+	}
+	*offsp = offs;
+	*noffsp = noffs;
+
+	return (0);
+}
+
+void *
+scan_thread(void *ctx)
+{
+	scan_chunk(ctx);
+	return (NULL);
+}
+
+void
+scan_chunk(struct scan *self)
+{
+	const char	*p, *lf;
+	size_t		 i = self->begin;
+#ifdef __SSE2__
+	__m128i		 lfs, fs, a, b;
+	unsigned	 mask;
+
+	lfs = _mm_set1_epi8('\n');
+	fs = _mm_set1_epi8('F');
+	/* `i + 1' is loaded too */
+	for (; i + 16 <= self->end && i + 17 <= self->len; i += 16) {
+		a = _mm_loadu_si128((const __m128i *)(self->buf + i));
+		b = _mm_loadu_si128((const __m128i *)(self->buf + i + 1));
+		mask = _mm_movemask_epi8(_mm_and_si128(
+		    _mm_cmpeq_epi8(a, lfs), _mm_cmpeq_epi8(b, fs)));
+		while (mask != 0) {
+			scan_add(self, i + __builtin_ctz(mask) + 1);
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for (p = self->buf + i; p < self->buf + self->end; p = lf + 1) {
+		if ((lf = memchr(p, '\n', self->buf + self->end - p)) == NULL)
+			break;
+		scan_add(self, lf - self->buf + 1);
+	}
+}
+
+/* add the line at `off' if it's a From_ line */
+void
+scan_add(struct scan *self, size_t off)
+{
+	uint64_t	*offs;
+	size_t		 newsiz;
+
+	if (self->len - off < 5 || memcmp(self->buf + off, "From ", 5) != 0)
+		return;
+	if (self->noffs >= self->offssiz) {
+		newsiz = (self->offssiz == 0)? 1024 : self->offssiz * 2;
+		if ((offs = reallocarray(self->offs, newsiz,
+		    sizeof(uint64_t))) == NULL) {
+			self->error = errno;
+			return;
+		}
+		self->offs = offs;
+		self->offssiz = newsiz;
+	}
+	self->offs[self->noffs++] = off;
+}
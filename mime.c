@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Streaming decoder of the MIME body.  The body lines are split into the
+ * parts by the boundaries of the multiparts, and the content of the leaf
+ * parts are decoded from quoted-printable or base64 and passed to the
+ * callback with the part.  An embedded message (message/rfc822) is
+ * decoded as a part too.
+ */
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mime.h"
+
+#define	MIME_MAXDEPTH		8
+#define	MIME_HDRSIZ		1024
+
+#define	MIME_TOPHEADERS		0	/* headers of the message */
+#define	MIME_HEADERS		1	/* headers of a part */
+#define	MIME_BODY		2
+#define	MIME_SKIP		3	/* preamble or epilogue */
+
+struct mime {
+	mime_on_data	 on_data;
+	void		*ctx;
+	int		 state;
+	struct mime_part part;
+	/* the boundaries of the enclosing multiparts */
+	char		 bounds[MIME_MAXDEPTH][sizeof(((struct mime_part *)0)
+			    ->boundary)];
+	int		 nbounds;
+	int		 nparts;
+	char		 hdr[MIME_HDRSIZ];	/* the part header unfolded */
+	size_t		 hdrlen;
+	u_char		 quad[4];		/* base64 not decoded yet */
+	int		 nquad;
+	char		*buf;
+	size_t		 bufsiz;
+};
+
+static void	 mime_line(struct mime *, const char *, size_t);
+static bool	 mime_boundary(struct mime *, const char *, size_t);
+static void	 mime_part_init(struct mime *);
+static void	 mime_part_header(struct mime *, const char *, const char *);
+static void	 mime_part_hdrline(struct mime *);
+static void	 mime_part_start(struct mime *);
+static void	 mime_part_end(struct mime *);
+static void	 mime_decode(struct mime *, const char *, size_t);
+static void	 mime_param(const char *, const char *, char *, size_t);
+static int	 hexval(int);
+static int	 b64val(int);
+
+struct mime *
+mime_new(mime_on_data on_data, void *ctx)
+{
+	struct mime	*self;
+
+	if ((self = calloc(1, sizeof(struct mime))) == NULL)
+		return (NULL);
+	self->on_data = on_data;
+	self->ctx = ctx;
+	mime_begin(self);
+
+	return (self);
+}
+
+void
+mime_free(struct mime *self)
+{
+	if (self == NULL)
+		return;
+	free(self->buf);
+	free(self);
+}
+
+/* start a message, the headers are given by mime_header() */
+void
+mime_begin(struct mime *self)
+{
+	self->state = MIME_TOPHEADERS;
+	self->nbounds = 0;
+	self->nparts = 0;
+	self->hdrlen = 0;
+	mime_part_init(self);
+}
+
+void
+mime_header(struct mime *self, const char *hdr, const char *value)
+{
+	if (self->state == MIME_TOPHEADERS)
+		mime_part_header(self, hdr, value);
+}
+
+/* a line of the body without the line break */
+void
+mime_body(struct mime *self, const char *line, size_t linelen)
+{
+	if (linelen > 0 && line[linelen - 1] == '\r')
+		linelen--;
+	if (self->state == MIME_TOPHEADERS)
+		mime_part_start(self);
+	mime_line(self, line, linelen);
+}
+
+/* the rest of the current part is not decoded */
+void
+mime_skip(struct mime *self)
+{
+	if (self->state == MIME_BODY)
+		self->state = MIME_SKIP;
+	self->nquad = 0;
+}
+
+void
+mime_end(struct mime *self)
+{
+	if (self->state == MIME_BODY)
+		mime_part_end(self);
+	self->state = MIME_SKIP;
+}
+
+void
+mime_line(struct mime *self, const char *line, size_t linelen)
+{
+	if (self->nbounds > 0 && linelen >= 2 && line[0] == '-' &&
+	    line[1] == '-' && mime_boundary(self, line + 2, linelen - 2))
+		return;
+
+	switch (self->state) {
+	case MIME_HEADERS:
+		if (linelen > 0 && (*line == ' ' || *line == '\t')) {
+			/* folded */
+			if (self->hdrlen + linelen < sizeof(self->hdr)) {
+				memcpy(self->hdr + self->hdrlen, line,
+				    linelen);
+				self->hdrlen += linelen;
+			}
+			break;
+		}
+		mime_part_hdrline(self);
+		if (linelen == 0) {
+			mime_part_start(self);
+			break;
+		}
+		if (linelen < sizeof(self->hdr)) {
+			memcpy(self->hdr, line, linelen);
+			self->hdrlen = linelen;
+		}
+		break;
+	case MIME_BODY:
+		mime_decode(self, line, linelen);
+		break;
+	}
+}
+
+/* returns true if the line is a boundary of the enclosing multiparts */
+bool
+mime_boundary(struct mime *self, const char *line, size_t linelen)
+{
+	size_t	 len, i;
+	int	 depth;
+	bool	 close;
+
+	for (depth = self->nbounds - 1; depth >= 0; depth--) {
+		len = strlen(self->bounds[depth]);
+		if (linelen < len || memcmp(line, self->bounds[depth], len)
+		    != 0)
+			continue;
+		close = (linelen >= len + 2 && line[len] == '-' &&
+		    line[len + 1] == '-');
+		for (i = len + (close? 2 : 0); i < linelen; i++) {
+			if (!isspace((u_char)line[i]))
+				break;
+		}
+		if (i < linelen)
+			continue;
+		break;
+	}
+	if (depth < 0)
+		return (false);
+
+	if (self->state == MIME_BODY)
+		mime_part_end(self);
+	if (close) {
+		/* the epilogue of the multipart */
+		self->nbounds = depth;
+		self->state = MIME_SKIP;
+	} else {
+		self->nbounds = depth + 1;
+		self->state = MIME_HEADERS;
+		self->hdrlen = 0;
+		mime_part_init(self);
+	}
+
+	return (true);
+}
+
+void
+mime_part_init(struct mime *self)
+{
+	memset(&self->part, 0, sizeof(self->part));
+	strlcpy(self->part.type, "text/plain", sizeof(self->part.type));
+	self->part.encoding = MIME_ENC_NONE;
+	self->part.depth = self->nbounds;
+	self->part.index = ++self->nparts;
+	self->nquad = 0;
+}
+
+void
+mime_part_header(struct mime *self, const char *hdr, const char *value)
+{
+	char	*sp, buf[sizeof(self->part.filename)];
+	size_t	 i, len;
+
+	while (isspace((u_char)*value))
+		value++;
+	if (strcasecmp(hdr, "content-type") == 0) {
+		len = strcspn(value, "; \t");
+		if (len == 0 || len >= sizeof(self->part.type))
+			return;
+		for (i = 0; i < len; i++)
+			self->part.type[i] = tolower((u_char)value[i]);
+		self->part.type[len] = '\0';
+		mime_param(value + len, "charset", self->part.charset,
+		    sizeof(self->part.charset));
+		for (sp = self->part.charset; *sp != '\0'; sp++)
+			*sp = tolower((u_char)*sp);
+		mime_param(value + len, "boundary", self->part.boundary,
+		    sizeof(self->part.boundary));
+		if (self->part.filename[0] == '\0')
+			mime_param(value + len, "name", self->part.filename,
+			    sizeof(self->part.filename));
+	} else if (strcasecmp(hdr, "content-disposition") == 0) {
+		len = strcspn(value, "; \t");
+		if (len >= sizeof(self->part.disposition))
+			return;
+		for (i = 0; i < len; i++)
+			self->part.disposition[i] = tolower((u_char)value[i]);
+		self->part.disposition[len] = '\0';
+		/* filename of the disposition takes precedence */
+		mime_param(value + len, "filename", buf, sizeof(buf));
+		if (buf[0] != '\0')
+			strlcpy(self->part.filename, buf,
+			    sizeof(self->part.filename));
+	} else if (strcasecmp(hdr, "content-transfer-encoding") == 0) {
+		if (strncasecmp(value, "quoted-printable", 16) == 0)
+			self->part.encoding = MIME_ENC_QP;
+		else if (strncasecmp(value, "base64", 6) == 0)
+			self->part.encoding = MIME_ENC_BASE64;
+		else
+			self->part.encoding = MIME_ENC_NONE;
+	}
+}
+
+/* the header line accumulated */
+void
+mime_part_hdrline(struct mime *self)
+{
+	char	*colon, *sp;
+
+	if (self->hdrlen == 0)
+		return;
+	self->hdr[self->hdrlen] = '\0';
+	self->hdrlen = 0;
+	if ((colon = strchr(self->hdr, ':')) == NULL)
+		return;
+	*colon = '\0';
+	for (sp = colon; sp > self->hdr && isspace((u_char)sp[-1]); sp--)
+		sp[-1] = '\0';
+	mime_part_header(self, self->hdr, colon + 1);
+}
+
+/* the headers of the part end */
+void
+mime_part_start(struct mime *self)
+{
+	if (strncmp(self->part.type, "multipart/", 10) == 0 &&
+	    self->part.boundary[0] != '\0' && self->nbounds < MIME_MAXDEPTH) {
+		strlcpy(self->bounds[self->nbounds++], self->part.boundary,
+		    sizeof(self->bounds[0]));
+		self->state = MIME_SKIP;	/* preamble */
+	} else if (strcmp(self->part.type, "message/rfc822") == 0) {
+		/* the headers of the embedded message follow */
+		self->state = MIME_HEADERS;
+		self->hdrlen = 0;
+		mime_part_init(self);
+	} else
+		self->state = MIME_BODY;
+}
+
+void
+mime_part_end(struct mime *self)
+{
+	u_char	 out[3];
+
+	/* base64 without the padding */
+	if (self->part.encoding == MIME_ENC_BASE64 && self->nquad >= 2) {
+		out[0] = self->quad[0] << 2 | self->quad[1] >> 4;
+		out[1] = self->quad[1] << 4 | self->quad[2] >> 2;
+		self->on_data(self->ctx, &self->part, (char *)out,
+		    self->nquad - 1);
+	}
+	self->nquad = 0;
+}
+
+void
+mime_decode(struct mime *self, const char *line, size_t linelen)
+{
+	char	*buf, *out;
+	size_t	 i, end;
+	int	 hi, lo, v;
+
+	/*
+	 * the line and the line break, or the base64 of the line and the 3
+	 * characters carried over from the previous lines
+	 */
+	if (self->bufsiz < linelen + 4) {
+		if ((buf = realloc(self->buf, linelen + 4)) == NULL)
+			return;
+		self->buf = buf;
+		self->bufsiz = linelen + 4;
+	}
+	out = self->buf;
+
+	switch (self->part.encoding) {
+	case MIME_ENC_QP:
+		for (end = linelen; end > 0 && (line[end - 1] == ' ' ||
+		    line[end - 1] == '\t'); end--)
+			;
+		for (i = 0; i < end; i++) {
+			if (line[i] != '=') {
+				*out++ = line[i];
+				continue;
+			}
+			if (i + 1 == end)
+				break;		/* soft line break */
+			if (i + 2 < end && (hi = hexval(line[i + 1])) >= 0 &&
+			    (lo = hexval(line[i + 2])) >= 0) {
+				*out++ = hi << 4 | lo;
+				i += 2;
+			} else
+				*out++ = '=';
+		}
+		if (i == end)
+			*out++ = '\n';
+		break;
+	case MIME_ENC_BASE64:
+		for (i = 0; i < linelen; i++) {
+			if (line[i] == '=') {
+				/* padding */
+				if (self->nquad >= 2)
+					*out++ = self->quad[0] << 2 |
+					    self->quad[1] >> 4;
+				if (self->nquad >= 3)
+					*out++ = self->quad[1] << 4 |
+					    self->quad[2] >> 2;
+				self->nquad = 0;
+				break;
+			}
+			if ((v = b64val((u_char)line[i])) < 0)
+				continue;
+			self->quad[self->nquad++] = v;
+			if (self->nquad < 4)
+				continue;
+			*out++ = self->quad[0] << 2 | self->quad[1] >> 4;
+			*out++ = self->quad[1] << 4 | self->quad[2] >> 2;
+			*out++ = self->quad[2] << 6 | self->quad[3];
+			self->nquad = 0;
+		}
+		break;
+	default:
+		memcpy(out, line, linelen);
+		out += linelen;
+		*out++ = '\n';
+		break;
+	}
+	if (out > self->buf)
+		self->on_data(self->ctx, &self->part, self->buf,
+		    out - self->buf);
+}
+
+/* get the parameter of the header value, `name=value' or `name="value"' */
+void
+mime_param(const char *params, const char *name, char *buf, size_t bufsiz)
+{
+	const char	*sp;
+	size_t		 namelen = strlen(name), len = 0;
+
+	buf[0] = '\0';
+	for (sp = params; (sp = strchr(sp, ';')) != NULL; ) {
+		for (sp++; isspace((u_char)*sp); sp++)
+			;
+		if (strncasecmp(sp, name, namelen) != 0)
+			continue;
+		for (sp += namelen; isspace((u_char)*sp); sp++)
+			;
+		if (*sp != '=')
+			continue;
+		for (sp++; isspace((u_char)*sp); sp++)
+			;
+		if (*sp == '"') {
+			for (sp++; *sp != '\0' && *sp != '"' &&
+			    len + 1 < bufsiz; sp++) {
+				if (*sp == '\\' && sp[1] != '\0')
+					sp++;
+				buf[len++] = *sp;
+			}
+		} else {
+			for (; *sp != '\0' && *sp != ';' &&
+			    !isspace((u_char)*sp) && len + 1 < bufsiz; sp++)
+				buf[len++] = *sp;
+		}
+		buf[len] = '\0';
+		return;
+	}
+}
+
+int
+hexval(int c)
+{
+	if ('0' <= c && c <= '9')
+		return (c - '0');
+	if ('A' <= c && c <= 'F')
+		return (c - 'A' + 10);
+	if ('a' <= c && c <= 'f')
+		return (c - 'a' + 10);
+
+	return (-1);
+}
+
+int
+b64val(int c)
+{
+	if ('A' <= c && c <= 'Z')
+		return (c - 'A');
+	if ('a' <= c && c <= 'z')
+		return (c - 'a' + 26);
+	if ('0' <= c && c <= '9')
+		return (c - '0' + 52);
+	if (c == '+')
+		return (62);
+	if (c == '/')
+		return (63);
+
+	return (-1);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	MIME_H
+#define	MIME_H 1
+
+#include <stddef.h>
+
+#define	MIME_ENC_NONE		0
+#define	MIME_ENC_QP		1
+#define	MIME_ENC_BASE64		2
+
+struct mime_part {
+	char		 type[80];	/* "text/plain", in lower case */
+	char		 charset[40];	/* in lower case, "" if not specified */
+	char		 boundary[76];	/* of multipart */
+	char		 disposition[16]; /* "attachment", in lower case */
+	char		 filename[128];	/* as is, "" if not specified */
+	int		 encoding;
+	int		 depth;		/* of the nested multiparts */
+	int		 index;		/* of the part in the message */
+};
+
+struct mime;
+
+typedef void	(*mime_on_data)(void *, const struct mime_part *,
+		    const char *, size_t);
+
+struct mime	*mime_new(mime_on_data, void *);
+void		 mime_free(struct mime *);
+void		 mime_begin(struct mime *);
+void		 mime_header(struct mime *, const char *, const char *);
+void		 mime_body(struct mime *, const char *, size_t);
+void		 mime_skip(struct mime *);
+void		 mime_end(struct mime *);
+
+#endif	/* !MIME_H */
@@ -46,6 +46,8 @@ struct token {
 
 static const struct token t_main[];
 static const struct token t_filename[];
+static const struct token t_stats[];
+static const struct token t_profile[];
 
 static const struct token t_main[] = {
 	{ KEYWORD,	"start",	RESTART,	t_filename},
@@ -53,6 +55,8 @@ static const struct token t_main[] = {
 	{ KEYWORD,	"restart",	RESTART,	t_filename},
 	{ KEYWORD,	"run",		RUN,		t_filename},
 	{ KEYWORD,	"inc",		INC,		NULL},
+	{ KEYWORD,	"stats",	STATS,		t_stats},
+	{ KEYWORD,	"profile",	NONE,		t_profile},
 	{ ENDTOKEN,	"",		NONE,		NULL}
 };
 
@@ -61,6 +65,18 @@ static const struct token t_filename[] = {
 	{ ENDTOKEN,	"",		NONE,		NULL}
 };
 
+static const struct token t_stats[] = {
+	{ NOTOKEN,	"",		NONE,		NULL},
+	{ KEYWORD,	"reset",	STATS_RESET,	NULL},
+	{ ENDTOKEN,	"",		NONE,		NULL}
+};
+
+static const struct token t_profile[] = {
+	{ KEYWORD,	"start",	PROFILE_START,	NULL},
+	{ KEYWORD,	"stop",		PROFILE_STOP,	NULL},
+	{ ENDTOKEN,	"",		NONE,		NULL}
+};
+
 static struct parse_result	res;
 
 const struct token	*match_token(int *argc, char **argv[],
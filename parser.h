@@ -24,6 +24,10 @@ enum actions {
 	RESTART,
 	RUN,
 	INC,
+	STATS,
+	STATS_RESET,
+	PROFILE_START,
+	PROFILE_STOP,
 	NONE
 };
 
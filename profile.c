@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lua.h>
+
+#include "local.h"
+
+/*
+ * Sampling profiler of the Lua code.  SIGPROF arms a count hook, the hook
+ * takes the stack at the next instruction.  The stacks are aggregated and
+ * reported in the collapsed form ("outer;inner count") which the flame
+ * graph tools take.
+ */
+
+#define	PROF_NBUCKETS		1024
+#define	PROF_STACKSIZ		2048
+
+struct prof_entry {
+	struct prof_entry	*next;
+	uint64_t		 count;
+	char			 stack[];
+};
+
+static lua_State		*prof_L = NULL;
+static struct prof_entry	*prof_buckets[PROF_NBUCKETS];
+static uint64_t			 prof_lost;
+
+static void	 prof_on_sigprof(int);
+static void	 prof_hook(lua_State *, lua_Debug *);
+static uint32_t	 prof_hash(const char *);
+static void	 prof_clear(void);
+
+int
+profile_start(lua_State *L, int hz)
+{
+	struct sigaction	 sa;
+	struct itimerval	 itv;
+
+	if (prof_L != NULL) {
+		errno = EALREADY;
+		return (-1);
+	}
+	if (hz <= 0 || hz > 1000000) {
+		errno = EINVAL;
+		return (-1);
+	}
+	prof_L = L;
+	prof_lost = 0;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = prof_on_sigprof;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, NULL) == -1)
+		goto fail;
+
+	memset(&itv, 0, sizeof(itv));
+	itv.it_interval.tv_usec = 1000000 / hz;
+	itv.it_value = itv.it_interval;
+	if (setitimer(ITIMER_PROF, &itv, NULL) == -1)
+		goto fail;
+
+	return (0);
+ fail:
+	signal(SIGPROF, SIG_DFL);
+	prof_L = NULL;
+	return (-1);
+}
+
+/*
+ * Stop the profiler and return the collapsed stacks.  The caller must free
+ * the result.
+ */
+char *
+profile_stop(void)
+{
+	struct itimerval	 itv;
+	struct prof_entry	*ent;
+	FILE			*fp;
+	char			*buf = NULL;
+	size_t			 bufsiz = 0;
+	int			 i;
+
+	if (prof_L == NULL) {
+		errno = ESRCH;
+		return (NULL);
+	}
+	memset(&itv, 0, sizeof(itv));
+	setitimer(ITIMER_PROF, &itv, NULL);
+	signal(SIGPROF, SIG_DFL);
+	lua_sethook(prof_L, NULL, 0, 0);
+	prof_L = NULL;
+
+	if ((fp = open_memstream(&buf, &bufsiz)) == NULL) {
+		prof_clear();
+		return (NULL);
+	}
+	for (i = 0; i < PROF_NBUCKETS; i++) {
+		for (ent = prof_buckets[i]; ent != NULL; ent = ent->next)
+			fprintf(fp, "%s %llu\n", ent->stack,
+			    (unsigned long long)ent->count);
+	}
+	if (prof_lost > 0)
+		fprintf(fp, "[lost] %llu\n", (unsigned long long)prof_lost);
+	fclose(fp);
+	prof_clear();
+
+	return (buf);
+}
+
+void
+prof_on_sigprof(int sig)
+{
+	int	 saved_errno = errno;
+
+	/* lua_sethook() is safe to be called by a signal handler */
+	if (prof_L != NULL)
+		lua_sethook(prof_L, prof_hook, LUA_MASKCOUNT, 1);
+	errno = saved_errno;
+}
+
+void
+prof_hook(lua_State *L, lua_Debug *ar)
+{
+	lua_Debug		 fr;
+	char			 stack[PROF_STACKSIZ];
+	int			 depth, level, len = 0, n;
+	uint32_t		 h;
+	struct prof_entry	*ent;
+
+	lua_sethook(L, NULL, 0, 0);
+
+	for (depth = 0; lua_getstack(L, depth, &fr); depth++)
+		;
+	/* from the outermost */
+	stack[0] = '\0';
+	for (level = depth - 1; level >= 0; level--) {
+		if (!lua_getstack(L, level, &fr) ||
+		    !lua_getinfo(L, "Sn", &fr))
+			break;
+		if (strcmp(fr.what, "C") == 0)
+			n = snprintf(stack + len, sizeof(stack) - len,
+			    "%s%s@[C]", (len > 0)? ";" : "",
+			    (fr.name != NULL)? fr.name : "?");
+		else if (strcmp(fr.what, "main") == 0)
+			n = snprintf(stack + len, sizeof(stack) - len,
+			    "%smain@%s", (len > 0)? ";" : "", fr.short_src);
+		else
+			n = snprintf(stack + len, sizeof(stack) - len,
+			    "%s%s@%s:%d", (len > 0)? ";" : "",
+			    (fr.name != NULL)? fr.name : "?", fr.short_src,
+			    fr.linedefined);
+		if (n < 0 || (size_t)n >= sizeof(stack) - len) {
+			/* too deep, cut the innermost */
+			stack[len] = '\0';
+			break;
+		}
+		len += n;
+	}
+	if (len == 0)
+		return;
+
+	h = prof_hash(stack) % PROF_NBUCKETS;
+	for (ent = prof_buckets[h]; ent != NULL; ent = ent->next) {
+		if (strcmp(ent->stack, stack) == 0)
+			break;
+	}
+	if (ent == NULL) {
+		if ((ent = calloc(1, sizeof(*ent) + len + 1)) == NULL) {
+			prof_lost++;
+			return;
+		}
+		memcpy(ent->stack, stack, len + 1);
+		ent->next = prof_buckets[h];
+		prof_buckets[h] = ent;
+	}
+	ent->count++;
+}
+
+uint32_t
+prof_hash(const char *str)
+{
+	uint32_t	 h = 2166136261U;	/* FNV-1a */
+
+	for (; *str != '\0'; str++)
+		h = (h ^ (u_char)*str) * 16777619U;
+
+	return (h);
+}
+
+void
+prof_clear(void)
+{
+	struct prof_entry	*ent, *next;
+	int			 i;
+
+	for (i = 0; i < PROF_NBUCKETS; i++) {
+		for (ent = prof_buckets[i]; ent != NULL; ent = next) {
+			next = ent->next;
+			free(ent);
+		}
+		prof_buckets[i] = NULL;
+	}
+}
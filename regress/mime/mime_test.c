@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <sys/types.h>
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mime.h"
+
+static void	 on_data(void *, const struct mime_part *, const char *,
+		    size_t);
+static void	 test(const char *, const char *[], const char *);
+
+static char	 out[1024];
+static size_t	 outlen;
+
+int
+main(void)
+{
+	/* characters carried over the short lines */
+	test("base64", (const char *[]){ "Q", "U", "J", "D", NULL }, "ABC");
+	test("base64", (const char *[]){ "QU", "JDRA", "=", NULL }, "ABCD");
+	test("base64", (const char *[]){ "QUJD", "REVG", "Rw", NULL },
+	    "ABCDEFG");
+	test("quoted-printable", (const char *[]){ "a=3Db=", "c", NULL },
+	    "a=bc\n");
+
+	return (0);
+}
+
+void
+on_data(void *ctx, const struct mime_part *part, const char *data,
+    size_t len)
+{
+	if (outlen + len > sizeof(out))
+		errx(1, "too long");
+	memcpy(out + outlen, data, len);
+	outlen += len;
+}
+
+void
+test(const char *encoding, const char *lines[], const char *expect)
+{
+	struct mime	*mime;
+	char		*line;
+	int		 i;
+
+	if ((mime = mime_new(on_data, NULL)) == NULL)
+		err(1, "mime_new");
+	outlen = 0;
+	mime_begin(mime);
+	mime_header(mime, "content-transfer-encoding", encoding);
+	for (i = 0; lines[i] != NULL; i++) {
+		/* exactly sized to catch the overflow */
+		if ((line = strdup(lines[i])) == NULL)
+			err(1, "strdup");
+		mime_body(mime, line, strlen(line));
+		free(line);
+	}
+	mime_end(mime);
+	mime_free(mime);
+	if (outlen != strlen(expect) || memcmp(out, expect, outlen) != 0)
+		errx(1, "%s: got \"%.*s\", expected \"%s\"", encoding,
+		    (int)outlen, out, expect);
+}
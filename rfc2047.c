@@ -20,29 +20,7 @@
 #include <strings.h>
 #include <iconv.h>
 
-static struct {
-	const char	*mime;
-	const char	*iconv;
-	int		 mimelen;
-} rfc2047_charsets[] = {
-	{	"us-ascii",		"ASCII"			},
-	{	"utf-8",		"UTF-8"			},
-	{	"iso-8859-1",		"ISO-8859-1"		},
-	{	"iso-2022-jp",		"ISO-2022-JP"		},
-	{	"gb2312",		"EUC-CN"		},
-	{	"ks_c_5601-1987",	"EUC-KR"		},
-	{	"windows-1250",		"CP1250"		},
-	{	"windows-1251",		"CP1251"		},
-	{	"windows-1252",		"CP1252"		},
-	{	"windows-1253",		"CP1253"		},
-	{	"windows-1254",		"CP1254"		},
-	{	"windows-1255",		"CP1255"		},
-	{	"windows-1256",		"CP1256"		},
-	{	"windows-1257",		"CP1257"		},
-	{	"windows-1258",		"CP1258"		}
-};
-
-#define nitems(_x)	(sizeof((_x)) / sizeof((_x)[0]))
+#include "charset.h"
 
 #define IS_XDIGIT(_c) (				\
 	(('0' <= (_c) && (_c) <= '9')) ||	\
@@ -86,22 +64,13 @@ rfc2047_decode(const char *str, const char *tocode, char *decode,
 	} else
 		goto fail;	/* unknown encoding */
 
-	for (i = 0; i < nitems(rfc2047_charsets); i++) {
-		if (rfc2047_charsets[i].mimelen == 0)
-			rfc2047_charsets[i].mimelen =
-			    strlen(rfc2047_charsets[i].mime);
-		if (strncasecmp(p, rfc2047_charsets[i].mime,
-		    rfc2047_charsets[i].mimelen) == 0 &&
-		    p[rfc2047_charsets[i].mimelen] == '?') {
-    			cs = rfc2047_charsets[i].mime;
-			break;
-		}
-	}
-	if (cs == NULL)
+	for (i = 0; p[i] != '\0' && p[i] != '?'; i++)
+		;
+	if (p[i] != '?' || (cs = charset_iconv(p, i)) == NULL)
 		goto fail;	/* unknown charset */
 
-	p += rfc2047_charsets[i].mimelen + 1;
-	len -= rfc2047_charsets[i].mimelen + 1;
+	p += i + 1;
+	len -= i + 1;
 
 	if ((p[0] == 'B' || p[0] == 'Q' || p[0] == 'b' || p[0] == 'q') &&
 	    p[1] == '?') {
@@ -154,17 +123,17 @@ rfc2047_decode(const char *str, const char *tocode, char *decode,
 		goto fail;
 		break;
 	}
-	if ((ic = iconv_open(tocode, cs)) == (iconv_t)-1)
+	if ((ic = charset_open(tocode, cs)) == (iconv_t)-1)
 		goto fail;
 	if (iconv(ic, &in, &insz, &out, &outsz) == (size_t)-1)
 		goto fail;
 	freezero(tmp, tmpsz);
-	iconv_close(ic);
+	charset_close(ic, tocode, cs);
 
 	return (p + len + 2 - str);
 fail:
 	freezero(tmp, tmpsz);
 	if (ic != (iconv_t)-1)
-		iconv_close(ic);
+		charset_close(ic, tocode, cs);
 	return (-1);
 }
@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Declarative filtering rules.  Each rule is a tree of conditions, the
+ * leaves are evaluated while the message is streamed and the tree is
+ * evaluated in three-valued logic, so the first matching rule is often
+ * decided at the end of the headers and the body need not be scanned.
+ * All the `contains' conditions share one multi-pattern matcher.
+ */
+#include <sys/types.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "matcher.h"
+#include "rules.h"
+
+struct rules_node {
+	enum rules_op	 op;
+	int		 parent;
+	int		 child;		/* first child, -1 if none */
+	int		 sibling;	/* next sibling, -1 if none */
+	char		*header;	/* NULL for body, "*" for any header */
+	int64_t		 size;
+	int		 value;
+	int		 rule;		/* index of the rule */
+};
+
+struct rules {
+	struct rules_node	*nodes;
+	int			 nnodes;
+	int			 nodesiz;
+	int			*roots;		/* root node of each rule */
+	struct rules_stat	*stats;
+	int			 nroots;
+	int			 rootsiz;
+	int			 nextnode;	/* first node of next rule */
+	int			 cur;		/* open AND, OR or NOT */
+	int			 pending;	/* root of the next rule */
+	struct matcher		*matcher;
+	int			 npats;
+	char			**headers;	/* headers to be scanned */
+	int			 nheaders;
+	bool			 anyheader;
+	struct matcher_state	 state;
+	const char		*curhdr;
+	int64_t			 size;
+	int			 result;
+	bool			 changed;
+	bool			 compiled;
+	bool			 headers_only;	/* the body is not read */
+};
+
+static int	 rules_newnode(struct rules *, enum rules_op);
+static int	 rules_eval(struct rules *, int);
+static void	 rules_decide(struct rules *, bool);
+static void	 rules_settle(struct rules *, bool);
+static void	 rules_hit(void *, int);
+static uint64_t	 rules_nsec(void);
+
+static bool	 rules_timing = false;	/* time the evaluations */
+
+struct rules *
+rules_new(void)
+{
+	struct rules	*self;
+
+	if ((self = calloc(1, sizeof(struct rules))) == NULL)
+		return (NULL);
+	if ((self->matcher = matcher_new()) == NULL) {
+		free(self);
+		return (NULL);
+	}
+	self->cur = -1;
+	self->pending = -1;
+	self->result = RULES_UNDECIDED;
+
+	return (self);
+}
+
+void
+rules_free(struct rules *self)
+{
+	int	 i;
+
+	if (self == NULL)
+		return;
+	for (i = 0; i < self->nnodes; i++)
+		free(self->nodes[i].header);
+	for (i = 0; i < self->nheaders; i++)
+		free(self->headers[i]);
+	free(self->headers);
+	free(self->nodes);
+	free(self->roots);
+	free(self->stats);
+	matcher_free(self->matcher);
+	free(self);
+}
+
+/* start AND, OR or NOT.  the following nodes become its children */
+int
+rules_open(struct rules *self, enum rules_op op)
+{
+	int	 n;
+
+	if (op != RULES_AND && op != RULES_OR && op != RULES_NOT) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if ((n = rules_newnode(self, op)) == -1)
+		return (-1);
+	self->cur = n;
+
+	return (n);
+}
+
+int
+rules_close(struct rules *self)
+{
+	struct rules_node	*node;
+	int			 n, nchildren = 0;
+
+	if (self->cur < 0) {
+		errno = EINVAL;
+		return (-1);
+	}
+	node = &self->nodes[self->cur];
+	for (n = node->child; n >= 0; n = self->nodes[n].sibling)
+		nchildren++;
+	if (nchildren == 0 || (node->op == RULES_NOT && nchildren != 1)) {
+		errno = EINVAL;
+		return (-1);
+	}
+	self->cur = node->parent;
+
+	return (0);
+}
+
+int
+rules_leaf(struct rules *self, enum rules_op op, const char *header,
+    const char *pat, size_t patlen, int flags, int64_t size)
+{
+	struct rules_node	*node;
+	char			**headers;
+	int			 n, i;
+
+	if (op == RULES_AND || op == RULES_OR || op == RULES_NOT ||
+	    ((op == RULES_EXISTS || op == RULES_EXTERN) && header == NULL)) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if ((n = rules_newnode(self, op)) == -1)
+		return (-1);
+	node = &self->nodes[n];
+	node->size = size;
+	if (header != NULL && (node->header = strdup(header)) == NULL)
+		return (-1);
+	if (op != RULES_CONTAINS)
+		return (n);
+
+	if (matcher_add(self->matcher, pat, patlen, flags, n) == -1)
+		return (-1);
+	self->npats++;
+	if (header == NULL)
+		return (n);
+	if (strcmp(header, "*") == 0) {
+		self->anyheader = true;
+		return (n);
+	}
+	for (i = 0; i < self->nheaders; i++) {
+		if (strcmp(self->headers[i], header) == 0)
+			return (n);
+	}
+	if ((headers = reallocarray(self->headers, self->nheaders + 1,
+	    sizeof(char *))) == NULL)
+		return (-1);
+	self->headers = headers;
+	if ((self->headers[self->nheaders] = strdup(header)) == NULL)
+		return (-1);
+	self->nheaders++;
+
+	return (n);
+}
+
+/* the last top level condition becomes a rule */
+int
+rules_add(struct rules *self)
+{
+	struct rules_stat	*stats;
+	int			*roots, newsiz, n;
+
+	if (self->cur >= 0 || self->pending < 0) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if (self->nroots >= self->rootsiz) {
+		newsiz = (self->rootsiz == 0)? 16 : self->rootsiz * 2;
+		if ((roots = reallocarray(self->roots, newsiz, sizeof(int)))
+		    == NULL)
+			return (-1);
+		self->roots = roots;
+		if ((stats = recallocarray(self->stats, self->rootsiz, newsiz,
+		    sizeof(struct rules_stat))) == NULL)
+			return (-1);
+		self->stats = stats;
+		self->rootsiz = newsiz;
+	}
+	self->roots[self->nroots] = self->pending;
+	self->pending = -1;
+	for (n = self->nextnode; n < self->nnodes; n++)
+		self->nodes[n].rule = self->nroots;
+	self->nextnode = self->nnodes;
+
+	return (self->nroots++);
+}
+
+int
+rules_compile(struct rules *self)
+{
+	if (self->cur >= 0 || self->pending >= 0) {
+		errno = EINVAL;
+		return (-1);
+	}
+	if (matcher_compile(self->matcher) == -1)
+		return (-1);
+	self->compiled = true;
+
+	return (0);
+}
+
+/*
+ * Start a message.  `size' is the size of the message if known, or -1.
+ * If `headers_only' is true, the body is not read, then the conditions on
+ * the body and on the unknown size are left unknown.
+ */
+void
+rules_begin(struct rules *self, int64_t size, bool headers_only)
+{
+	struct rules_node	*node;
+	int			 i;
+
+	self->size = 0;
+	self->result = RULES_UNDECIDED;
+	self->changed = false;
+	self->headers_only = headers_only;
+	for (i = 0; i < self->nnodes; i++) {
+		node = &self->nodes[i];
+		node->value = RULES_UNKNOWN;
+		if (size < 0)
+			continue;
+		if (node->op == RULES_LARGER)
+			node->value = (size > node->size)
+			    ? RULES_TRUE : RULES_FALSE;
+		else if (node->op == RULES_SMALLER)
+			node->value = (size < node->size)
+			    ? RULES_TRUE : RULES_FALSE;
+	}
+	if (size >= 0)
+		self->size = -1;	/* don't count */
+	if (self->compiled)
+		rules_decide(self, false);
+}
+
+/*
+ * Process a header.  `ext' is called for the RULES_EXTERN conditions for
+ * the header, it should return non-zero if the condition is true.
+ */
+void
+rules_header(struct rules *self, const char *hdr, const char *value,
+    int (*ext)(void *, int, const char *), void *ctx)
+{
+	struct rules_node	*node;
+	int			 i, ret;
+	uint64_t		 t0;
+
+	if (self->size >= 0)
+		self->size += strlen(hdr) + strlen(value) + 3;
+	if (self->result != RULES_UNDECIDED)
+		return;
+	for (i = 0; i < self->nnodes; i++) {
+		node = &self->nodes[i];
+		if ((node->op != RULES_EXISTS && node->op != RULES_EXTERN) ||
+		    node->value == RULES_TRUE || strcmp(node->header, hdr) != 0)
+			continue;
+		if (node->op == RULES_EXTERN) {
+			t0 = rules_nsec();
+			ret = ext(ctx, i, value);
+			if (t0 != 0)
+				self->stats[node->rule].nsec += rules_nsec() -
+				    t0;
+			if (!ret)
+				continue;
+		}
+		node->value = RULES_TRUE;
+		self->changed = true;
+	}
+	for (i = 0; i < self->nheaders; i++) {
+		if (strcmp(self->headers[i], hdr) == 0)
+			break;
+	}
+	if (i < self->nheaders || self->anyheader) {
+		self->curhdr = hdr;
+		matcher_reset(self->matcher, &self->state);
+		matcher_scan(self->matcher, &self->state, value, strlen(value),
+		    rules_hit, self);
+	}
+}
+
+void
+rules_end_of_headers(struct rules *self)
+{
+	if (self->size >= 0)
+		self->size += 2;
+	self->curhdr = NULL;
+	matcher_reset(self->matcher, &self->state);
+	if (self->result != RULES_UNDECIDED)
+		return;
+	rules_settle(self, true);
+	rules_decide(self, false);
+}
+
+void
+rules_body(struct rules *self, const char *line, size_t linelen)
+{
+	if (self->size >= 0)
+		self->size += linelen + 1;
+	if (self->result != RULES_UNDECIDED)
+		return;
+	matcher_scan(self->matcher, &self->state, line, linelen, rules_hit,
+	    self);
+	matcher_scan(self->matcher, &self->state, "\n", 1, rules_hit, self);
+	if (self->changed)
+		rules_decide(self, false);
+}
+
+/* end of the message, `size' is the number of bytes actually read */
+void
+rules_end(struct rules *self, int64_t size)
+{
+	struct rules_node	*node;
+	int			 i;
+
+	if (self->result != RULES_UNDECIDED)
+		return;
+	if (self->size >= 0 && (size >= 0 || !self->headers_only)) {
+		if (size < 0)
+			size = self->size;
+		for (i = 0; i < self->nnodes; i++) {
+			node = &self->nodes[i];
+			if (node->op == RULES_LARGER)
+				node->value = (size > node->size)
+				    ? RULES_TRUE : RULES_FALSE;
+			else if (node->op == RULES_SMALLER)
+				node->value = (size < node->size)
+				    ? RULES_TRUE : RULES_FALSE;
+		}
+	}
+	rules_settle(self, false);
+	rules_decide(self, true);
+}
+
+/*
+ * Returns the index of the matched rule, RULES_NOMATCH or
+ * RULES_UNDECIDED.
+ */
+int
+rules_result(struct rules *self)
+{
+	return (self->result);
+}
+
+int
+rules_count(struct rules *self)
+{
+	return (self->nroots);
+}
+
+const struct rules_stat *
+rules_stat(struct rules *self, int rule)
+{
+	if (rule < 0 || rule >= self->nroots)
+		return (NULL);
+
+	return (&self->stats[rule]);
+}
+
+void
+rules_stat_reset(struct rules *self)
+{
+	memset(self->stats, 0, sizeof(struct rules_stat) * self->nroots);
+}
+
+int
+rules_newnode(struct rules *self, enum rules_op op)
+{
+	struct rules_node	*nodes;
+	int			 n, newsiz;
+
+	if (self->compiled) {
+		errno = EBUSY;
+		return (-1);
+	}
+	if (self->nnodes >= self->nodesiz) {
+		newsiz = (self->nodesiz == 0)? 64 : self->nodesiz * 2;
+		if ((nodes = reallocarray(self->nodes, newsiz,
+		    sizeof(struct rules_node))) == NULL)
+			return (-1);
+		self->nodes = nodes;
+		self->nodesiz = newsiz;
+	}
+	n = self->nnodes++;
+	memset(&self->nodes[n], 0, sizeof(struct rules_node));
+	self->nodes[n].op = op;
+	self->nodes[n].parent = self->cur;
+	self->nodes[n].child = -1;
+	self->nodes[n].sibling = -1;
+	if (self->cur >= 0) {
+		self->nodes[n].sibling = self->nodes[self->cur].child;
+		self->nodes[self->cur].child = n;
+	} else
+		self->pending = n;
+
+	return (n);
+}
+
+int
+rules_eval(struct rules *self, int n)
+{
+	struct rules_node	*node = &self->nodes[n];
+	int			 c, v;
+
+	switch (node->op) {
+	case RULES_AND:
+		v = RULES_TRUE;
+		for (c = node->child; c >= 0; c = self->nodes[c].sibling) {
+			switch (rules_eval(self, c)) {
+			case RULES_FALSE:
+				return (RULES_FALSE);
+			case RULES_UNKNOWN:
+				v = RULES_UNKNOWN;
+				break;
+			}
+		}
+		return (v);
+	case RULES_OR:
+		v = RULES_FALSE;
+		for (c = node->child; c >= 0; c = self->nodes[c].sibling) {
+			switch (rules_eval(self, c)) {
+			case RULES_TRUE:
+				return (RULES_TRUE);
+			case RULES_UNKNOWN:
+				v = RULES_UNKNOWN;
+				break;
+			}
+		}
+		return (v);
+	case RULES_NOT:
+		v = rules_eval(self, node->child);
+		return ((v == RULES_UNKNOWN)? v : !v);
+	default:
+		break;
+	}
+
+	return (node->value);
+}
+
+/* find the first matching rule, if it can be decided */
+void
+rules_decide(struct rules *self, bool final)
+{
+	int		 i, v;
+	uint64_t	 t0;
+
+	self->changed = false;
+	for (i = 0; i < self->nroots; i++) {
+		t0 = rules_nsec();
+		v = rules_eval(self, self->roots[i]);
+		self->stats[i].evals++;
+		if (t0 != 0)
+			self->stats[i].nsec += rules_nsec() - t0;
+		switch (v) {
+		case RULES_TRUE:
+			self->stats[i].hits++;
+			self->result = i;
+			return;
+		case RULES_UNKNOWN:
+			if (!final)
+				return;
+			break;
+		}
+	}
+	self->result = RULES_NOMATCH;
+}
+
+/* conditions which were not true until now are false */
+void
+rules_settle(struct rules *self, bool headers)
+{
+	struct rules_node	*node;
+	int			 i;
+
+	for (i = 0; i < self->nnodes; i++) {
+		node = &self->nodes[i];
+		if (node->value != RULES_UNKNOWN)
+			continue;
+		switch (node->op) {
+		case RULES_CONTAINS:
+			if (node->header != NULL ||
+			    (!headers && !self->headers_only))
+				node->value = RULES_FALSE;
+			break;
+		case RULES_EXISTS:
+		case RULES_EXTERN:
+			node->value = RULES_FALSE;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void
+rules_hit(void *ctx, int n)
+{
+	struct rules		*self = ctx;
+	struct rules_node	*node = &self->nodes[n];
+
+	if (node->value == RULES_TRUE)
+		return;
+	if (self->curhdr == NULL) {
+		if (node->header != NULL)
+			return;
+	} else if (node->header == NULL || (strcmp(node->header, "*") != 0 &&
+	    strcmp(node->header, self->curhdr) != 0))
+		return;
+	node->value = RULES_TRUE;
+	self->changed = true;
+}
+
+/* the time is taken only while enabled, 0 otherwise */
+void
+rules_stat_timing(bool on)
+{
+	rules_timing = on;
+}
+
+uint64_t
+rules_nsec(void)
+{
+	struct timespec	 ts;
+
+	if (!rules_timing)
+		return (0);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	RULES_H
+#define	RULES_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define	RULES_FALSE		0
+#define	RULES_TRUE		1
+#define	RULES_UNKNOWN		(-1)
+
+/* rules_result() */
+#define	RULES_NOMATCH		(-1)
+#define	RULES_UNDECIDED		(-2)
+
+enum rules_op {
+	RULES_AND,
+	RULES_OR,
+	RULES_NOT,
+	RULES_CONTAINS,		/* header or body contains the pattern */
+	RULES_EXISTS,		/* header exists */
+	RULES_LARGER,		/* message is larger than the size */
+	RULES_SMALLER,		/* message is smaller than the size */
+	RULES_EXTERN		/* header is tested by the callback */
+};
+
+struct rules;
+
+struct rules_stat {
+	uint64_t	 evals;		/* number of evaluations */
+	uint64_t	 hits;		/* number of messages matched */
+	uint64_t	 nsec;		/* time for evaluations and tests */
+};
+
+struct rules	*rules_new(void);
+void		 rules_free(struct rules *);
+int		 rules_open(struct rules *, enum rules_op);
+int		 rules_close(struct rules *);
+int		 rules_leaf(struct rules *, enum rules_op, const char *,
+		    const char *, size_t, int, int64_t);
+int		 rules_add(struct rules *);
+int		 rules_compile(struct rules *);
+void		 rules_begin(struct rules *, int64_t, bool);
+void		 rules_header(struct rules *, const char *, const char *,
+		    int (*)(void *, int, const char *), void *);
+void		 rules_end_of_headers(struct rules *);
+void		 rules_body(struct rules *, const char *, size_t);
+void		 rules_end(struct rules *, int64_t);
+int		 rules_result(struct rules *);
+int		 rules_count(struct rules *);
+const struct rules_stat
+		*rules_stat(struct rules *, int);
+void		 rules_stat_reset(struct rules *);
+void		 rules_stat_timing(bool);
+
+#endif	/* !RULES_H */
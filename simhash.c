@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Similarity index of the messages to find the bulk mail which varies
+ * slightly per recipient.  The body text is hashed into a 64 bits simhash
+ * of the shingles of 4 characters, the near-duplicates have the hashes of
+ * a small Hamming distance.  The hash is split into 8 blocks of 8 bits and
+ * a hash within the distance 6 shares 2 blocks at least, so the buckets
+ * are keyed by every pair of the blocks, 28 tables, and such a hash is
+ * always found.  The file is a ring of the recent hashes and the buckets,
+ * mapped by mapfile.c.
+ */
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapfile.h"
+#include "simhash.h"
+#include "utf8.h"
+
+#define	SIMHASH_MAGIC		"MFSIMH01"
+#define	SIMHASH_VERSION		1
+#define	SIMHASH_NENTRIES	32768	/* recent messages, power of 2 */
+#define	SIMHASH_NBLOCKS		8	/* of 8 bits */
+#define	SIMHASH_NTABLES		28	/* pairs of the blocks */
+#define	SIMHASH_NBUCKETS	4096	/* per table, power of 2 */
+#define	SIMHASH_MAXCHAIN	64	/* entries examined per table */
+#define	SIMHASH_SHINGLE		4	/* characters per feature */
+#define	SIMHASH_MINFEATURES	16	/* shorter text is not hashed */
+#define	SIMHASH_SIZE		\
+	(sizeof(struct simhash_hdr) + SIMHASH_NTABLES * SIMHASH_NBUCKETS * \
+	sizeof(uint32_t) + SIMHASH_NENTRIES * sizeof(struct simhash_ent))
+
+#define	FNV1A_INIT		14695981039346656037ULL
+#define	FNV1A(_h, _c)		(((_h) ^ (u_char)(_c)) * 1099511628211ULL)
+
+struct simhash_hdr {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 nentries;
+	uint32_t	 seq;		/* of the last entry, from 1 */
+	uint32_t	 pad;
+};
+
+struct simhash_ent {
+	uint64_t	 hash;
+	uint64_t	 msgid;
+	uint32_t	 seq;		/* 0 if empty */
+	uint32_t	 next[SIMHASH_NTABLES];	/* older one in the bucket */
+};
+
+struct simhash {
+	struct mapfile		 mf;
+	struct simhash_hdr	*hdr;
+	uint32_t		*heads;		/* newest of the buckets */
+	struct simhash_ent	*ents;
+	/* the message being read */
+	int32_t			 v[64];
+	uint32_t		 win[SIMHASH_SHINGLE];
+	u_int			 nchars;
+	u_int			 nfeatures;
+	bool			 space;		/* the last is a separator */
+	uint64_t		 msgid;
+	uint64_t		 texthash;	/* for the one without ID */
+	uint64_t		 hash;
+	bool			 valid;
+	bool			 seen;		/* recorded already */
+};
+
+static void	 simhash_init(void *, size_t, uint32_t);
+static int	 simhash_valid(const void *, size_t);
+static void	 simhash_attach(void *);
+static void	 simhash_char(struct simhash *, uint32_t);
+static uint32_t	*simhash_head(struct simhash *, uint64_t, int);
+static u_int	 simhash_same(uint64_t, uint64_t);
+static int	 popcount64(uint64_t);
+
+/* the pairs of the blocks */
+static const uint8_t simhash_pairs[SIMHASH_NTABLES][2] = {
+	{ 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 5 }, { 0, 6 }, { 0, 7 },
+	{ 1, 2 }, { 1, 3 }, { 1, 4 }, { 1, 5 }, { 1, 6 }, { 1, 7 }, { 2, 3 },
+	{ 2, 4 }, { 2, 5 }, { 2, 6 }, { 2, 7 }, { 3, 4 }, { 3, 5 }, { 3, 6 },
+	{ 3, 7 }, { 4, 5 }, { 4, 6 }, { 4, 7 }, { 5, 6 }, { 5, 7 }, { 6, 7 }
+};
+
+/* the ring is overwritten in place, never rebuilt */
+static const struct mapfile_ops simhash_ops = {
+	SIMHASH_MAGIC, SIMHASH_VERSION, 0, SIMHASH_NENTRIES, SIMHASH_SIZE,
+	simhash_init, simhash_valid, simhash_attach
+};
+
+struct simhash *
+simhash_open(const char *path)
+{
+	struct simhash	*self;
+
+	if ((self = calloc(1, sizeof(struct simhash))) == NULL)
+		return (NULL);
+	if (mapfile_open(&self->mf, path, &simhash_ops, self) == -1) {
+		free(self);
+		return (NULL);
+	}
+
+	return (self);
+}
+
+void
+simhash_close(struct simhash *self)
+{
+	if (self == NULL)
+		return;
+	mapfile_close(&self->mf);
+	free(self);
+}
+
+/* start reading a message */
+void
+simhash_begin(struct simhash *self)
+{
+	memset(self->v, 0, sizeof(self->v));
+	self->nchars = 0;
+	self->nfeatures = 0;
+	self->space = true;
+	self->msgid = 0;
+	self->texthash = FNV1A_INIT;
+	self->hash = 0;
+	self->valid = false;
+	self->seen = false;
+}
+
+/* the Message-ID not to take the message itself as similar */
+void
+simhash_header(struct simhash *self, const char *hdr, const char *value)
+{
+	uint64_t	 h = FNV1A_INIT;
+
+	if (self->msgid != 0 || strcmp(hdr, "message-id") != 0)
+		return;
+	for (; *value != '\0'; value++) {
+		if (!isspace((u_char)*value))
+			h = FNV1A(h, *value);
+	}
+	self->msgid = (h == 0)? 1 : h;
+}
+
+/*
+ * A line of the body text in UTF-8, normalized by the caller.  The digits
+ * are taken as same and the punctuations and the spaces as a separator.
+ */
+void
+simhash_text(struct simhash *self, const char *text, size_t len)
+{
+	const u_char	*s = (const u_char *)text;
+	uint32_t	 cp;
+	size_t		 i;
+	int		 n;
+
+	for (i = 0; i < len; i++)
+		self->texthash = FNV1A(self->texthash, s[i]);
+	self->texthash = FNV1A(self->texthash, '\n');
+
+	for (i = 0; i < len; i += n) {
+		if (s[i] < 0x80) {
+			n = 1;
+			if (isdigit(s[i]))
+				simhash_char(self, '0');
+			else if (isalpha(s[i]))
+				simhash_char(self, tolower(s[i]));
+			else
+				simhash_char(self, ' ');
+			continue;
+		}
+		if ((n = utf8_decode(s + i, len - i, &cp)) == -1) {
+			n = 1;
+			simhash_char(self, ' ');
+		} else if (0x3000 <= cp && cp <= 0x303f)
+			simhash_char(self, ' ');	/* CJK punctuations */
+		else
+			simhash_char(self, cp);
+	}
+	simhash_char(self, ' ');
+}
+
+/*
+ * Returns 0, or -1 if the text is too short to be hashed.  A message
+ * without Message-ID is identified by the hash of its text instead.
+ */
+int
+simhash_end(struct simhash *self)
+{
+	int	 i;
+
+	if (self->msgid == 0)
+		self->msgid = (self->texthash == 0)? 1 : self->texthash;
+
+	self->hash = 0;
+	for (i = 0; i < 64; i++) {
+		if (self->v[i] > 0)
+			self->hash |= 1ULL << i;
+	}
+	self->valid = (self->nfeatures >= SIMHASH_MINFEATURES);
+
+	return (self->valid? 0 : -1);
+}
+
+/*
+ * Returns the number of the messages recorded within the Hamming distance
+ * `maxdist' from the message read, and the nearest distance in `mindist'
+ * (-1 if no candidate).  The message itself, of the same Message-ID or of
+ * the same text, is not counted.  `maxdist' is up to SIMHASH_MAXDIST, the
+ * farther ones may not share the blocks.
+ */
+int
+simhash_lookup(struct simhash *self, int maxdist, int *mindist)
+{
+	struct simhash_ent	*ent;
+	uint32_t		 seq, mask = self->hdr->nentries - 1;
+	u_int			 same;
+	int			 t, i, first, dist, count = 0;
+
+	*mindist = -1;
+	if (!self->valid)
+		return (0);
+	if (maxdist > SIMHASH_MAXDIST)
+		maxdist = SIMHASH_MAXDIST;
+	for (t = 0; t < SIMHASH_NTABLES; t++) {
+		seq = *simhash_head(self, self->hash, t);
+		for (i = 0; seq != 0 && i < SIMHASH_MAXCHAIN; i++) {
+			ent = &self->ents[seq & mask];
+			if (ent->seq != seq)
+				break;		/* overwritten */
+			seq = (ent->next[t] < ent->seq)? ent->next[t] : 0;
+			/* the bucket may have other pairs of the blocks */
+			same = simhash_same(ent->hash, self->hash);
+			if ((same & (1 << simhash_pairs[t][0])) == 0 ||
+			    (same & (1 << simhash_pairs[t][1])) == 0)
+				continue;
+			/* found by the former table already */
+			for (first = 0; first < t; first++) {
+				if ((same & (1 << simhash_pairs[first][0])) &&
+				    (same & (1 << simhash_pairs[first][1])))
+					break;
+			}
+			if (first < t)
+				continue;
+			if (ent->msgid == self->msgid) {
+				self->seen = true;
+				continue;
+			}
+			dist = popcount64(ent->hash ^ self->hash);
+			if (*mindist == -1 || dist < *mindist)
+				*mindist = dist;
+			if (dist <= maxdist)
+				count++;
+		}
+	}
+
+	return (count);
+}
+
+/* record the message read, unless it's recorded by simhash_lookup() */
+int
+simhash_put(struct simhash *self)
+{
+	struct simhash_ent	*ent;
+	uint32_t		 seq;
+	int			 t;
+
+	if (!self->valid || self->seen)
+		return (0);
+	if (mapfile_lock(&self->mf) == -1)
+		return (-1);
+	if ((seq = self->hdr->seq + 1) == 0)
+		seq = 1;
+	ent = &self->ents[seq & (self->hdr->nentries - 1)];
+	/* invalidate first, the lookups don't lock */
+	ent->seq = 0;
+	ent->hash = self->hash;
+	ent->msgid = self->msgid;
+	for (t = 0; t < SIMHASH_NTABLES; t++)
+		ent->next[t] = *simhash_head(self, self->hash, t);
+	ent->seq = seq;
+	for (t = 0; t < SIMHASH_NTABLES; t++)
+		*simhash_head(self, self->hash, t) = seq;
+	self->hdr->seq = seq;
+	self->seen = true;
+	mapfile_unlock(&self->mf);
+
+	return (0);
+}
+
+void
+simhash_init(void *map, size_t mapsiz, uint32_t nentries)
+{
+	struct simhash_hdr	*hdr = map;
+
+	hdr->nentries = nentries;
+}
+
+int
+simhash_valid(const void *map, size_t mapsiz)
+{
+	const struct simhash_hdr	*hdr = map;
+
+	if (mapsiz != SIMHASH_SIZE || hdr->nentries != SIMHASH_NENTRIES)
+		return (-1);
+
+	return (0);
+}
+
+void
+simhash_attach(void *ctx)
+{
+	struct simhash	*self = ctx;
+
+	self->hdr = self->mf.map;
+	self->heads = (uint32_t *)(self->hdr + 1);
+	self->ents = (struct simhash_ent *)(self->heads + SIMHASH_NTABLES *
+	    SIMHASH_NBUCKETS);
+}
+
+/* a character of the text, the shingle ending with it is a feature */
+void
+simhash_char(struct simhash *self, uint32_t c)
+{
+	uint64_t	 h = FNV1A_INIT;
+	int		 i;
+
+	if (c == ' ') {
+		if (self->space)
+			return;
+		self->space = true;
+	} else
+		self->space = false;
+	memmove(self->win, self->win + 1, sizeof(self->win) -
+	    sizeof(self->win[0]));
+	self->win[SIMHASH_SHINGLE - 1] = c;
+	if (++self->nchars < SIMHASH_SHINGLE)
+		return;
+
+	for (i = 0; i < SIMHASH_SHINGLE; i++) {
+		h = FNV1A(h, self->win[i]);
+		h = FNV1A(h, self->win[i] >> 8);
+		h = FNV1A(h, self->win[i] >> 16);
+	}
+	/* the bits of FNV-1a are not mixed enough */
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	for (i = 0; i < 64; i++)
+		self->v[i] += ((h >> i) & 1)? 1 : -1;
+	self->nfeatures++;
+}
+
+/* the bucket of the table for the hash */
+uint32_t *
+simhash_head(struct simhash *self, uint64_t hash, int table)
+{
+	uint32_t	 key;
+
+	key = ((hash >> (simhash_pairs[table][0] * 8)) & 0xff) << 8 |
+	    ((hash >> (simhash_pairs[table][1] * 8)) & 0xff);
+	key = (key * 0x9e3779b1U) >> 16;
+
+	return (&self->heads[table * SIMHASH_NBUCKETS +
+	    (key & (SIMHASH_NBUCKETS - 1))]);
+}
+
+/* returns the bits of the blocks which are same */
+u_int
+simhash_same(uint64_t a, uint64_t b)
+{
+	uint64_t	 x = a ^ b;
+	u_int		 same = 0;
+	int		 i;
+
+	for (i = 0; i < SIMHASH_NBLOCKS; i++) {
+		if (((x >> (i * 8)) & 0xff) == 0)
+			same |= 1 << i;
+	}
+
+	return (same);
+}
+
+int
+popcount64(uint64_t x)
+{
+	int	 n;
+
+	for (n = 0; x != 0; n++)
+		x &= x - 1;
+
+	return (n);
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	SIMHASH_H
+#define	SIMHASH_H 1
+
+#include <stddef.h>
+
+#define	SIMHASH_MAXDIST		6	/* lookups find all within this */
+
+struct simhash;
+
+struct simhash	*simhash_open(const char *);
+void		 simhash_close(struct simhash *);
+void		 simhash_begin(struct simhash *);
+void		 simhash_header(struct simhash *, const char *, const char *);
+void		 simhash_text(struct simhash *, const char *, size_t);
+int		 simhash_end(struct simhash *);
+int		 simhash_lookup(struct simhash *, int, int *);
+int		 simhash_put(struct simhash *);
+
+#endif	/* !SIMHASH_H */
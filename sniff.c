@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Type of the attachment from its content.  The magic bytes are taken from
+ * the first SNIFF_HEADSIZ bytes and the most of the types need no more.
+ * The local file headers of zip are followed through the data to find the
+ * macros of Office and the executables in the archive, and PDF is
+ * searched for JavaScript.
+ */
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sniff.h"
+
+#define	MINIMUM(_a,_b)	(((_a) < (_b))? (_a) : (_b))
+#define	nitems(_x)	(sizeof(_x) / sizeof((_x)[0]))
+
+#define	ZIP_HDRSIZ		30	/* the local file header w/o the name */
+#define	ZIP_NAMETAIL		16	/* the end of a long name kept */
+
+static const char *sniff_names[] = {
+	NULL, "exe", "elf", "macho", "lnk", "ole", "zip", "zip-exe", "jar",
+	"ooxml", "vba", "rar", "7z", "gzip", "cab", "pdf", "pdf-js", "rtf",
+	"html", "script", "png", "jpeg", "gif"
+};
+
+/* executables and scripts run by a click on Windows */
+static const char *sniff_exts[] = {
+	".exe", ".scr", ".com", ".pif", ".cpl", ".bat", ".cmd", ".js", ".jse",
+	".vbs", ".vbe", ".wsf", ".hta", ".lnk", ".msi", ".ps1", ".jar"
+};
+
+static void	 sniff_magic(struct sniff *);
+static void	 sniff_more(struct sniff *, const u_char *, size_t);
+static void	 sniff_zip(struct sniff *, const u_char *, size_t);
+static void	 sniff_zipentry(struct sniff *, const char *, size_t);
+static void	 sniff_pdf(struct sniff *, const u_char *, size_t);
+static bool	 sniff_pdfjs(const u_char *, size_t);
+
+void
+sniff_begin(struct sniff *self)
+{
+	self->type = SNIFF_UNKNOWN;
+	self->done = false;
+	self->nhead = 0;
+	self->nzhdr = 0;
+	self->nzname = 0;
+	self->zskip = 0;
+	self->ntail = 0;
+}
+
+/* the decoded data of the part.  returns false if no more is needed */
+bool
+sniff_data(struct sniff *self, const u_char *data, size_t len)
+{
+	size_t	 n;
+
+	if (self->done)
+		return (false);
+	if (self->nhead < sizeof(self->head)) {
+		n = MINIMUM(len, sizeof(self->head) - self->nhead);
+		memcpy(self->head + self->nhead, data, n);
+		self->nhead += n;
+		if (self->nhead < sizeof(self->head))
+			return (true);
+		data += n;
+		len -= n;
+		sniff_magic(self);
+		sniff_more(self, self->head, self->nhead);
+	}
+	sniff_more(self, data, len);
+
+	return (!self->done);
+}
+
+/* the end of the part */
+enum sniff_type
+sniff_end(struct sniff *self)
+{
+	if (!self->done && self->nhead < sizeof(self->head)) {
+		sniff_magic(self);
+		sniff_more(self, self->head, self->nhead);
+	}
+	self->done = true;
+
+	return (self->type);
+}
+
+const char *
+sniff_name(enum sniff_type type)
+{
+	if (type <= SNIFF_UNKNOWN || type >= SNIFF_NTYPES)
+		return (NULL);
+	return (sniff_names[type]);
+}
+
+/* returns the type of the name, -1 if unknown */
+int
+sniff_lookup(const char *name)
+{
+	size_t	 i;
+
+	for (i = 1; i < nitems(sniff_names); i++) {
+		if (strcmp(sniff_names[i], name) == 0)
+			return (i);
+	}
+
+	return (-1);
+}
+
+void
+sniff_magic(struct sniff *self)
+{
+	const u_char	*h = self->head;
+	size_t		 n = self->nhead, i;
+
+#define	MAGIC(_s)	(n >= sizeof(_s) - 1 &&				\
+			    memcmp(h, (_s), sizeof(_s) - 1) == 0)
+
+	self->done = true;
+	if (MAGIC("MZ"))
+		self->type = SNIFF_EXE;
+	else if (MAGIC("\177ELF"))
+		self->type = SNIFF_ELF;
+	else if (MAGIC("\xfe\xed\xfa\xce") || MAGIC("\xfe\xed\xfa\xcf") ||
+	    MAGIC("\xce\xfa\xed\xfe") || MAGIC("\xcf\xfa\xed\xfe") ||
+	    MAGIC("\xca\xfe\xba\xbe"))
+		self->type = SNIFF_MACHO;
+	else if (MAGIC("L\0\0\0\1\24\2\0"))
+		self->type = SNIFF_LNK;
+	else if (MAGIC("\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1"))
+		self->type = SNIFF_OLE;
+	else if (MAGIC("PK\3\4")) {
+		self->type = SNIFF_ZIP;
+		self->done = false;
+	} else if (MAGIC("Rar!\x1a\a"))
+		self->type = SNIFF_RAR;
+	else if (MAGIC("7z\xbc\xaf\x27\x1c"))
+		self->type = SNIFF_7Z;
+	else if (MAGIC("\x1f\x8b"))
+		self->type = SNIFF_GZIP;
+	else if (MAGIC("MSCF"))
+		self->type = SNIFF_CAB;
+	else if (MAGIC("{\\rt"))
+		self->type = SNIFF_RTF;
+	else if (MAGIC("#!"))
+		self->type = SNIFF_SCRIPT;
+	else if (MAGIC("\x89PNG"))
+		self->type = SNIFF_PNG;
+	else if (MAGIC("\xff\xd8\xff"))
+		self->type = SNIFF_JPEG;
+	else if (MAGIC("GIF8"))
+		self->type = SNIFF_GIF;
+	if (self->type != SNIFF_UNKNOWN)
+		return;
+#undef	MAGIC
+
+	/* the readers take "%PDF-" anywhere in the first 1024 bytes */
+	for (i = 0; i + 5 <= n; i++) {
+		if (h[i] == '%' && memcmp(h + i, "%PDF-", 5) == 0) {
+			self->type = SNIFF_PDF;
+			self->done = false;
+			return;
+		}
+	}
+
+	/* BOM and spaces before the markup */
+	i = (n >= 3 && memcmp(h, "\xef\xbb\xbf", 3) == 0)? 3 : 0;
+	for (; i < n && isspace(h[i]); i++)
+		;
+	if ((n - i >= 14 && strncasecmp((char *)h + i, "<!doctype html",
+	    14) == 0) || (n - i >= 5 && strncasecmp((char *)h + i, "<html",
+	    5) == 0))
+		self->type = SNIFF_HTML;
+}
+
+/* the data after the magic */
+void
+sniff_more(struct sniff *self, const u_char *data, size_t len)
+{
+	if (self->done || len == 0)
+		return;
+	switch (self->type) {
+	case SNIFF_ZIP:
+	case SNIFF_JAR:
+	case SNIFF_OOXML:
+		sniff_zip(self, data, len);
+		break;
+	case SNIFF_PDF:
+		sniff_pdf(self, data, len);
+		break;
+	default:
+		self->done = true;
+		break;
+	}
+}
+
+/* follow the local file headers, a long entry name is taken w/o its middle */
+void
+sniff_zip(struct sniff *self, const u_char *data, size_t len)
+{
+	const u_char	*h = self->zhdr;
+	u_char		*tail;
+	size_t		 n, want, namelen = 0, extlen;
+	uint32_t	 compsize;
+	u_int		 flags;
+
+	while (len > 0 && !self->done) {
+		if (self->zskip > 0) {
+			n = MINIMUM(len, self->zskip);
+			self->zskip -= n;
+			data += n;
+			len -= n;
+			continue;
+		}
+		want = ZIP_HDRSIZ;
+		if (self->nzhdr >= ZIP_HDRSIZ) {
+			if (memcmp(h, "PK\3\4", 4) != 0) {
+				/* the central directory */
+				self->done = true;
+				break;
+			}
+			namelen = h[26] | h[27] << 8;
+			want += MINIMUM(namelen, sizeof(self->zhdr) -
+			    ZIP_HDRSIZ);
+		}
+		if (self->nzhdr < want) {
+			n = MINIMUM(len, want - self->nzhdr);
+			memcpy(self->zhdr + self->nzhdr, data, n);
+			self->nzhdr += n;
+			data += n;
+			len -= n;
+			continue;
+		}
+		if (self->nzname < namelen - (want - ZIP_HDRSIZ)) {
+			/* slide the last bytes for the extension */
+			n = MINIMUM(len, namelen - (want - ZIP_HDRSIZ) -
+			    self->nzname);
+			tail = self->zhdr + sizeof(self->zhdr) - ZIP_NAMETAIL;
+			if (n >= ZIP_NAMETAIL)
+				memcpy(tail, data + n - ZIP_NAMETAIL,
+				    ZIP_NAMETAIL);
+			else {
+				memmove(tail, tail + n, ZIP_NAMETAIL - n);
+				memcpy(tail + ZIP_NAMETAIL - n, data, n);
+			}
+			self->nzname += n;
+			data += n;
+			len -= n;
+			continue;
+		}
+		flags = h[6] | h[7] << 8;
+		compsize = h[18] | h[19] << 8 | h[20] << 16 |
+		    (uint32_t)h[21] << 24;
+		extlen = h[28] | h[29] << 8;
+		sniff_zipentry(self, (const char *)h + ZIP_HDRSIZ,
+		    want - ZIP_HDRSIZ);
+		/* the size is unknown if it follows the data or is zip64 */
+		if (((flags & 0x08) && compsize == 0) ||
+		    compsize == 0xffffffffU)
+			self->done = true;
+		self->zskip = (uint64_t)extlen + compsize;
+		self->nzhdr = 0;
+		self->nzname = 0;
+	}
+}
+
+void
+sniff_zipentry(struct sniff *self, const char *name, size_t namelen)
+{
+	size_t	 i, len;
+
+	len = strlen("vbaProject.bin");
+	if (namelen >= len && strncasecmp(name + namelen - len,
+	    "vbaProject.bin", len) == 0) {
+		self->type = SNIFF_VBA;
+		self->done = true;
+		return;
+	}
+	for (i = 0; i < nitems(sniff_exts); i++) {
+		len = strlen(sniff_exts[i]);
+		if (namelen > len && strncasecmp(name + namelen - len,
+		    sniff_exts[i], len) == 0) {
+			self->type = SNIFF_ZIPEXE;
+			self->done = true;
+			return;
+		}
+	}
+	if (self->type != SNIFF_ZIP)
+		return;
+	if ((namelen == 19 && memcmp(name, "[Content_Types].xml", 19) ==
+	    0) || (namelen > 5 && memcmp(name, "word/", 5) == 0) ||
+	    (namelen > 3 && memcmp(name, "xl/", 3) == 0) ||
+	    (namelen > 4 && memcmp(name, "ppt/", 4) == 0))
+		self->type = SNIFF_OOXML;
+	else if (namelen == 20 && memcmp(name, "META-INF/MANIFEST.MF", 20) ==
+	    0)
+		self->type = SNIFF_JAR;
+}
+
+/* search the PDF for JavaScript, also across the data given before */
+void
+sniff_pdf(struct sniff *self, const u_char *data, size_t len)
+{
+	u_char	 buf[sizeof(self->tail) * 2];
+	size_t	 n;
+
+	n = MINIMUM(len, sizeof(self->tail));
+	memcpy(buf, self->tail, self->ntail);
+	memcpy(buf + self->ntail, data, n);
+	if (sniff_pdfjs(buf, self->ntail + n) || sniff_pdfjs(data, len)) {
+		self->type = SNIFF_PDFJS;
+		self->done = true;
+		return;
+	}
+	if (len >= sizeof(self->tail)) {
+		memcpy(self->tail, data + len - sizeof(self->tail),
+		    sizeof(self->tail));
+		self->ntail = sizeof(self->tail);
+	} else {
+		/* buf has the tail and the data */
+		n = self->ntail + len;
+		len = MINIMUM(n, sizeof(self->tail));
+		memcpy(self->tail, buf + n - len, len);
+		self->ntail = len;
+	}
+}
+
+/* "/JavaScript" or "/JS" name */
+bool
+sniff_pdfjs(const u_char *buf, size_t len)
+{
+	const u_char	*p, *end = buf + len;
+
+	for (p = buf; (p = memchr(p, '/', end - p)) != NULL; p++) {
+		if (end - p < 3 || p[1] != 'J')
+			continue;
+		if (p[2] == 'S' && (end - p == 3 || !isalnum(p[3])))
+			return (true);
+		if (end - p >= 11 && memcmp(p, "/JavaScript", 11) == 0)
+			return (true);
+	}
+
+	return (false);
+}
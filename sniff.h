@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	SNIFF_H
+#define	SNIFF_H 1
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define	SNIFF_HEADSIZ		1024	/* bytes to take the magic from */
+
+enum sniff_type {
+	SNIFF_UNKNOWN = 0,
+	SNIFF_EXE,		/* MS-DOS or PE executable */
+	SNIFF_ELF,
+	SNIFF_MACHO,
+	SNIFF_LNK,		/* Windows shortcut */
+	SNIFF_OLE,		/* legacy Office, MSI */
+	SNIFF_ZIP,
+	SNIFF_ZIPEXE,		/* zip with an executable or a script */
+	SNIFF_JAR,
+	SNIFF_OOXML,
+	SNIFF_VBA,		/* OOXML with vbaProject.bin */
+	SNIFF_RAR,
+	SNIFF_7Z,
+	SNIFF_GZIP,
+	SNIFF_CAB,
+	SNIFF_PDF,
+	SNIFF_PDFJS,		/* PDF with JavaScript */
+	SNIFF_RTF,
+	SNIFF_HTML,
+	SNIFF_SCRIPT,		/* "#!" */
+	SNIFF_PNG,
+	SNIFF_JPEG,
+	SNIFF_GIF,
+	SNIFF_NTYPES
+};
+
+struct sniff {
+	enum sniff_type	 type;
+	bool		 done;		/* no more data is needed */
+	u_char		 head[SNIFF_HEADSIZ];
+	size_t		 nhead;
+	/* zip local file headers, a long name keeps its first and last bytes */
+	u_char		 zhdr[30 + 256];
+	size_t		 nzhdr;
+	size_t		 nzname;	/* bytes of the long name after zhdr */
+	uint64_t	 zskip;
+	/* the last bytes of the PDF for the tokens split */
+	u_char		 tail[16];
+	size_t		 ntail;
+};
+
+void		 sniff_begin(struct sniff *);
+bool		 sniff_data(struct sniff *, const u_char *, size_t);
+enum sniff_type	 sniff_end(struct sniff *);
+const char	*sniff_name(enum sniff_type);
+int		 sniff_lookup(const char *);
+
+#endif	/* !SNIFF_H */
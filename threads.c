@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Index of the conversation threads.  It maps the hash of a Message-ID to
+ * the thread ID, which is the hash of the Message-ID of the root message.
+ * The file is the header and an open addressing hash table mapped by
+ * mapfile.c, it's rebuilt into a new file when the table becomes full.
+ */
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapfile.h"
+#include "threads.h"
+
+#define	THREADS_MAGIC		"MFTHRDS1"
+#define	THREADS_VERSION		1
+#define	THREADS_INITSLOTS	4096
+#define	THREADS_MAXREFS		32	/* the root and the recent ones */
+#define	THREADS_SIZE(_n)	(sizeof(struct threads_hdr) +		\
+				    (size_t)(_n) * sizeof(struct threads_slot))
+
+struct threads_hdr {
+	char		 magic[8];
+	uint32_t	 version;
+	uint32_t	 nslots;	/* power of 2 */
+	uint32_t	 nused;
+	uint32_t	 obsolete;	/* replaced by a new file */
+};
+
+struct threads_slot {
+	uint64_t	 key;		/* hash of the Message-ID, 0 if empty */
+	uint64_t	 thread;
+};
+
+struct threads {
+	struct mapfile		 mf;
+	struct threads_hdr	*hdr;
+	struct threads_slot	*slots;
+	/* the message being read */
+	uint64_t		 msgid;
+	uint64_t		 inreplyto;
+	uint64_t		 refs[THREADS_MAXREFS];
+	int			 nrefs;
+};
+
+static void	 threads_init(void *, size_t, uint32_t);
+static int	 threads_valid(const void *, size_t);
+static void	 threads_attach(void *);
+static int	 threads_rebuild(struct threads *, uint32_t);
+static uint64_t	 threads_get(struct threads *, uint64_t);
+static int	 threads_put(struct threads *, uint64_t, uint64_t);
+static const char
+		*threads_msgid(const char *, uint64_t *);
+
+static const struct mapfile_ops threads_ops = {
+	THREADS_MAGIC, THREADS_VERSION, offsetof(struct threads_hdr, obsolete),
+	THREADS_INITSLOTS, THREADS_SIZE(THREADS_INITSLOTS),
+	threads_init, threads_valid, threads_attach
+};
+
+struct threads *
+threads_open(const char *path)
+{
+	struct threads	*self;
+
+	if ((self = calloc(1, sizeof(struct threads))) == NULL)
+		return (NULL);
+	if (mapfile_open(&self->mf, path, &threads_ops, self) == -1) {
+		free(self);
+		return (NULL);
+	}
+
+	return (self);
+}
+
+void
+threads_close(struct threads *self)
+{
+	if (self == NULL)
+		return;
+	mapfile_close(&self->mf);
+	free(self);
+}
+
+/* start reading the headers of a message */
+void
+threads_begin(struct threads *self)
+{
+	self->msgid = 0;
+	self->inreplyto = 0;
+	self->nrefs = 0;
+}
+
+void
+threads_header(struct threads *self, const char *hdr, const char *value)
+{
+	uint64_t	 id;
+
+	if (strcmp(hdr, "message-id") == 0) {
+		if (self->msgid == 0)
+			threads_msgid(value, &self->msgid);
+	} else if (strcmp(hdr, "in-reply-to") == 0) {
+		/* the first one is the parent */
+		if (self->inreplyto == 0)
+			threads_msgid(value, &self->inreplyto);
+	} else if (strcmp(hdr, "references") == 0) {
+		while ((value = threads_msgid(value, &id)) != NULL) {
+			if (self->nrefs >= THREADS_MAXREFS) {
+				memmove(self->refs + 1, self->refs + 2,
+				    (THREADS_MAXREFS - 2) * sizeof(uint64_t));
+				self->nrefs--;
+			}
+			self->refs[self->nrefs++] = id;
+		}
+	}
+}
+
+/*
+ * Add the message to the thread of the known parent or the references.  If
+ * none is known, the message starts a new thread.  The references are also
+ * added, so replies to the messages not seen yet are in the thread.
+ */
+int
+threads_end(struct threads *self)
+{
+	uint64_t	 thread = 0, root;
+	int		 i;
+
+	if (self->msgid == 0 && self->inreplyto == 0 && self->nrefs == 0)
+		return (0);
+	if (mapfile_lock(&self->mf) == -1)
+		return (-1);
+	if (self->inreplyto != 0)
+		thread = threads_get(self, self->inreplyto);
+	for (i = self->nrefs - 1; thread == 0 && i >= 0; i--)
+		thread = threads_get(self, self->refs[i]);
+	if (thread == 0 && self->msgid != 0)
+		thread = threads_get(self, self->msgid);
+	if (thread == 0) {
+		root = (self->nrefs > 0)? self->refs[0] :
+		    (self->inreplyto != 0)? self->inreplyto : self->msgid;
+		/* to be a positive integer of Lua */
+		if ((thread = root & INT64_MAX) == 0)
+			thread = 1;
+	}
+	if ((self->msgid != 0 && threads_put(self, self->msgid, thread) == -1)
+	    || (self->inreplyto != 0 &&
+	    threads_put(self, self->inreplyto, thread) == -1))
+		goto fail;
+	for (i = 0; i < self->nrefs; i++) {
+		if (threads_put(self, self->refs[i], thread) == -1)
+			goto fail;
+	}
+	mapfile_unlock(&self->mf);
+
+	return (0);
+ fail:
+	mapfile_unlock(&self->mf);
+	return (-1);
+}
+
+/*
+ * Returns the thread of the first known Message-ID in `value', 0 if none
+ * is known.
+ */
+uint64_t
+threads_lookup(struct threads *self, const char *value)
+{
+	uint64_t	 id, thread;
+
+	if (mapfile_refresh(&self->mf) == -1)
+		return (0);
+	while ((value = threads_msgid(value, &id)) != NULL) {
+		if ((thread = threads_get(self, id)) != 0)
+			return (thread);
+	}
+
+	return (0);
+}
+
+void
+threads_init(void *map, size_t mapsiz, uint32_t nslots)
+{
+	struct threads_hdr	*hdr = map;
+
+	hdr->nslots = nslots;
+}
+
+int
+threads_valid(const void *map, size_t mapsiz)
+{
+	const struct threads_hdr	*hdr = map;
+
+	if (mapsiz < sizeof(*hdr) || hdr->nslots == 0 ||
+	    (hdr->nslots & (hdr->nslots - 1)) != 0 ||
+	    mapsiz != THREADS_SIZE(hdr->nslots))
+		return (-1);
+
+	return (0);
+}
+
+void
+threads_attach(void *ctx)
+{
+	struct threads	*self = ctx;
+
+	self->hdr = self->mf.map;
+	self->slots = (struct threads_slot *)(self->hdr + 1);
+}
+
+/*
+ * Copy the entries into a new file which replaces the index.  Must be
+ * called with the lock, the lock is taken over by the new file.
+ */
+int
+threads_rebuild(struct threads *self, uint32_t nslots)
+{
+	struct threads	 new;
+	uint32_t	 i, j, mask;
+
+	if (nslots == 0 || nslots > UINT32_MAX / 2) {
+		errno = ENOSPC;
+		return (-1);
+	}
+	if (mapfile_create(&self->mf, &new.mf, THREADS_SIZE(nslots), nslots,
+	    &new) == -1)
+		return (-1);
+	mask = nslots - 1;
+	for (i = 0; i < self->hdr->nslots; i++) {
+		if (self->slots[i].key == 0)
+			continue;
+		for (j = self->slots[i].key & mask; new.slots[j].key != 0;
+		    j = (j + 1) & mask)
+			;
+		new.slots[j] = self->slots[i];
+		new.hdr->nused++;
+	}
+
+	return (mapfile_replace(&self->mf, &new.mf));
+}
+
+uint64_t
+threads_get(struct threads *self, uint64_t key)
+{
+	uint32_t	 i, mask = self->hdr->nslots - 1;
+
+	for (i = key & mask; self->slots[i].key != 0; i = (i + 1) & mask) {
+		if (self->slots[i].key == key)
+			return (self->slots[i].thread);
+	}
+
+	return (0);
+}
+
+/* the entry existing is kept, a message stays in the thread */
+int
+threads_put(struct threads *self, uint64_t key, uint64_t thread)
+{
+	uint32_t	 i, mask;
+
+	/* keep the load factor under 0.7 */
+	if ((uint64_t)(self->hdr->nused + 1) * 10 >
+	    (uint64_t)self->hdr->nslots * 7 &&
+	    threads_rebuild(self, self->hdr->nslots * 2) == -1)
+		return (-1);
+
+	mask = self->hdr->nslots - 1;
+	for (i = key & mask; self->slots[i].key != 0; i = (i + 1) & mask) {
+		if (self->slots[i].key == key)
+			return (0);
+	}
+	/* the thread first, the lookups don't lock */
+	self->slots[i].thread = thread;
+	self->slots[i].key = key;
+	self->hdr->nused++;
+
+	return (0);
+}
+
+/*
+ * Hash the first Message-ID in `str' and return the position after it, or
+ * NULL if there is no more.  The angle brackets and the spaces are
+ * removed, the domain part is case insensitive.  `str' without angle
+ * brackets is taken as a Message-ID.
+ */
+const char *
+threads_msgid(const char *str, uint64_t *idp)
+{
+	const char	*sp, *ep;
+	uint64_t	 h = 14695981039346656037ULL;	/* FNV-1a */
+	bool		 domain = false;
+	u_char		 c;
+
+	while (isspace((u_char)*str) || *str == ',')
+		str++;
+	if (*str == '\0')
+		return (NULL);
+	if (*str == '<') {
+		sp = str + 1;
+		if ((ep = strchr(sp, '>')) == NULL)
+			ep = sp + strlen(sp);
+	} else {
+		/* a Message-ID without the brackets, or a garbage */
+		sp = str;
+		for (ep = sp; *ep != '\0' && *ep != '<' &&
+		    !isspace((u_char)*ep); ep++)
+			;
+	}
+	for (str = sp; str < ep; str++) {
+		c = *str;
+		if (isspace(c))
+			continue;
+		if (c == '@')
+			domain = true;
+		else if (domain)
+			c = tolower(c);
+		h = (h ^ c) * 1099511628211ULL;
+	}
+	/* 0 is the empty slot, the hash is used as is for the table */
+	h ^= h >> 29;
+	*idp = (h == 0)? 1 : h;
+
+	return ((*ep == '>')? ep + 1 : ep);
+}
@@ -0,0 +1,1190 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Full text index by trigrams.  The text is case folded and split into the
+ * trigrams of the code points, a trigram is packed into 64 bits.  The
+ * index is a set of immutable segment files, each has the sorted trigrams
+ * and their posting lists, the sequence numbers of the messages delta
+ * encoded in the variable length integers.  The messages indexed are
+ * accumulated in memory and written as a new segment by tindex_flush(),
+ * the segments are merged into one when they are many.  The postings of
+ * a message removed are killed by a tombstone, the number and the id of
+ * the next segment, until the segments are merged.
+ */
+#include <sys/types.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tindex.h"
+#include "utf8.h"
+
+#define	MINIMUM(_a,_b)	(((_a) < (_b))? (_a) : (_b))
+#define	MAXIMUM(_a,_b)	(((_a) > (_b))? (_a) : (_b))
+
+#define	TINDEX_MAGIC		"MFTIDX01"
+#define	TINDEX_LOCKFILE		"lock"
+#define	TINDEX_LASTSEQ		"lastseq"
+#define	TINDEX_DEAD		"dead"
+#define	TINDEX_SEGPREFIX	"seg."
+#define	TINDEX_MAXSEGS		8	/* merged if more */
+#define	TINDEX_MAXPENDING	(4 * 1024 * 1024)	/* postings in memory */
+#define	TINDEX_MAXDOCTRIS	(1024 * 1024)	/* trigrams of a message */
+
+#define	TRIGRAM(_a, _b, _c)	\
+	(((uint64_t)(_a) << 42) | ((uint64_t)(_b) << 21) | (uint64_t)(_c))
+
+/*
+ * Segment file.  The posting lists follow the header, then the entries
+ * sorted by the trigram are at `entoff'.
+ */
+struct tseg_hdr {
+	char		 magic[8];
+	uint32_t	 ntris;
+	uint32_t	 reserved;
+	uint64_t	 entoff;
+};
+
+struct tseg_ent {
+	uint64_t	 tri;
+	uint64_t	 off;		/* of the posting list */
+	uint32_t	 len;		/* in bytes */
+	uint32_t	 n;		/* number of the sequence numbers */
+};
+
+struct tseg {
+	u_int			 id;
+	u_char			*map;
+	size_t			 mapsiz;
+	const struct tseg_ent	*ents;
+	uint32_t		 ntris;
+};
+
+struct tseg_writer {
+	FILE		*fp;
+	char		 path[PATH_MAX];
+	uint64_t	 off;
+	struct tseg_ent	*ents;
+	size_t		 nents;
+	size_t		 entsiz;
+};
+
+struct tposting {
+	uint64_t	 tri;
+	uint32_t	 seq;
+};
+
+/* the postings of `seq' in the segments before `segid' are dead */
+struct tdead {
+	uint32_t	 seq;
+	uint32_t	 segid;
+};
+
+struct tdeads {
+	struct tdead	*ents;		/* sorted by the number */
+	size_t		 n;
+};
+
+struct tgrams {
+	uint64_t	*tris;
+	size_t		 n;
+	size_t		 siz;
+	int		 error;
+	bool		 full;		/* TINDEX_MAXDOCTRIS reached */
+};
+
+struct tindex {
+	char		*dir;
+	int		 lockfd;
+	uint32_t	 lastseq;
+	uint32_t	 seq;		/* of the message being indexed */
+	struct tgrams	 doc;
+	struct tposting	*pending;	/* not written yet */
+	size_t		 npending;
+	size_t		 pendingsiz;
+};
+
+static int	 tindex_lock(struct tindex *);
+static void	 tindex_unlock(struct tindex *);
+static uint32_t	 tindex_load_lastseq(struct tindex *);
+static int	 tindex_store_lastseq(struct tindex *);
+static int	 tindex_segs(struct tindex *, struct tseg **, int *);
+static void	 tindex_segs_free(struct tseg *, int);
+static u_int	 tindex_seg_id(const char *);
+static int	 tindex_seg_open(struct tindex *, u_int, struct tseg *);
+static int	 tindex_merge(struct tindex *, struct tseg *, int);
+static int	 tindex_postings(struct tseg *, int, struct tdeads *,
+		    uint64_t, uint32_t **, size_t *);
+static int	 tindex_dead_load(struct tindex *, struct tdeads *);
+static size_t	 tindex_dead_filter(struct tdeads *, u_int, uint32_t *,
+		    size_t);
+static int	 tseg_writer_open(struct tindex *, struct tseg_writer *);
+static int	 tseg_writer_add(struct tseg_writer *, uint64_t,
+		    const uint32_t *, size_t);
+static int	 tseg_writer_close(struct tindex *, struct tseg_writer *,
+		    u_int);
+static void	 tseg_writer_abort(struct tseg_writer *);
+static const struct tseg_ent
+		*tseg_lookup(struct tseg *, uint64_t);
+static int	 tseg_decode(struct tseg *, const struct tseg_ent *,
+		    uint32_t *);
+static void	 tgrams_add(struct tgrams *, const char *, size_t);
+static void	 tgrams_uniq(struct tgrams *);
+static size_t	 uint32_uniq(uint32_t *, size_t);
+static int	 tposting_cmp(const void *, const void *);
+static int	 tdead_cmp(const void *, const void *);
+static int	 uint64_cmp(const void *, const void *);
+static int	 uint32_cmp(const void *, const void *);
+static int	 tseg_cmp(const void *, const void *);
+
+struct tindex *
+tindex_open(const char *dir)
+{
+	struct tindex	*self;
+	char		 path[PATH_MAX];
+
+	if ((self = calloc(1, sizeof(struct tindex))) == NULL)
+		return (NULL);
+	self->lockfd = -1;
+	if ((self->dir = strdup(dir)) == NULL)
+		goto fail;
+	if (mkdir(dir, 0700) == -1 && errno != EEXIST)
+		goto fail;
+	snprintf(path, sizeof(path), "%s/%s", dir, TINDEX_LOCKFILE);
+	if ((self->lockfd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600))
+	    == -1)
+		goto fail;
+
+	return (self);
+ fail:
+	tindex_close(self);
+	return (NULL);
+}
+
+void
+tindex_close(struct tindex *self)
+{
+	if (self == NULL)
+		return;
+	if (self->lockfd >= 0)
+		close(self->lockfd);
+	free(self->dir);
+	free(self->doc.tris);
+	free(self->pending);
+	free(self);
+}
+
+/*
+ * The last sequence number indexed by this or other processes.  The
+ * messages after it are not indexed yet.
+ */
+uint32_t
+tindex_lastseq(struct tindex *self)
+{
+	uint32_t	 lastseq;
+
+	if (tindex_lock(self) == 0) {
+		lastseq = tindex_load_lastseq(self);
+		tindex_unlock(self);
+		self->lastseq = MAXIMUM(self->lastseq, lastseq);
+	}
+
+	return (self->lastseq);
+}
+
+/* start indexing the message `seq' */
+void
+tindex_begin(struct tindex *self, uint32_t seq)
+{
+	self->seq = seq;
+	self->doc.n = 0;
+	self->doc.error = 0;
+	self->doc.full = false;
+}
+
+/*
+ * Add a text of the message, a header value or a line of the body.  The
+ * trigrams don't cross the texts.
+ */
+void
+tindex_text(struct tindex *self, const char *text, size_t len)
+{
+	tgrams_add(&self->doc, text, len);
+}
+
+/* finish the message, its trigrams are added to the pending postings */
+int
+tindex_end(struct tindex *self)
+{
+	struct tposting	*pending;
+	size_t		 i, newsiz;
+
+	if (self->doc.error != 0) {
+		errno = self->doc.error;
+		return (-1);
+	}
+	tgrams_uniq(&self->doc);
+	if (self->npending + self->doc.n > self->pendingsiz) {
+		newsiz = MAXIMUM(self->pendingsiz, 65536);
+		while (self->npending + self->doc.n > newsiz)
+			newsiz *= 2;
+		if ((pending = reallocarray(self->pending, newsiz,
+		    sizeof(struct tposting))) == NULL)
+			return (-1);
+		self->pending = pending;
+		self->pendingsiz = newsiz;
+	}
+	for (i = 0; i < self->doc.n; i++) {
+		self->pending[self->npending].tri = self->doc.tris[i];
+		self->pending[self->npending++].seq = self->seq;
+	}
+	self->doc.n = 0;
+	self->lastseq = MAXIMUM(self->lastseq, self->seq);
+	if (self->npending >= TINDEX_MAXPENDING)
+		return (tindex_flush(self));
+
+	return (0);
+}
+
+/*
+ * Kill the postings of the message `seq' removed.  Must be called before
+ * the number is indexed again for a new message.
+ */
+int
+tindex_remove(struct tindex *self, uint32_t seq)
+{
+	DIR		*dir;
+	struct dirent	*ent;
+	struct tdead	 dead;
+	char		 path[PATH_MAX];
+	size_t		 i, n;
+	u_int		 id, maxid = 0;
+	int		 fd, saved_errno;
+
+	for (i = n = 0; i < self->npending; i++) {
+		if (self->pending[i].seq != seq)
+			self->pending[n++] = self->pending[i];
+	}
+	self->npending = n;
+
+	if (tindex_lock(self) == -1)
+		return (-1);
+	if ((dir = opendir(self->dir)) == NULL)
+		goto fail;
+	while ((ent = readdir(dir)) != NULL) {
+		if ((id = tindex_seg_id(ent->d_name)) > maxid)
+			maxid = id;
+	}
+	closedir(dir);
+	if (maxid == 0) {
+		/* nothing indexed */
+		tindex_unlock(self);
+		return (0);
+	}
+	dead.seq = seq;
+	dead.segid = maxid + 1;
+	snprintf(path, sizeof(path), "%s/%s", self->dir, TINDEX_DEAD);
+	if ((fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+	    0600)) == -1)
+		goto fail;
+	if (write(fd, &dead, sizeof(dead)) != sizeof(dead)) {
+		saved_errno = errno;
+		close(fd);
+		errno = saved_errno;
+		goto fail;
+	}
+	close(fd);
+	tindex_unlock(self);
+
+	return (0);
+ fail:
+	saved_errno = errno;
+	tindex_unlock(self);
+	errno = saved_errno;
+	return (-1);
+}
+
+/*
+ * Write the pending postings as a new segment.  The segments are merged
+ * into one when there are more than TINDEX_MAXSEGS.
+ */
+int
+tindex_flush(struct tindex *self)
+{
+	struct tseg_writer	 w;
+	struct tseg		*segs;
+	int			 nsegs, ret = 0;
+	size_t			 i, j, n;
+	uint32_t		*seqs = NULL;
+	u_int			 id;
+
+	if (tindex_lock(self) == -1)
+		return (-1);
+	if (tindex_segs(self, &segs, &nsegs) == -1) {
+		tindex_unlock(self);
+		return (-1);
+	}
+	if (self->npending > 0) {
+		qsort(self->pending, self->npending, sizeof(struct tposting),
+		    tposting_cmp);
+		id = (nsegs > 0)? segs[nsegs - 1].id + 1 : 1;
+		if ((seqs = calloc(self->npending, sizeof(uint32_t))) == NULL ||
+		    tseg_writer_open(self, &w) == -1)
+			goto fail;
+		for (i = 0; i < self->npending; i = j) {
+			for (j = i, n = 0; j < self->npending &&
+			    self->pending[j].tri == self->pending[i].tri; j++)
+				seqs[n++] = self->pending[j].seq;
+			n = uint32_uniq(seqs, n);
+			if (tseg_writer_add(&w, self->pending[i].tri, seqs, n)
+			    == -1) {
+				tseg_writer_abort(&w);
+				goto fail;
+			}
+		}
+		if (tseg_writer_close(self, &w, id) == -1)
+			goto fail;
+		free(seqs);
+		seqs = NULL;
+		self->npending = 0;
+		tindex_segs_free(segs, nsegs);
+		if (tindex_segs(self, &segs, &nsegs) == -1) {
+			tindex_unlock(self);
+			return (-1);
+		}
+	}
+	self->lastseq = MAXIMUM(self->lastseq, tindex_load_lastseq(self));
+	if ((ret = tindex_store_lastseq(self)) == 0 && nsegs > TINDEX_MAXSEGS)
+		ret = tindex_merge(self, segs, nsegs);
+	tindex_segs_free(segs, nsegs);
+	tindex_unlock(self);
+
+	return (ret);
+ fail:
+	free(seqs);
+	tindex_segs_free(segs, nsegs);
+	tindex_unlock(self);
+	return (-1);
+}
+
+/*
+ * Search the messages which have all the trigrams of `query'.  They are
+ * the candidates, the text may not be contiguous in the message.  The
+ * result is sorted and must be freed by the caller.
+ */
+int
+tindex_search(struct tindex *self, const char *query, uint32_t **seqsp,
+    size_t *np)
+{
+	struct tgrams	  q;
+	struct tseg	 *segs;
+	struct tdeads	  deads;
+	int		  nsegs, ret;
+	size_t		  qlen, i, j, k, *ns = NULL, n = 0;
+	uint32_t	**lists = NULL, *tmp;
+
+	/* the leading and trailing spaces are not significant */
+	qlen = strlen(query);
+	while (qlen > 0 && isspace((u_char)query[qlen - 1]))
+		qlen--;
+	memset(&q, 0, sizeof(q));
+	tgrams_add(&q, query, qlen);
+	if (q.error != 0) {
+		free(q.tris);
+		errno = q.error;
+		return (-1);
+	}
+	tgrams_uniq(&q);
+	if (q.n == 0) {
+		free(q.tris);
+		errno = EINVAL;
+		return (-1);
+	}
+
+	if (tindex_lock(self) == -1) {
+		free(q.tris);
+		return (-1);
+	}
+	/* the files mapped are valid even if they are removed by merging */
+	if ((ret = tindex_dead_load(self, &deads)) == 0 &&
+	    (ret = tindex_segs(self, &segs, &nsegs)) == -1)
+		free(deads.ents);
+	tindex_unlock(self);
+	if (ret == -1) {
+		free(q.tris);
+		return (-1);
+	}
+
+	if ((lists = calloc(q.n, sizeof(uint32_t *))) == NULL ||
+	    (ns = calloc(q.n, sizeof(size_t))) == NULL)
+		goto fail;
+	for (i = 0; i < q.n; i++) {
+		if (tindex_postings(segs, nsegs, &deads, q.tris[i], &lists[i],
+		    &ns[i]) == -1)
+			goto fail;
+		if (ns[i] == 0)
+			break;
+	}
+	if (i < q.n) {
+		/* a trigram is missing */
+		n = 0;
+		goto out;
+	}
+
+	/* intersect from the shortest */
+	for (i = 1; i < q.n; i++) {
+		if (ns[i] < ns[0]) {
+			tmp = lists[0];
+			lists[0] = lists[i];
+			lists[i] = tmp;
+			n = ns[0];
+			ns[0] = ns[i];
+			ns[i] = n;
+		}
+	}
+	n = ns[0];
+	for (i = 1; i < q.n && n > 0; i++) {
+		for (j = k = 0, n = 0; j < ns[0] && k < ns[i]; ) {
+			if (lists[0][j] < lists[i][k])
+				j++;
+			else if (lists[0][j] > lists[i][k])
+				k++;
+			else {
+				lists[0][n++] = lists[0][j++];
+				k++;
+			}
+		}
+		ns[0] = n;
+	}
+ out:
+	*seqsp = lists[0];
+	*np = n;
+	lists[0] = NULL;
+	for (i = 0; i < q.n; i++)
+		free(lists[i]);
+	free(lists);
+	free(ns);
+	free(q.tris);
+	free(deads.ents);
+	tindex_segs_free(segs, nsegs);
+
+	return (0);
+ fail:
+	if (lists != NULL) {
+		for (i = 0; i < q.n; i++)
+			free(lists[i]);
+	}
+	free(lists);
+	free(ns);
+	free(q.tris);
+	free(deads.ents);
+	tindex_segs_free(segs, nsegs);
+	return (-1);
+}
+
+int
+tindex_lock(struct tindex *self)
+{
+	while (flock(self->lockfd, LOCK_EX) == -1) {
+		if (errno != EINTR)
+			return (-1);
+	}
+
+	return (0);
+}
+
+void
+tindex_unlock(struct tindex *self)
+{
+	flock(self->lockfd, LOCK_UN);
+}
+
+/* returns 0 if not stored yet */
+uint32_t
+tindex_load_lastseq(struct tindex *self)
+{
+	FILE		*fp;
+	char		 path[PATH_MAX];
+	unsigned long	 lastseq = 0;
+
+	snprintf(path, sizeof(path), "%s/%s", self->dir, TINDEX_LASTSEQ);
+	if ((fp = fopen(path, "r")) == NULL)
+		return (0);
+	if (fscanf(fp, "%lu", &lastseq) != 1 || lastseq > UINT32_MAX)
+		lastseq = 0;
+	fclose(fp);
+
+	return (lastseq);
+}
+
+int
+tindex_store_lastseq(struct tindex *self)
+{
+	FILE		*fp;
+	char		 path[PATH_MAX], tmppath[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s", self->dir, TINDEX_LASTSEQ);
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+	if ((fp = fopen(tmppath, "w")) == NULL)
+		return (-1);
+	fprintf(fp, "%u\n", self->lastseq);
+	if (fflush(fp) == EOF || fsync(fileno(fp)) == -1) {
+		fclose(fp);
+		unlink(tmppath);
+		return (-1);
+	}
+	fclose(fp);
+
+	return (rename(tmppath, path));
+}
+
+/* open the segments sorted by the id, must be locked */
+int
+tindex_segs(struct tindex *self, struct tseg **segsp, int *nsegsp)
+{
+	DIR		*dir;
+	struct dirent	*ent;
+	struct tseg	*segs = NULL;
+	int		 n = 0, siz = 0, i, saved_errno;
+	u_int		*ids = NULL, *nids, id;
+
+	if ((dir = opendir(self->dir)) == NULL)
+		return (-1);
+	while ((ent = readdir(dir)) != NULL) {
+		if ((id = tindex_seg_id(ent->d_name)) == 0)
+			continue;
+		if (n >= siz) {
+			if ((nids = reallocarray(ids, siz + 16,
+			    sizeof(u_int))) == NULL)
+				goto fail;
+			ids = nids;
+			siz += 16;
+		}
+		ids[n++] = id;
+	}
+	closedir(dir);
+	dir = NULL;
+
+	if ((segs = calloc(MAXIMUM(n, 1), sizeof(struct tseg))) == NULL)
+		goto fail;
+	for (i = 0; i < n; i++) {
+		if (tindex_seg_open(self, ids[i], &segs[i]) == -1) {
+			saved_errno = errno;
+			tindex_segs_free(segs, i);
+			segs = NULL;
+			errno = saved_errno;
+			goto fail;
+		}
+	}
+	qsort(segs, n, sizeof(struct tseg), tseg_cmp);
+	free(ids);
+	*segsp = segs;
+	*nsegsp = n;
+
+	return (0);
+ fail:
+	saved_errno = errno;
+	if (dir != NULL)
+		closedir(dir);
+	free(ids);
+	free(segs);
+	errno = saved_errno;
+	return (-1);
+}
+
+void
+tindex_segs_free(struct tseg *segs, int nsegs)
+{
+	int	 i;
+
+	for (i = 0; i < nsegs; i++)
+		munmap(segs[i].map, segs[i].mapsiz);
+	free(segs);
+}
+
+/* returns the id of the segment file, 0 if it's not */
+u_int
+tindex_seg_id(const char *name)
+{
+	char		*ep;
+	unsigned long	 ul;
+
+	if (strncmp(name, TINDEX_SEGPREFIX, sizeof(TINDEX_SEGPREFIX) - 1)
+	    != 0)
+		return (0);
+	errno = 0;
+	ul = strtoul(name + sizeof(TINDEX_SEGPREFIX) - 1, &ep, 10);
+	if (*ep != '\0' || ul > UINT_MAX || errno != 0)
+		return (0);
+
+	return (ul);
+}
+
+int
+tindex_seg_open(struct tindex *self, u_int id, struct tseg *seg)
+{
+	struct tseg_hdr	*hdr;
+	struct stat	 st;
+	char		 path[PATH_MAX];
+	int		 fd, saved_errno;
+
+	snprintf(path, sizeof(path), "%s/%s%u", self->dir, TINDEX_SEGPREFIX,
+	    id);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return (-1);
+	if (fstat(fd, &st) == -1)
+		goto fail;
+	if ((size_t)st.st_size < sizeof(struct tseg_hdr)) {
+		errno = EINVAL;
+		goto fail;
+	}
+	seg->id = id;
+	seg->mapsiz = st.st_size;
+	if ((seg->map = mmap(NULL, seg->mapsiz, PROT_READ, MAP_SHARED, fd, 0))
+	    == MAP_FAILED)
+		goto fail;
+	close(fd);
+	hdr = (struct tseg_hdr *)seg->map;
+	if (memcmp(hdr->magic, TINDEX_MAGIC, sizeof(hdr->magic)) != 0 ||
+	    hdr->entoff < sizeof(struct tseg_hdr) ||
+	    hdr->entoff > seg->mapsiz || hdr->entoff % sizeof(uint64_t) != 0 ||
+	    (seg->mapsiz - hdr->entoff) / sizeof(struct tseg_ent) <
+	    hdr->ntris) {
+		munmap(seg->map, seg->mapsiz);
+		errno = EINVAL;
+		return (-1);
+	}
+	seg->ents = (const struct tseg_ent *)(seg->map + hdr->entoff);
+	seg->ntris = hdr->ntris;
+
+	return (0);
+ fail:
+	saved_errno = errno;
+	close(fd);
+	errno = saved_errno;
+	return (-1);
+}
+
+/*
+ * Merge all the segments into a new one, must be locked.  The dead
+ * postings are dropped, so are the tombstones.
+ */
+int
+tindex_merge(struct tindex *self, struct tseg *segs, int nsegs)
+{
+	struct tseg_writer	 w;
+	const struct tseg_ent	*ent;
+	struct tdeads		 deads;
+	size_t			*pos = NULL, n, siz = 0;
+	uint32_t		*seqs = NULL, *nseqs;
+	uint64_t		 tri;
+	char			 path[PATH_MAX];
+	int			 i, saved_errno;
+
+	if (tindex_dead_load(self, &deads) == -1)
+		return (-1);
+	if ((pos = calloc(nsegs, sizeof(size_t))) == NULL ||
+	    tseg_writer_open(self, &w) == -1) {
+		free(pos);
+		free(deads.ents);
+		return (-1);
+	}
+	for (;;) {
+		/* the smallest trigram of the heads */
+		tri = UINT64_MAX;
+		for (i = 0; i < nsegs; i++) {
+			if (pos[i] < segs[i].ntris)
+				tri = MINIMUM(tri, segs[i].ents[pos[i]].tri);
+		}
+		if (tri == UINT64_MAX)
+			break;
+		for (i = 0, n = 0; i < nsegs; i++) {
+			if (pos[i] >= segs[i].ntris ||
+			    segs[i].ents[pos[i]].tri != tri)
+				continue;
+			ent = &segs[i].ents[pos[i]++];
+			if (n + ent->n > siz) {
+				if ((nseqs = reallocarray(seqs, n + ent->n,
+				    sizeof(uint32_t))) == NULL)
+					goto fail;
+				seqs = nseqs;
+				siz = n + ent->n;
+			}
+			if (tseg_decode(&segs[i], ent, seqs + n) == -1)
+				goto fail;
+			n += tindex_dead_filter(&deads, segs[i].id, seqs + n,
+			    ent->n);
+		}
+		qsort(seqs, n, sizeof(uint32_t), uint32_cmp);
+		n = uint32_uniq(seqs, n);
+		if (tseg_writer_add(&w, tri, seqs, n) == -1)
+			goto fail;
+	}
+	if (tseg_writer_close(self, &w, segs[nsegs - 1].id + 1) == -1) {
+		saved_errno = errno;
+		free(pos);
+		free(seqs);
+		free(deads.ents);
+		errno = saved_errno;
+		return (-1);
+	}
+	/* duplicated postings are harmless even if this is interrupted */
+	for (i = 0; i < nsegs; i++) {
+		snprintf(path, sizeof(path), "%s/%s%u", self->dir,
+		    TINDEX_SEGPREFIX, segs[i].id);
+		unlink(path);
+	}
+	/* the tombstones are before the new segment */
+	snprintf(path, sizeof(path), "%s/%s", self->dir, TINDEX_DEAD);
+	unlink(path);
+	free(pos);
+	free(seqs);
+	free(deads.ents);
+
+	return (0);
+ fail:
+	saved_errno = errno;
+	tseg_writer_abort(&w);
+	free(pos);
+	free(seqs);
+	free(deads.ents);
+	errno = saved_errno;
+	return (-1);
+}
+
+/* the sorted sequence numbers which have the trigram in any segment */
+int
+tindex_postings(struct tseg *segs, int nsegs, struct tdeads *deads,
+    uint64_t tri, uint32_t **seqsp, size_t *np)
+{
+	const struct tseg_ent	*ents[nsegs > 0 ? nsegs : 1];
+	uint32_t		*seqs;
+	size_t			 n = 0;
+	int			 i;
+
+	for (i = 0; i < nsegs; i++) {
+		if ((ents[i] = tseg_lookup(&segs[i], tri)) != NULL)
+			n += ents[i]->n;
+	}
+	if ((seqs = calloc(MAXIMUM(n, 1), sizeof(uint32_t))) == NULL)
+		return (-1);
+	for (i = 0, n = 0; i < nsegs; i++) {
+		if (ents[i] == NULL)
+			continue;
+		if (tseg_decode(&segs[i], ents[i], seqs + n) == -1) {
+			free(seqs);
+			return (-1);
+		}
+		n += tindex_dead_filter(deads, segs[i].id, seqs + n,
+		    ents[i]->n);
+	}
+	if (nsegs > 1)
+		qsort(seqs, n, sizeof(uint32_t), uint32_cmp);
+	*seqsp = seqs;
+	*np = uint32_uniq(seqs, n);
+
+	return (0);
+}
+
+/*
+ * Load the tombstones, must be locked.  The latest one is taken for the
+ * same number.
+ */
+int
+tindex_dead_load(struct tindex *self, struct tdeads *deads)
+{
+	struct stat	 st;
+	char		 path[PATH_MAX];
+	size_t		 i, n;
+	ssize_t		 sz;
+	int		 fd, saved_errno;
+
+	memset(deads, 0, sizeof(*deads));
+	snprintf(path, sizeof(path), "%s/%s", self->dir, TINDEX_DEAD);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return ((errno == ENOENT)? 0 : -1);
+	if (fstat(fd, &st) == -1)
+		goto fail;
+	/* a record partially written is ignored */
+	if ((n = st.st_size / sizeof(struct tdead)) == 0) {
+		close(fd);
+		return (0);
+	}
+	if ((deads->ents = calloc(n, sizeof(struct tdead))) == NULL)
+		goto fail;
+	if ((sz = pread(fd, deads->ents, n * sizeof(struct tdead), 0)) !=
+	    (ssize_t)(n * sizeof(struct tdead))) {
+		if (sz >= 0)
+			errno = EIO;
+		goto fail;
+	}
+	close(fd);
+	qsort(deads->ents, n, sizeof(struct tdead), tdead_cmp);
+	for (i = 1, deads->n = 1; i < n; i++) {
+		if (deads->ents[i].seq == deads->ents[deads->n - 1].seq)
+			deads->ents[deads->n - 1].segid = MAXIMUM(
+			    deads->ents[deads->n - 1].segid,
+			    deads->ents[i].segid);
+		else
+			deads->ents[deads->n++] = deads->ents[i];
+	}
+
+	return (0);
+ fail:
+	saved_errno = errno;
+	close(fd);
+	free(deads->ents);
+	deads->ents = NULL;
+	errno = saved_errno;
+	return (-1);
+}
+
+/* drop the dead ones from the numbers of the segment `id' */
+size_t
+tindex_dead_filter(struct tdeads *deads, u_int id, uint32_t *seqs, size_t n)
+{
+	struct tdead	 key, *dead;
+	size_t		 i, m;
+
+	if (deads->n == 0)
+		return (n);
+	for (i = m = 0; i < n; i++) {
+		key.seq = seqs[i];
+		dead = bsearch(&key, deads->ents, deads->n,
+		    sizeof(struct tdead), tdead_cmp);
+		if (dead == NULL || id >= dead->segid)
+			seqs[m++] = seqs[i];
+	}
+
+	return (m);
+}
+
+/* the new segment is written into a temporary file, then renamed */
+int
+tseg_writer_open(struct tindex *self, struct tseg_writer *w)
+{
+	struct tseg_hdr	 hdr;
+	int		 fd;
+
+	memset(w, 0, sizeof(*w));
+	snprintf(w->path, sizeof(w->path), "%s/tmp.XXXXXX", self->dir);
+	if ((fd = mkstemp(w->path)) == -1)
+		return (-1);
+	if ((w->fp = fdopen(fd, "w")) == NULL) {
+		close(fd);
+		unlink(w->path);
+		return (-1);
+	}
+	memset(&hdr, 0, sizeof(hdr));
+	if (fwrite(&hdr, sizeof(hdr), 1, w->fp) != 1) {
+		tseg_writer_abort(w);
+		return (-1);
+	}
+	w->off = sizeof(hdr);
+
+	return (0);
+}
+
+/* add the posting list of the trigram, must be called in the order */
+int
+tseg_writer_add(struct tseg_writer *w, uint64_t tri, const uint32_t *seqs,
+    size_t n)
+{
+	struct tseg_ent	*ents;
+	u_char		 buf[5];
+	uint32_t	 prev = 0, delta;
+	size_t		 i, len;
+	int		 blen;
+
+	if (n == 0)
+		return (0);
+	if (w->nents >= w->entsiz) {
+		if ((ents = reallocarray(w->ents, MAXIMUM(w->entsiz * 2, 4096),
+		    sizeof(struct tseg_ent))) == NULL)
+			return (-1);
+		w->ents = ents;
+		w->entsiz = MAXIMUM(w->entsiz * 2, 4096);
+	}
+	/* delta in the variable length integers, 7 bits per byte */
+	for (i = 0, len = 0; i < n; i++) {
+		delta = seqs[i] - prev;
+		prev = seqs[i];
+		for (blen = 0; delta >= 0x80; delta >>= 7)
+			buf[blen++] = (delta & 0x7f) | 0x80;
+		buf[blen++] = delta;
+		if (fwrite(buf, blen, 1, w->fp) != 1)
+			return (-1);
+		len += blen;
+	}
+	if (len > UINT32_MAX || n > UINT32_MAX) {
+		errno = EFBIG;
+		return (-1);
+	}
+	w->ents[w->nents].tri = tri;
+	w->ents[w->nents].off = w->off;
+	w->ents[w->nents].len = len;
+	w->ents[w->nents++].n = n;
+	w->off += len;
+
+	return (0);
+}
+
+/* write the entries and the header, then rename the file to the segment */
+int
+tseg_writer_close(struct tindex *self, struct tseg_writer *w, u_int id)
+{
+	struct tseg_hdr	 hdr;
+	char		 path[PATH_MAX];
+	static const u_char
+			 pad[sizeof(uint64_t)];
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, TINDEX_MAGIC, sizeof(hdr.magic));
+	hdr.ntris = w->nents;
+	hdr.entoff = (w->off + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+	if ((hdr.entoff > w->off &&
+	    fwrite(pad, hdr.entoff - w->off, 1, w->fp) != 1) ||
+	    (w->nents > 0 &&
+	    fwrite(w->ents, sizeof(struct tseg_ent), w->nents, w->fp) !=
+	    w->nents) ||
+	    fseeko(w->fp, 0, SEEK_SET) == -1 ||
+	    fwrite(&hdr, sizeof(hdr), 1, w->fp) != 1 ||
+	    fflush(w->fp) == EOF || fsync(fileno(w->fp)) == -1) {
+		tseg_writer_abort(w);
+		return (-1);
+	}
+	fclose(w->fp);
+	w->fp = NULL;
+	free(w->ents);
+	w->ents = NULL;
+	snprintf(path, sizeof(path), "%s/%s%u", self->dir, TINDEX_SEGPREFIX,
+	    id);
+	if (rename(w->path, path) == -1) {
+		unlink(w->path);
+		return (-1);
+	}
+
+	return (0);
+}
+
+void
+tseg_writer_abort(struct tseg_writer *w)
+{
+	int	 saved_errno = errno;
+
+	if (w->fp != NULL)
+		fclose(w->fp);
+	w->fp = NULL;
+	unlink(w->path);
+	free(w->ents);
+	w->ents = NULL;
+	errno = saved_errno;
+}
+
+const struct tseg_ent *
+tseg_lookup(struct tseg *seg, uint64_t tri)
+{
+	size_t	 lo = 0, hi = seg->ntris, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (seg->ents[mid].tri < tri)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < seg->ntris && seg->ents[lo].tri == tri)
+		return (&seg->ents[lo]);
+
+	return (NULL);
+}
+
+/* decode the posting list into `seqs' which has room for `ent->n' */
+int
+tseg_decode(struct tseg *seg, const struct tseg_ent *ent, uint32_t *seqs)
+{
+	const u_char	*p, *end;
+	uint32_t	 seq = 0, delta;
+	size_t		 i;
+	int		 shift;
+
+	if (ent->off > seg->mapsiz || ent->len > seg->mapsiz - ent->off) {
+		errno = EINVAL;
+		return (-1);
+	}
+	p = seg->map + ent->off;
+	end = p + ent->len;
+	for (i = 0; i < ent->n; i++) {
+		for (delta = 0, shift = 0; p < end && shift < 35; shift += 7) {
+			delta |= (uint32_t)(*p & 0x7f) << shift;
+			if ((*p++ & 0x80) == 0)
+				break;
+		}
+		if (shift >= 35 || (p == end && i + 1 < ent->n)) {
+			errno = EINVAL;
+			return (-1);
+		}
+		seq += delta;
+		seqs[i] = seq;
+	}
+
+	return (0);
+}
+
+/*
+ * Append the trigrams of the text.  The code points are case folded and a
+ * run of the spaces is a space.
+ */
+void
+tgrams_add(struct tgrams *self, const char *text, size_t len)
+{
+	const u_char	*p = (const u_char *)text, *end = p + len;
+	uint32_t	 cp, cp0 = 0, cp1 = 0;
+	uint64_t	*tris;
+	size_t		 ncp = 0, newsiz;
+	int		 n;
+
+	if (self->error != 0 || self->full)
+		return;
+	while (p < end) {
+		if ((n = utf8_decode(p, end - p, &cp)) <= 0) {
+			/* take the broken byte as is */
+			cp = *p;
+			n = 1;
+		}
+		p += n;
+		if (cp == ' ' || cp == '\t' || cp == '\r' || cp == '\n' ||
+		    cp == '\f' || cp == '\v') {
+			if (ncp == 0 || cp1 == ' ')
+				continue;
+			cp = ' ';
+		} else if (cp == '\0')
+			continue;
+		else
+			cp = utf8_casefold(cp) & 0x1fffff;
+		if (++ncp >= 3) {
+			if (self->n >= self->siz) {
+				newsiz = MAXIMUM(self->siz * 2, 1024);
+				if ((tris = reallocarray(self->tris, newsiz,
+				    sizeof(uint64_t))) == NULL) {
+					self->error = errno;
+					return;
+				}
+				self->tris = tris;
+				self->siz = newsiz;
+			}
+			self->tris[self->n++] = TRIGRAM(cp0, cp1, cp);
+			if (self->n >= TINDEX_MAXDOCTRIS) {
+				/* a huge message, take the distinct ones */
+				tgrams_uniq(self);
+				if (self->n >= TINDEX_MAXDOCTRIS / 2) {
+					self->full = true;
+					return;
+				}
+			}
+		}
+		cp0 = cp1;
+		cp1 = cp;
+	}
+}
+
+void
+tgrams_uniq(struct tgrams *self)
+{
+	size_t	 i, n;
+
+	if (self->n == 0)
+		return;
+	qsort(self->tris, self->n, sizeof(uint64_t), uint64_cmp);
+	for (i = 1, n = 1; i < self->n; i++) {
+		if (self->tris[i] != self->tris[n - 1])
+			self->tris[n++] = self->tris[i];
+	}
+	self->n = n;
+}
+
+/* remove the duplicates of the sorted array */
+size_t
+uint32_uniq(uint32_t *a, size_t n)
+{
+	size_t	 i, m;
+
+	if (n == 0)
+		return (0);
+	for (i = 1, m = 1; i < n; i++) {
+		if (a[i] != a[m - 1])
+			a[m++] = a[i];
+	}
+
+	return (m);
+}
+
+int
+tposting_cmp(const void *a0, const void *b0)
+{
+	const struct tposting	*a = a0, *b = b0;
+
+	if (a->tri != b->tri)
+		return ((a->tri < b->tri)? -1 : 1);
+	if (a->seq != b->seq)
+		return ((a->seq < b->seq)? -1 : 1);
+
+	return (0);
+}
+
+int
+tdead_cmp(const void *a0, const void *b0)
+{
+	const struct tdead	*a = a0, *b = b0;
+
+	return ((a->seq < b->seq)? -1 : (a->seq > b->seq)? 1 : 0);
+}
+
+int
+uint64_cmp(const void *a0, const void *b0)
+{
+	uint64_t	 a = *(const uint64_t *)a0, b = *(const uint64_t *)b0;
+
+	return ((a < b)? -1 : (a > b)? 1 : 0);
+}
+
+int
+uint32_cmp(const void *a0, const void *b0)
+{
+	uint32_t	 a = *(const uint32_t *)a0, b = *(const uint32_t *)b0;
+
+	return ((a < b)? -1 : (a > b)? 1 : 0);
+}
+
+int
+tseg_cmp(const void *a0, const void *b0)
+{
+	const struct tseg	*a = a0, *b = b0;
+
+	return ((a->id < b->id)? -1 : (a->id > b->id)? 1 : 0);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	TINDEX_H
+#define	TINDEX_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct tindex;
+
+struct tindex	*tindex_open(const char *);
+void		 tindex_close(struct tindex *);
+uint32_t	 tindex_lastseq(struct tindex *);
+void		 tindex_begin(struct tindex *, uint32_t);
+void		 tindex_text(struct tindex *, const char *, size_t);
+int		 tindex_end(struct tindex *);
+int		 tindex_remove(struct tindex *, uint32_t);
+int		 tindex_flush(struct tindex *);
+int		 tindex_search(struct tindex *, const char *, uint32_t **,
+		    size_t *);
+
+#endif	/* !TINDEX_H */
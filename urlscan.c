@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * Extract the URLs from the text stream and collect the host names.  The
+ * text is split into the tokens by the spaces, the quotes and the angle
+ * brackets, so the URLs in the plain text and in the HTML attributes are
+ * found.  The host names are normalized, lower case and the labels of the
+ * internationalized names in punycode, to be matched with the domain sets.
+ */
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "urlscan.h"
+#include "utf8.h"
+
+#define	URLSCAN_TOKSIZ		2048
+#define	URLSCAN_NSLOTS		(URLSCAN_MAXHOSTS * 2)
+#define	URLSCAN_HOSTSIZ		254
+#define	URLSCAN_LABELMAX	63
+
+struct urlscan_host {
+	char	*name;
+	u_int	 count;
+};
+
+struct urlscan {
+	char			 tok[URLSCAN_TOKSIZ];
+	size_t			 toklen;
+	bool			 toolong;	/* skip the rest of the token */
+	u_int			 nurls;
+	struct urlscan_host	 hosts[URLSCAN_MAXHOSTS];
+	size_t			 nhosts;
+	uint16_t		 slots[URLSCAN_NSLOTS];	/* index + 1 */
+};
+
+static void	 urlscan_token(struct urlscan *, const char *, size_t);
+static void	 urlscan_url(struct urlscan *, const char *, size_t);
+static void	 urlscan_addhost(struct urlscan *, const char *, size_t);
+static int	 punycode_encode(const uint32_t *, size_t, char *, size_t);
+static uint32_t	 punycode_adapt(uint32_t, uint32_t, bool);
+
+struct urlscan *
+urlscan_new(void)
+{
+	return (calloc(1, sizeof(struct urlscan)));
+}
+
+void
+urlscan_free(struct urlscan *self)
+{
+	if (self == NULL)
+		return;
+	urlscan_begin(self);
+	free(self);
+}
+
+void
+urlscan_begin(struct urlscan *self)
+{
+	size_t	 i;
+
+	for (i = 0; i < self->nhosts; i++)
+		free(self->hosts[i].name);
+	self->nhosts = 0;
+	self->nurls = 0;
+	self->toklen = 0;
+	self->toolong = false;
+	memset(self->slots, 0, sizeof(self->slots));
+}
+
+void
+urlscan_text(struct urlscan *self, const char *text, size_t len)
+{
+	size_t	 i;
+	u_char	 c;
+
+	for (i = 0; i < len; i++) {
+		c = text[i];
+		if (c <= ' ' || c == 0x7f || strchr("\"'<>`()[]{}|^\\", c)
+		    != NULL) {
+			urlscan_end(self);
+			continue;
+		}
+		if (self->toolong)
+			continue;
+		if (self->toklen >= sizeof(self->tok)) {
+			/* the host is in the first part */
+			urlscan_end(self);
+			self->toolong = true;
+			continue;
+		}
+		self->tok[self->toklen++] = c;
+	}
+}
+
+/* the end of the text, terminates the token */
+void
+urlscan_end(struct urlscan *self)
+{
+	if (self->toklen > 0)
+		urlscan_token(self, self->tok, self->toklen);
+	self->toklen = 0;
+	self->toolong = false;
+}
+
+u_int
+urlscan_nurls(struct urlscan *self)
+{
+	return (self->nurls);
+}
+
+size_t
+urlscan_nhosts(struct urlscan *self)
+{
+	return (self->nhosts);
+}
+
+const char *
+urlscan_host(struct urlscan *self, size_t idx, u_int *count)
+{
+	if (idx >= self->nhosts)
+		return (NULL);
+	if (count != NULL)
+		*count = self->hosts[idx].count;
+
+	return (self->hosts[idx].name);
+}
+
+void
+urlscan_token(struct urlscan *self, const char *tok, size_t len)
+{
+	size_t	 i;
+	bool	 found = false;
+
+	/* a token may have many, like the redirectors */
+	for (i = 4; i + 3 <= len; i++) {
+		if (tok[i] != ':' || tok[i + 1] != '/' || tok[i + 2] != '/')
+			continue;
+		if (strncasecmp(tok + i - 4, "http", 4) == 0 ||
+		    (i >= 5 && strncasecmp(tok + i - 5, "https", 5) == 0)) {
+			urlscan_url(self, tok + i + 3, len - i - 3);
+			found = true;
+		}
+		i += 2;
+	}
+	if (!found && len > 4 && strncasecmp(tok, "www.", 4) == 0)
+		urlscan_url(self, tok, len);
+}
+
+/* the URL after the scheme */
+void
+urlscan_url(struct urlscan *self, const char *url, size_t len)
+{
+	const char	*host = url;
+	size_t		 i, hostlen;
+
+	self->nurls++;
+	for (i = 0; i < len; i++) {
+		if (strchr("/?#", url[i]) != NULL)
+			break;
+		if (url[i] == '@')	/* userinfo */
+			host = url + i + 1;
+	}
+	len = i - (host - url);
+	for (hostlen = 0; hostlen < len; hostlen++) {
+		if (!isalnum((u_char)host[hostlen]) && host[hostlen] != '-' &&
+		    host[hostlen] != '.' && host[hostlen] != '_' &&
+		    (u_char)host[hostlen] < 0x80)
+			break;
+	}
+	urlscan_addhost(self, host, hostlen);
+}
+
+void
+urlscan_addhost(struct urlscan *self, const char *host, size_t len)
+{
+	char		 name[URLSCAN_HOSTSIZ];
+	int		 namelen;
+	uint32_t	 h = 2166136261U;	/* FNV-1a */
+	size_t		 i, slot;
+	struct urlscan_host
+			*ent;
+
+	if ((namelen = urlscan_normalize(host, len, name, sizeof(name))) <= 0)
+		return;
+	for (i = 0; i < (size_t)namelen; i++)
+		h = (h ^ (u_char)name[i]) * 16777619U;
+	for (slot = h % URLSCAN_NSLOTS; self->slots[slot] != 0;
+	    slot = (slot + 1) % URLSCAN_NSLOTS) {
+		ent = &self->hosts[self->slots[slot] - 1];
+		if (strcmp(ent->name, name) == 0) {
+			ent->count++;
+			return;
+		}
+	}
+	if (self->nhosts >= URLSCAN_MAXHOSTS)
+		return;
+	ent = &self->hosts[self->nhosts];
+	if ((ent->name = strdup(name)) == NULL)
+		return;
+	ent->count = 1;
+	self->slots[slot] = ++self->nhosts;
+}
+
+/*
+ * Normalize the host name into `buf'.  The ideographic and the full width
+ * dots separate the labels, the labels are case folded and the labels of
+ * non ASCII are encoded by punycode ("xn--").  Returns the length, or -1
+ * if the name is broken or not qualified.
+ */
+int
+urlscan_normalize(const char *host, size_t len, char *buf, size_t bufsiz)
+{
+	uint32_t	 label[URLSCAN_LABELMAX], cp;
+	size_t		 i, j, nlabel = 0, outlen = 0, ndots = 0;
+	int		 n, plen;
+	bool		 ascii = true;
+
+	for (i = 0; i <= len; i += n) {
+		n = 1;
+		if (i == len)
+			cp = '.';
+		else if ((n = utf8_decode((const u_char *)host + i, len - i,
+		    &cp)) <= 0)
+			return (-1);
+		if (cp == 0x3002 || cp == 0xff0e || cp == 0xff61)
+			cp = '.';
+		else if (0xff01 <= cp && cp <= 0xff5e)	/* full width */
+			cp -= 0xfee0;
+		if (cp != '.') {
+			if (nlabel >= URLSCAN_LABELMAX)
+				return (-1);
+			cp = (cp < 0x80)? (uint32_t)tolower(cp) :
+			    utf8_casefold(cp);
+			if (cp >= 0x80)
+				ascii = false;
+			label[nlabel++] = cp;
+			continue;
+		}
+		if (nlabel == 0) {
+			/* the root at the end */
+			if (i == len && outlen > 0)
+				continue;
+			return (-1);
+		}
+		if (outlen > 0) {
+			if (outlen + 1 >= bufsiz)
+				return (-1);
+			buf[outlen++] = '.';
+			ndots++;
+		}
+		if (ascii) {
+			if (outlen + nlabel >= bufsiz)
+				return (-1);
+			for (j = 0; j < nlabel; j++)
+				buf[outlen++] = label[j];
+		} else {
+			if (outlen + 4 >= bufsiz)
+				return (-1);
+			memcpy(buf + outlen, "xn--", 4);
+			outlen += 4;
+			if ((plen = punycode_encode(label, nlabel,
+			    buf + outlen, bufsiz - outlen)) == -1)
+				return (-1);
+			outlen += plen;
+		}
+		nlabel = 0;
+		ascii = true;
+	}
+	if (ndots == 0)
+		return (-1);
+	buf[outlen] = '\0';
+
+	return (outlen);
+}
+
+/* RFC 3492 */
+#define	PUNY_BASE		36
+#define	PUNY_TMIN		1
+#define	PUNY_TMAX		26
+
+int
+punycode_encode(const uint32_t *cps, size_t ncps, char *buf, size_t bufsiz)
+{
+	uint32_t	 n = 128, delta = 0, bias = 72, m, q, k, t, d;
+	size_t		 i, h, b, len = 0;
+
+	for (i = 0; i < ncps; i++) {
+		if (cps[i] < 0x80) {
+			if (len + 1 >= bufsiz)
+				return (-1);
+			buf[len++] = cps[i];
+		}
+	}
+	h = b = len;
+	if (b > 0) {
+		if (len + 1 >= bufsiz)
+			return (-1);
+		buf[len++] = '-';
+	}
+	while (h < ncps) {
+		for (m = UINT32_MAX, i = 0; i < ncps; i++) {
+			if (cps[i] >= n && cps[i] < m)
+				m = cps[i];
+		}
+		if (m - n > (UINT32_MAX - delta) / (h + 1))
+			return (-1);
+		delta += (m - n) * (h + 1);
+		n = m;
+		for (i = 0; i < ncps; i++) {
+			if (cps[i] < n && ++delta == 0)
+				return (-1);
+			if (cps[i] != n)
+				continue;
+			for (q = delta, k = PUNY_BASE; ; k += PUNY_BASE) {
+				if (k <= bias)
+					t = PUNY_TMIN;
+				else if (k >= bias + PUNY_TMAX)
+					t = PUNY_TMAX;
+				else
+					t = k - bias;
+				if (q < t)
+					break;
+				d = t + (q - t) % (PUNY_BASE - t);
+				if (len + 1 >= bufsiz)
+					return (-1);
+				buf[len++] = (d < 26)? 'a' + d : '0' + d - 26;
+				q = (q - t) / (PUNY_BASE - t);
+			}
+			if (len + 1 >= bufsiz)
+				return (-1);
+			buf[len++] = (q < 26)? 'a' + q : '0' + q - 26;
+			bias = punycode_adapt(delta, h + 1, h == b);
+			delta = 0;
+			h++;
+		}
+		delta++;
+		n++;
+	}
+
+	return (len);
+}
+
+uint32_t
+punycode_adapt(uint32_t delta, uint32_t npoints, bool first)
+{
+	uint32_t	 k = 0;
+
+	delta = (first)? delta / 700 : delta / 2;
+	delta += delta / npoints;
+	while (delta > ((PUNY_BASE - PUNY_TMIN) * PUNY_TMAX) / 2) {
+		delta /= PUNY_BASE - PUNY_TMIN;
+		k += PUNY_BASE;
+	}
+
+	return (k + (PUNY_BASE - PUNY_TMIN + 1) * delta / (delta + 38));
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	URLSCAN_H
+#define	URLSCAN_H 1
+
+#include <sys/types.h>
+#include <stddef.h>
+
+#define	URLSCAN_MAXHOSTS	1024	/* distinct hosts in a message */
+
+struct urlscan;
+
+struct urlscan	*urlscan_new(void);
+void		 urlscan_free(struct urlscan *);
+void		 urlscan_begin(struct urlscan *);
+void		 urlscan_text(struct urlscan *, const char *, size_t);
+void		 urlscan_end(struct urlscan *);
+u_int		 urlscan_nurls(struct urlscan *);
+size_t		 urlscan_nhosts(struct urlscan *);
+const char	*urlscan_host(struct urlscan *, size_t, u_int *);
+int		 urlscan_normalize(const char *, size_t, char *, size_t);
+
+#endif	/* !URLSCAN_H */
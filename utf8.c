@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <sys/types.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "utf8.h"
+#include "utf8_nfkc.h"
+
+#define nitems(_x)	(sizeof((_x)) / sizeof((_x)[0]))
+
+static uint32_t	 utf8_map(uint32_t);
+static const struct utf8_expand
+		*utf8_expand(uint32_t);
+static uint32_t	 utf8_compose(uint32_t, uint32_t);
+
+/*
+ * Decode a UTF-8 sequence.  Returns the length of the sequence or -1 if it
+ * is broken, the overlong ones and the surrogates are broken too.
+ */
+int
+utf8_decode(const u_char *s, size_t len, uint32_t *cp)
+{
+	int	 i, n;
+
+	if (s[0] < 0x80) {
+		*cp = s[0];
+		return (1);
+	} else if ((s[0] & 0xe0) == 0xc0) {
+		*cp = s[0] & 0x1f;
+		n = 2;
+	} else if ((s[0] & 0xf0) == 0xe0) {
+		*cp = s[0] & 0x0f;
+		n = 3;
+	} else if ((s[0] & 0xf8) == 0xf0) {
+		*cp = s[0] & 0x07;
+		n = 4;
+	} else
+		return (-1);
+	if ((size_t)n > len)
+		return (-1);
+	for (i = 1; i < n; i++) {
+		if ((s[i] & 0xc0) != 0x80)
+			return (-1);
+		*cp = (*cp << 6) | (s[i] & 0x3f);
+	}
+	if ((n == 2 && *cp < 0x80) || (n == 3 && *cp < 0x800) ||
+	    (n == 4 && *cp < 0x10000) || *cp > 0x10ffff ||
+	    (0xd800 <= *cp && *cp <= 0xdfff))
+		return (-1);
+
+	return (n);
+}
+
+int
+utf8_encode(uint32_t cp, u_char *buf)
+{
+	if (cp < 0x80) {
+		buf[0] = cp;
+		return (1);
+	} else if (cp < 0x800) {
+		buf[0] = 0xc0 | (cp >> 6);
+		buf[1] = 0x80 | (cp & 0x3f);
+		return (2);
+	} else if (cp < 0x10000) {
+		buf[0] = 0xe0 | (cp >> 12);
+		buf[1] = 0x80 | ((cp >> 6) & 0x3f);
+		buf[2] = 0x80 | (cp & 0x3f);
+		return (3);
+	}
+	buf[0] = 0xf0 | (cp >> 18);
+	buf[1] = 0x80 | ((cp >> 12) & 0x3f);
+	buf[2] = 0x80 | ((cp >> 6) & 0x3f);
+	buf[3] = 0x80 | (cp & 0x3f);
+
+	return (4);
+}
+
+/*
+ * Simple case folding for Latin, Greek, Cyrillic and full-width Latin
+ * letters.  Folding never makes a character longer in UTF-8.
+ */
+uint32_t
+utf8_casefold(uint32_t cp)
+{
+	if (cp < 0x80)
+		return (('A' <= cp && cp <= 'Z')? cp + 0x20 : cp);
+	if (0xc0 <= cp && cp <= 0xde && cp != 0xd7)
+		return (cp + 0x20);
+	if ((0x100 <= cp && cp <= 0x12f) || (0x132 <= cp && cp <= 0x137) ||
+	    (0x14a <= cp && cp <= 0x177))
+		return (cp | 1);
+	if ((0x139 <= cp && cp <= 0x148) || (0x179 <= cp && cp <= 0x17e))
+		return ((cp & 1)? cp + 1 : cp);
+	if (cp == 0x178)
+		return (0xff);
+	if (cp == 0x17f)
+		return ('s');
+	if (0x391 <= cp && cp <= 0x3a9 && cp != 0x3a2)
+		return (cp + 0x20);
+	if (0x400 <= cp && cp <= 0x40f)
+		return (cp + 0x50);
+	if (0x410 <= cp && cp <= 0x42f)
+		return (cp + 0x20);
+	if (cp == 0x212a)
+		return ('k');
+	if (cp == 0x212b)
+		return (0xe5);
+	if (0xff21 <= cp && cp <= 0xff3a)
+		return (cp + 0x20);
+
+	return (cp);
+}
+
+/* `out' must have 4 times bigger space than `len' */
+size_t
+utf8_casefold_str(const u_char *s, size_t len, u_char *out)
+{
+	size_t		 i, outlen = 0;
+	uint32_t	 cp;
+	int		 n;
+
+	for (i = 0; i < len; i += n) {
+		if ((n = utf8_decode(s + i, len - i, &cp)) <= 0) {
+			out[outlen++] = s[i];
+			n = 1;
+			continue;
+		}
+		outlen += utf8_encode(utf8_casefold(cp), out + outlen);
+	}
+
+	return (outlen);
+}
+
+/*
+ * NFKC and case folding for matching, the full-width, the half-width and
+ * the styled forms become the plain ones, "\uff26\uff32\uff25\uff25" and
+ * "Free" become "free".  The mappings are limited to the blocks in
+ * utf8_nfkc.h, and only the adjacent pairs of a character and a combining
+ * mark are composed.  Each byte of a broken sequence becomes U+FFFD.
+ * `out' must have 6 times bigger space than `len'.
+ */
+size_t
+utf8_normalize(const u_char *s, size_t len, u_char *out)
+{
+	const struct utf8_expand
+			*ex;
+	size_t		 i, outlen = 0, lastoff = 0;
+	uint32_t	 cp, last = 0, comp;
+	int		 n;
+
+	for (i = 0; i < len; i += n) {
+		n = 1;
+		if (s[i] < 0x80) {
+			/* fast path */
+			last = s[i];
+			if ('A' <= last && last <= 'Z')
+				last += 0x20;
+			lastoff = outlen;
+			out[outlen++] = last;
+			continue;
+		}
+		if ((n = utf8_decode(s + i, len - i, &cp)) <= 0) {
+			outlen += utf8_encode(0xfffd, out + outlen);
+			n = 1;
+			last = 0;
+			continue;
+		}
+		if ((ex = utf8_expand(cp)) != NULL) {
+			memcpy(out + outlen, utf8_pool + ex->off, ex->len);
+			outlen += ex->len;
+			last = 0;
+			continue;
+		}
+		cp = utf8_map(cp);
+		if (last != 0 && (comp = utf8_compose(last, cp)) != 0) {
+			outlen = lastoff;
+			cp = comp;
+		}
+		lastoff = outlen;
+		outlen += utf8_encode(cp, out + outlen);
+		last = cp;
+	}
+
+	return (outlen);
+}
+
+uint32_t
+utf8_map(uint32_t cp)
+{
+	const struct utf8_run	*run;
+	size_t			 lo = 0, hi = nitems(utf8_runs), mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (utf8_runs[mid].first <= cp)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return (cp);
+	run = &utf8_runs[lo - 1];
+	if (cp < run->first + run->count * run->stride &&
+	    (cp - run->first) % run->stride == 0)
+		return (cp + run->delta);
+
+	return (cp);
+}
+
+const struct utf8_expand *
+utf8_expand(uint32_t cp)
+{
+	size_t	 lo = 0, hi = nitems(utf8_expands), mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (utf8_expands[mid].cp == cp)
+			return (&utf8_expands[mid]);
+		if (utf8_expands[mid].cp < cp)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (NULL);
+}
+
+/* returns the composition of the pair, or 0 */
+uint32_t
+utf8_compose(uint32_t base, uint32_t mark)
+{
+	size_t	 lo = 0, hi = nitems(utf8_comps), mid;
+
+	/* the combining diacritical marks and the kana voiced marks */
+	if (!(0x300 <= mark && mark <= 0x36f) && mark != 0x3099 &&
+	    mark != 0x309a)
+		return (0);
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (utf8_comps[mid].base == base &&
+		    utf8_comps[mid].mark == mark)
+			return (utf8_comps[mid].comp);
+		if (utf8_comps[mid].base < base ||
+		    (utf8_comps[mid].base == base &&
+		    utf8_comps[mid].mark < mark))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (0);
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef	UTF8_H
+#define	UTF8_H 1
+
+#include <sys/types.h>
+#include <stdint.h>
+
+int		 utf8_decode(const u_char *, size_t, uint32_t *);
+int		 utf8_encode(uint32_t, u_char *);
+uint32_t	 utf8_casefold(uint32_t);
+size_t		 utf8_casefold_str(const u_char *, size_t, u_char *);
+size_t		 utf8_normalize(const u_char *, size_t, u_char *);
+
+#endif	/* !UTF8_H */
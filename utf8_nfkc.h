@@ -0,0 +1,2001 @@
+/*
+ * Copyright (c) 2026 YASUOKA Masahiko <yasuoka@yasuoka.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/*
+ * The tables of utf8_normalize(), derived from the Unicode Character
+ * Database by Python's unicodedata: each code point of the blocks below is
+ * mapped to NFKC(casefold(NFKC(c))) with the default ignorable code points
+ * removed.
+ *
+ *   Latin, IPA and spacing modifiers	U+0080 - U+02FF
+ *   Greek, Cyrillic and Armenian	U+0370 - U+058F
+ *   Latin and Greek Extended		U+1E00 - U+1FFF
+ *   punctuation, super/subscripts, currency, letterlike symbols and
+ *   number forms			U+2000 - U+218F
+ *   enclosed alphanumerics		U+2460 - U+24FF
+ *   Latin Extended-C			U+2C60 - U+2C7F
+ *   CJK symbols, Hiragana, Katakana	U+3000 - U+30FF
+ *   enclosed CJK and CJK compatibility	U+3200 - U+33FF
+ *   Latin Extended-D			U+A720 - U+A7FF
+ *   Latin ligatures			U+FB00 - U+FB17
+ *   variation selectors, vertical forms, CJK compatibility forms and
+ *   small forms			U+FE00 - U+FE6F
+ *   full-width and half-width forms	U+FF00 - U+FF9F, U+FFE0 - U+FFEF
+ *   mathematical alphanumerics		U+1D400 - U+1D7FF
+ *   enclosed alphanumeric supplement	U+1F100 - U+1F1FF
+ *
+ * utf8_runs are the single code point mappings, `count' code points from
+ * `first' by `stride' are mapped to cp + `delta'.  utf8_expands are the
+ * mappings into a string (or empty), utf8_comps are the canonical
+ * compositions of the pairs.
+ */
+static const struct utf8_run {
+	uint32_t	 first;
+	uint16_t	 count;
+	uint8_t		 stride;
+	int32_t		 delta;
+} utf8_runs[] = {
+	{ 0x000a0,   1, 1,    -128 },
+	{ 0x000aa,   1, 1,     -73 },
+	{ 0x000b2,   2, 1,    -128 },
+	{ 0x000b5,   1, 1,     775 },
+	{ 0x000b9,   1, 1,    -136 },
+	{ 0x000ba,   1, 1,     -75 },
+	{ 0x000c0,  23, 1,      32 },
+	{ 0x000d8,   7, 1,      32 },
+	{ 0x00100,  24, 2,       1 },
+	{ 0x00134,   2, 2,       1 },
+	{ 0x00139,   3, 2,       1 },
+	{ 0x00141,   4, 2,       1 },
+	{ 0x0014a,  23, 2,       1 },
+	{ 0x00178,   1, 1,    -121 },
+	{ 0x00179,   3, 2,       1 },
+	{ 0x0017f,   1, 1,    -268 },
+	{ 0x00181,   1, 1,     210 },
+	{ 0x00182,   2, 2,       1 },
+	{ 0x00186,   1, 1,     206 },
+	{ 0x00187,   1, 1,       1 },
+	{ 0x00189,   2, 1,     205 },
+	{ 0x0018b,   1, 1,       1 },
+	{ 0x0018e,   1, 1,      79 },
+	{ 0x0018f,   1, 1,     202 },
+	{ 0x00190,   1, 1,     203 },
+	{ 0x00191,   1, 1,       1 },
+	{ 0x00193,   1, 1,     205 },
+	{ 0x00194,   1, 1,     207 },
+	{ 0x00196,   1, 1,     211 },
+	{ 0x00197,   1, 1,     209 },
+	{ 0x00198,   1, 1,       1 },
+	{ 0x0019c,   1, 1,     211 },
+	{ 0x0019d,   1, 1,     213 },
+	{ 0x0019f,   1, 1,     214 },
+	{ 0x001a0,   3, 2,       1 },
+	{ 0x001a6,   1, 1,     218 },
+	{ 0x001a7,   1, 1,       1 },
+	{ 0x001a9,   1, 1,     218 },
+	{ 0x001ac,   1, 1,       1 },
+	{ 0x001ae,   1, 1,     218 },
+	{ 0x001af,   1, 1,       1 },
+	{ 0x001b1,   2, 1,     217 },
+	{ 0x001b3,   2, 2,       1 },
+	{ 0x001b7,   1, 1,     219 },
+	{ 0x001b8,   1, 1,       1 },
+	{ 0x001bc,   1, 1,       1 },
+	{ 0x001cd,   8, 2,       1 },
+	{ 0x001de,   9, 2,       1 },
+	{ 0x001f4,   1, 1,       1 },
+	{ 0x001f6,   1, 1,     -97 },
+	{ 0x001f7,   1, 1,     -56 },
+	{ 0x001f8,  20, 2,       1 },
+	{ 0x00220,   1, 1,    -130 },
+	{ 0x00222,   9, 2,       1 },
+	{ 0x0023a,   1, 1,   10795 },
+	{ 0x0023b,   1, 1,       1 },
+	{ 0x0023d,   1, 1,    -163 },
+	{ 0x0023e,   1, 1,   10792 },
+	{ 0x00241,   1, 1,       1 },
+	{ 0x00243,   1, 1,    -195 },
+	{ 0x00244,   1, 1,      69 },
+	{ 0x00245,   1, 1,      71 },
+	{ 0x00246,   5, 2,       1 },
+	{ 0x002b0,   1, 1,    -584 },
+	{ 0x002b1,   1, 1,     -75 },
+	{ 0x002b2,   1, 1,    -584 },
+	{ 0x002b3,   1, 1,    -577 },
+	{ 0x002b4,   1, 1,     -59 },
+	{ 0x002b5,   1, 1,     -58 },
+	{ 0x002b6,   1, 1,     -53 },
+	{ 0x002b7,   1, 1,    -576 },
+	{ 0x002b8,   1, 1,    -575 },
+	{ 0x002e0,   1, 1,    -125 },
+	{ 0x002e1,   1, 1,    -629 },
+	{ 0x002e2,   1, 1,    -623 },
+	{ 0x002e3,   1, 1,    -619 },
+	{ 0x002e4,   1, 1,     -79 },
+	{ 0x00370,   2, 2,       1 },
+	{ 0x00374,   1, 1,    -187 },
+	{ 0x00376,   1, 1,       1 },
+	{ 0x0037e,   1, 1,    -835 },
+	{ 0x0037f,   1, 1,     116 },
+	{ 0x00386,   1, 1,      38 },
+	{ 0x00387,   1, 1,    -720 },
+	{ 0x00388,   3, 1,      37 },
+	{ 0x0038c,   1, 1,      64 },
+	{ 0x0038e,   2, 1,      63 },
+	{ 0x00391,  17, 1,      32 },
+	{ 0x003a3,   9, 1,      32 },
+	{ 0x003c2,   1, 1,       1 },
+	{ 0x003cf,   1, 1,       8 },
+	{ 0x003d0,   1, 1,     -30 },
+	{ 0x003d1,   1, 1,     -25 },
+	{ 0x003d2,   1, 1,     -13 },
+	{ 0x003d3,   1, 1,      -6 },
+	{ 0x003d4,   1, 1,      -9 },
+	{ 0x003d5,   1, 1,     -15 },
+	{ 0x003d6,   1, 1,     -22 },
+	{ 0x003d8,  12, 2,       1 },
+	{ 0x003f0,   1, 1,     -54 },
+	{ 0x003f1,   1, 1,     -48 },
+	{ 0x003f2,   1, 1,     -47 },
+	{ 0x003f4,   1, 1,     -60 },
+	{ 0x003f5,   1, 1,     -64 },
+	{ 0x003f7,   1, 1,       1 },
+	{ 0x003f9,   1, 1,     -54 },
+	{ 0x003fa,   1, 1,       1 },
+	{ 0x003fd,   3, 1,    -130 },
+	{ 0x00400,  16, 1,      80 },
+	{ 0x00410,  32, 1,      32 },
+	{ 0x00460,  17, 2,       1 },
+	{ 0x0048a,  27, 2,       1 },
+	{ 0x004c0,   1, 1,      15 },
+	{ 0x004c1,   7, 2,       1 },
+	{ 0x004d0,  48, 2,       1 },
+	{ 0x00531,  38, 1,      48 },
+	{ 0x01e00,  75, 2,       1 },
+	{ 0x01e9b,   1, 1,     -58 },
+	{ 0x01ea0,  48, 2,       1 },
+	{ 0x01f08,   8, 1,      -8 },
+	{ 0x01f18,   6, 1,      -8 },
+	{ 0x01f28,   8, 1,      -8 },
+	{ 0x01f38,   8, 1,      -8 },
+	{ 0x01f48,   6, 1,      -8 },
+	{ 0x01f59,   4, 2,      -8 },
+	{ 0x01f68,   8, 1,      -8 },
+	{ 0x01f71,   1, 1,   -7109 },
+	{ 0x01f73,   1, 1,   -7110 },
+	{ 0x01f75,   1, 1,   -7111 },
+	{ 0x01f77,   1, 1,   -7112 },
+	{ 0x01f79,   1, 1,   -7085 },
+	{ 0x01f7b,   1, 1,   -7086 },
+	{ 0x01f7d,   1, 1,   -7087 },
+	{ 0x01fb8,   2, 1,      -8 },
+	{ 0x01fba,   1, 1,     -74 },
+	{ 0x01fbb,   1, 1,   -7183 },
+	{ 0x01fbe,   1, 1,   -7173 },
+	{ 0x01fc8,   1, 1,     -86 },
+	{ 0x01fc9,   1, 1,   -7196 },
+	{ 0x01fca,   1, 1,     -86 },
+	{ 0x01fcb,   1, 1,   -7197 },
+	{ 0x01fd3,   1, 1,   -7235 },
+	{ 0x01fd8,   2, 1,      -8 },
+	{ 0x01fda,   1, 1,    -100 },
+	{ 0x01fdb,   1, 1,   -7212 },
+	{ 0x01fe3,   1, 1,   -7219 },
+	{ 0x01fe8,   2, 1,      -8 },
+	{ 0x01fea,   1, 1,    -112 },
+	{ 0x01feb,   1, 1,   -7198 },
+	{ 0x01fec,   1, 1,      -7 },
+	{ 0x01fef,   1, 1,   -8079 },
+	{ 0x01ff8,   1, 1,    -128 },
+	{ 0x01ff9,   1, 1,   -7213 },
+	{ 0x01ffa,   1, 1,    -126 },
+	{ 0x01ffb,   1, 1,   -7213 },
+	{ 0x02000,   1, 1,   -8160 },
+	{ 0x02001,   1, 1,   -8161 },
+	{ 0x02002,   1, 1,   -8162 },
+	{ 0x02003,   1, 1,   -8163 },
+	{ 0x02004,   1, 1,   -8164 },
+	{ 0x02005,   1, 1,   -8165 },
+	{ 0x02006,   1, 1,   -8166 },
+	{ 0x02007,   1, 1,   -8167 },
+	{ 0x02008,   1, 1,   -8168 },
+	{ 0x02009,   1, 1,   -8169 },
+	{ 0x0200a,   1, 1,   -8170 },
+	{ 0x02011,   1, 1,      -1 },
+	{ 0x02024,   1, 1,   -8182 },
+	{ 0x0202f,   1, 1,   -8207 },
+	{ 0x0205f,   1, 1,   -8255 },
+	{ 0x02070,   1, 1,   -8256 },
+	{ 0x02071,   1, 1,   -8200 },
+	{ 0x02074,   6, 1,   -8256 },
+	{ 0x0207a,   1, 1,   -8271 },
+	{ 0x0207b,   1, 1,     407 },
+	{ 0x0207c,   1, 1,   -8255 },
+	{ 0x0207d,   2, 1,   -8277 },
+	{ 0x0207f,   1, 1,   -8209 },
+	{ 0x02080,  10, 1,   -8272 },
+	{ 0x0208a,   1, 1,   -8287 },
+	{ 0x0208b,   1, 1,     391 },
+	{ 0x0208c,   1, 1,   -8271 },
+	{ 0x0208d,   2, 1,   -8293 },
+	{ 0x02090,   1, 1,   -8239 },
+	{ 0x02091,   1, 1,   -8236 },
+	{ 0x02092,   1, 1,   -8227 },
+	{ 0x02093,   1, 1,   -8219 },
+	{ 0x02094,   1, 1,   -7739 },
+	{ 0x02095,   1, 1,   -8237 },
+	{ 0x02096,   4, 1,   -8235 },
+	{ 0x0209a,   1, 1,   -8234 },
+	{ 0x0209b,   2, 1,   -8232 },
+	{ 0x02102,   1, 1,   -8351 },
+	{ 0x02107,   1, 1,   -7852 },
+	{ 0x0210a,   2, 1,   -8355 },
+	{ 0x0210c,   1, 1,   -8356 },
+	{ 0x0210d,   1, 1,   -8357 },
+	{ 0x0210e,   1, 1,   -8358 },
+	{ 0x0210f,   1, 1,   -8168 },
+	{ 0x02110,   1, 1,   -8359 },
+	{ 0x02111,   1, 1,   -8360 },
+	{ 0x02112,   1, 1,   -8358 },
+	{ 0x02113,   2, 2,   -8359 },
+	{ 0x02119,   3, 1,   -8361 },
+	{ 0x0211c,   1, 1,   -8362 },
+	{ 0x0211d,   1, 1,   -8363 },
+	{ 0x02124,   1, 1,   -8362 },
+	{ 0x02126,   1, 1,   -7517 },
+	{ 0x02128,   1, 1,   -8366 },
+	{ 0x0212a,   1, 1,   -8383 },
+	{ 0x0212b,   1, 1,   -8262 },
+	{ 0x0212c,   2, 1,   -8394 },
+	{ 0x0212f,   1, 1,   -8394 },
+	{ 0x02130,   2, 1,   -8395 },
+	{ 0x02132,   1, 1,      28 },
+	{ 0x02133,   1, 1,   -8390 },
+	{ 0x02134,   1, 1,   -8389 },
+	{ 0x02135,   4, 1,   -7013 },
+	{ 0x02139,   1, 1,   -8400 },
+	{ 0x0213c,   1, 1,   -7548 },
+	{ 0x0213d,   1, 1,   -7562 },
+	{ 0x0213e,   1, 1,   -7563 },
+	{ 0x0213f,   1, 1,   -7551 },
+	{ 0x02140,   1, 1,     209 },
+	{ 0x02145,   1, 1,   -8417 },
+	{ 0x02146,   2, 1,   -8418 },
+	{ 0x02148,   2, 1,   -8415 },
+	{ 0x02160,   1, 1,   -8439 },
+	{ 0x02164,   1, 1,   -8430 },
+	{ 0x02169,   1, 1,   -8433 },
+	{ 0x0216c,   1, 1,   -8448 },
+	{ 0x0216d,   2, 1,   -8458 },
+	{ 0x0216f,   1, 1,   -8450 },
+	{ 0x02170,   1, 1,   -8455 },
+	{ 0x02174,   1, 1,   -8446 },
+	{ 0x02179,   1, 1,   -8449 },
+	{ 0x0217c,   1, 1,   -8464 },
+	{ 0x0217d,   2, 1,   -8474 },
+	{ 0x0217f,   1, 1,   -8466 },
+	{ 0x02183,   1, 1,       1 },
+	{ 0x02460,   9, 1,   -9263 },
+	{ 0x024b6,  26, 1,   -9301 },
+	{ 0x024d0,  26, 1,   -9327 },
+	{ 0x024ea,   1, 1,   -9402 },
+	{ 0x02c60,   1, 1,       1 },
+	{ 0x02c62,   1, 1,  -10743 },
+	{ 0x02c63,   1, 1,   -3814 },
+	{ 0x02c64,   1, 1,  -10727 },
+	{ 0x02c67,   3, 2,       1 },
+	{ 0x02c6d,   1, 1,  -10780 },
+	{ 0x02c6e,   1, 1,  -10749 },
+	{ 0x02c6f,   1, 1,  -10783 },
+	{ 0x02c70,   1, 1,  -10782 },
+	{ 0x02c72,   1, 1,       1 },
+	{ 0x02c75,   1, 1,       1 },
+	{ 0x02c7c,   1, 1,  -11282 },
+	{ 0x02c7d,   1, 1,  -11271 },
+	{ 0x02c7e,   2, 1,  -10815 },
+	{ 0x03000,   1, 1,  -12256 },
+	{ 0x03036,   1, 1,     -36 },
+	{ 0x03038,   1, 1,    8969 },
+	{ 0x03039,   2, 1,    8971 },
+	{ 0x03244,   1, 1,    8971 },
+	{ 0x03245,   1, 1,   11319 },
+	{ 0x03246,   1, 1,   13121 },
+	{ 0x03247,   1, 1,   18760 },
+	{ 0x03260,   1, 1,   -8544 },
+	{ 0x03261,   2, 1,   -8543 },
+	{ 0x03263,   3, 1,   -8542 },
+	{ 0x03266,   1, 1,   -8541 },
+	{ 0x03267,   2, 1,   -8540 },
+	{ 0x03269,   5, 1,   -8539 },
+	{ 0x0326e,   1, 1,   31122 },
+	{ 0x0326f,   1, 1,   32297 },
+	{ 0x03270,   1, 1,   32884 },
+	{ 0x03271,   1, 1,   34059 },
+	{ 0x03272,   1, 1,   34646 },
+	{ 0x03273,   1, 1,   35233 },
+	{ 0x03274,   1, 1,   36408 },
+	{ 0x03275,   1, 1,   37583 },
+	{ 0x03276,   1, 1,   38170 },
+	{ 0x03277,   1, 1,   39345 },
+	{ 0x03278,   1, 1,   39932 },
+	{ 0x03279,   1, 1,   40519 },
+	{ 0x0327a,   1, 1,   41106 },
+	{ 0x0327b,   1, 1,   41693 },
+	{ 0x0327e,   1, 1,   37938 },
+	{ 0x03280,   1, 1,    7040 },
+	{ 0x03281,   1, 1,    7179 },
+	{ 0x03282,   1, 1,    7047 },
+	{ 0x03283,   1, 1,    9304 },
+	{ 0x03284,   1, 1,    7184 },
+	{ 0x03285,   1, 1,    7912 },
+	{ 0x03286,   1, 1,    7037 },
+	{ 0x03287,   1, 1,    7908 },
+	{ 0x03288,   1, 1,    7125 },
+	{ 0x03289,   1, 1,    8376 },
+	{ 0x0328a,   1, 1,   13438 },
+	{ 0x0328b,   1, 1,   15840 },
+	{ 0x0328c,   1, 1,   14760 },
+	{ 0x0328d,   1, 1,   13467 },
+	{ 0x0328e,   1, 1,   24387 },
+	{ 0x0328f,   1, 1,    9360 },
+	{ 0x03290,   1, 1,   13141 },
+	{ 0x03291,   1, 1,   13721 },
+	{ 0x03292,   1, 1,   13431 },
+	{ 0x03293,   1, 1,   18091 },
+	{ 0x03294,   1, 1,    8569 },
+	{ 0x03295,   1, 1,   16356 },
+	{ 0x03296,   1, 1,   23051 },
+	{ 0x03297,   1, 1,   18118 },
+	{ 0x03298,   1, 1,    8220 },
+	{ 0x03299,   1, 1,   18239 },
+	{ 0x0329a,   1, 1,   17053 },
+	{ 0x0329b,   1, 1,    9944 },
+	{ 0x0329c,   1, 1,   24013 },
+	{ 0x0329d,   1, 1,    7821 },
+	{ 0x0329e,   1, 1,    8402 },
+	{ 0x0329f,   1, 1,   14921 },
+	{ 0x032a0,   1, 1,   25957 },
+	{ 0x032a1,   1, 1,    7280 },
+	{ 0x032a2,   1, 1,    7927 },
+	{ 0x032a3,   1, 1,   14528 },
+	{ 0x032a4,   1, 1,    7014 },
+	{ 0x032a5,   1, 1,    7048 },
+	{ 0x032a6,   1, 1,    7013 },
+	{ 0x032a7,   1, 1,   11071 },
+	{ 0x032a8,   1, 1,    8523 },
+	{ 0x032a9,   1, 1,    8338 },
+	{ 0x032aa,   1, 1,   10477 },
+	{ 0x032ab,   1, 1,   10427 },
+	{ 0x032ac,   1, 1,   17463 },
+	{ 0x032ad,   1, 1,    7252 },
+	{ 0x032ae,   1, 1,   23065 },
+	{ 0x032af,   1, 1,    8357 },
+	{ 0x032b0,   1, 1,    9836 },
+	{ 0x032d0,   1, 1,    -558 },
+	{ 0x032d1,   1, 1,    -557 },
+	{ 0x032d2,   1, 1,    -556 },
+	{ 0x032d3,   1, 1,    -555 },
+	{ 0x032d4,   2, 1,    -554 },
+	{ 0x032d6,   1, 1,    -553 },
+	{ 0x032d7,   1, 1,    -552 },
+	{ 0x032d8,   1, 1,    -551 },
+	{ 0x032d9,   1, 1,    -550 },
+	{ 0x032da,   1, 1,    -549 },
+	{ 0x032db,   1, 1,    -548 },
+	{ 0x032dc,   1, 1,    -547 },
+	{ 0x032dd,   1, 1,    -546 },
+	{ 0x032de,   1, 1,    -545 },
+	{ 0x032df,   1, 1,    -544 },
+	{ 0x032e0,   1, 1,    -543 },
+	{ 0x032e1,   1, 1,    -541 },
+	{ 0x032e2,   1, 1,    -540 },
+	{ 0x032e3,   1, 1,    -539 },
+	{ 0x032e4,   6, 1,    -538 },
+	{ 0x032ea,   1, 1,    -536 },
+	{ 0x032eb,   1, 1,    -534 },
+	{ 0x032ec,   1, 1,    -532 },
+	{ 0x032ed,   1, 1,    -530 },
+	{ 0x032ee,   5, 1,    -528 },
+	{ 0x032f3,   1, 1,    -527 },
+	{ 0x032f4,   1, 1,    -526 },
+	{ 0x032f5,   6, 1,    -525 },
+	{ 0x032fb,   4, 1,    -524 },
+	{ 0x0a722,   7, 2,       1 },
+	{ 0x0a732,  31, 2,       1 },
+	{ 0x0a770,   1, 1,      -1 },
+	{ 0x0a779,   2, 2,       1 },
+	{ 0x0a77d,   1, 1,  -35332 },
+	{ 0x0a77e,   5, 2,       1 },
+	{ 0x0a78b,   1, 1,       1 },
+	{ 0x0a78d,   1, 1,  -42280 },
+	{ 0x0a790,   2, 2,       1 },
+	{ 0x0a796,  10, 2,       1 },
+	{ 0x0a7aa,   1, 1,  -42308 },
+	{ 0x0a7ab,   1, 1,  -42319 },
+	{ 0x0a7ac,   1, 1,  -42315 },
+	{ 0x0a7ad,   1, 1,  -42305 },
+	{ 0x0a7ae,   1, 1,  -42308 },
+	{ 0x0a7b0,   1, 1,  -42258 },
+	{ 0x0a7b1,   1, 1,  -42282 },
+	{ 0x0a7b2,   1, 1,  -42261 },
+	{ 0x0a7b3,   1, 1,     928 },
+	{ 0x0a7b4,   8, 2,       1 },
+	{ 0x0a7c4,   1, 1,     -48 },
+	{ 0x0a7c5,   1, 1,  -42307 },
+	{ 0x0a7c6,   1, 1,  -35384 },
+	{ 0x0a7c7,   2, 2,       1 },
+	{ 0x0a7d0,   1, 1,       1 },
+	{ 0x0a7d6,   2, 2,       1 },
+	{ 0x0a7f2,   1, 1,  -42895 },
+	{ 0x0a7f3,   1, 1,  -42893 },
+	{ 0x0a7f4,   1, 1,  -42883 },
+	{ 0x0a7f5,   1, 1,       1 },
+	{ 0x0a7f8,   1, 1,  -42705 },
+	{ 0x0a7f9,   1, 1,  -42662 },
+	{ 0x0fe10,   1, 1,  -64996 },
+	{ 0x0fe11,   2, 1,  -52752 },
+	{ 0x0fe13,   2, 1,  -64985 },
+	{ 0x0fe15,   1, 1,  -65012 },
+	{ 0x0fe16,   1, 1,  -64983 },
+	{ 0x0fe17,   2, 1,  -52737 },
+	{ 0x0fe31,   1, 1,  -56861 },
+	{ 0x0fe32,   1, 1,  -56863 },
+	{ 0x0fe33,   1, 1,  -64980 },
+	{ 0x0fe34,   1, 1,  -64981 },
+	{ 0x0fe35,   2, 1,  -65037 },
+	{ 0x0fe37,   1, 1,  -64956 },
+	{ 0x0fe38,   1, 1,  -64955 },
+	{ 0x0fe39,   2, 1,  -52773 },
+	{ 0x0fe3b,   2, 1,  -52779 },
+	{ 0x0fe3d,   2, 1,  -52787 },
+	{ 0x0fe3f,   2, 1,  -52791 },
+	{ 0x0fe41,   4, 1,  -52789 },
+	{ 0x0fe47,   1, 1,  -65004 },
+	{ 0x0fe48,   1, 1,  -65003 },
+	{ 0x0fe4d,   1, 1,  -65006 },
+	{ 0x0fe4e,   1, 1,  -65007 },
+	{ 0x0fe4f,   1, 1,  -65008 },
+	{ 0x0fe50,   1, 1,  -65060 },
+	{ 0x0fe51,   1, 1,  -52816 },
+	{ 0x0fe52,   1, 1,  -65060 },
+	{ 0x0fe54,   1, 1,  -65049 },
+	{ 0x0fe55,   1, 1,  -65051 },
+	{ 0x0fe56,   1, 1,  -65047 },
+	{ 0x0fe57,   1, 1,  -65078 },
+	{ 0x0fe58,   1, 1,  -56900 },
+	{ 0x0fe59,   2, 1,  -65073 },
+	{ 0x0fe5b,   1, 1,  -64992 },
+	{ 0x0fe5c,   1, 1,  -64991 },
+	{ 0x0fe5d,   2, 1,  -52809 },
+	{ 0x0fe5f,   1, 1,  -65084 },
+	{ 0x0fe60,   1, 1,  -65082 },
+	{ 0x0fe61,   2, 1,  -65079 },
+	{ 0x0fe63,   1, 1,  -65078 },
+	{ 0x0fe64,   1, 1,  -65064 },
+	{ 0x0fe65,   1, 1,  -65063 },
+	{ 0x0fe66,   1, 1,  -65065 },
+	{ 0x0fe68,   1, 1,  -65036 },
+	{ 0x0fe69,   2, 1,  -65093 },
+	{ 0x0fe6b,   1, 1,  -65067 },
+	{ 0x0ff01,  32, 1,  -65248 },
+	{ 0x0ff21,  26, 1,  -65216 },
+	{ 0x0ff3b,  36, 1,  -65248 },
+	{ 0x0ff5f,   2, 1,  -54746 },
+	{ 0x0ff61,   1, 1,  -53087 },
+	{ 0x0ff62,   2, 1,  -53078 },
+	{ 0x0ff64,   1, 1,  -53091 },
+	{ 0x0ff65,   1, 1,  -52842 },
+	{ 0x0ff66,   1, 1,  -52852 },
+	{ 0x0ff67,   1, 1,  -52934 },
+	{ 0x0ff68,   1, 1,  -52933 },
+	{ 0x0ff69,   1, 1,  -52932 },
+	{ 0x0ff6a,   1, 1,  -52931 },
+	{ 0x0ff6b,   1, 1,  -52930 },
+	{ 0x0ff6c,   1, 1,  -52873 },
+	{ 0x0ff6d,   1, 1,  -52872 },
+	{ 0x0ff6e,   1, 1,  -52871 },
+	{ 0x0ff6f,   1, 1,  -52908 },
+	{ 0x0ff70,   1, 1,  -52852 },
+	{ 0x0ff71,   1, 1,  -52943 },
+	{ 0x0ff72,   1, 1,  -52942 },
+	{ 0x0ff73,   1, 1,  -52941 },
+	{ 0x0ff74,   1, 1,  -52940 },
+	{ 0x0ff75,   2, 1,  -52939 },
+	{ 0x0ff77,   1, 1,  -52938 },
+	{ 0x0ff78,   1, 1,  -52937 },
+	{ 0x0ff79,   1, 1,  -52936 },
+	{ 0x0ff7a,   1, 1,  -52935 },
+	{ 0x0ff7b,   1, 1,  -52934 },
+	{ 0x0ff7c,   1, 1,  -52933 },
+	{ 0x0ff7d,   1, 1,  -52932 },
+	{ 0x0ff7e,   1, 1,  -52931 },
+	{ 0x0ff7f,   1, 1,  -52930 },
+	{ 0x0ff80,   1, 1,  -52929 },
+	{ 0x0ff81,   1, 1,  -52928 },
+	{ 0x0ff82,   1, 1,  -52926 },
+	{ 0x0ff83,   1, 1,  -52925 },
+	{ 0x0ff84,   1, 1,  -52924 },
+	{ 0x0ff85,   6, 1,  -52923 },
+	{ 0x0ff8b,   1, 1,  -52921 },
+	{ 0x0ff8c,   1, 1,  -52919 },
+	{ 0x0ff8d,   1, 1,  -52917 },
+	{ 0x0ff8e,   1, 1,  -52915 },
+	{ 0x0ff8f,   5, 1,  -52913 },
+	{ 0x0ff94,   1, 1,  -52912 },
+	{ 0x0ff95,   1, 1,  -52911 },
+	{ 0x0ff96,   6, 1,  -52910 },
+	{ 0x0ff9c,   1, 1,  -52909 },
+	{ 0x0ff9d,   1, 1,  -52906 },
+	{ 0x0ff9e,   2, 1,  -52997 },
+	{ 0x0ffe0,   2, 1,  -65342 },
+	{ 0x0ffe2,   1, 1,  -65334 },
+	{ 0x0ffe4,   1, 1,  -65342 },
+	{ 0x0ffe5,   1, 1,  -65344 },
+	{ 0x0ffe6,   1, 1,  -57149 },
+	{ 0x0ffe8,   1, 1,  -56038 },
+	{ 0x0ffe9,   4, 1,  -56921 },
+	{ 0x0ffed,   1, 1,  -55885 },
+	{ 0x0ffee,   1, 1,  -55843 },
+	{ 0x1d400,  26, 1, -119711 },
+	{ 0x1d41a,  26, 1, -119737 },
+	{ 0x1d434,  26, 1, -119763 },
+	{ 0x1d44e,   7, 1, -119789 },
+	{ 0x1d456,  18, 1, -119789 },
+	{ 0x1d468,  26, 1, -119815 },
+	{ 0x1d482,  26, 1, -119841 },
+	{ 0x1d49c,   2, 2, -119867 },
+	{ 0x1d49f,   1, 1, -119867 },
+	{ 0x1d4a2,   1, 1, -119867 },
+	{ 0x1d4a5,   2, 1, -119867 },
+	{ 0x1d4a9,   4, 1, -119867 },
+	{ 0x1d4ae,   8, 1, -119867 },
+	{ 0x1d4b6,   4, 1, -119893 },
+	{ 0x1d4bb,   2, 2, -119893 },
+	{ 0x1d4be,   6, 1, -119893 },
+	{ 0x1d4c5,  11, 1, -119893 },
+	{ 0x1d4d0,  26, 1, -119919 },
+	{ 0x1d4ea,  26, 1, -119945 },
+	{ 0x1d504,   2, 1, -119971 },
+	{ 0x1d507,   4, 1, -119971 },
+	{ 0x1d50d,   8, 1, -119971 },
+	{ 0x1d516,   7, 1, -119971 },
+	{ 0x1d51e,  26, 1, -119997 },
+	{ 0x1d538,   2, 1, -120023 },
+	{ 0x1d53b,   4, 1, -120023 },
+	{ 0x1d540,   5, 1, -120023 },
+	{ 0x1d546,   1, 1, -120023 },
+	{ 0x1d54a,   7, 1, -120023 },
+	{ 0x1d552,  26, 1, -120049 },
+	{ 0x1d56c,  26, 1, -120075 },
+	{ 0x1d586,  26, 1, -120101 },
+	{ 0x1d5a0,  26, 1, -120127 },
+	{ 0x1d5ba,  26, 1, -120153 },
+	{ 0x1d5d4,  26, 1, -120179 },
+	{ 0x1d5ee,  26, 1, -120205 },
+	{ 0x1d608,  26, 1, -120231 },
+	{ 0x1d622,  26, 1, -120257 },
+	{ 0x1d63c,  26, 1, -120283 },
+	{ 0x1d656,  26, 1, -120309 },
+	{ 0x1d670,  26, 1, -120335 },
+	{ 0x1d68a,  26, 1, -120361 },
+	{ 0x1d6a4,   1, 1, -120179 },
+	{ 0x1d6a5,   1, 1, -119918 },
+	{ 0x1d6a8,  17, 1, -119543 },
+	{ 0x1d6b9,   1, 1, -119553 },
+	{ 0x1d6ba,   7, 1, -119543 },
+	{ 0x1d6c1,   1, 1, -111802 },
+	{ 0x1d6c2,  17, 1, -119569 },
+	{ 0x1d6d3,   1, 1, -119568 },
+	{ 0x1d6d4,   7, 1, -119569 },
+	{ 0x1d6db,   1, 1, -111833 },
+	{ 0x1d6dc,   1, 1, -119591 },
+	{ 0x1d6dd,   1, 1, -119589 },
+	{ 0x1d6de,   1, 1, -119588 },
+	{ 0x1d6df,   1, 1, -119577 },
+	{ 0x1d6e0,   1, 1, -119583 },
+	{ 0x1d6e1,   1, 1, -119585 },
+	{ 0x1d6e2,  17, 1, -119601 },
+	{ 0x1d6f3,   1, 1, -119611 },
+	{ 0x1d6f4,   7, 1, -119601 },
+	{ 0x1d6fb,   1, 1, -111860 },
+	{ 0x1d6fc,  17, 1, -119627 },
+	{ 0x1d70d,   1, 1, -119626 },
+	{ 0x1d70e,   7, 1, -119627 },
+	{ 0x1d715,   1, 1, -111891 },
+	{ 0x1d716,   1, 1, -119649 },
+	{ 0x1d717,   1, 1, -119647 },
+	{ 0x1d718,   1, 1, -119646 },
+	{ 0x1d719,   1, 1, -119635 },
+	{ 0x1d71a,   1, 1, -119641 },
+	{ 0x1d71b,   1, 1, -119643 },
+	{ 0x1d71c,  17, 1, -119659 },
+	{ 0x1d72d,   1, 1, -119669 },
+	{ 0x1d72e,   7, 1, -119659 },
+	{ 0x1d735,   1, 1, -111918 },
+	{ 0x1d736,  17, 1, -119685 },
+	{ 0x1d747,   1, 1, -119684 },
+	{ 0x1d748,   7, 1, -119685 },
+	{ 0x1d74f,   1, 1, -111949 },
+	{ 0x1d750,   1, 1, -119707 },
+	{ 0x1d751,   1, 1, -119705 },
+	{ 0x1d752,   1, 1, -119704 },
+	{ 0x1d753,   1, 1, -119693 },
+	{ 0x1d754,   1, 1, -119699 },
+	{ 0x1d755,   1, 1, -119701 },
+	{ 0x1d756,  17, 1, -119717 },
+	{ 0x1d767,   1, 1, -119727 },
+	{ 0x1d768,   7, 1, -119717 },
+	{ 0x1d76f,   1, 1, -111976 },
+	{ 0x1d770,  17, 1, -119743 },
+	{ 0x1d781,   1, 1, -119742 },
+	{ 0x1d782,   7, 1, -119743 },
+	{ 0x1d789,   1, 1, -112007 },
+	{ 0x1d78a,   1, 1, -119765 },
+	{ 0x1d78b,   1, 1, -119763 },
+	{ 0x1d78c,   1, 1, -119762 },
+	{ 0x1d78d,   1, 1, -119751 },
+	{ 0x1d78e,   1, 1, -119757 },
+	{ 0x1d78f,   1, 1, -119759 },
+	{ 0x1d790,  17, 1, -119775 },
+	{ 0x1d7a1,   1, 1, -119785 },
+	{ 0x1d7a2,   7, 1, -119775 },
+	{ 0x1d7a9,   1, 1, -112034 },
+	{ 0x1d7aa,  17, 1, -119801 },
+	{ 0x1d7bb,   1, 1, -119800 },
+	{ 0x1d7bc,   7, 1, -119801 },
+	{ 0x1d7c3,   1, 1, -112065 },
+	{ 0x1d7c4,   1, 1, -119823 },
+	{ 0x1d7c5,   1, 1, -119821 },
+	{ 0x1d7c6,   1, 1, -119820 },
+	{ 0x1d7c7,   1, 1, -119809 },
+	{ 0x1d7c8,   1, 1, -119815 },
+	{ 0x1d7c9,   1, 1, -119817 },
+	{ 0x1d7ca,   1, 1, -119789 },
+	{ 0x1d7cb,   1, 1, -119790 },
+	{ 0x1d7ce,  10, 1, -120734 },
+	{ 0x1d7d8,  10, 1, -120744 },
+	{ 0x1d7e2,  10, 1, -120754 },
+	{ 0x1d7ec,  10, 1, -120764 },
+	{ 0x1d7f6,  10, 1, -120774 },
+	{ 0x1f12b,   1, 1, -127176 },
+	{ 0x1f12c,   1, 1, -127162 },
+	{ 0x1f130,  26, 1, -127183 },
+};
+
+static const struct utf8_expand {
+	uint32_t	 cp;
+	uint16_t	 off;		/* in utf8_pool */
+	uint8_t		 len;
+} utf8_expands[] = {
+	{ 0x000a8,    0,  3 },
+	{ 0x000ad,    3,  0 },	/*  */
+	{ 0x000af,    3,  3 },
+	{ 0x000b4,    6,  3 },
+	{ 0x000b8,    9,  3 },
+	{ 0x000bc,   12,  5 },
+	{ 0x000bd,   17,  5 },
+	{ 0x000be,   22,  5 },
+	{ 0x000df,   27,  2 },	/* ss */
+	{ 0x00130,   29,  3 },
+	{ 0x00132,   32,  2 },	/* ij */
+	{ 0x00133,   34,  2 },	/* ij */
+	{ 0x0013f,   36,  3 },
+	{ 0x00140,   39,  3 },
+	{ 0x00149,   42,  3 },
+	{ 0x001c4,   45,  3 },
+	{ 0x001c5,   48,  3 },
+	{ 0x001c6,   51,  3 },
+	{ 0x001c7,   54,  2 },	/* lj */
+	{ 0x001c8,   56,  2 },	/* lj */
+	{ 0x001c9,   58,  2 },	/* lj */
+	{ 0x001ca,   60,  2 },	/* nj */
+	{ 0x001cb,   62,  2 },	/* nj */
+	{ 0x001cc,   64,  2 },	/* nj */
+	{ 0x001f1,   66,  2 },	/* dz */
+	{ 0x001f2,   68,  2 },	/* dz */
+	{ 0x001f3,   70,  2 },	/* dz */
+	{ 0x002d8,   72,  3 },
+	{ 0x002d9,   75,  3 },
+	{ 0x002da,   78,  3 },
+	{ 0x002db,   81,  3 },
+	{ 0x002dc,   84,  3 },
+	{ 0x002dd,   87,  3 },
+	{ 0x0034f,   90,  0 },	/*  */
+	{ 0x0037a,   90,  3 },
+	{ 0x00384,   93,  3 },
+	{ 0x00385,   96,  5 },
+	{ 0x00587,  101,  4 },
+	{ 0x0061c,  105,  0 },	/*  */
+	{ 0x0115f,  105,  0 },	/*  */
+	{ 0x01160,  105,  0 },	/*  */
+	{ 0x017b4,  105,  0 },	/*  */
+	{ 0x017b5,  105,  0 },	/*  */
+	{ 0x0180b,  105,  0 },	/*  */
+	{ 0x0180c,  105,  0 },	/*  */
+	{ 0x0180d,  105,  0 },	/*  */
+	{ 0x0180e,  105,  0 },	/*  */
+	{ 0x0180f,  105,  0 },	/*  */
+	{ 0x01e9a,  105,  3 },
+	{ 0x01e9e,  108,  2 },	/* ss */
+	{ 0x01f80,  110,  5 },
+	{ 0x01f81,  115,  5 },
+	{ 0x01f82,  120,  5 },
+	{ 0x01f83,  125,  5 },
+	{ 0x01f84,  130,  5 },
+	{ 0x01f85,  135,  5 },
+	{ 0x01f86,  140,  5 },
+	{ 0x01f87,  145,  5 },
+	{ 0x01f88,  150,  5 },
+	{ 0x01f89,  155,  5 },
+	{ 0x01f8a,  160,  5 },
+	{ 0x01f8b,  165,  5 },
+	{ 0x01f8c,  170,  5 },
+	{ 0x01f8d,  175,  5 },
+	{ 0x01f8e,  180,  5 },
+	{ 0x01f8f,  185,  5 },
+	{ 0x01f90,  190,  5 },
+	{ 0x01f91,  195,  5 },
+	{ 0x01f92,  200,  5 },
+	{ 0x01f93,  205,  5 },
+	{ 0x01f94,  210,  5 },
+	{ 0x01f95,  215,  5 },
+	{ 0x01f96,  220,  5 },
+	{ 0x01f97,  225,  5 },
+	{ 0x01f98,  230,  5 },
+	{ 0x01f99,  235,  5 },
+	{ 0x01f9a,  240,  5 },
+	{ 0x01f9b,  245,  5 },
+	{ 0x01f9c,  250,  5 },
+	{ 0x01f9d,  255,  5 },
+	{ 0x01f9e,  260,  5 },
+	{ 0x01f9f,  265,  5 },
+	{ 0x01fa0,  270,  5 },
+	{ 0x01fa1,  275,  5 },
+	{ 0x01fa2,  280,  5 },
+	{ 0x01fa3,  285,  5 },
+	{ 0x01fa4,  290,  5 },
+	{ 0x01fa5,  295,  5 },
+	{ 0x01fa6,  300,  5 },
+	{ 0x01fa7,  305,  5 },
+	{ 0x01fa8,  310,  5 },
+	{ 0x01fa9,  315,  5 },
+	{ 0x01faa,  320,  5 },
+	{ 0x01fab,  325,  5 },
+	{ 0x01fac,  330,  5 },
+	{ 0x01fad,  335,  5 },
+	{ 0x01fae,  340,  5 },
+	{ 0x01faf,  345,  5 },
+	{ 0x01fb2,  350,  5 },
+	{ 0x01fb3,  355,  4 },
+	{ 0x01fb4,  359,  4 },
+	{ 0x01fb7,  363,  5 },
+	{ 0x01fbc,  368,  4 },
+	{ 0x01fbd,  372,  3 },
+	{ 0x01fbf,  375,  3 },
+	{ 0x01fc0,  378,  3 },
+	{ 0x01fc1,  381,  5 },
+	{ 0x01fc2,  386,  5 },
+	{ 0x01fc3,  391,  4 },
+	{ 0x01fc4,  395,  4 },
+	{ 0x01fc7,  399,  5 },
+	{ 0x01fcc,  404,  4 },
+	{ 0x01fcd,  408,  5 },
+	{ 0x01fce,  413,  5 },
+	{ 0x01fcf,  418,  5 },
+	{ 0x01fdd,  423,  5 },
+	{ 0x01fde,  428,  5 },
+	{ 0x01fdf,  433,  5 },
+	{ 0x01fed,  438,  5 },
+	{ 0x01fee,  443,  5 },
+	{ 0x01ff2,  448,  5 },
+	{ 0x01ff3,  453,  4 },
+	{ 0x01ff4,  457,  4 },
+	{ 0x01ff7,  461,  5 },
+	{ 0x01ffc,  466,  4 },
+	{ 0x01ffd,  470,  3 },
+	{ 0x01ffe,  473,  3 },
+	{ 0x0200b,  476,  0 },	/*  */
+	{ 0x0200c,  476,  0 },	/*  */
+	{ 0x0200d,  476,  0 },	/*  */
+	{ 0x0200e,  476,  0 },	/*  */
+	{ 0x0200f,  476,  0 },	/*  */
+	{ 0x02017,  476,  3 },
+	{ 0x02025,  479,  2 },	/* .. */
+	{ 0x02026,  481,  3 },	/* ... */
+	{ 0x0202a,  484,  0 },	/*  */
+	{ 0x0202b,  484,  0 },	/*  */
+	{ 0x0202c,  484,  0 },	/*  */
+	{ 0x0202d,  484,  0 },	/*  */
+	{ 0x0202e,  484,  0 },	/*  */
+	{ 0x02033,  484,  6 },
+	{ 0x02034,  490,  9 },
+	{ 0x02036,  499,  6 },
+	{ 0x02037,  505,  9 },
+	{ 0x0203c,  514,  2 },	/* !! */
+	{ 0x0203e,  516,  3 },
+	{ 0x02047,  519,  2 },	/* ?? */
+	{ 0x02048,  521,  2 },	/* ?! */
+	{ 0x02049,  523,  2 },	/* !? */
+	{ 0x02057,  525, 12 },
+	{ 0x02060,  537,  0 },	/*  */
+	{ 0x02061,  537,  0 },	/*  */
+	{ 0x02062,  537,  0 },	/*  */
+	{ 0x02063,  537,  0 },	/*  */
+	{ 0x02064,  537,  0 },	/*  */
+	{ 0x02065,  537,  0 },	/*  */
+	{ 0x02066,  537,  0 },	/*  */
+	{ 0x02067,  537,  0 },	/*  */
+	{ 0x02068,  537,  0 },	/*  */
+	{ 0x02069,  537,  0 },	/*  */
+	{ 0x0206a,  537,  0 },	/*  */
+	{ 0x0206b,  537,  0 },	/*  */
+	{ 0x0206c,  537,  0 },	/*  */
+	{ 0x0206d,  537,  0 },	/*  */
+	{ 0x0206e,  537,  0 },	/*  */
+	{ 0x0206f,  537,  0 },	/*  */
+	{ 0x020a8,  537,  2 },	/* rs */
+	{ 0x02100,  539,  3 },	/* a/c */
+	{ 0x02101,  542,  3 },	/* a/s */
+	{ 0x02103,  545,  3 },
+	{ 0x02105,  548,  3 },	/* c/o */
+	{ 0x02106,  551,  3 },	/* c/u */
+	{ 0x02109,  554,  3 },
+	{ 0x02116,  557,  2 },	/* no */
+	{ 0x02120,  559,  2 },	/* sm */
+	{ 0x02121,  561,  3 },	/* tel */
+	{ 0x02122,  564,  2 },	/* tm */
+	{ 0x0213b,  566,  3 },	/* fax */
+	{ 0x02150,  569,  5 },
+	{ 0x02151,  574,  5 },
+	{ 0x02152,  579,  6 },
+	{ 0x02153,  585,  5 },
+	{ 0x02154,  590,  5 },
+	{ 0x02155,  595,  5 },
+	{ 0x02156,  600,  5 },
+	{ 0x02157,  605,  5 },
+	{ 0x02158,  610,  5 },
+	{ 0x02159,  615,  5 },
+	{ 0x0215a,  620,  5 },
+	{ 0x0215b,  625,  5 },
+	{ 0x0215c,  630,  5 },
+	{ 0x0215d,  635,  5 },
+	{ 0x0215e,  640,  5 },
+	{ 0x0215f,  645,  4 },
+	{ 0x02161,  649,  2 },	/* ii */
+	{ 0x02162,  651,  3 },	/* iii */
+	{ 0x02163,  654,  2 },	/* iv */
+	{ 0x02165,  656,  2 },	/* vi */
+	{ 0x02166,  658,  3 },	/* vii */
+	{ 0x02167,  661,  4 },	/* viii */
+	{ 0x02168,  665,  2 },	/* ix */
+	{ 0x0216a,  667,  2 },	/* xi */
+	{ 0x0216b,  669,  3 },	/* xii */
+	{ 0x02171,  672,  2 },	/* ii */
+	{ 0x02172,  674,  3 },	/* iii */
+	{ 0x02173,  677,  2 },	/* iv */
+	{ 0x02175,  679,  2 },	/* vi */
+	{ 0x02176,  681,  3 },	/* vii */
+	{ 0x02177,  684,  4 },	/* viii */
+	{ 0x02178,  688,  2 },	/* ix */
+	{ 0x0217a,  690,  2 },	/* xi */
+	{ 0x0217b,  692,  3 },	/* xii */
+	{ 0x02189,  695,  5 },
+	{ 0x02469,  700,  2 },	/* 10 */
+	{ 0x0246a,  702,  2 },	/* 11 */
+	{ 0x0246b,  704,  2 },	/* 12 */
+	{ 0x0246c,  706,  2 },	/* 13 */
+	{ 0x0246d,  708,  2 },	/* 14 */
+	{ 0x0246e,  710,  2 },	/* 15 */
+	{ 0x0246f,  712,  2 },	/* 16 */
+	{ 0x02470,  714,  2 },	/* 17 */
+	{ 0x02471,  716,  2 },	/* 18 */
+	{ 0x02472,  718,  2 },	/* 19 */
+	{ 0x02473,  720,  2 },	/* 20 */
+	{ 0x02474,  722,  3 },	/* (1) */
+	{ 0x02475,  725,  3 },	/* (2) */
+	{ 0x02476,  728,  3 },	/* (3) */
+	{ 0x02477,  731,  3 },	/* (4) */
+	{ 0x02478,  734,  3 },	/* (5) */
+	{ 0x02479,  737,  3 },	/* (6) */
+	{ 0x0247a,  740,  3 },	/* (7) */
+	{ 0x0247b,  743,  3 },	/* (8) */
+	{ 0x0247c,  746,  3 },	/* (9) */
+	{ 0x0247d,  749,  4 },	/* (10) */
+	{ 0x0247e,  753,  4 },	/* (11) */
+	{ 0x0247f,  757,  4 },	/* (12) */
+	{ 0x02480,  761,  4 },	/* (13) */
+	{ 0x02481,  765,  4 },	/* (14) */
+	{ 0x02482,  769,  4 },	/* (15) */
+	{ 0x02483,  773,  4 },	/* (16) */
+	{ 0x02484,  777,  4 },	/* (17) */
+	{ 0x02485,  781,  4 },	/* (18) */
+	{ 0x02486,  785,  4 },	/* (19) */
+	{ 0x02487,  789,  4 },	/* (20) */
+	{ 0x02488,  793,  2 },	/* 1. */
+	{ 0x02489,  795,  2 },	/* 2. */
+	{ 0x0248a,  797,  2 },	/* 3. */
+	{ 0x0248b,  799,  2 },	/* 4. */
+	{ 0x0248c,  801,  2 },	/* 5. */
+	{ 0x0248d,  803,  2 },	/* 6. */
+	{ 0x0248e,  805,  2 },	/* 7. */
+	{ 0x0248f,  807,  2 },	/* 8. */
+	{ 0x02490,  809,  2 },	/* 9. */
+	{ 0x02491,  811,  3 },	/* 10. */
+	{ 0x02492,  814,  3 },	/* 11. */
+	{ 0x02493,  817,  3 },	/* 12. */
+	{ 0x02494,  820,  3 },	/* 13. */
+	{ 0x02495,  823,  3 },	/* 14. */
+	{ 0x02496,  826,  3 },	/* 15. */
+	{ 0x02497,  829,  3 },	/* 16. */
+	{ 0x02498,  832,  3 },	/* 17. */
+	{ 0x02499,  835,  3 },	/* 18. */
+	{ 0x0249a,  838,  3 },	/* 19. */
+	{ 0x0249b,  841,  3 },	/* 20. */
+	{ 0x0249c,  844,  3 },	/* (a) */
+	{ 0x0249d,  847,  3 },	/* (b) */
+	{ 0x0249e,  850,  3 },	/* (c) */
+	{ 0x0249f,  853,  3 },	/* (d) */
+	{ 0x024a0,  856,  3 },	/* (e) */
+	{ 0x024a1,  859,  3 },	/* (f) */
+	{ 0x024a2,  862,  3 },	/* (g) */
+	{ 0x024a3,  865,  3 },	/* (h) */
+	{ 0x024a4,  868,  3 },	/* (i) */
+	{ 0x024a5,  871,  3 },	/* (j) */
+	{ 0x024a6,  874,  3 },	/* (k) */
+	{ 0x024a7,  877,  3 },	/* (l) */
+	{ 0x024a8,  880,  3 },	/* (m) */
+	{ 0x024a9,  883,  3 },	/* (n) */
+	{ 0x024aa,  886,  3 },	/* (o) */
+	{ 0x024ab,  889,  3 },	/* (p) */
+	{ 0x024ac,  892,  3 },	/* (q) */
+	{ 0x024ad,  895,  3 },	/* (r) */
+	{ 0x024ae,  898,  3 },	/* (s) */
+	{ 0x024af,  901,  3 },	/* (t) */
+	{ 0x024b0,  904,  3 },	/* (u) */
+	{ 0x024b1,  907,  3 },	/* (v) */
+	{ 0x024b2,  910,  3 },	/* (w) */
+	{ 0x024b3,  913,  3 },	/* (x) */
+	{ 0x024b4,  916,  3 },	/* (y) */
+	{ 0x024b5,  919,  3 },	/* (z) */
+	{ 0x0309b,  922,  4 },
+	{ 0x0309c,  926,  4 },
+	{ 0x0309f,  930,  6 },
+	{ 0x030ff,  936,  6 },
+	{ 0x03164,  942,  0 },	/*  */
+	{ 0x03200,  942,  5 },
+	{ 0x03201,  947,  5 },
+	{ 0x03202,  952,  5 },
+	{ 0x03203,  957,  5 },
+	{ 0x03204,  962,  5 },
+	{ 0x03205,  967,  5 },
+	{ 0x03206,  972,  5 },
+	{ 0x03207,  977,  5 },
+	{ 0x03208,  982,  5 },
+	{ 0x03209,  987,  5 },
+	{ 0x0320a,  992,  5 },
+	{ 0x0320b,  997,  5 },
+	{ 0x0320c, 1002,  5 },
+	{ 0x0320d, 1007,  5 },
+	{ 0x0320e, 1012,  5 },
+	{ 0x0320f, 1017,  5 },
+	{ 0x03210, 1022,  5 },
+	{ 0x03211, 1027,  5 },
+	{ 0x03212, 1032,  5 },
+	{ 0x03213, 1037,  5 },
+	{ 0x03214, 1042,  5 },
+	{ 0x03215, 1047,  5 },
+	{ 0x03216, 1052,  5 },
+	{ 0x03217, 1057,  5 },
+	{ 0x03218, 1062,  5 },
+	{ 0x03219, 1067,  5 },
+	{ 0x0321a, 1072,  5 },
+	{ 0x0321b, 1077,  5 },
+	{ 0x0321c, 1082,  5 },
+	{ 0x0321d, 1087,  8 },
+	{ 0x0321e, 1095,  8 },
+	{ 0x03220, 1103,  5 },
+	{ 0x03221, 1108,  5 },
+	{ 0x03222, 1113,  5 },
+	{ 0x03223, 1118,  5 },
+	{ 0x03224, 1123,  5 },
+	{ 0x03225, 1128,  5 },
+	{ 0x03226, 1133,  5 },
+	{ 0x03227, 1138,  5 },
+	{ 0x03228, 1143,  5 },
+	{ 0x03229, 1148,  5 },
+	{ 0x0322a, 1153,  5 },
+	{ 0x0322b, 1158,  5 },
+	{ 0x0322c, 1163,  5 },
+	{ 0x0322d, 1168,  5 },
+	{ 0x0322e, 1173,  5 },
+	{ 0x0322f, 1178,  5 },
+	{ 0x03230, 1183,  5 },
+	{ 0x03231, 1188,  5 },
+	{ 0x03232, 1193,  5 },
+	{ 0x03233, 1198,  5 },
+	{ 0x03234, 1203,  5 },
+	{ 0x03235, 1208,  5 },
+	{ 0x03236, 1213,  5 },
+	{ 0x03237, 1218,  5 },
+	{ 0x03238, 1223,  5 },
+	{ 0x03239, 1228,  5 },
+	{ 0x0323a, 1233,  5 },
+	{ 0x0323b, 1238,  5 },
+	{ 0x0323c, 1243,  5 },
+	{ 0x0323d, 1248,  5 },
+	{ 0x0323e, 1253,  5 },
+	{ 0x0323f, 1258,  5 },
+	{ 0x03240, 1263,  5 },
+	{ 0x03241, 1268,  5 },
+	{ 0x03242, 1273,  5 },
+	{ 0x03243, 1278,  5 },
+	{ 0x03250, 1283,  3 },	/* pte */
+	{ 0x03251, 1286,  2 },	/* 21 */
+	{ 0x03252, 1288,  2 },	/* 22 */
+	{ 0x03253, 1290,  2 },	/* 23 */
+	{ 0x03254, 1292,  2 },	/* 24 */
+	{ 0x03255, 1294,  2 },	/* 25 */
+	{ 0x03256, 1296,  2 },	/* 26 */
+	{ 0x03257, 1298,  2 },	/* 27 */
+	{ 0x03258, 1300,  2 },	/* 28 */
+	{ 0x03259, 1302,  2 },	/* 29 */
+	{ 0x0325a, 1304,  2 },	/* 30 */
+	{ 0x0325b, 1306,  2 },	/* 31 */
+	{ 0x0325c, 1308,  2 },	/* 32 */
+	{ 0x0325d, 1310,  2 },	/* 33 */
+	{ 0x0325e, 1312,  2 },	/* 34 */
+	{ 0x0325f, 1314,  2 },	/* 35 */
+	{ 0x0327c, 1316,  6 },
+	{ 0x0327d, 1322,  6 },
+	{ 0x032b1, 1328,  2 },	/* 36 */
+	{ 0x032b2, 1330,  2 },	/* 37 */
+	{ 0x032b3, 1332,  2 },	/* 38 */
+	{ 0x032b4, 1334,  2 },	/* 39 */
+	{ 0x032b5, 1336,  2 },	/* 40 */
+	{ 0x032b6, 1338,  2 },	/* 41 */
+	{ 0x032b7, 1340,  2 },	/* 42 */
+	{ 0x032b8, 1342,  2 },	/* 43 */
+	{ 0x032b9, 1344,  2 },	/* 44 */
+	{ 0x032ba, 1346,  2 },	/* 45 */
+	{ 0x032bb, 1348,  2 },	/* 46 */
+	{ 0x032bc, 1350,  2 },	/* 47 */
+	{ 0x032bd, 1352,  2 },	/* 48 */
+	{ 0x032be, 1354,  2 },	/* 49 */
+	{ 0x032bf, 1356,  2 },	/* 50 */
+	{ 0x032c0, 1358,  4 },
+	{ 0x032c1, 1362,  4 },
+	{ 0x032c2, 1366,  4 },
+	{ 0x032c3, 1370,  4 },
+	{ 0x032c4, 1374,  4 },
+	{ 0x032c5, 1378,  4 },
+	{ 0x032c6, 1382,  4 },
+	{ 0x032c7, 1386,  4 },
+	{ 0x032c8, 1390,  4 },
+	{ 0x032c9, 1394,  5 },
+	{ 0x032ca, 1399,  5 },
+	{ 0x032cb, 1404,  5 },
+	{ 0x032cc, 1409,  2 },	/* hg */
+	{ 0x032cd, 1411,  3 },	/* erg */
+	{ 0x032ce, 1414,  2 },	/* ev */
+	{ 0x032cf, 1416,  3 },	/* ltd */
+	{ 0x032ff, 1419,  6 },
+	{ 0x03300, 1425, 12 },
+	{ 0x03301, 1437, 12 },
+	{ 0x03302, 1449, 12 },
+	{ 0x03303, 1461,  9 },
+	{ 0x03304, 1470, 12 },
+	{ 0x03305, 1482,  9 },
+	{ 0x03306, 1491,  9 },
+	{ 0x03307, 1500, 15 },
+	{ 0x03308, 1515, 12 },
+	{ 0x03309, 1527,  9 },
+	{ 0x0330a, 1536,  9 },
+	{ 0x0330b, 1545,  9 },
+	{ 0x0330c, 1554, 12 },
+	{ 0x0330d, 1566, 12 },
+	{ 0x0330e, 1578,  9 },
+	{ 0x0330f, 1587,  9 },
+	{ 0x03310, 1596,  6 },
+	{ 0x03311, 1602,  9 },
+	{ 0x03312, 1611, 12 },
+	{ 0x03313, 1623, 12 },
+	{ 0x03314, 1635,  6 },
+	{ 0x03315, 1641, 15 },
+	{ 0x03316, 1656, 18 },
+	{ 0x03317, 1674, 15 },
+	{ 0x03318, 1689,  9 },
+	{ 0x03319, 1698, 15 },
+	{ 0x0331a, 1713, 15 },
+	{ 0x0331b, 1728, 12 },
+	{ 0x0331c, 1740,  9 },
+	{ 0x0331d, 1749,  9 },
+	{ 0x0331e, 1758,  9 },
+	{ 0x0331f, 1767, 12 },
+	{ 0x03320, 1779, 15 },
+	{ 0x03321, 1794, 12 },
+	{ 0x03322, 1806,  9 },
+	{ 0x03323, 1815,  9 },
+	{ 0x03324, 1824,  9 },
+	{ 0x03325, 1833,  6 },
+	{ 0x03326, 1839,  6 },
+	{ 0x03327, 1845,  6 },
+	{ 0x03328, 1851,  6 },
+	{ 0x03329, 1857,  9 },
+	{ 0x0332a, 1866,  9 },
+	{ 0x0332b, 1875, 15 },
+	{ 0x0332c, 1890,  9 },
+	{ 0x0332d, 1899, 12 },
+	{ 0x0332e, 1911, 15 },
+	{ 0x0332f, 1926,  9 },
+	{ 0x03330, 1935,  6 },
+	{ 0x03331, 1941,  6 },
+	{ 0x03332, 1947, 15 },
+	{ 0x03333, 1962, 12 },
+	{ 0x03334, 1974, 15 },
+	{ 0x03335, 1989,  9 },
+	{ 0x03336, 1998, 15 },
+	{ 0x03337, 2013,  6 },
+	{ 0x03338, 2019,  9 },
+	{ 0x03339, 2028,  9 },
+	{ 0x0333a, 2037,  9 },
+	{ 0x0333b, 2046,  9 },
+	{ 0x0333c, 2055,  9 },
+	{ 0x0333d, 2064, 12 },
+	{ 0x0333e, 2076,  9 },
+	{ 0x0333f, 2085,  6 },
+	{ 0x03340, 2091,  9 },
+	{ 0x03341, 2100,  9 },
+	{ 0x03342, 2109,  9 },
+	{ 0x03343, 2118, 12 },
+	{ 0x03344, 2130,  9 },
+	{ 0x03345, 2139,  9 },
+	{ 0x03346, 2148,  9 },
+	{ 0x03347, 2157, 15 },
+	{ 0x03348, 2172, 12 },
+	{ 0x03349, 2184,  6 },
+	{ 0x0334a, 2190, 15 },
+	{ 0x0334b, 2205,  6 },
+	{ 0x0334c, 2211, 12 },
+	{ 0x0334d, 2223, 12 },
+	{ 0x0334e, 2235,  9 },
+	{ 0x0334f, 2244,  9 },
+	{ 0x03350, 2253,  9 },
+	{ 0x03351, 2262, 12 },
+	{ 0x03352, 2274,  6 },
+	{ 0x03353, 2280,  9 },
+	{ 0x03354, 2289, 12 },
+	{ 0x03355, 2301,  6 },
+	{ 0x03356, 2307, 15 },
+	{ 0x03357, 2322,  9 },
+	{ 0x03358, 2331,  4 },
+	{ 0x03359, 2335,  4 },
+	{ 0x0335a, 2339,  4 },
+	{ 0x0335b, 2343,  4 },
+	{ 0x0335c, 2347,  4 },
+	{ 0x0335d, 2351,  4 },
+	{ 0x0335e, 2355,  4 },
+	{ 0x0335f, 2359,  4 },
+	{ 0x03360, 2363,  4 },
+	{ 0x03361, 2367,  4 },
+	{ 0x03362, 2371,  5 },
+	{ 0x03363, 2376,  5 },
+	{ 0x03364, 2381,  5 },
+	{ 0x03365, 2386,  5 },
+	{ 0x03366, 2391,  5 },
+	{ 0x03367, 2396,  5 },
+	{ 0x03368, 2401,  5 },
+	{ 0x03369, 2406,  5 },
+	{ 0x0336a, 2411,  5 },
+	{ 0x0336b, 2416,  5 },
+	{ 0x0336c, 2421,  5 },
+	{ 0x0336d, 2426,  5 },
+	{ 0x0336e, 2431,  5 },
+	{ 0x0336f, 2436,  5 },
+	{ 0x03370, 2441,  5 },
+	{ 0x03371, 2446,  3 },	/* hpa */
+	{ 0x03372, 2449,  2 },	/* da */
+	{ 0x03373, 2451,  2 },	/* au */
+	{ 0x03374, 2453,  3 },	/* bar */
+	{ 0x03375, 2456,  2 },	/* ov */
+	{ 0x03376, 2458,  2 },	/* pc */
+	{ 0x03377, 2460,  2 },	/* dm */
+	{ 0x03378, 2462,  3 },	/* dm2 */
+	{ 0x03379, 2465,  3 },	/* dm3 */
+	{ 0x0337a, 2468,  2 },	/* iu */
+	{ 0x0337b, 2470,  6 },
+	{ 0x0337c, 2476,  6 },
+	{ 0x0337d, 2482,  6 },
+	{ 0x0337e, 2488,  6 },
+	{ 0x0337f, 2494, 12 },
+	{ 0x03380, 2506,  2 },	/* pa */
+	{ 0x03381, 2508,  2 },	/* na */
+	{ 0x03382, 2510,  3 },
+	{ 0x03383, 2513,  2 },	/* ma */
+	{ 0x03384, 2515,  2 },	/* ka */
+	{ 0x03385, 2517,  2 },	/* kb */
+	{ 0x03386, 2519,  2 },	/* mb */
+	{ 0x03387, 2521,  2 },	/* gb */
+	{ 0x03388, 2523,  3 },	/* cal */
+	{ 0x03389, 2526,  4 },	/* kcal */
+	{ 0x0338a, 2530,  2 },	/* pf */
+	{ 0x0338b, 2532,  2 },	/* nf */
+	{ 0x0338c, 2534,  3 },
+	{ 0x0338d, 2537,  3 },
+	{ 0x0338e, 2540,  2 },	/* mg */
+	{ 0x0338f, 2542,  2 },	/* kg */
+	{ 0x03390, 2544,  2 },	/* hz */
+	{ 0x03391, 2546,  3 },	/* khz */
+	{ 0x03392, 2549,  3 },	/* mhz */
+	{ 0x03393, 2552,  3 },	/* ghz */
+	{ 0x03394, 2555,  3 },	/* thz */
+	{ 0x03395, 2558,  3 },
+	{ 0x03396, 2561,  2 },	/* ml */
+	{ 0x03397, 2563,  2 },	/* dl */
+	{ 0x03398, 2565,  2 },	/* kl */
+	{ 0x03399, 2567,  2 },	/* fm */
+	{ 0x0339a, 2569,  2 },	/* nm */
+	{ 0x0339b, 2571,  3 },
+	{ 0x0339c, 2574,  2 },	/* mm */
+	{ 0x0339d, 2576,  2 },	/* cm */
+	{ 0x0339e, 2578,  2 },	/* km */
+	{ 0x0339f, 2580,  3 },	/* mm2 */
+	{ 0x033a0, 2583,  3 },	/* cm2 */
+	{ 0x033a1, 2586,  2 },	/* m2 */
+	{ 0x033a2, 2588,  3 },	/* km2 */
+	{ 0x033a3, 2591,  3 },	/* mm3 */
+	{ 0x033a4, 2594,  3 },	/* cm3 */
+	{ 0x033a5, 2597,  2 },	/* m3 */
+	{ 0x033a6, 2599,  3 },	/* km3 */
+	{ 0x033a7, 2602,  5 },
+	{ 0x033a8, 2607,  6 },
+	{ 0x033a9, 2613,  2 },	/* pa */
+	{ 0x033aa, 2615,  3 },	/* kpa */
+	{ 0x033ab, 2618,  3 },	/* mpa */
+	{ 0x033ac, 2621,  3 },	/* gpa */
+	{ 0x033ad, 2624,  3 },	/* rad */
+	{ 0x033ae, 2627,  7 },
+	{ 0x033af, 2634,  8 },
+	{ 0x033b0, 2642,  2 },	/* ps */
+	{ 0x033b1, 2644,  2 },	/* ns */
+	{ 0x033b2, 2646,  3 },
+	{ 0x033b3, 2649,  2 },	/* ms */
+	{ 0x033b4, 2651,  2 },	/* pv */
+	{ 0x033b5, 2653,  2 },	/* nv */
+	{ 0x033b6, 2655,  3 },
+	{ 0x033b7, 2658,  2 },	/* mv */
+	{ 0x033b8, 2660,  2 },	/* kv */
+	{ 0x033b9, 2662,  2 },	/* mv */
+	{ 0x033ba, 2664,  2 },	/* pw */
+	{ 0x033bb, 2666,  2 },	/* nw */
+	{ 0x033bc, 2668,  3 },
+	{ 0x033bd, 2671,  2 },	/* mw */
+	{ 0x033be, 2673,  2 },	/* kw */
+	{ 0x033bf, 2675,  2 },	/* mw */
+	{ 0x033c0, 2677,  3 },
+	{ 0x033c1, 2680,  3 },
+	{ 0x033c2, 2683,  4 },	/* a.m. */
+	{ 0x033c3, 2687,  2 },	/* bq */
+	{ 0x033c4, 2689,  2 },	/* cc */
+	{ 0x033c5, 2691,  2 },	/* cd */
+	{ 0x033c6, 2693,  6 },
+	{ 0x033c7, 2699,  3 },	/* co. */
+	{ 0x033c8, 2702,  2 },	/* db */
+	{ 0x033c9, 2704,  2 },	/* gy */
+	{ 0x033ca, 2706,  2 },	/* ha */
+	{ 0x033cb, 2708,  2 },	/* hp */
+	{ 0x033cc, 2710,  2 },	/* in */
+	{ 0x033cd, 2712,  2 },	/* kk */
+	{ 0x033ce, 2714,  2 },	/* km */
+	{ 0x033cf, 2716,  2 },	/* kt */
+	{ 0x033d0, 2718,  2 },	/* lm */
+	{ 0x033d1, 2720,  2 },	/* ln */
+	{ 0x033d2, 2722,  3 },	/* log */
+	{ 0x033d3, 2725,  2 },	/* lx */
+	{ 0x033d4, 2727,  2 },	/* mb */
+	{ 0x033d5, 2729,  3 },	/* mil */
+	{ 0x033d6, 2732,  3 },	/* mol */
+	{ 0x033d7, 2735,  2 },	/* ph */
+	{ 0x033d8, 2737,  4 },	/* p.m. */
+	{ 0x033d9, 2741,  3 },	/* ppm */
+	{ 0x033da, 2744,  2 },	/* pr */
+	{ 0x033db, 2746,  2 },	/* sr */
+	{ 0x033dc, 2748,  2 },	/* sv */
+	{ 0x033dd, 2750,  2 },	/* wb */
+	{ 0x033de, 2752,  5 },
+	{ 0x033df, 2757,  5 },
+	{ 0x033e0, 2762,  4 },
+	{ 0x033e1, 2766,  4 },
+	{ 0x033e2, 2770,  4 },
+	{ 0x033e3, 2774,  4 },
+	{ 0x033e4, 2778,  4 },
+	{ 0x033e5, 2782,  4 },
+	{ 0x033e6, 2786,  4 },
+	{ 0x033e7, 2790,  4 },
+	{ 0x033e8, 2794,  4 },
+	{ 0x033e9, 2798,  5 },
+	{ 0x033ea, 2803,  5 },
+	{ 0x033eb, 2808,  5 },
+	{ 0x033ec, 2813,  5 },
+	{ 0x033ed, 2818,  5 },
+	{ 0x033ee, 2823,  5 },
+	{ 0x033ef, 2828,  5 },
+	{ 0x033f0, 2833,  5 },
+	{ 0x033f1, 2838,  5 },
+	{ 0x033f2, 2843,  5 },
+	{ 0x033f3, 2848,  5 },
+	{ 0x033f4, 2853,  5 },
+	{ 0x033f5, 2858,  5 },
+	{ 0x033f6, 2863,  5 },
+	{ 0x033f7, 2868,  5 },
+	{ 0x033f8, 2873,  5 },
+	{ 0x033f9, 2878,  5 },
+	{ 0x033fa, 2883,  5 },
+	{ 0x033fb, 2888,  5 },
+	{ 0x033fc, 2893,  5 },
+	{ 0x033fd, 2898,  5 },
+	{ 0x033fe, 2903,  5 },
+	{ 0x033ff, 2908,  3 },	/* gal */
+	{ 0x0fb00, 2911,  2 },	/* ff */
+	{ 0x0fb01, 2913,  2 },	/* fi */
+	{ 0x0fb02, 2915,  2 },	/* fl */
+	{ 0x0fb03, 2917,  3 },	/* ffi */
+	{ 0x0fb04, 2920,  3 },	/* ffl */
+	{ 0x0fb05, 2923,  2 },	/* st */
+	{ 0x0fb06, 2925,  2 },	/* st */
+	{ 0x0fb13, 2927,  4 },
+	{ 0x0fb14, 2931,  4 },
+	{ 0x0fb15, 2935,  4 },
+	{ 0x0fb16, 2939,  4 },
+	{ 0x0fb17, 2943,  4 },
+	{ 0x0fe00, 2947,  0 },	/*  */
+	{ 0x0fe01, 2947,  0 },	/*  */
+	{ 0x0fe02, 2947,  0 },	/*  */
+	{ 0x0fe03, 2947,  0 },	/*  */
+	{ 0x0fe04, 2947,  0 },	/*  */
+	{ 0x0fe05, 2947,  0 },	/*  */
+	{ 0x0fe06, 2947,  0 },	/*  */
+	{ 0x0fe07, 2947,  0 },	/*  */
+	{ 0x0fe08, 2947,  0 },	/*  */
+	{ 0x0fe09, 2947,  0 },	/*  */
+	{ 0x0fe0a, 2947,  0 },	/*  */
+	{ 0x0fe0b, 2947,  0 },	/*  */
+	{ 0x0fe0c, 2947,  0 },	/*  */
+	{ 0x0fe0d, 2947,  0 },	/*  */
+	{ 0x0fe0e, 2947,  0 },	/*  */
+	{ 0x0fe0f, 2947,  0 },	/*  */
+	{ 0x0fe19, 2947,  3 },	/* ... */
+	{ 0x0fe30, 2950,  2 },	/* .. */
+	{ 0x0fe49, 2952,  3 },
+	{ 0x0fe4a, 2955,  3 },
+	{ 0x0fe4b, 2958,  3 },
+	{ 0x0fe4c, 2961,  3 },
+	{ 0x0feff, 2964,  0 },	/*  */
+	{ 0x0ffa0, 2964,  0 },	/*  */
+	{ 0x0ffe3, 2964,  3 },
+	{ 0x1f100, 2967,  2 },	/* 0. */
+	{ 0x1f101, 2969,  2 },	/* 0, */
+	{ 0x1f102, 2971,  2 },	/* 1, */
+	{ 0x1f103, 2973,  2 },	/* 2, */
+	{ 0x1f104, 2975,  2 },	/* 3, */
+	{ 0x1f105, 2977,  2 },	/* 4, */
+	{ 0x1f106, 2979,  2 },	/* 5, */
+	{ 0x1f107, 2981,  2 },	/* 6, */
+	{ 0x1f108, 2983,  2 },	/* 7, */
+	{ 0x1f109, 2985,  2 },	/* 8, */
+	{ 0x1f10a, 2987,  2 },	/* 9, */
+	{ 0x1f110, 2989,  3 },	/* (a) */
+	{ 0x1f111, 2992,  3 },	/* (b) */
+	{ 0x1f112, 2995,  3 },	/* (c) */
+	{ 0x1f113, 2998,  3 },	/* (d) */
+	{ 0x1f114, 3001,  3 },	/* (e) */
+	{ 0x1f115, 3004,  3 },	/* (f) */
+	{ 0x1f116, 3007,  3 },	/* (g) */
+	{ 0x1f117, 3010,  3 },	/* (h) */
+	{ 0x1f118, 3013,  3 },	/* (i) */
+	{ 0x1f119, 3016,  3 },	/* (j) */
+	{ 0x1f11a, 3019,  3 },	/* (k) */
+	{ 0x1f11b, 3022,  3 },	/* (l) */
+	{ 0x1f11c, 3025,  3 },	/* (m) */
+	{ 0x1f11d, 3028,  3 },	/* (n) */
+	{ 0x1f11e, 3031,  3 },	/* (o) */
+	{ 0x1f11f, 3034,  3 },	/* (p) */
+	{ 0x1f120, 3037,  3 },	/* (q) */
+	{ 0x1f121, 3040,  3 },	/* (r) */
+	{ 0x1f122, 3043,  3 },	/* (s) */
+	{ 0x1f123, 3046,  3 },	/* (t) */
+	{ 0x1f124, 3049,  3 },	/* (u) */
+	{ 0x1f125, 3052,  3 },	/* (v) */
+	{ 0x1f126, 3055,  3 },	/* (w) */
+	{ 0x1f127, 3058,  3 },	/* (x) */
+	{ 0x1f128, 3061,  3 },	/* (y) */
+	{ 0x1f129, 3064,  3 },	/* (z) */
+	{ 0x1f12a, 3067,  7 },
+	{ 0x1f12d, 3074,  2 },	/* cd */
+	{ 0x1f12e, 3076,  2 },	/* wz */
+	{ 0x1f14a, 3078,  2 },	/* hv */
+	{ 0x1f14b, 3080,  2 },	/* mv */
+	{ 0x1f14c, 3082,  2 },	/* sd */
+	{ 0x1f14d, 3084,  2 },	/* ss */
+	{ 0x1f14e, 3086,  3 },	/* ppv */
+	{ 0x1f14f, 3089,  2 },	/* wc */
+	{ 0x1f16a, 3091,  2 },	/* mc */
+	{ 0x1f16b, 3093,  2 },	/* md */
+	{ 0x1f16c, 3095,  2 },	/* mr */
+	{ 0x1f190, 3097,  2 },	/* dj */
+};
+
+static const char utf8_pool[] =
+	" \314\210 \314\204 \314\201 \314\2471\342\201\20441\342\201\20423"
+	"\342\201\2044ssi\314\207ijijl\302\267l\302\267\312\274nd\305\276d"
+	"\305\276d\305\276ljljljnjnjnjdzdzdz \314\206 \314\207 \314\212 \314"
+	"\250 \314\203 \314\213 \316\271 \314\201 \314\210\314\201\325\245"
+	"\326\202a\312\276ss\341\274\200\316\271\341\274\201\316\271\341\274"
+	"\202\316\271\341\274\203\316\271\341\274\204\316\271\341\274\205\316"
+	"\271\341\274\206\316\271\341\274\207\316\271\341\274\200\316\271\341"
+	"\274\201\316\271\341\274\202\316\271\341\274\203\316\271\341\274\204"
+	"\316\271\341\274\205\316\271\341\274\206\316\271\341\274\207\316\271"
+	"\341\274\240\316\271\341\274\241\316\271\341\274\242\316\271\341\274"
+	"\243\316\271\341\274\244\316\271\341\274\245\316\271\341\274\246\316"
+	"\271\341\274\247\316\271\341\274\240\316\271\341\274\241\316\271\341"
+	"\274\242\316\271\341\274\243\316\271\341\274\244\316\271\341\274\245"
+	"\316\271\341\274\246\316\271\341\274\247\316\271\341\275\240\316\271"
+	"\341\275\241\316\271\341\275\242\316\271\341\275\243\316\271\341\275"
+	"\244\316\271\341\275\245\316\271\341\275\246\316\271\341\275\247\316"
+	"\271\341\275\240\316\271\341\275\241\316\271\341\275\242\316\271\341"
+	"\275\243\316\271\341\275\244\316\271\341\275\245\316\271\341\275\246"
+	"\316\271\341\275\247\316\271\341\275\260\316\271\316\261\316\271\316"
+	"\254\316\271\341\276\266\316\271\316\261\316\271 \314\223 \314\223 "
+	"\315\202 \314\210\315\202\341\275\264\316\271\316\267\316\271\316"
+	"\256\316\271\341\277\206\316\271\316\267\316\271 \314\223\314\200 "
+	"\314\223\314\201 \314\223\315\202 \314\224\314\200 \314\224\314\201 "
+	"\314\224\315\202 \314\210\314\200 \314\210\314\201\341\275\274\316"
+	"\271\317\211\316\271\317\216\316\271\341\277\266\316\271\317\211\316"
+	"\271 \314\201 \314\224 \314\263.....\342\200\262\342\200\262\342\200"
+	"\262\342\200\262\342\200\262\342\200\265\342\200\265\342\200\265\342"
+	"\200\265\342\200\265!! \314\205\077\077\077!!\077\342\200\262\342"
+	"\200\262\342\200\262\342\200\262rsa/ca/s\302\260cc/oc/u\302\260fnosm"
+	"teltmfax1\342\201\20471\342\201\20491\342\201\204101\342\201\20432"
+	"\342\201\20431\342\201\20452\342\201\20453\342\201\20454\342\201\204"
+	"51\342\201\20465\342\201\20461\342\201\20483\342\201\20485\342\201"
+	"\20487\342\201\20481\342\201\204iiiiiivviviiviiiixxixiiiiiiiivviviiv"
+	"iiiixxixii0\342\201\20431011121314151617181920(1)(2)(3)(4)(5)(6)(7)("
+	"8)(9)(10)(11)(12)(13)(14)(15)(16)(17)(18)(19)(20)1.2.3.4.5.6.7.8.9.1"
+	"0.11.12.13.14.15.16.17.18.19.20.(a)(b)(c)(d)(e)(f)(g)(h)(i)(j)(k)(l)"
+	"(m)(n)(o)(p)(q)(r)(s)(t)(u)(v)(w)(x)(y)(z) \343\202\231 \343\202\232"
+	"\343\202\210\343\202\212\343\202\263\343\203\210(\341\204\200)(\341"
+	"\204\202)(\341\204\203)(\341\204\205)(\341\204\206)(\341\204\207)("
+	"\341\204\211)(\341\204\213)(\341\204\214)(\341\204\216)(\341\204\217"
+	")(\341\204\220)(\341\204\221)(\341\204\222)(\352\260\200)(\353\202"
+	"\230)(\353\213\244)(\353\235\274)(\353\247\210)(\353\260\224)(\354"
+	"\202\254)(\354\225\204)(\354\236\220)(\354\260\250)(\354\271\264)("
+	"\355\203\200)(\355\214\214)(\355\225\230)(\354\243\274)(\354\230\244"
+	"\354\240\204)(\354\230\244\355\233\204)(\344\270\200)(\344\272\214)("
+	"\344\270\211)(\345\233\233)(\344\272\224)(\345\205\255)(\344\270\203"
+	")(\345\205\253)(\344\271\235)(\345\215\201)(\346\234\210)(\347\201"
+	"\253)(\346\260\264)(\346\234\250)(\351\207\221)(\345\234\237)(\346"
+	"\227\245)(\346\240\252)(\346\234\211)(\347\244\276)(\345\220\215)("
+	"\347\211\271)(\350\262\241)(\347\245\235)(\345\212\264)(\344\273\243"
+	")(\345\221\274)(\345\255\246)(\347\233\243)(\344\274\201)(\350\263"
+	"\207)(\345\215\224)(\347\245\255)(\344\274\221)(\350\207\252)(\350"
+	"\207\263)pte212223242526272829303132333435\354\260\270\352\263\240"
+	"\354\243\274\354\235\2303637383940414243444546474849501\346\234\2102"
+	"\346\234\2103\346\234\2104\346\234\2105\346\234\2106\346\234\2107"
+	"\346\234\2108\346\234\2109\346\234\21010\346\234\21011\346\234\21012"
+	"\346\234\210hgergevltd\344\273\244\345\222\214\343\202\242\343\203"
+	"\221\343\203\274\343\203\210\343\202\242\343\203\253\343\203\225\343"
+	"\202\241\343\202\242\343\203\263\343\203\232\343\202\242\343\202\242"
+	"\343\203\274\343\203\253\343\202\244\343\203\213\343\203\263\343\202"
+	"\260\343\202\244\343\203\263\343\203\201\343\202\246\343\202\251\343"
+	"\203\263\343\202\250\343\202\271\343\202\257\343\203\274\343\203\211"
+	"\343\202\250\343\203\274\343\202\253\343\203\274\343\202\252\343\203"
+	"\263\343\202\271\343\202\252\343\203\274\343\203\240\343\202\253\343"
+	"\202\244\343\203\252\343\202\253\343\203\251\343\203\203\343\203\210"
+	"\343\202\253\343\203\255\343\203\252\343\203\274\343\202\254\343\203"
+	"\255\343\203\263\343\202\254\343\203\263\343\203\236\343\202\256\343"
+	"\202\254\343\202\256\343\203\213\343\203\274\343\202\255\343\203\245"
+	"\343\203\252\343\203\274\343\202\256\343\203\253\343\203\200\343\203"
+	"\274\343\202\255\343\203\255\343\202\255\343\203\255\343\202\260\343"
+	"\203\251\343\203\240\343\202\255\343\203\255\343\203\241\343\203\274"
+	"\343\203\210\343\203\253\343\202\255\343\203\255\343\203\257\343\203"
+	"\203\343\203\210\343\202\260\343\203\251\343\203\240\343\202\260\343"
+	"\203\251\343\203\240\343\203\210\343\203\263\343\202\257\343\203\253"
+	"\343\202\274\343\202\244\343\203\255\343\202\257\343\203\255\343\203"
+	"\274\343\203\215\343\202\261\343\203\274\343\202\271\343\202\263\343"
+	"\203\253\343\203\212\343\202\263\343\203\274\343\203\235\343\202\265"
+	"\343\202\244\343\202\257\343\203\253\343\202\265\343\203\263\343\203"
+	"\201\343\203\274\343\203\240\343\202\267\343\203\252\343\203\263\343"
+	"\202\260\343\202\273\343\203\263\343\203\201\343\202\273\343\203\263"
+	"\343\203\210\343\203\200\343\203\274\343\202\271\343\203\207\343\202"
+	"\267\343\203\211\343\203\253\343\203\210\343\203\263\343\203\212\343"
+	"\203\216\343\203\216\343\203\203\343\203\210\343\203\217\343\202\244"
+	"\343\203\204\343\203\221\343\203\274\343\202\273\343\203\263\343\203"
+	"\210\343\203\221\343\203\274\343\203\204\343\203\220\343\203\274\343"
+	"\203\254\343\203\253\343\203\224\343\202\242\343\202\271\343\203\210"
+	"\343\203\253\343\203\224\343\202\257\343\203\253\343\203\224\343\202"
+	"\263\343\203\223\343\203\253\343\203\225\343\202\241\343\203\251\343"
+	"\203\203\343\203\211\343\203\225\343\202\243\343\203\274\343\203\210"
+	"\343\203\226\343\203\203\343\202\267\343\202\247\343\203\253\343\203"
+	"\225\343\203\251\343\203\263\343\203\230\343\202\257\343\202\277\343"
+	"\203\274\343\203\253\343\203\232\343\202\275\343\203\232\343\203\213"
+	"\343\203\222\343\203\230\343\203\253\343\203\204\343\203\232\343\203"
+	"\263\343\202\271\343\203\232\343\203\274\343\202\270\343\203\231\343"
+	"\203\274\343\202\277\343\203\235\343\202\244\343\203\263\343\203\210"
+	"\343\203\234\343\203\253\343\203\210\343\203\233\343\203\263\343\203"
+	"\235\343\203\263\343\203\211\343\203\233\343\203\274\343\203\253\343"
+	"\203\233\343\203\274\343\203\263\343\203\236\343\202\244\343\202\257"
+	"\343\203\255\343\203\236\343\202\244\343\203\253\343\203\236\343\203"
+	"\203\343\203\217\343\203\236\343\203\253\343\202\257\343\203\236\343"
+	"\203\263\343\202\267\343\203\247\343\203\263\343\203\237\343\202\257"
+	"\343\203\255\343\203\263\343\203\237\343\203\252\343\203\237\343\203"
+	"\252\343\203\220\343\203\274\343\203\253\343\203\241\343\202\254\343"
+	"\203\241\343\202\254\343\203\210\343\203\263\343\203\241\343\203\274"
+	"\343\203\210\343\203\253\343\203\244\343\203\274\343\203\211\343\203"
+	"\244\343\203\274\343\203\253\343\203\246\343\202\242\343\203\263\343"
+	"\203\252\343\203\203\343\203\210\343\203\253\343\203\252\343\203\251"
+	"\343\203\253\343\203\224\343\203\274\343\203\253\343\203\274\343\203"
+	"\226\343\203\253\343\203\254\343\203\240\343\203\254\343\203\263\343"
+	"\203\210\343\202\262\343\203\263\343\203\257\343\203\203\343\203\210"
+	"0\347\202\2711\347\202\2712\347\202\2713\347\202\2714\347\202\2715"
+	"\347\202\2716\347\202\2717\347\202\2718\347\202\2719\347\202\27110"
+	"\347\202\27111\347\202\27112\347\202\27113\347\202\27114\347\202\271"
+	"15\347\202\27116\347\202\27117\347\202\27118\347\202\27119\347\202"
+	"\27120\347\202\27121\347\202\27122\347\202\27123\347\202\27124\347"
+	"\202\271hpadaaubarovpcdmdm2dm3iu\345\271\263\346\210\220\346\230\255"
+	"\345\222\214\345\244\247\346\255\243\346\230\216\346\262\273\346\240"
+	"\252\345\274\217\344\274\232\347\244\276pana\316\274amakakbmbgbcalkc"
+	"alpfnf\316\274f\316\274gmgkghzkhzmhzghzthz\316\274lmldlklfmnm\316"
+	"\274mmmcmkmmm2cm2m2km2mm3cm3m3km3m\342\210\225sm\342\210\225s2pakpam"
+	"pagparadrad\342\210\225srad\342\210\225s2psns\316\274smspvnv\316\274"
+	"vmvkvmvpwnw\316\274wmwkwmwk\317\211m\317\211a.m.bqcccdc\342\210\225k"
+	"gco.dbgyhahpinkkkmktlmlnloglxmbmilmolphp.m.ppmprsrsvwbv\342\210\225m"
+	"a\342\210\225m1\346\227\2452\346\227\2453\346\227\2454\346\227\2455"
+	"\346\227\2456\346\227\2457\346\227\2458\346\227\2459\346\227\24510"
+	"\346\227\24511\346\227\24512\346\227\24513\346\227\24514\346\227\245"
+	"15\346\227\24516\346\227\24517\346\227\24518\346\227\24519\346\227"
+	"\24520\346\227\24521\346\227\24522\346\227\24523\346\227\24524\346"
+	"\227\24525\346\227\24526\346\227\24527\346\227\24528\346\227\24529"
+	"\346\227\24530\346\227\24531\346\227\245galfffiflffifflstst\325\264"
+	"\325\266\325\264\325\245\325\264\325\253\325\276\325\266\325\264\325"
+	"\255..... \314\205 \314\205 \314\205 \314\205 \314\2040.0,1,2,3,4,5,"
+	"6,7,8,9,(a)(b)(c)(d)(e)(f)(g)(h)(i)(j)(k)(l)(m)(n)(o)(p)(q)(r)(s)(t)"
+	"(u)(v)(w)(x)(y)(z)\343\200\224s\343\200\225cdwzhvmvsdssppvwcmcmdmrdj";
+
+static const struct utf8_comp {
+	uint32_t	 base;
+	uint32_t	 mark;
+	uint32_t	 comp;
+} utf8_comps[] = {
+	{ 0x0061, 0x0300, 0x00e0 },
+	{ 0x0061, 0x0301, 0x00e1 },
+	{ 0x0061, 0x0302, 0x00e2 },
+	{ 0x0061, 0x0303, 0x00e3 },
+	{ 0x0061, 0x0304, 0x0101 },
+	{ 0x0061, 0x0306, 0x0103 },
+	{ 0x0061, 0x0307, 0x0227 },
+	{ 0x0061, 0x0308, 0x00e4 },
+	{ 0x0061, 0x0309, 0x1ea3 },
+	{ 0x0061, 0x030a, 0x00e5 },
+	{ 0x0061, 0x030c, 0x01ce },
+	{ 0x0061, 0x030f, 0x0201 },
+	{ 0x0061, 0x0311, 0x0203 },
+	{ 0x0061, 0x0323, 0x1ea1 },
+	{ 0x0061, 0x0325, 0x1e01 },
+	{ 0x0061, 0x0328, 0x0105 },
+	{ 0x0062, 0x0307, 0x1e03 },
+	{ 0x0062, 0x0323, 0x1e05 },
+	{ 0x0062, 0x0331, 0x1e07 },
+	{ 0x0063, 0x0301, 0x0107 },
+	{ 0x0063, 0x0302, 0x0109 },
+	{ 0x0063, 0x0307, 0x010b },
+	{ 0x0063, 0x030c, 0x010d },
+	{ 0x0063, 0x0327, 0x00e7 },
+	{ 0x0064, 0x0307, 0x1e0b },
+	{ 0x0064, 0x030c, 0x010f },
+	{ 0x0064, 0x0323, 0x1e0d },
+	{ 0x0064, 0x0327, 0x1e11 },
+	{ 0x0064, 0x032d, 0x1e13 },
+	{ 0x0064, 0x0331, 0x1e0f },
+	{ 0x0065, 0x0300, 0x00e8 },
+	{ 0x0065, 0x0301, 0x00e9 },
+	{ 0x0065, 0x0302, 0x00ea },
+	{ 0x0065, 0x0303, 0x1ebd },
+	{ 0x0065, 0x0304, 0x0113 },
+	{ 0x0065, 0x0306, 0x0115 },
+	{ 0x0065, 0x0307, 0x0117 },
+	{ 0x0065, 0x0308, 0x00eb },
+	{ 0x0065, 0x0309, 0x1ebb },
+	{ 0x0065, 0x030c, 0x011b },
+	{ 0x0065, 0x030f, 0x0205 },
+	{ 0x0065, 0x0311, 0x0207 },
+	{ 0x0065, 0x0323, 0x1eb9 },
+	{ 0x0065, 0x0327, 0x0229 },
+	{ 0x0065, 0x0328, 0x0119 },
+	{ 0x0065, 0x032d, 0x1e19 },
+	{ 0x0065, 0x0330, 0x1e1b },
+	{ 0x0066, 0x0307, 0x1e1f },
+	{ 0x0067, 0x0301, 0x01f5 },
+	{ 0x0067, 0x0302, 0x011d },
+	{ 0x0067, 0x0304, 0x1e21 },
+	{ 0x0067, 0x0306, 0x011f },
+	{ 0x0067, 0x0307, 0x0121 },
+	{ 0x0067, 0x030c, 0x01e7 },
+	{ 0x0067, 0x0327, 0x0123 },
+	{ 0x0068, 0x0302, 0x0125 },
+	{ 0x0068, 0x0307, 0x1e23 },
+	{ 0x0068, 0x0308, 0x1e27 },
+	{ 0x0068, 0x030c, 0x021f },
+	{ 0x0068, 0x0323, 0x1e25 },
+	{ 0x0068, 0x0327, 0x1e29 },
+	{ 0x0068, 0x032e, 0x1e2b },
+	{ 0x0068, 0x0331, 0x1e96 },
+	{ 0x0069, 0x0300, 0x00ec },
+	{ 0x0069, 0x0301, 0x00ed },
+	{ 0x0069, 0x0302, 0x00ee },
+	{ 0x0069, 0x0303, 0x0129 },
+	{ 0x0069, 0x0304, 0x012b },
+	{ 0x0069, 0x0306, 0x012d },
+	{ 0x0069, 0x0308, 0x00ef },
+	{ 0x0069, 0x0309, 0x1ec9 },
+	{ 0x0069, 0x030c, 0x01d0 },
+	{ 0x0069, 0x030f, 0x0209 },
+	{ 0x0069, 0x0311, 0x020b },
+	{ 0x0069, 0x0323, 0x1ecb },
+	{ 0x0069, 0x0328, 0x012f },
+	{ 0x0069, 0x0330, 0x1e2d },
+	{ 0x006a, 0x0302, 0x0135 },
+	{ 0x006a, 0x030c, 0x01f0 },
+	{ 0x006b, 0x0301, 0x1e31 },
+	{ 0x006b, 0x030c, 0x01e9 },
+	{ 0x006b, 0x0323, 0x1e33 },
+	{ 0x006b, 0x0327, 0x0137 },
+	{ 0x006b, 0x0331, 0x1e35 },
+	{ 0x006c, 0x0301, 0x013a },
+	{ 0x006c, 0x030c, 0x013e },
+	{ 0x006c, 0x0323, 0x1e37 },
+	{ 0x006c, 0x0327, 0x013c },
+	{ 0x006c, 0x032d, 0x1e3d },
+	{ 0x006c, 0x0331, 0x1e3b },
+	{ 0x006d, 0x0301, 0x1e3f },
+	{ 0x006d, 0x0307, 0x1e41 },
+	{ 0x006d, 0x0323, 0x1e43 },
+	{ 0x006e, 0x0300, 0x01f9 },
+	{ 0x006e, 0x0301, 0x0144 },
+	{ 0x006e, 0x0303, 0x00f1 },
+	{ 0x006e, 0x0307, 0x1e45 },
+	{ 0x006e, 0x030c, 0x0148 },
+	{ 0x006e, 0x0323, 0x1e47 },
+	{ 0x006e, 0x0327, 0x0146 },
+	{ 0x006e, 0x032d, 0x1e4b },
+	{ 0x006e, 0x0331, 0x1e49 },
+	{ 0x006f, 0x0300, 0x00f2 },
+	{ 0x006f, 0x0301, 0x00f3 },
+	{ 0x006f, 0x0302, 0x00f4 },
+	{ 0x006f, 0x0303, 0x00f5 },
+	{ 0x006f, 0x0304, 0x014d },
+	{ 0x006f, 0x0306, 0x014f },
+	{ 0x006f, 0x0307, 0x022f },
+	{ 0x006f, 0x0308, 0x00f6 },
+	{ 0x006f, 0x0309, 0x1ecf },
+	{ 0x006f, 0x030b, 0x0151 },
+	{ 0x006f, 0x030c, 0x01d2 },
+	{ 0x006f, 0x030f, 0x020d },
+	{ 0x006f, 0x0311, 0x020f },
+	{ 0x006f, 0x031b, 0x01a1 },
+	{ 0x006f, 0x0323, 0x1ecd },
+	{ 0x006f, 0x0328, 0x01eb },
+	{ 0x0070, 0x0301, 0x1e55 },
+	{ 0x0070, 0x0307, 0x1e57 },
+	{ 0x0072, 0x0301, 0x0155 },
+	{ 0x0072, 0x0307, 0x1e59 },
+	{ 0x0072, 0x030c, 0x0159 },
+	{ 0x0072, 0x030f, 0x0211 },
+	{ 0x0072, 0x0311, 0x0213 },
+	{ 0x0072, 0x0323, 0x1e5b },
+	{ 0x0072, 0x0327, 0x0157 },
+	{ 0x0072, 0x0331, 0x1e5f },
+	{ 0x0073, 0x0301, 0x015b },
+	{ 0x0073, 0x0302, 0x015d },
+	{ 0x0073, 0x0307, 0x1e61 },
+	{ 0x0073, 0x030c, 0x0161 },
+	{ 0x0073, 0x0323, 0x1e63 },
+	{ 0x0073, 0x0326, 0x0219 },
+	{ 0x0073, 0x0327, 0x015f },
+	{ 0x0074, 0x0307, 0x1e6b },
+	{ 0x0074, 0x0308, 0x1e97 },
+	{ 0x0074, 0x030c, 0x0165 },
+	{ 0x0074, 0x0323, 0x1e6d },
+	{ 0x0074, 0x0326, 0x021b },
+	{ 0x0074, 0x0327, 0x0163 },
+	{ 0x0074, 0x032d, 0x1e71 },
+	{ 0x0074, 0x0331, 0x1e6f },
+	{ 0x0075, 0x0300, 0x00f9 },
+	{ 0x0075, 0x0301, 0x00fa },
+	{ 0x0075, 0x0302, 0x00fb },
+	{ 0x0075, 0x0303, 0x0169 },
+	{ 0x0075, 0x0304, 0x016b },
+	{ 0x0075, 0x0306, 0x016d },
+	{ 0x0075, 0x0308, 0x00fc },
+	{ 0x0075, 0x0309, 0x1ee7 },
+	{ 0x0075, 0x030a, 0x016f },
+	{ 0x0075, 0x030b, 0x0171 },
+	{ 0x0075, 0x030c, 0x01d4 },
+	{ 0x0075, 0x030f, 0x0215 },
+	{ 0x0075, 0x0311, 0x0217 },
+	{ 0x0075, 0x031b, 0x01b0 },
+	{ 0x0075, 0x0323, 0x1ee5 },
+	{ 0x0075, 0x0324, 0x1e73 },
+	{ 0x0075, 0x0328, 0x0173 },
+	{ 0x0075, 0x032d, 0x1e77 },
+	{ 0x0075, 0x0330, 0x1e75 },
+	{ 0x0076, 0x0303, 0x1e7d },
+	{ 0x0076, 0x0323, 0x1e7f },
+	{ 0x0077, 0x0300, 0x1e81 },
+	{ 0x0077, 0x0301, 0x1e83 },
+	{ 0x0077, 0x0302, 0x0175 },
+	{ 0x0077, 0x0307, 0x1e87 },
+	{ 0x0077, 0x0308, 0x1e85 },
+	{ 0x0077, 0x030a, 0x1e98 },
+	{ 0x0077, 0x0323, 0x1e89 },
+	{ 0x0078, 0x0307, 0x1e8b },
+	{ 0x0078, 0x0308, 0x1e8d },
+	{ 0x0079, 0x0300, 0x1ef3 },
+	{ 0x0079, 0x0301, 0x00fd },
+	{ 0x0079, 0x0302, 0x0177 },
+	{ 0x0079, 0x0303, 0x1ef9 },
+	{ 0x0079, 0x0304, 0x0233 },
+	{ 0x0079, 0x0307, 0x1e8f },
+	{ 0x0079, 0x0308, 0x00ff },
+	{ 0x0079, 0x0309, 0x1ef7 },
+	{ 0x0079, 0x030a, 0x1e99 },
+	{ 0x0079, 0x0323, 0x1ef5 },
+	{ 0x007a, 0x0301, 0x017a },
+	{ 0x007a, 0x0302, 0x1e91 },
+	{ 0x007a, 0x0307, 0x017c },
+	{ 0x007a, 0x030c, 0x017e },
+	{ 0x007a, 0x0323, 0x1e93 },
+	{ 0x007a, 0x0331, 0x1e95 },
+	{ 0x00e2, 0x0300, 0x1ea7 },
+	{ 0x00e2, 0x0301, 0x1ea5 },
+	{ 0x00e2, 0x0303, 0x1eab },
+	{ 0x00e2, 0x0309, 0x1ea9 },
+	{ 0x00e4, 0x0304, 0x01df },
+	{ 0x00e5, 0x0301, 0x01fb },
+	{ 0x00e6, 0x0301, 0x01fd },
+	{ 0x00e6, 0x0304, 0x01e3 },
+	{ 0x00e7, 0x0301, 0x1e09 },
+	{ 0x00ea, 0x0300, 0x1ec1 },
+	{ 0x00ea, 0x0301, 0x1ebf },
+	{ 0x00ea, 0x0303, 0x1ec5 },
+	{ 0x00ea, 0x0309, 0x1ec3 },
+	{ 0x00ef, 0x0301, 0x1e2f },
+	{ 0x00f4, 0x0300, 0x1ed3 },
+	{ 0x00f4, 0x0301, 0x1ed1 },
+	{ 0x00f4, 0x0303, 0x1ed7 },
+	{ 0x00f4, 0x0309, 0x1ed5 },
+	{ 0x00f5, 0x0301, 0x1e4d },
+	{ 0x00f5, 0x0304, 0x022d },
+	{ 0x00f5, 0x0308, 0x1e4f },
+	{ 0x00f6, 0x0304, 0x022b },
+	{ 0x00f8, 0x0301, 0x01ff },
+	{ 0x00fc, 0x0300, 0x01dc },
+	{ 0x00fc, 0x0301, 0x01d8 },
+	{ 0x00fc, 0x0304, 0x01d6 },
+	{ 0x00fc, 0x030c, 0x01da },
+	{ 0x0103, 0x0300, 0x1eb1 },
+	{ 0x0103, 0x0301, 0x1eaf },
+	{ 0x0103, 0x0303, 0x1eb5 },
+	{ 0x0103, 0x0309, 0x1eb3 },
+	{ 0x0113, 0x0300, 0x1e15 },
+	{ 0x0113, 0x0301, 0x1e17 },
+	{ 0x014d, 0x0300, 0x1e51 },
+	{ 0x014d, 0x0301, 0x1e53 },
+	{ 0x015b, 0x0307, 0x1e65 },
+	{ 0x0161, 0x0307, 0x1e67 },
+	{ 0x0169, 0x0301, 0x1e79 },
+	{ 0x016b, 0x0308, 0x1e7b },
+	{ 0x01a1, 0x0300, 0x1edd },
+	{ 0x01a1, 0x0301, 0x1edb },
+	{ 0x01a1, 0x0303, 0x1ee1 },
+	{ 0x01a1, 0x0309, 0x1edf },
+	{ 0x01a1, 0x0323, 0x1ee3 },
+	{ 0x01b0, 0x0300, 0x1eeb },
+	{ 0x01b0, 0x0301, 0x1ee9 },
+	{ 0x01b0, 0x0303, 0x1eef },
+	{ 0x01b0, 0x0309, 0x1eed },
+	{ 0x01b0, 0x0323, 0x1ef1 },
+	{ 0x01eb, 0x0304, 0x01ed },
+	{ 0x0227, 0x0304, 0x01e1 },
+	{ 0x0229, 0x0306, 0x1e1d },
+	{ 0x022f, 0x0304, 0x0231 },
+	{ 0x0292, 0x030c, 0x01ef },
+	{ 0x03b1, 0x0300, 0x1f70 },
+	{ 0x03b1, 0x0301, 0x03ac },
+	{ 0x03b1, 0x0304, 0x1fb1 },
+	{ 0x03b1, 0x0306, 0x1fb0 },
+	{ 0x03b1, 0x0313, 0x1f00 },
+	{ 0x03b1, 0x0314, 0x1f01 },
+	{ 0x03b1, 0x0342, 0x1fb6 },
+	{ 0x03b5, 0x0300, 0x1f72 },
+	{ 0x03b5, 0x0301, 0x03ad },
+	{ 0x03b5, 0x0313, 0x1f10 },
+	{ 0x03b5, 0x0314, 0x1f11 },
+	{ 0x03b7, 0x0300, 0x1f74 },
+	{ 0x03b7, 0x0301, 0x03ae },
+	{ 0x03b7, 0x0313, 0x1f20 },
+	{ 0x03b7, 0x0314, 0x1f21 },
+	{ 0x03b7, 0x0342, 0x1fc6 },
+	{ 0x03b9, 0x0300, 0x1f76 },
+	{ 0x03b9, 0x0301, 0x03af },
+	{ 0x03b9, 0x0304, 0x1fd1 },
+	{ 0x03b9, 0x0306, 0x1fd0 },
+	{ 0x03b9, 0x0308, 0x03ca },
+	{ 0x03b9, 0x0313, 0x1f30 },
+	{ 0x03b9, 0x0314, 0x1f31 },
+	{ 0x03b9, 0x0342, 0x1fd6 },
+	{ 0x03bf, 0x0300, 0x1f78 },
+	{ 0x03bf, 0x0301, 0x03cc },
+	{ 0x03bf, 0x0313, 0x1f40 },
+	{ 0x03bf, 0x0314, 0x1f41 },
+	{ 0x03c1, 0x0313, 0x1fe4 },
+	{ 0x03c1, 0x0314, 0x1fe5 },
+	{ 0x03c5, 0x0300, 0x1f7a },
+	{ 0x03c5, 0x0301, 0x03cd },
+	{ 0x03c5, 0x0304, 0x1fe1 },
+	{ 0x03c5, 0x0306, 0x1fe0 },
+	{ 0x03c5, 0x0308, 0x03cb },
+	{ 0x03c5, 0x0313, 0x1f50 },
+	{ 0x03c5, 0x0314, 0x1f51 },
+	{ 0x03c5, 0x0342, 0x1fe6 },
+	{ 0x03c9, 0x0300, 0x1f7c },
+	{ 0x03c9, 0x0301, 0x03ce },
+	{ 0x03c9, 0x0313, 0x1f60 },
+	{ 0x03c9, 0x0314, 0x1f61 },
+	{ 0x03c9, 0x0342, 0x1ff6 },
+	{ 0x03ca, 0x0300, 0x1fd2 },
+	{ 0x03ca, 0x0301, 0x0390 },
+	{ 0x03ca, 0x0342, 0x1fd7 },
+	{ 0x03cb, 0x0300, 0x1fe2 },
+	{ 0x03cb, 0x0301, 0x03b0 },
+	{ 0x03cb, 0x0342, 0x1fe7 },
+	{ 0x0430, 0x0306, 0x04d1 },
+	{ 0x0430, 0x0308, 0x04d3 },
+	{ 0x0433, 0x0301, 0x0453 },
+	{ 0x0435, 0x0300, 0x0450 },
+	{ 0x0435, 0x0306, 0x04d7 },
+	{ 0x0435, 0x0308, 0x0451 },
+	{ 0x0436, 0x0306, 0x04c2 },
+	{ 0x0436, 0x0308, 0x04dd },
+	{ 0x0437, 0x0308, 0x04df },
+	{ 0x0438, 0x0300, 0x045d },
+	{ 0x0438, 0x0304, 0x04e3 },
+	{ 0x0438, 0x0306, 0x0439 },
+	{ 0x0438, 0x0308, 0x04e5 },
+	{ 0x043a, 0x0301, 0x045c },
+	{ 0x043e, 0x0308, 0x04e7 },
+	{ 0x0443, 0x0304, 0x04ef },
+	{ 0x0443, 0x0306, 0x045e },
+	{ 0x0443, 0x0308, 0x04f1 },
+	{ 0x0443, 0x030b, 0x04f3 },
+	{ 0x0447, 0x0308, 0x04f5 },
+	{ 0x044b, 0x0308, 0x04f9 },
+	{ 0x044d, 0x0308, 0x04ed },
+	{ 0x0456, 0x0308, 0x0457 },
+	{ 0x0475, 0x030f, 0x0477 },
+	{ 0x04d9, 0x0308, 0x04db },
+	{ 0x04e9, 0x0308, 0x04eb },
+	{ 0x1e37, 0x0304, 0x1e39 },
+	{ 0x1e5b, 0x0304, 0x1e5d },
+	{ 0x1e63, 0x0307, 0x1e69 },
+	{ 0x1ea1, 0x0302, 0x1ead },
+	{ 0x1ea1, 0x0306, 0x1eb7 },
+	{ 0x1eb9, 0x0302, 0x1ec7 },
+	{ 0x1ecd, 0x0302, 0x1ed9 },
+	{ 0x1f00, 0x0300, 0x1f02 },
+	{ 0x1f00, 0x0301, 0x1f04 },
+	{ 0x1f00, 0x0342, 0x1f06 },
+	{ 0x1f01, 0x0300, 0x1f03 },
+	{ 0x1f01, 0x0301, 0x1f05 },
+	{ 0x1f01, 0x0342, 0x1f07 },
+	{ 0x1f10, 0x0300, 0x1f12 },
+	{ 0x1f10, 0x0301, 0x1f14 },
+	{ 0x1f11, 0x0300, 0x1f13 },
+	{ 0x1f11, 0x0301, 0x1f15 },
+	{ 0x1f20, 0x0300, 0x1f22 },
+	{ 0x1f20, 0x0301, 0x1f24 },
+	{ 0x1f20, 0x0342, 0x1f26 },
+	{ 0x1f21, 0x0300, 0x1f23 },
+	{ 0x1f21, 0x0301, 0x1f25 },
+	{ 0x1f21, 0x0342, 0x1f27 },
+	{ 0x1f30, 0x0300, 0x1f32 },
+	{ 0x1f30, 0x0301, 0x1f34 },
+	{ 0x1f30, 0x0342, 0x1f36 },
+	{ 0x1f31, 0x0300, 0x1f33 },
+	{ 0x1f31, 0x0301, 0x1f35 },
+	{ 0x1f31, 0x0342, 0x1f37 },
+	{ 0x1f40, 0x0300, 0x1f42 },
+	{ 0x1f40, 0x0301, 0x1f44 },
+	{ 0x1f41, 0x0300, 0x1f43 },
+	{ 0x1f41, 0x0301, 0x1f45 },
+	{ 0x1f50, 0x0300, 0x1f52 },
+	{ 0x1f50, 0x0301, 0x1f54 },
+	{ 0x1f50, 0x0342, 0x1f56 },
+	{ 0x1f51, 0x0300, 0x1f53 },
+	{ 0x1f51, 0x0301, 0x1f55 },
+	{ 0x1f51, 0x0342, 0x1f57 },
+	{ 0x1f60, 0x0300, 0x1f62 },
+	{ 0x1f60, 0x0301, 0x1f64 },
+	{ 0x1f60, 0x0342, 0x1f66 },
+	{ 0x1f61, 0x0300, 0x1f63 },
+	{ 0x1f61, 0x0301, 0x1f65 },
+	{ 0x1f61, 0x0342, 0x1f67 },
+	{ 0x3046, 0x3099, 0x3094 },
+	{ 0x304b, 0x3099, 0x304c },
+	{ 0x304d, 0x3099, 0x304e },
+	{ 0x304f, 0x3099, 0x3050 },
+	{ 0x3051, 0x3099, 0x3052 },
+	{ 0x3053, 0x3099, 0x3054 },
+	{ 0x3055, 0x3099, 0x3056 },
+	{ 0x3057, 0x3099, 0x3058 },
+	{ 0x3059, 0x3099, 0x305a },
+	{ 0x305b, 0x3099, 0x305c },
+	{ 0x305d, 0x3099, 0x305e },
+	{ 0x305f, 0x3099, 0x3060 },
+	{ 0x3061, 0x3099, 0x3062 },
+	{ 0x3064, 0x3099, 0x3065 },
+	{ 0x3066, 0x3099, 0x3067 },
+	{ 0x3068, 0x3099, 0x3069 },
+	{ 0x306f, 0x3099, 0x3070 },
+	{ 0x306f, 0x309a, 0x3071 },
+	{ 0x3072, 0x3099, 0x3073 },
+	{ 0x3072, 0x309a, 0x3074 },
+	{ 0x3075, 0x3099, 0x3076 },
+	{ 0x3075, 0x309a, 0x3077 },
+	{ 0x3078, 0x3099, 0x3079 },
+	{ 0x3078, 0x309a, 0x307a },
+	{ 0x307b, 0x3099, 0x307c },
+	{ 0x307b, 0x309a, 0x307d },
+	{ 0x309d, 0x3099, 0x309e },
+	{ 0x30a6, 0x3099, 0x30f4 },
+	{ 0x30ab, 0x3099, 0x30ac },
+	{ 0x30ad, 0x3099, 0x30ae },
+	{ 0x30af, 0x3099, 0x30b0 },
+	{ 0x30b1, 0x3099, 0x30b2 },
+	{ 0x30b3, 0x3099, 0x30b4 },
+	{ 0x30b5, 0x3099, 0x30b6 },
+	{ 0x30b7, 0x3099, 0x30b8 },
+	{ 0x30b9, 0x3099, 0x30ba },
+	{ 0x30bb, 0x3099, 0x30bc },
+	{ 0x30bd, 0x3099, 0x30be },
+	{ 0x30bf, 0x3099, 0x30c0 },
+	{ 0x30c1, 0x3099, 0x30c2 },
+	{ 0x30c4, 0x3099, 0x30c5 },
+	{ 0x30c6, 0x3099, 0x30c7 },
+	{ 0x30c8, 0x3099, 0x30c9 },
+	{ 0x30cf, 0x3099, 0x30d0 },
+	{ 0x30cf, 0x309a, 0x30d1 },
+	{ 0x30d2, 0x3099, 0x30d3 },
+	{ 0x30d2, 0x309a, 0x30d4 },
+	{ 0x30d5, 0x3099, 0x30d6 },
+	{ 0x30d5, 0x309a, 0x30d7 },
+	{ 0x30d8, 0x3099, 0x30d9 },
+	{ 0x30d8, 0x309a, 0x30da },
+	{ 0x30db, 0x3099, 0x30dc },
+	{ 0x30db, 0x309a, 0x30dd },
+	{ 0x30ef, 0x3099, 0x30f7 },
+	{ 0x30f0, 0x3099, 0x30f8 },
+	{ 0x30f1, 0x3099, 0x30f9 },
+	{ 0x30f2, 0x3099, 0x30fa },
+	{ 0x30fd, 0x3099, 0x30fe },
+};